@@ -25,6 +25,7 @@ doc_files=(
 	'Inflight Adjustments.md'
 	'Controls.md'
 	'Gtune.md'
+	'Autotune.md'
 	'Blackbox.md'
 	'Migrating from baseflight.md'
 	'Boards.md'
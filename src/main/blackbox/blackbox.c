@@ -41,6 +41,7 @@
 
 #include "fc/rate_profile.h"
 #include "fc/rc_controls.h"
+#include "fc/rc_latency.h"
 
 #include "sensors/sensors.h"
 #include "sensors/boardalignment.h"
@@ -253,7 +254,15 @@ static const blackboxSimpleFieldDefinition_t blackboxSlowFields[] = {
 
     {"failsafePhase",         -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)},
     {"rxSignalReceived",      -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)},
-    {"rxFlightChannelsValid", -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)}
+    {"rxFlightChannelsValid", -1, UNSIGNED, PREDICT(0),      ENCODING(TAG2_3S32)},
+
+    {"accClipCount",          -1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
+    {"accVibration",           0, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
+    {"accVibration",           1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
+    {"accVibration",           2, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
+    {"accHealth",             -1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
+    {"rcLatency",             -1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)},
+    {"rcLatencyMax",          -1, UNSIGNED, PREDICT(0),      ENCODING(UNSIGNED_VB)}
 };
 
 typedef enum BlackboxState {
@@ -312,8 +321,17 @@ typedef struct blackboxSlowState_s {
     uint8_t failsafePhase;
     bool rxSignalReceived;
     bool rxFlightChannelsValid;
+    uint32_t accClipCount;
+
+    // These change continuously so they don't trigger a slow frame by themselves, see SLOW_STATE_COMPARE_SIZE
+    uint16_t accVibration[XYZ_AXIS_COUNT];
+    uint8_t accHealth;
+    uint16_t rcLatencyAverage;
+    uint16_t rcLatencyMax;
 } __attribute__((__packed__)) blackboxSlowState_t; // We pack this struct so that padding doesn't interfere with memcmp()
 
+#define SLOW_STATE_COMPARE_SIZE offsetof(blackboxSlowState_t, accVibration)
+
 //From mixer.c:
 extern uint8_t motorCount;
 
@@ -725,6 +743,14 @@ static void writeSlowFrame(void)
     values[2] = slowHistory.rxFlightChannelsValid ? 1 : 0;
     blackboxWriteTag2_3S32(values);
 
+    blackboxWriteUnsignedVB(slowHistory.accClipCount);
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        blackboxWriteUnsignedVB(slowHistory.accVibration[i]);
+    }
+    blackboxWriteUnsignedVB(slowHistory.accHealth);
+    blackboxWriteUnsignedVB(slowHistory.rcLatencyAverage);
+    blackboxWriteUnsignedVB(slowHistory.rcLatencyMax);
+
     blackboxSlowFrameIterationTimer = 0;
 }
 
@@ -738,6 +764,13 @@ static void loadSlowState(blackboxSlowState_t *slow)
     slow->failsafePhase = failsafePhase();
     slow->rxSignalReceived = rxIsReceivingSignal();
     slow->rxFlightChannelsValid = rxAreFlightChannelsValid();
+    slow->accClipCount = accClipCount;
+    for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
+        slow->accVibration[i] = imuGetAccVibration(i);
+    }
+    slow->accHealth = imuGetAccHealth();
+    slow->rcLatencyAverage = rcLatencyGetStats()->average;
+    slow->rcLatencyMax = rcLatencyGetStats()->max;
 }
 
 /**
@@ -759,7 +792,7 @@ static void writeSlowFrameIfNeeded(bool allowPeriodicWrite)
         loadSlowState(&newSlowState);
 
         // Only write a slow frame if it was different from the previous state
-        if (memcmp(&newSlowState, &slowHistory, sizeof(slowHistory)) != 0) {
+        if (memcmp(&newSlowState, &slowHistory, SLOW_STATE_COMPARE_SIZE) != 0) {
             // Use the new state as our new history
             memcpy(&slowHistory, &newSlowState, sizeof(slowHistory));
             shouldWrite = true;
@@ -1078,7 +1111,7 @@ static bool sendFieldDefinition(char mainFrameChar, char deltaFrameChar, const v
 
             // The first header is a field name
             if (xmitState.headerIndex == 0) {
-                blackboxPrint(def->name);
+                blackboxPrintConst(def->name);
 
                 // Do we need to print an index in brackets after the name?
                 if (def->fieldNameIndex != -1) {
@@ -1209,7 +1242,7 @@ void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
             blackboxWriteUnsignedVB(data->loggingResume.currentTime);
         break;
         case FLIGHT_LOG_EVENT_LOG_END:
-            blackboxPrint("End of log");
+            blackboxPrintConst("End of log");
             blackboxWrite(0);
         break;
     }
@@ -187,6 +187,23 @@ int blackboxPrint(const char *s)
     return length;
 }
 
+/*
+ * Print the null-terminated string 's' like blackboxPrint(), the serial port DMA sends it from where it is instead of
+ * copying it, so the string must not change afterwards.
+ */
+int blackboxPrintConst(const char *s)
+{
+    if (blackboxConfig()->device != BLACKBOX_DEVICE_SERIAL) {
+        return blackboxPrint(s);
+    }
+
+    const int length = strlen(s);
+    const serialTxSegment_t segment = { (const uint8_t*) s, length, NULL, NULL };
+    serialWriteSegments(blackboxPort, &segment, 1);
+
+    return length;
+}
+
 /**
  * Write an unsigned integer to the blackbox serial port using variable byte encoding.
  */
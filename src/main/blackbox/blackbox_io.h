@@ -55,6 +55,7 @@ void blackboxWrite(uint8_t value);
 int blackboxPrintf(const char *fmt, ...);
 void blackboxPrintfHeaderLine(const char *fmt, ...);
 int blackboxPrint(const char *s);
+int blackboxPrintConst(const char *s);
 
 void blackboxWriteUnsignedVB(uint32_t value);
 void blackboxWriteSignedVB(int32_t value);
@@ -111,3 +111,4 @@ static inline uint8_t __basepriSetRetVal(uint8_t prio)
 // define these wrappers for atomic operations, use gcc buildins
 #define ATOMIC_OR(ptr, val) __sync_fetch_and_or(ptr, val)
 #define ATOMIC_AND(ptr, val) __sync_fetch_and_and(ptr, val)
+#define ATOMIC_XCHG(ptr, val) __sync_lock_test_and_set(ptr, val)
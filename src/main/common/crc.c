@@ -38,3 +38,35 @@ uint16_t crc16_CCITT(uint16_t crc, uint8_t value)
     }
     return crc;
 }
+
+uint8_t crc8_dvb_s2(uint8_t crc, uint8_t value)
+{
+    uint8_t i;
+
+    crc ^= value;
+
+    for (i = 0; i < 8; i++) {
+        if (crc & 0x80) {
+            crc = crc << 1 ^ 0xD5;
+        } else {
+            crc = crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint8_t crc8_dallas(uint8_t crc, uint8_t value)
+{
+    uint8_t i;
+
+    crc ^= value;
+
+    for (i = 0; i < 8; i++) {
+        if (crc & 0x01) {
+            crc = crc >> 1 ^ 0x8C;
+        } else {
+            crc = crc >> 1;
+        }
+    }
+    return crc;
+}
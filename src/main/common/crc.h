@@ -18,3 +18,5 @@
 #pragma once
 
 uint16_t crc16_CCITT(uint16_t crc, uint8_t value);
+uint8_t crc8_dvb_s2(uint8_t crc, uint8_t value);
+uint8_t crc8_dallas(uint8_t crc, uint8_t value);
@@ -43,62 +43,39 @@ bool unittest_outsideRealtimeGuardInterval;
 #endif
 
 
-#ifdef SRC_MAIN_FLIGHT_PID_LUXFLOAT_C_
+#ifdef SRC_MAIN_FLIGHT_PID_KERNEL_C_
 #ifdef UNIT_TEST
 
-float unittest_pidLuxFloatCore_lastRateForDelta[3];
-float unittest_pidLuxFloatCore_PTerm[3];
-float unittest_pidLuxFloatCore_ITerm[3];
-float unittest_pidLuxFloatCore_DTerm[3];
+int32_t unittest_pidKernel_PTerm[3];
+int32_t unittest_pidKernel_ITerm[3];
+int32_t unittest_pidKernel_DTerm[3];
+int32_t unittest_pidKernel_FTerm[3];
+float unittest_pidKernelf_PTerm[3];
+float unittest_pidKernelf_ITerm[3];
+float unittest_pidKernelf_DTerm[3];
+float unittest_pidKernelf_FTerm[3];
 
-#define SET_PID_LUX_FLOAT_CORE_LOCALS(axis) \
+#define GET_PID_KERNEL_LOCALS() \
     { \
-        lastRateForDelta[axis] = unittest_pidLuxFloatCore_lastRateForDelta[axis]; \
+        memcpy(unittest_pidKernel_PTerm, PTerm, sizeof(unittest_pidKernel_PTerm)); \
+        memcpy(unittest_pidKernel_ITerm, ITerm, sizeof(unittest_pidKernel_ITerm)); \
+        memcpy(unittest_pidKernel_DTerm, DTerm, sizeof(unittest_pidKernel_DTerm)); \
+        memcpy(unittest_pidKernel_FTerm, FTerm, sizeof(unittest_pidKernel_FTerm)); \
     }
 
-#define GET_PID_LUX_FLOAT_CORE_LOCALS(axis) \
+#define GET_PID_KERNELF_LOCALS() \
     { \
-        unittest_pidLuxFloatCore_lastRateForDelta[axis] = lastRateForDelta[axis]; \
-        unittest_pidLuxFloatCore_PTerm[axis] = PTerm; \
-        unittest_pidLuxFloatCore_ITerm[axis] = ITerm; \
-        unittest_pidLuxFloatCore_DTerm[axis] = DTerm; \
+        memcpy(unittest_pidKernelf_PTerm, PTerm, sizeof(unittest_pidKernelf_PTerm)); \
+        memcpy(unittest_pidKernelf_ITerm, ITerm, sizeof(unittest_pidKernelf_ITerm)); \
+        memcpy(unittest_pidKernelf_DTerm, DTerm, sizeof(unittest_pidKernelf_DTerm)); \
+        memcpy(unittest_pidKernelf_FTerm, FTerm, sizeof(unittest_pidKernelf_FTerm)); \
     }
 
 #else
 
-#define SET_PID_LUX_FLOAT_CORE_LOCALS(axis) {}
-#define GET_PID_LUX_FLOAT_CORE_LOCALS(axis) {}
+#define GET_PID_KERNEL_LOCALS() {}
+#define GET_PID_KERNELF_LOCALS() {}
 
 #endif // UNIT_TEST
-#endif // SRC_MAIN_FLIGHT_PID_LUXFLOAT_C_
-
-
-#ifdef SRC_MAIN_FLIGHT_PID_MWREWRITE_C_
-#ifdef UNIT_TEST
-
-int32_t unittest_pidMultiWiiRewriteCore_lastRateForDelta[3];
-int32_t unittest_pidMultiWiiRewriteCore_PTerm[3];
-int32_t unittest_pidMultiWiiRewriteCore_ITerm[3];
-int32_t unittest_pidMultiWiiRewriteCore_DTerm[3];
-
-#define SET_PID_MULTI_WII_REWRITE_CORE_LOCALS(axis) \
-    { \
-        lastRateForDelta[axis] = unittest_pidMultiWiiRewriteCore_lastRateForDelta[axis]; \
-    }
-
-#define GET_PID_MULTI_WII_REWRITE_CORE_LOCALS(axis) \
-    { \
-        unittest_pidMultiWiiRewriteCore_lastRateForDelta[axis] = lastRateForDelta[axis]; \
-        unittest_pidMultiWiiRewriteCore_PTerm[axis] = PTerm; \
-        unittest_pidMultiWiiRewriteCore_ITerm[axis] = ITerm; \
-        unittest_pidMultiWiiRewriteCore_DTerm[axis] = DTerm; \
-    }
-
-#else
-
-#define SET_PID_MULTI_WII_REWRITE_CORE_LOCALS(axis) {}
-#define GET_PID_MULTI_WII_REWRITE_CORE_LOCALS(axis) {}
-
-#endif // UNIT_TEST
-#endif // SRC_MAIN_FLIGHT_PID_MWREWRITE_C_
+#endif // SRC_MAIN_FLIGHT_PID_KERNEL_C_
 
@@ -29,6 +29,7 @@ typedef struct acc_s {
     sensorAccInitFuncPtr init;                              // initialize function
     sensorReadFuncPtr read;                                 // read 3 axis data function
     uint16_t acc_1G;
+    uint8_t acc_range;                                      // full scale in G, readings at acc_1G * acc_range are clipped
     char revisionCode;                                      // a revision code for the sensor, if known
 } acc_t;
 
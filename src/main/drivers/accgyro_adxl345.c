@@ -92,6 +92,7 @@ static void adxl345Init(acc_t *acc)
         i2cWrite(ADXL345_ADDRESS, ADXL345_BW_RATE, ADXL345_RATE_100);
     }
     acc->acc_1G = 256;
+    acc->acc_range = 8;
 }
 
 uint8_t acc_samples = 0;
@@ -55,6 +55,7 @@ static void bma280Init(acc_t *acc)
     i2cWrite(BMA280_ADDRESS, BMA280_PMU_BW, 0x0E); // 500Hz BW
 
     acc->acc_1G = 512 * 8;
+    acc->acc_range = 8;
 }
 
 static bool bma280Read(int16_t *accelData)
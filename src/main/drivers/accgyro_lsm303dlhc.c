@@ -128,6 +128,7 @@ void lsm303dlhcAccInit(acc_t *acc)
     delay(100);
 
     acc->acc_1G = 512 * 8;
+    acc->acc_range = 4;
 }
 
 // Read 3 gyro values into user-provided buffer. No overrun checking is done.
@@ -130,6 +130,7 @@ static void mma8452Init(acc_t *acc)
     i2cWrite(MMA8452_ADDRESS, MMA8452_CTRL_REG1, MMA8452_CTRL_REG1_LNOISE | MMA8452_CTRL_REG1_ACTIVE); // Turn on measurements, low noise at max scale mode, Data Rate 800Hz. LNoise mode makes range +-4G.
 
     acc->acc_1G = 256;
+    acc->acc_range = 4;
 }
 
 static bool mma8452Read(int16_t *accelData)
@@ -89,9 +89,11 @@ static void mpu6050AccInit(acc_t *acc)
     switch (mpuDetectionResult.resolution) {
         case MPU_HALF_RESOLUTION:
             acc->acc_1G = 256 * 8;
+            acc->acc_range = 16;
             break;
         case MPU_FULL_RESOLUTION:
             acc->acc_1G = 512 * 8;
+            acc->acc_range = 8;
             break;
     }
 }
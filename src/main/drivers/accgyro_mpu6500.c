@@ -68,6 +68,7 @@ void mpu6500AccInit(acc_t *acc)
     mpuIntExtiInit();
 
     acc->acc_1G = 512 * 8;
+    acc->acc_range = 8;
 }
 
 void mpu6500GyroInit(uint8_t lpf)
@@ -146,6 +146,7 @@ void mpu6000SpiAccInit(acc_t *acc)
     mpuIntExtiInit();
 
     acc->acc_1G = 512 * 8;
+    acc->acc_range = 8;
 }
 
 bool mpu6000SpiDetect(void)
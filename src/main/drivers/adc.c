@@ -17,12 +17,18 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <platform.h>
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/atomic.h"
+
+#include "common/utils.h"
 
 #include "system.h"
+#include "dma.h"
+#include "nvic.h"
 
 #include "adc.h"
 #include "adc_impl.h"
@@ -31,34 +37,118 @@
 
 #ifdef USE_ADC
 adc_config_t adcConfig[ADC_CHANNEL_COUNT];
-volatile uint16_t adcValues[ADC_CHANNEL_COUNT];
+volatile uint16_t adcValues[ADC_DMA_BUFFER_SIZE];
 
+typedef struct adcChannelState_s {
+    uint16_t latest;            // most recent decimated block
+    uint16_t blockCount;        // blocks accumulated since the last adcReadChannel()
+    uint32_t accumulator;       // sum of those blocks
+} adcChannelState_t;
 
-uint16_t adcGetChannel(uint8_t channel)
+// indexed by dmaIndex, only written by the DMA interrupt handler
+static volatile adcChannelState_t adcChannelState[ADC_CHANNEL_COUNT];
+static volatile uint32_t adcLastBlockAt;
+static uint8_t adcActiveChannelCount;
+static dmaCallbackHandler_t adcDmaHandlerRec;
+
+static void adcDecimateBlock(const volatile uint16_t *block)
 {
-#ifdef DEBUG_ADC_CHANNELS
-#if ADC_CHANNEL_COUNT > 0
-    if (adcConfig[0].enabled) {
-        debug[0] = adcValues[adcConfig[0].dmaIndex];
+    uint32_t sums[ADC_CHANNEL_COUNT] = { 0 };
+
+    for (int scan = 0; scan < ADC_OVERSAMPLE_COUNT; scan++) {
+        for (int i = 0; i < adcActiveChannelCount; i++) {
+            sums[i] += *block++;
+        }
     }
-#endif
-#if ADC_CHANNEL_COUNT > 1
-    if (adcConfig[1].enabled) {
-        debug[1] = adcValues[adcConfig[1].dmaIndex];
+
+    for (int i = 0; i < adcActiveChannelCount; i++) {
+        volatile adcChannelState_t *state = &adcChannelState[i];
+        uint16_t value = sums[i] >> ADC_OVERSAMPLE_SHIFT;
+
+        if (state->blockCount == UINT16_MAX) {
+            // nobody is consuming this channel, restart the accumulation rather than overflow
+            state->accumulator = 0;
+            state->blockCount = 0;
+        }
+        state->latest = value;
+        state->accumulator += value;
+        state->blockCount++;
     }
-#endif
-#if ADC_CHANNEL_COUNT > 2
-    if (adcConfig[2].enabled) {
-        debug[2] = adcValues[adcConfig[2].dmaIndex];
+
+    adcLastBlockAt = micros();
+}
+
+static void adcDmaHandler(dmaChannel_t *descriptor, dmaCallbackHandler_t *handler)
+{
+    UNUSED(handler);
+
+    const int halfSize = ADC_OVERSAMPLE_COUNT * adcActiveChannelCount;
+
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_HTIF);
+        adcDecimateBlock(&adcValues[0]);
     }
-#endif
-#if ADC_CHANNEL_COUNT > 3
-    if (adcConfig[3].enabled) {
-        debug[3] = adcValues[adcConfig[3].dmaIndex];
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+        adcDecimateBlock(&adcValues[halfSize]);
+    }
+}
+
+// Called by the MCU specific driver once the DMA channel is configured, but before it is enabled.
+void adcDecimationInit(uint8_t activeChannelCount)
+{
+    adcActiveChannelCount = activeChannelCount;
+    memset((void *)adcChannelState, 0, sizeof(adcChannelState));
+
+    dmaChannel_t *descriptor = dmaFindChannelDescriptor(ADC_DMA_CHANNEL);
+    if (!descriptor) {
+        return;
+    }
+
+    dmaHandlerInit(&adcDmaHandlerRec, adcDmaHandler);
+    dmaSetHandler(descriptor, &adcDmaHandlerRec, NVIC_PRIO_ADC_DMA);
+}
+
+uint16_t adcGetChannel(uint8_t channel)
+{
+#ifdef DEBUG_ADC_CHANNELS
+    for (int i = 0; i < MIN(ADC_CHANNEL_COUNT, 4); i++) {
+        if (adcConfig[i].enabled) {
+            debug[i] = adcChannelState[adcConfig[i].dmaIndex].latest >> ADC_OVERSAMPLE_SHIFT;
+        }
     }
-#endif
 #endif // DEBUG_ADC_CHANNELS
-    return adcValues[adcConfig[channel].dmaIndex];
+    return adcChannelState[adcConfig[channel].dmaIndex].latest >> ADC_OVERSAMPLE_SHIFT;
+}
+
+/*
+ * Returns the mean of all the blocks decimated since the previous call for the same channel, so a
+ * consumer running at any task rate sees every conversion exactly once without doing its own averaging.
+ */
+void adcReadChannel(uint8_t channel, adcSample_t *sample)
+{
+    if (!adcConfig[channel].enabled) {
+        memset(sample, 0, sizeof(*sample));
+        return;
+    }
+
+    volatile adcChannelState_t *state = &adcChannelState[adcConfig[channel].dmaIndex];
+    uint32_t accumulator;
+    uint16_t blockCount;
+
+    ATOMIC_BLOCK(NVIC_PRIO_ADC_DMA) {
+        accumulator = state->accumulator;
+        blockCount = state->blockCount;
+        sample->timestamp = adcLastBlockAt;
+        state->accumulator = 0;
+        state->blockCount = 0;
+        if (!blockCount) {
+            accumulator = state->latest;
+        }
+    }
+
+    sample->value = blockCount ? accumulator / blockCount : accumulator;
+    sample->blockCount = blockCount;
 }
 
 #else
@@ -67,4 +157,12 @@ uint16_t adcGetChannel(uint8_t channel)
     UNUSED(channel);
     return 0;
 }
+
+void adcReadChannel(uint8_t channel, adcSample_t *sample)
+{
+    UNUSED(channel);
+    sample->value = 0;
+    sample->blockCount = 0;
+    sample->timestamp = 0;
+}
 #endif
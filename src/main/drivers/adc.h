@@ -45,6 +45,17 @@ typedef enum {
 
 #define ADC_CHANNEL_MASK(adcChannel) (1 << adcChannel)
 
+#define ADC_RESOLUTION_BITS 12
+
+// Each decimated block is the sum of 4^ADC_OVERSAMPLE_SHIFT scans shifted right by ADC_OVERSAMPLE_SHIFT,
+// giving ADC_OVERSAMPLE_SHIFT extra bits of resolution.  Override in target.h if required.
+#ifndef ADC_OVERSAMPLE_SHIFT
+#define ADC_OVERSAMPLE_SHIFT 2
+#endif
+
+#define ADC_OVERSAMPLE_COUNT (1 << (2 * ADC_OVERSAMPLE_SHIFT))
+#define ADC_OVERSAMPLED_BITS (ADC_RESOLUTION_BITS + ADC_OVERSAMPLE_SHIFT)
+
 typedef struct adc_config_s {
     uint8_t adcChannel;         // ADC1_INxx channel number
     uint8_t dmaIndex;           // index into DMA buffer in case of sparse channels
@@ -56,5 +67,12 @@ typedef struct drv_adc_config_s {
     uint32_t channelMask;
 } drv_adc_config_t;
 
+typedef struct adcSample_s {
+    uint16_t value;             // mean of the decimated blocks since the previous read, ADC_OVERSAMPLED_BITS wide
+    uint16_t blockCount;        // number of blocks that contributed to value, 0 if nothing new arrived
+    uint32_t timestamp;         // micros() when the newest contributing block completed
+} adcSample_t;
+
 void adcInit(drv_adc_config_t *init);
 uint16_t adcGetChannel(uint8_t channel);
+void adcReadChannel(uint8_t channel, adcSample_t *sample);
@@ -17,5 +17,10 @@
 
 #pragma once
 
+// Two halves of ADC_OVERSAMPLE_COUNT scans each, the DMA fills one half while the other is decimated.
+#define ADC_DMA_BUFFER_SIZE (2 * ADC_OVERSAMPLE_COUNT * ADC_CHANNEL_COUNT)
+
 extern adc_config_t adcConfig[ADC_CHANNEL_COUNT];
-extern volatile uint16_t adcValues[ADC_CHANNEL_COUNT];
+extern volatile uint16_t adcValues[ADC_DMA_BUFFER_SIZE];
+
+void adcDecimationInit(uint8_t activeChannelCount);
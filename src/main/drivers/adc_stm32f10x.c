@@ -118,15 +118,20 @@ void adcInit(drv_adc_config_t *init)
     DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC_INSTANCE->DR;
     DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)adcValues;
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
-    DMA_InitStructure.DMA_BufferSize = configuredAdcChannels;
+    DMA_InitStructure.DMA_BufferSize = configuredAdcChannels * ADC_OVERSAMPLE_COUNT * 2;
     DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-    DMA_InitStructure.DMA_MemoryInc = configuredAdcChannels > 1 ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
     DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
     DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
     DMA_InitStructure.DMA_Priority = DMA_Priority_High;
     DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
     DMA_Init(ADC_DMA_CHANNEL, &DMA_InitStructure);
+
+    // each half of the circular buffer holds ADC_OVERSAMPLE_COUNT scans, decimate them as they complete
+    adcDecimationInit(configuredAdcChannels);
+    DMA_ITConfig(ADC_DMA_CHANNEL, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
     DMA_Cmd(ADC_DMA_CHANNEL, ENABLE);
 
     ADC_InitTypeDef ADC_InitStructure;
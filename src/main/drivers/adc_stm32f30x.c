@@ -32,6 +32,12 @@
 
 #ifdef USE_ADC
 
+/*
+ * 181.5 + 12.5 cycles at 4.5 MHz is 43 us per conversion, so a block of ADC_OVERSAMPLE_COUNT scans of all six
+ * channels takes about 4 ms and the battery, current and RSSI readings get several blocks between updates.
+ */
+#define ADC_SAMPLE_TIME ADC_SampleTime_181Cycles5
+
 void adcInit(drv_adc_config_t *init)
 {
     ADC_InitTypeDef ADC_InitStructure;
@@ -54,7 +60,7 @@ void adcInit(drv_adc_config_t *init)
 
         adcConfig[ADC_CHANNEL0].adcChannel = ADC0_CHANNEL;
         adcConfig[ADC_CHANNEL0].dmaIndex = adcChannelCount;
-        adcConfig[ADC_CHANNEL0].sampleTime = ADC_SampleTime_601Cycles5;
+        adcConfig[ADC_CHANNEL0].sampleTime = ADC_SAMPLE_TIME;
         adcConfig[ADC_CHANNEL0].enabled = true;
         adcChannelCount++;
     }
@@ -67,7 +73,7 @@ void adcInit(drv_adc_config_t *init)
 
         adcConfig[ADC_CHANNEL1].adcChannel = ADC1_CHANNEL;
         adcConfig[ADC_CHANNEL1].dmaIndex = adcChannelCount;
-        adcConfig[ADC_CHANNEL1].sampleTime = ADC_SampleTime_601Cycles5;
+        adcConfig[ADC_CHANNEL1].sampleTime = ADC_SAMPLE_TIME;
         adcConfig[ADC_CHANNEL1].enabled = true;
         adcChannelCount++;
     }
@@ -80,7 +86,7 @@ void adcInit(drv_adc_config_t *init)
 
         adcConfig[ADC_CHANNEL2].adcChannel = ADC2_CHANNEL;
         adcConfig[ADC_CHANNEL2].dmaIndex = adcChannelCount;
-        adcConfig[ADC_CHANNEL2].sampleTime = ADC_SampleTime_601Cycles5;
+        adcConfig[ADC_CHANNEL2].sampleTime = ADC_SAMPLE_TIME;
         adcConfig[ADC_CHANNEL2].enabled = true;
         adcChannelCount++;
     }
@@ -93,7 +99,7 @@ void adcInit(drv_adc_config_t *init)
 
         adcConfig[ADC_CHANNEL3].adcChannel = ADC3_CHANNEL;
         adcConfig[ADC_CHANNEL3].dmaIndex = adcChannelCount;
-        adcConfig[ADC_CHANNEL3].sampleTime = ADC_SampleTime_601Cycles5;
+        adcConfig[ADC_CHANNEL3].sampleTime = ADC_SAMPLE_TIME;
         adcConfig[ADC_CHANNEL3].enabled = true;
         adcChannelCount++;
     }
@@ -106,7 +112,7 @@ void adcInit(drv_adc_config_t *init)
 
         adcConfig[ADC_CHANNEL4].adcChannel = ADC4_CHANNEL;
         adcConfig[ADC_CHANNEL4].dmaIndex = adcChannelCount;
-        adcConfig[ADC_CHANNEL4].sampleTime = ADC_SampleTime_601Cycles5;
+        adcConfig[ADC_CHANNEL4].sampleTime = ADC_SAMPLE_TIME;
         adcConfig[ADC_CHANNEL4].enabled = true;
         adcChannelCount++;
     }
@@ -119,13 +125,13 @@ void adcInit(drv_adc_config_t *init)
 
         adcConfig[ADC_CHANNEL5].adcChannel = ADC5_CHANNEL;
         adcConfig[ADC_CHANNEL5].dmaIndex = adcChannelCount;
-        adcConfig[ADC_CHANNEL5].sampleTime = ADC_SampleTime_601Cycles5;
+        adcConfig[ADC_CHANNEL5].sampleTime = ADC_SAMPLE_TIME;
         adcConfig[ADC_CHANNEL5].enabled = true;
         adcChannelCount++;
     }
 #endif
 
-    RCC_ADCCLKConfig(RCC_ADC12PLLCLK_Div256);  // 72 MHz divided by 256 = 281.25 kHz
+    RCC_ADCCLKConfig(RCC_ADC12PLLCLK_Div16);   // 72 MHz divided by 16 = 4.5 MHz
     RCC_AHBPeriphClockCmd(ADC_AHB_PERIPHERAL | RCC_AHBPeriph_ADC12, ENABLE);
 
     DMA_DeInit(ADC_DMA_CHANNEL);
@@ -134,9 +140,9 @@ void adcInit(drv_adc_config_t *init)
     DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC_INSTANCE->DR;
     DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)adcValues;
     DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
-    DMA_InitStructure.DMA_BufferSize = adcChannelCount;
+    DMA_InitStructure.DMA_BufferSize = adcChannelCount * ADC_OVERSAMPLE_COUNT * 2;
     DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-    DMA_InitStructure.DMA_MemoryInc = adcChannelCount > 1 ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
     DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
     DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
     DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
@@ -145,6 +151,10 @@ void adcInit(drv_adc_config_t *init)
 
     DMA_Init(ADC_DMA_CHANNEL, &DMA_InitStructure);
 
+    // each half of the circular buffer holds ADC_OVERSAMPLE_COUNT scans, decimate them as they complete
+    adcDecimationInit(adcChannelCount);
+    DMA_ITConfig(ADC_DMA_CHANNEL, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
     DMA_Cmd(ADC_DMA_CHANNEL, ENABLE);
 
 
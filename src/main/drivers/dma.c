@@ -23,6 +23,8 @@
 
 #include "build/build_config.h"
 
+#include "common/utils.h"
+
 #include "drivers/dma.h"
 #include "drivers/nvic.h"
 
@@ -91,6 +93,16 @@ void dmaInit(void)
     // TODO: Do we need this?
 }
 
+dmaChannel_t* dmaFindChannelDescriptor(DMA_Channel_TypeDef* channel)
+{
+    for (unsigned i = 0; i < ARRAYLEN(dmaChannels); i++) {
+        if (dmaChannels[i].channel == channel) {
+            return &dmaChannels[i];
+        }
+    }
+    return NULL;
+}
+
 void dmaHandlerInit(dmaCallbackHandler_t* handlerRec, dmaCallbackHandlerFunc* handler)
 {
     handlerRec->fn = handler;
@@ -61,6 +61,7 @@ extern dmaChannel_t dmaChannels[];
 #define DMA_IT_TEIF                          ((uint32_t)0x00000008)
 
 void dmaInit(void);
+dmaChannel_t* dmaFindChannelDescriptor(DMA_Channel_TypeDef* channel);
 void dmaHandlerInit(dmaCallbackHandler_t* handlerRec, dmaCallbackHandlerFunc* handler);
 void dmaSetHandler(dmaChannel_t* dmaChannel, dmaCallbackHandler_t* handler, uint8_t priority);
 
@@ -0,0 +1,98 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <platform.h>
+
+#include "dshot.h"
+
+/*
+ * DShot sends a 16 bit frame per motor, MSB first, as pulses of a fixed bit period.  The timer compare register of the
+ * motor output is reloaded from a DMA buffer on every period, so the buffer holds one compare value per bit.
+ *
+ * The frame is encoded a nibble at a time from a table holding the four compare values of each nibble for each
+ * protocol, 3 x 16 = 48 entries.
+ */
+
+#define DSHOT_BIT(protocol, nibble, bit) (((nibble) & (1 << (bit))) ? DSHOT_BIT_1(protocol) : DSHOT_BIT_0(protocol))
+
+#define DSHOT_NIBBLE(protocol, nibble) { \
+    DSHOT_BIT(protocol, nibble, 3), \
+    DSHOT_BIT(protocol, nibble, 2), \
+    DSHOT_BIT(protocol, nibble, 1), \
+    DSHOT_BIT(protocol, nibble, 0)  \
+}
+
+#define DSHOT_NIBBLES(protocol) { \
+    DSHOT_NIBBLE(protocol, 0x0), DSHOT_NIBBLE(protocol, 0x1), DSHOT_NIBBLE(protocol, 0x2), DSHOT_NIBBLE(protocol, 0x3), \
+    DSHOT_NIBBLE(protocol, 0x4), DSHOT_NIBBLE(protocol, 0x5), DSHOT_NIBBLE(protocol, 0x6), DSHOT_NIBBLE(protocol, 0x7), \
+    DSHOT_NIBBLE(protocol, 0x8), DSHOT_NIBBLE(protocol, 0x9), DSHOT_NIBBLE(protocol, 0xA), DSHOT_NIBBLE(protocol, 0xB), \
+    DSHOT_NIBBLE(protocol, 0xC), DSHOT_NIBBLE(protocol, 0xD), DSHOT_NIBBLE(protocol, 0xE), DSHOT_NIBBLE(protocol, 0xF)  \
+}
+
+static const uint16_t dshotNibbleTable[DSHOT_PROTOCOL_COUNT][16][4] = {
+    DSHOT_NIBBLES(DSHOT150),
+    DSHOT_NIBBLES(DSHOT300),
+    DSHOT_NIBBLES(DSHOT600),
+};
+
+/*
+ * Returns the frame for a value of 0-2047, with the CRC in the low nibble.
+ */
+uint16_t dshotPrepareFrame(uint16_t value, bool requestTelemetry)
+{
+    const uint16_t packet = (value << 1) | (requestTelemetry ? 1 : 0);
+
+    // the CRC is the XOR of the three nibbles of the packet
+    const uint16_t crc = (packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0f;
+
+    return (packet << 4) | crc;
+}
+
+/*
+ * Fills the first DSHOT_FRAME_BITS compare values of the buffer, the pause at the end is left untouched.
+ */
+void dshotEncodeFrame(uint16_t *buffer, uint16_t frame, dshotProtocol_e protocol)
+{
+    for (int i = DSHOT_FRAME_NIBBLES - 1; i >= 0; i--) {
+        memcpy(buffer, dshotNibbleTable[protocol][(frame >> (i * 4)) & 0x0f], sizeof(dshotNibbleTable[0][0]));
+        buffer += 4;
+    }
+}
+
+/*
+ * Commands that change the ESC settings are only acted on when they are received several times in a row.
+ */
+uint8_t dshotCommandRepeats(uint8_t command)
+{
+    switch (command) {
+        case DSHOT_CMD_SPIN_DIRECTION_1:
+        case DSHOT_CMD_SPIN_DIRECTION_2:
+        case DSHOT_CMD_3D_MODE_OFF:
+        case DSHOT_CMD_3D_MODE_ON:
+        case DSHOT_CMD_SETTINGS_REQUEST:
+        case DSHOT_CMD_SAVE_SETTINGS:
+        case DSHOT_CMD_SPIN_DIRECTION_NORMAL:
+        case DSHOT_CMD_SPIN_DIRECTION_REVERSED:
+            return DSHOT_COMMAND_REPEATS;
+        default:
+            return 1;
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define DSHOT_TIMER_MHZ             24
+
+#define DSHOT_MIN_THROTTLE          48      // 0 stops the motor, 1-47 are commands
+#define DSHOT_MAX_THROTTLE          2047
+
+#define DSHOT_FRAME_BITS            16      // 11 bit value, telemetry request, 4 bit CRC
+#define DSHOT_FRAME_NIBBLES         (DSHOT_FRAME_BITS / 4)
+#define DSHOT_FRAME_PAUSE_BITS      2       // compare values of 0 hold the line low between frames
+
+#define DSHOT_DMA_BUFFER_SIZE       (DSHOT_FRAME_BITS + DSHOT_FRAME_PAUSE_BITS)
+
+#define DSHOT_COMMAND_REPEATS       10      // frames needed before the ESC acts on a setting command
+
+typedef enum {
+    DSHOT150 = 0,
+    DSHOT300,
+    DSHOT600,
+    DSHOT_PROTOCOL_COUNT
+} dshotProtocol_e;
+
+// bit period in timer ticks, a 1 is high for 3/4 of it and a 0 for 3/8
+#define DSHOT_BIT_PERIOD(protocol)  (DSHOT_TIMER_MHZ * 1000 / (150 << (protocol)))
+#define DSHOT_BIT_1(protocol)       (DSHOT_BIT_PERIOD(protocol) * 3 / 4)
+#define DSHOT_BIT_0(protocol)       (DSHOT_BIT_PERIOD(protocol) * 3 / 8)
+
+typedef enum {
+    DSHOT_CMD_MOTOR_STOP = 0,
+    DSHOT_CMD_BEEP1,
+    DSHOT_CMD_BEEP2,
+    DSHOT_CMD_BEEP3,
+    DSHOT_CMD_BEEP4,
+    DSHOT_CMD_BEEP5,
+    DSHOT_CMD_ESC_INFO,
+    DSHOT_CMD_SPIN_DIRECTION_1,
+    DSHOT_CMD_SPIN_DIRECTION_2,
+    DSHOT_CMD_3D_MODE_OFF,
+    DSHOT_CMD_3D_MODE_ON,
+    DSHOT_CMD_SETTINGS_REQUEST,
+    DSHOT_CMD_SAVE_SETTINGS,
+    DSHOT_CMD_SPIN_DIRECTION_NORMAL = 20,
+    DSHOT_CMD_SPIN_DIRECTION_REVERSED,
+    DSHOT_CMD_LED0_ON,
+    DSHOT_CMD_LED1_ON,
+    DSHOT_CMD_LED2_ON,
+    DSHOT_CMD_LED3_ON,
+    DSHOT_CMD_LED0_OFF,
+    DSHOT_CMD_LED1_OFF,
+    DSHOT_CMD_LED2_OFF,
+    DSHOT_CMD_LED3_OFF,
+    DSHOT_CMD_MAX = DSHOT_MIN_THROTTLE - 1
+} dshotCommands_e;
+
+uint16_t dshotPrepareFrame(uint16_t value, bool requestTelemetry);
+void dshotEncodeFrame(uint16_t *buffer, uint16_t frame, dshotProtocol_e protocol);
+uint8_t dshotCommandRepeats(uint8_t command);
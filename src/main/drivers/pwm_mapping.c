@@ -41,7 +41,10 @@
 
 void pwmBrushedMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse);
 void pwmBrushlessMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint16_t motorPwmRate, uint16_t idlePulse);
-void pwmOneshotMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex);
+void pwmOneshotMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint8_t motorPwmProtocol);
+#ifdef USE_DSHOT
+bool pwmDshotMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint8_t motorPwmProtocol);
+#endif
 void pwmServoConfig(const timerHardware_t *timerHardware, uint8_t servoIndex, uint16_t servoPwmRate, uint16_t servoCenterPulse);
 
 /*
@@ -933,10 +936,23 @@ pwmIOConfiguration_t *pwmInit(drv_pwm_config_t *init)
             	if (timerHardwarePtr->tim == TIM2)
             		continue;
             }
+#endif
+#ifdef USE_DSHOT
+            if (init->motorPwmProtocol >= PWM_TYPE_DSHOT150) {
+
+                // an output without a free DMA channel keeps its motor index so the others don't move, but it isn't
+                // driven and its ESC gets no signal
+                if (pwmDshotMotorConfig(timerHardwarePtr, pwmIOConfiguration.motorCount, init->motorPwmProtocol)) {
+                    pwmIOConfiguration.ioConfigurations[pwmIOConfiguration.ioCount].flags = PWM_PF_MOTOR | PWM_PF_OUTPUT_PROTOCOL_DSHOT;
+                } else {
+                    pwmIOConfiguration.ioConfigurations[pwmIOConfiguration.ioCount].flags = PWM_PF_MOTOR;
+                }
+
+            } else
 #endif
             if (init->useOneshot) {
 
-                pwmOneshotMotorConfig(timerHardwarePtr, pwmIOConfiguration.motorCount);
+                pwmOneshotMotorConfig(timerHardwarePtr, pwmIOConfiguration.motorCount, init->motorPwmProtocol);
                 pwmIOConfiguration.ioConfigurations[pwmIOConfiguration.ioCount].flags = PWM_PF_MOTOR | PWM_PF_OUTPUT_PROTOCOL_ONESHOT|PWM_PF_OUTPUT_PROTOCOL_PWM;
 
             } else if (isMotorBrushed(init->motorPwmRate)) {
@@ -972,5 +988,11 @@ pwmIOConfiguration_t *pwmInit(drv_pwm_config_t *init)
         pwmIOConfiguration.ioCount++;
     }
 
+#ifdef USE_PPM_DMA
+    if (pwmIOConfiguration.ppmInputCount) {
+        ppmInDmaConfig();
+    }
+#endif
+
     return &pwmIOConfiguration;
 }
@@ -47,6 +47,25 @@
 #define ONESHOT125_TIMER_MHZ 8
 #define PWM_BRUSHED_TIMER_MHZ 8
 
+// the timer clock must divide SystemCoreClock, targets running the core at other than 72MHz can override these
+#ifndef ONESHOT42_TIMER_MHZ
+#define ONESHOT42_TIMER_MHZ 24      // 1000-2000 ticks are 42-84us
+#endif
+#ifndef MULTISHOT_TIMER_MHZ
+#define MULTISHOT_TIMER_MHZ 72      // 5-25us are scaled onto 360-1800 ticks
+#endif
+
+typedef enum {
+    PWM_TYPE_STANDARD = 0,
+    PWM_TYPE_ONESHOT125,
+    PWM_TYPE_ONESHOT42,
+    PWM_TYPE_MULTISHOT,
+    PWM_TYPE_DSHOT150,
+    PWM_TYPE_DSHOT300,
+    PWM_TYPE_DSHOT600,
+    PWM_TYPE_COUNT
+} motorPwmProtocolTypes_e;
+
 
 typedef struct sonarGPIOConfig_s {
     GPIO_TypeDef *gpio;
@@ -73,7 +92,8 @@ typedef struct drv_pwm_config_s {
     bool useUART5;
 #endif
     bool useVbat;
-    bool useOneshot;
+    bool useOneshot;                // any of the OneShot125, OneShot42 and Multishot protocols
+    uint8_t motorPwmProtocol;
     bool useSoftSerial;
     bool useLEDStrip;
 #ifdef SONAR
@@ -101,7 +121,8 @@ typedef enum {
     PWM_PF_OUTPUT_PROTOCOL_PWM = (1 << 3),
     PWM_PF_OUTPUT_PROTOCOL_ONESHOT = (1 << 4),
     PWM_PF_PPM = (1 << 5),
-    PWM_PF_PWM = (1 << 6)
+    PWM_PF_PWM = (1 << 6),
+    PWM_PF_OUTPUT_PROTOCOL_DSHOT = (1 << 7)
 } pwmPortFlags_e;
 
 
@@ -19,17 +19,20 @@
 #include <stdint.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <platform.h>
 
 #include "gpio.h"
 #include "timer.h"
+#include "dshot.h"
 
 #include "pwm_mapping.h"
 
 #include "pwm_output.h"
 
 #include "common/maths.h"
+#include "common/utils.h"
 
 #define MAX_PWM_OUTPUT_PORTS MAX(MAX_MOTORS, MAX_SERVOS)
 
@@ -40,6 +43,12 @@ typedef struct {
     TIM_TypeDef *tim;
     uint16_t period;
     pwmWriteFuncPtr pwmWritePtr;
+#ifdef USE_DSHOT
+    DMA_Channel_TypeDef *dmaChannel;
+    uint8_t command;
+    uint8_t commandRepeats;
+    uint16_t dmaBuffer[DSHOT_DMA_BUFFER_SIZE];
+#endif
 } pwmOutputPort_t;
 
 static pwmOutputPort_t pwmOutputPorts[MAX_PWM_OUTPUT_PORTS];
@@ -53,6 +62,12 @@ static pwmOutputPort_t *servos[MAX_PWM_SERVOS];
 static uint8_t allocatedOutputPortCount = 0;
 
 static bool pwmMotorsEnabled = true;
+static bool useOneshot = false;
+
+#ifdef USE_DSHOT
+static bool useDshot = false;
+static dshotProtocol_e dshotProtocol;
+#endif
 static void pwmOCConfig(TIM_TypeDef *tim, uint8_t channel, uint16_t value)
 {
     TIM_OCInitTypeDef  TIM_OCInitStructure;
@@ -138,6 +153,13 @@ static void pwmWriteStandard(uint8_t index, uint16_t value)
     *motors[index]->ccr = value;
 }
 
+static void pwmWriteMultishot(uint8_t index, uint16_t value)
+{
+    // keep the pulse within 5-25us, a value below 1000 would wrap the compare register
+    value = constrain(value, 1000, 2000);
+    *motors[index]->ccr = MULTISHOT_TIMER_MHZ * 5 + (value - 1000) * MULTISHOT_TIMER_MHZ * 20 / 1000;
+}
+
 void pwmWriteMotor(uint8_t index, uint16_t value)
 {
     if (motors[index] && index < MAX_MOTORS && pwmMotorsEnabled)
@@ -149,6 +171,10 @@ void pwmShutdownPulsesForAllMotors(uint8_t motorCount)
     uint8_t index;
 
     for(index = 0; index < motorCount; index++){
+        // a DShot output without a DMA channel has no port
+        if (!motors[index])
+            continue;
+
         // Set the compare register to 0, which stops the output pulsing if the timer overflows
         *motors[index]->ccr = 0;
     }
@@ -164,6 +190,15 @@ void pwmEnableMotors(void)
     pwmMotorsEnabled = true;
 }
 
+bool isMotorProtocolOneshot(void)
+{
+    return useOneshot;
+}
+
+/*
+ * Called once per loop right after the motors have been written, so the pulses start as soon as the mixer output is
+ * known and the motors are updated at the full loop rate.
+ */
 void pwmCompleteOneshotMotorUpdate(uint8_t motorCount)
 {
     uint8_t index;
@@ -203,12 +238,119 @@ void pwmBrushlessMotorConfig(const timerHardware_t *timerHardware, uint8_t motor
     motors[motorIndex]->pwmWritePtr = pwmWriteStandard;
 }
 
-void pwmOneshotMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex)
+void pwmOneshotMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint8_t motorPwmProtocol)
 {
-    motors[motorIndex] = pwmOutConfig(timerHardware, ONESHOT125_TIMER_MHZ, 0xFFFF, 0);
-    motors[motorIndex]->pwmWritePtr = pwmWriteStandard;
+    useOneshot = true;
+
+    switch (motorPwmProtocol) {
+        case PWM_TYPE_MULTISHOT:
+            motors[motorIndex] = pwmOutConfig(timerHardware, MULTISHOT_TIMER_MHZ, 0xFFFF, 0);
+            motors[motorIndex]->pwmWritePtr = pwmWriteMultishot;
+            break;
+        case PWM_TYPE_ONESHOT42:
+            motors[motorIndex] = pwmOutConfig(timerHardware, ONESHOT42_TIMER_MHZ, 0xFFFF, 0);
+            motors[motorIndex]->pwmWritePtr = pwmWriteStandard;
+            break;
+        default:
+            motors[motorIndex] = pwmOutConfig(timerHardware, ONESHOT125_TIMER_MHZ, 0xFFFF, 0);
+            motors[motorIndex]->pwmWritePtr = pwmWriteStandard;
+            break;
+    }
 }
 
+#ifdef USE_DSHOT
+static void pwmWriteDshot(uint8_t index, uint16_t value)
+{
+    pwmOutputPort_t *motor = motors[index];
+    bool requestTelemetry = false;
+
+    // commands are only sent while the motor is stopped
+    if (motor->commandRepeats && value == DSHOT_CMD_MOTOR_STOP) {
+        value = motor->command;
+        requestTelemetry = true;
+        motor->commandRepeats--;
+    }
+
+    dshotEncodeFrame(motor->dmaBuffer, dshotPrepareFrame(value, requestTelemetry), dshotProtocol);
+}
+
+/*
+ * The timers run continuously with a period of one bit and the compare register is 0 between frames, each DMA
+ * transfer is triggered by a compare event and the frame starts on the next period.  The DMA channel stops by itself
+ * when the buffer has been sent, it only has to be reloaded for the next frame.
+ */
+void pwmCompleteDshotMotorUpdate(uint8_t motorCount)
+{
+    for (int index = 0; index < motorCount; index++) {
+        if (!motors[index]) {
+            continue;
+        }
+
+        DMA_Channel_TypeDef *dmaChannel = motors[index]->dmaChannel;
+
+        DMA_Cmd(dmaChannel, DISABLE);
+        DMA_SetCurrDataCounter(dmaChannel, DSHOT_DMA_BUFFER_SIZE);
+        DMA_Cmd(dmaChannel, ENABLE);
+    }
+}
+
+void pwmWriteDshotCommand(uint8_t index, uint8_t command)
+{
+    if (!useDshot || index >= MAX_MOTORS || !motors[index] || command > DSHOT_CMD_MAX) {
+        return;
+    }
+
+    motors[index]->command = command;
+    motors[index]->commandRepeats = dshotCommandRepeats(command);
+}
+
+bool isMotorProtocolDshot(void)
+{
+    return useDshot;
+}
+
+bool pwmDshotMotorConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, uint8_t motorPwmProtocol)
+{
+    DMA_InitTypeDef DMA_InitStructure;
+
+    const timerDmaMapping_t *mapping = timerDmaAllocate(timerHardware);
+    if (!mapping) {
+        return false;
+    }
+
+    useDshot = true;
+    dshotProtocol = motorPwmProtocol - PWM_TYPE_DSHOT150;
+
+    pwmOutputPort_t *motor = pwmOutConfig(timerHardware, DSHOT_TIMER_MHZ, DSHOT_BIT_PERIOD(dshotProtocol), 0);
+    motor->pwmWritePtr = pwmWriteDshot;
+    motor->dmaChannel = mapping->dmaChannel;
+    motor->commandRepeats = 0;
+    memset(motor->dmaBuffer, 0, sizeof(motor->dmaBuffer));
+    motors[motorIndex] = motor;
+
+    DMA_DeInit(mapping->dmaChannel);
+
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)motor->ccr;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)motor->dmaBuffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+    DMA_InitStructure.DMA_BufferSize = DSHOT_DMA_BUFFER_SIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+
+    DMA_Init(mapping->dmaChannel, &DMA_InitStructure);
+
+    TIM_DMACmd(timerHardware->tim, timerDmaSource(timerHardware->channel), ENABLE);
+
+    return true;
+}
+#endif
+
 #ifdef USE_SERVOS
 void pwmServoConfig(const timerHardware_t *timerHardware, uint8_t servoIndex, uint16_t servoPwmRate, uint16_t servoCenterPulse)
 {
@@ -20,6 +20,13 @@
 void pwmWriteMotor(uint8_t index, uint16_t value);
 void pwmShutdownPulsesForAllMotors(uint8_t motorCount);
 void pwmCompleteOneshotMotorUpdate(uint8_t motorCount);
+bool isMotorProtocolOneshot(void);
+
+#ifdef USE_DSHOT
+void pwmCompleteDshotMotorUpdate(uint8_t motorCount);
+void pwmWriteDshotCommand(uint8_t index, uint8_t command);
+bool isMotorProtocolDshot(void);
+#endif
 
 void pwmWriteServo(uint8_t index, uint16_t value);
 
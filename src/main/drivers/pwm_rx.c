@@ -33,6 +33,9 @@
 #include "nvic.h"
 #include "gpio.h"
 #include "timer.h"
+#ifdef USE_PPM_DMA
+#include "dma.h"
+#endif
 
 #include "pwm_mapping.h"
 
@@ -53,6 +56,9 @@
 #define INPUT_FILTER_TO_HELP_WITH_NOISE_FROM_OPENLRS_TELEMETRY_RX 0x03
 
 void pwmICConfig(TIM_TypeDef *tim, uint8_t channel, uint16_t polarity);
+#ifdef USE_PPM_DMA
+static void ppmDmaProcessEdges(void);
+#endif
 
 typedef enum {
     INPUT_MODE_PPM,
@@ -115,6 +121,9 @@ ppmDevice_t ppmDev;
 
 bool isPPMDataBeingReceived(void)
 {
+#ifdef USE_PPM_DMA
+    ppmDmaProcessEdges();
+#endif
     return (ppmFrameCount != lastPPMFrameCount);
 }
 
@@ -180,13 +189,66 @@ static void ppmOverflowCallback(timerOvrHandlerRec_t* cbRec, captureCompare_t ca
 
 }
 
+static void ppmProcessPulse(uint32_t deltaTime)
+{
+    int32_t i;
+
+    /* Sync pulse detection */
+    if (deltaTime > PPM_IN_MIN_SYNC_PULSE_US) {
+        if (ppmDev.pulseIndex == ppmDev.numChannelsPrevFrame
+            && ppmDev.pulseIndex >= PPM_IN_MIN_NUM_CHANNELS
+            && ppmDev.pulseIndex <= PPM_IN_MAX_NUM_CHANNELS) {
+            /* If we see n simultaneous frames of the same
+               number of channels we save it as our frame size */
+            if (ppmDev.stableFramesSeenCount < PPM_STABLE_FRAMES_REQUIRED_COUNT) {
+                ppmDev.stableFramesSeenCount++;
+            } else {
+                ppmDev.numChannels = ppmDev.pulseIndex;
+            }
+        } else {
+            ppmDev.stableFramesSeenCount = 0;
+        }
+
+        /* Check if the last frame was well formed */
+        if (ppmDev.pulseIndex == ppmDev.numChannels && ppmDev.tracking) {
+            /* The last frame was well formed */
+            for (i = 0; i < ppmDev.numChannels; i++) {
+                captures[i] = ppmDev.captures[i];
+            }
+            for (i = ppmDev.numChannels; i < PPM_IN_MAX_NUM_CHANNELS; i++) {
+                captures[i] = PPM_RCVR_TIMEOUT;
+            }
+            ppmFrameCount++;
+        }
+
+        ppmDev.tracking   = true;
+        ppmDev.numChannelsPrevFrame = ppmDev.pulseIndex;
+        ppmDev.pulseIndex = 0;
+
+        /* We rely on the supervisor to set captureValue to invalid
+           if no valid frame is found otherwise we ride over it */
+    } else if (ppmDev.tracking) {
+        /* Valid pulse duration 0.75 to 2.5 ms*/
+        if (deltaTime > PPM_IN_MIN_CHANNEL_PULSE_US
+            && deltaTime < PPM_IN_MAX_CHANNEL_PULSE_US
+            && ppmDev.pulseIndex < PPM_IN_MAX_NUM_CHANNELS) {
+            ppmDev.captures[ppmDev.pulseIndex] = deltaTime;
+            ppmDev.pulseIndex++;
+        } else {
+            /* Not a valid pulse duration */
+            ppmDev.tracking = false;
+            for (i = 0; i < PWM_PORTS_OR_PPM_CAPTURE_COUNT; i++) {
+                ppmDev.captures[i] = PPM_RCVR_TIMEOUT;
+            }
+        }
+    }
+}
+
 static void ppmEdgeCallback(timerCCHandlerRec_t* cbRec, captureCompare_t capture)
 {
     UNUSED(cbRec);
     ppmISREvent(SOURCE_EDGE, capture);
 
-    int32_t i;
-
     uint32_t previousTime = ppmDev.currentTime;
     uint32_t previousCapture = ppmDev.currentCapture;
 
@@ -238,56 +300,57 @@ static void ppmEdgeCallback(timerCCHandlerRec_t* cbRec, captureCompare_t capture
     UNUSED(captureTimes);
 #endif
 
-    /* Sync pulse detection */
-    if (ppmDev.deltaTime > PPM_IN_MIN_SYNC_PULSE_US) {
-        if (ppmDev.pulseIndex == ppmDev.numChannelsPrevFrame
-            && ppmDev.pulseIndex >= PPM_IN_MIN_NUM_CHANNELS
-            && ppmDev.pulseIndex <= PPM_IN_MAX_NUM_CHANNELS) {
-            /* If we see n simultaneous frames of the same
-               number of channels we save it as our frame size */
-            if (ppmDev.stableFramesSeenCount < PPM_STABLE_FRAMES_REQUIRED_COUNT) {
-                ppmDev.stableFramesSeenCount++;
-            } else {
-                ppmDev.numChannels = ppmDev.pulseIndex;
-            }
-        } else {
-            ppmDev.stableFramesSeenCount = 0;
-        }
+    ppmProcessPulse(ppmDev.deltaTime);
+}
 
-        /* Check if the last frame was well formed */
-        if (ppmDev.pulseIndex == ppmDev.numChannels && ppmDev.tracking) {
-            /* The last frame was well formed */
-            for (i = 0; i < ppmDev.numChannels; i++) {
-                captures[i] = ppmDev.captures[i];
-            }
-            for (i = ppmDev.numChannels; i < PPM_IN_MAX_NUM_CHANNELS; i++) {
-                captures[i] = PPM_RCVR_TIMEOUT;
-            }
-            ppmFrameCount++;
-        }
+#ifdef USE_PPM_DMA
+/*
+ * With a DMA channel for the capture requests of the PPM timer channel every rising edge is copied into a circular
+ * buffer without an interrupt.  The edges are decoded in task context when the RX task polls for a new frame, the
+ * buffer holds a few frames so the task can be late.
+ *
+ * The captures are 16 bit at 1 MHz, the edges of a PPM frame are never a timer period (65ms) apart so their
+ * difference doesn't need the overflows.  After an outage the first pulse is garbage and the frame is rejected.
+ *
+ * The half and full transfer flags tell how far the DMA got since the last poll.  When it passed both the buffer
+ * may have been overwritten under the read index, the edges are dropped and the decoder waits for the next sync.
+ */
+#define PPM_DMA_BUFFER_SIZE 64
 
-        ppmDev.tracking   = true;
-        ppmDev.numChannelsPrevFrame = ppmDev.pulseIndex;
-        ppmDev.pulseIndex = 0;
+STATIC_UNIT_TESTED captureCompare_t ppmDmaBuffer[PPM_DMA_BUFFER_SIZE];
+static dmaChannel_t *ppmDmaDescriptor = NULL;
+static uint8_t ppmDmaReadIndex;
+static captureCompare_t ppmDmaPreviousCapture;
 
-        /* We rely on the supervisor to set captureValue to invalid
-           if no valid frame is found otherwise we ride over it */
-    } else if (ppmDev.tracking) {
-        /* Valid pulse duration 0.75 to 2.5 ms*/
-        if (ppmDev.deltaTime > PPM_IN_MIN_CHANNEL_PULSE_US
-            && ppmDev.deltaTime < PPM_IN_MAX_CHANNEL_PULSE_US
-            && ppmDev.pulseIndex < PPM_IN_MAX_NUM_CHANNELS) {
-            ppmDev.captures[ppmDev.pulseIndex] = ppmDev.deltaTime;
-            ppmDev.pulseIndex++;
-        } else {
-            /* Not a valid pulse duration */
-            ppmDev.tracking = false;
-            for (i = 0; i < PWM_PORTS_OR_PPM_CAPTURE_COUNT; i++) {
-                ppmDev.captures[i] = PPM_RCVR_TIMEOUT;
-            }
-        }
+static void ppmDmaProcessEdges(void)
+{
+    if (!ppmDmaDescriptor) {
+        return;
+    }
+
+    // read the flags before the write index, an edge written in between is decoded now and flagged at the next poll
+    const bool passedHalf = DMA_GET_FLAG_STATUS(ppmDmaDescriptor, DMA_IT_HTIF);
+    const bool passedEnd = DMA_GET_FLAG_STATUS(ppmDmaDescriptor, DMA_IT_TCIF);
+    DMA_CLEAR_FLAG(ppmDmaDescriptor, DMA_IT_HTIF | DMA_IT_TCIF);
+
+    const uint8_t writeIndex = PPM_DMA_BUFFER_SIZE - DMA_GetCurrDataCounter(ppmDmaDescriptor->channel);
+
+    if (passedHalf && passedEnd) {
+        ppmDmaReadIndex = writeIndex;
+        ppmDmaPreviousCapture = ppmDmaBuffer[(writeIndex + PPM_DMA_BUFFER_SIZE - 1) % PPM_DMA_BUFFER_SIZE];
+        ppmDev.tracking = false;
+        return;
+    }
+
+    while (ppmDmaReadIndex != writeIndex) {
+        const captureCompare_t capture = ppmDmaBuffer[ppmDmaReadIndex];
+        ppmDmaReadIndex = (ppmDmaReadIndex + 1) % PPM_DMA_BUFFER_SIZE;
+
+        ppmProcessPulse((captureCompare_t)(capture - ppmDmaPreviousCapture));
+        ppmDmaPreviousCapture = capture;
     }
 }
+#endif
 
 #define MAX_MISSED_PWM_EVENTS 10
 
@@ -414,6 +477,54 @@ void ppmInConfig(const timerHardware_t *timerHardwarePtr)
     timerChConfigCallbacks(timerHardwarePtr, &self->edgeCb, &self->overflowCb);
 }
 
+#ifdef USE_PPM_DMA
+/*
+ * Called once the motors have been configured, DShot outputs get the DMA channels first.  Without a free DMA channel
+ * PPM stays on the edge interrupt.
+ */
+void ppmInDmaConfig(void)
+{
+    DMA_InitTypeDef DMA_InitStructure;
+
+    const timerHardware_t *timerHardwarePtr = pwmInputPorts[FIRST_PWM_PORT].timerHardware;
+
+    // the 8 MHz timer shared with the motors overflows between the edges of a frame, that needs the interrupts
+    if (ppmCountShift) {
+        return;
+    }
+
+    const timerDmaMapping_t *mapping = timerDmaAllocate(timerHardwarePtr);
+    if (!mapping) {
+        return;
+    }
+
+    timerChITConfig(timerHardwarePtr, DISABLE);
+
+    DMA_DeInit(mapping->dmaChannel);
+
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)timerChCCR(timerHardwarePtr);
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)ppmDmaBuffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = PPM_DMA_BUFFER_SIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+
+    DMA_Init(mapping->dmaChannel, &DMA_InitStructure);
+    DMA_Cmd(mapping->dmaChannel, ENABLE);
+
+    ppmDmaDescriptor = dmaFindChannelDescriptor(mapping->dmaChannel);
+    ppmDmaReadIndex = 0;
+
+    TIM_DMACmd(timerHardwarePtr->tim, timerDmaSource(timerHardwarePtr->channel), ENABLE);
+}
+#endif
+
 uint16_t ppmRead(uint8_t channel)
 {
     return captures[channel];
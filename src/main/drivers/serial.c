@@ -56,12 +56,30 @@ void serialWriteBuf(serialPort_t *instance, uint8_t *data, int count)
     }
 }
 
-uint8_t serialRxBytesWaiting(serialPort_t *instance)
+/*
+ * The segments are sent in order after anything written before them.  Ports that can't send them from the caller's
+ * memory copy them into the transmit buffer, the callbacks are called as soon as each segment has been copied.
+ */
+void serialWriteSegments(serialPort_t *instance, const serialTxSegment_t *segments, int count)
+{
+    if (instance->vTable->writeSegments && instance->vTable->writeSegments(instance, segments, count)) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        serialWriteBuf(instance, (uint8_t *)segments[i].data, segments[i].length);
+        if (segments[i].callback) {
+            segments[i].callback(segments[i].context);
+        }
+    }
+}
+
+uint16_t serialRxBytesWaiting(serialPort_t *instance)
 {
     return instance->vTable->serialTotalRxWaiting(instance);
 }
 
-uint8_t serialTxBytesFree(serialPort_t *instance)
+uint16_t serialTxBytesFree(serialPort_t *instance)
 {
     return instance->vTable->serialTotalTxFree(instance);
 }
@@ -102,3 +120,11 @@ void serialEndWrite(serialPort_t *instance)
     if (instance->vTable->endWrite)
         instance->vTable->endWrite(instance);
 }
+
+bool serialSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr frameCallback)
+{
+    if (!instance->vTable->setReceiveFrameCallback)
+        return false;
+
+    return instance->vTable->setReceiveFrameCallback(instance, frameCallback);
+}
@@ -36,6 +36,37 @@ typedef enum portOptions_t {
 
 typedef void (*serialReceiveCallbackPtr)(uint16_t data);   // used by serial drivers to return frames to app
 
+// used by serial drivers to return the bytes received until the line went idle, with the micros() time of the last stop bit
+typedef void (*serialReceiveFrameCallbackPtr)(const uint8_t *frame, uint8_t length, uint32_t frameEndAt);
+
+// longer bursts are dropped, they are not frames of a receiver protocol
+#define SERIAL_RX_FRAME_SIZE_MAX 64
+
+/*
+ * The receive and transmit buffers are ring buffers with a power of two size, the head and tail are wrapped by
+ * masking.  One byte stays free so a full buffer can be told from an empty one.
+ */
+#define SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(size) (((size) & ((size) - 1)) == 0)
+
+static inline uint32_t serialBufferNext(uint32_t index, uint32_t size) { return (index + 1) & (size - 1); }
+static inline uint16_t serialBufferUsed(uint32_t head, uint32_t tail, uint32_t size) { return (head - tail) & (size - 1); }
+static inline uint16_t serialBufferFree(uint32_t head, uint32_t tail, uint32_t size) { return (size - 1) - serialBufferUsed(head, tail, size); }
+
+// called once the data of a segment has been sent and the memory can be used again
+typedef void (*serialTxCompleteCallbackPtr)(void *context);
+
+/*
+ * A block of the caller's memory to be transmitted as it is.  Ports with a transmit DMA send it from where it is
+ * instead of copying it into the transmit buffer, so the data must not change until the callback has been called.
+ * The callback may be called from the DMA interrupt.
+ */
+typedef struct serialTxSegment_s {
+    const uint8_t *data;
+    uint16_t length;
+    serialTxCompleteCallbackPtr callback;   // optional
+    void *context;
+} serialTxSegment_t;
+
 typedef struct serialPort_s {
 
     const struct serialPortVTable *vTable;
@@ -57,13 +88,14 @@ typedef struct serialPort_s {
 
     // FIXME rename member to rxCallback
     serialReceiveCallbackPtr callback;
+    serialReceiveFrameCallbackPtr frameCallback;
 } serialPort_t;
 
 struct serialPortVTable {
     void (*serialWrite)(serialPort_t *instance, uint8_t ch);
 
-    uint8_t (*serialTotalRxWaiting)(serialPort_t *instance);
-    uint8_t (*serialTotalTxFree)(serialPort_t *instance);
+    uint16_t (*serialTotalRxWaiting)(serialPort_t *instance);
+    uint16_t (*serialTotalTxFree)(serialPort_t *instance);
 
     uint8_t (*serialRead)(serialPort_t *instance);
 
@@ -78,12 +110,19 @@ struct serialPortVTable {
     // Optional functions used to buffer large writes.
     void (*beginWrite)(serialPort_t *instance);
     void (*endWrite)(serialPort_t *instance);
+
+    // Optional, frames replace the receive callback.
+    bool (*setReceiveFrameCallback)(serialPort_t *instance, serialReceiveFrameCallbackPtr frameCallback);
+
+    // Optional, queues all of the segments to be sent by DMA or none of them.
+    bool (*writeSegments)(serialPort_t *instance, const serialTxSegment_t *segments, int count);
 };
 
 void serialWrite(serialPort_t *instance, uint8_t ch);
-uint8_t serialRxBytesWaiting(serialPort_t *instance);
-uint8_t serialTxBytesFree(serialPort_t *instance);
+uint16_t serialRxBytesWaiting(serialPort_t *instance);
+uint16_t serialTxBytesFree(serialPort_t *instance);
 void serialWriteBuf(serialPort_t *instance, uint8_t *data, int count);
+void serialWriteSegments(serialPort_t *instance, const serialTxSegment_t *segments, int count);
 uint8_t serialRead(serialPort_t *instance);
 void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate);
 void serialSetMode(serialPort_t *instance, portMode_t mode);
@@ -95,3 +134,4 @@ uint32_t serialGetBaudRate(serialPort_t *instance);
 void serialWriteBufShim(void *instance, uint8_t *data, int count);
 void serialBeginWrite(serialPort_t *instance);
 void serialEndWrite(serialPort_t *instance);
+bool serialSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr frameCallback);
@@ -247,10 +247,8 @@ void processTxState(softSerial_t *softSerial)
         }
 
         // data to send
-        byteToSend = softSerial->port.txBuffer[softSerial->port.txBufferTail++];
-        if (softSerial->port.txBufferTail >= softSerial->port.txBufferSize) {
-            softSerial->port.txBufferTail = 0;
-        }
+        byteToSend = softSerial->port.txBuffer[softSerial->port.txBufferTail];
+        softSerial->port.txBufferTail = serialBufferNext(softSerial->port.txBufferTail, softSerial->port.txBufferSize);
 
         // build internal buffer, MSB = Stop Bit (1) + data bits (MSB to LSB) + start bit(0) LSB
         softSerial->internalTxBuffer = (1 << (TX_TOTAL_BITS - 1)) | (byteToSend << 1);
@@ -327,7 +325,7 @@ void extractAndStoreRxByte(softSerial_t *softSerial)
         softSerial->port.callback(rxByte);
     } else {
         softSerial->port.rxBuffer[softSerial->port.rxBufferHead] = rxByte;
-        softSerial->port.rxBufferHead = (softSerial->port.rxBufferHead + 1) % softSerial->port.rxBufferSize;
+        softSerial->port.rxBufferHead = serialBufferNext(softSerial->port.rxBufferHead, softSerial->port.rxBufferSize);
     }
 }
 
@@ -409,7 +407,7 @@ void onSerialRxPinChange(timerCCHandlerRec_t *cbRec, captureCompare_t capture)
     }
 }
 
-uint8_t softSerialRxBytesWaiting(serialPort_t *instance)
+uint16_t softSerialRxBytesWaiting(serialPort_t *instance)
 {
     if ((instance->mode & MODE_RX) == 0) {
         return 0;
@@ -417,10 +415,10 @@ uint8_t softSerialRxBytesWaiting(serialPort_t *instance)
 
     softSerial_t *s = (softSerial_t *)instance;
 
-    return (s->port.rxBufferHead - s->port.rxBufferTail) & (s->port.rxBufferSize - 1);
+    return serialBufferUsed(s->port.rxBufferHead, s->port.rxBufferTail, s->port.rxBufferSize);
 }
 
-uint8_t softSerialTxBytesFree(serialPort_t *instance)
+uint16_t softSerialTxBytesFree(serialPort_t *instance)
 {
     if ((instance->mode & MODE_TX) == 0) {
         return 0;
@@ -428,9 +426,7 @@ uint8_t softSerialTxBytesFree(serialPort_t *instance)
 
     softSerial_t *s = (softSerial_t *)instance;
 
-    uint8_t bytesUsed = (s->port.txBufferHead - s->port.txBufferTail) & (s->port.txBufferSize - 1);
-
-    return (s->port.txBufferSize - 1) - bytesUsed;
+    return serialBufferFree(s->port.txBufferHead, s->port.txBufferTail, s->port.txBufferSize);
 }
 
 uint8_t softSerialReadByte(serialPort_t *instance)
@@ -446,7 +442,7 @@ uint8_t softSerialReadByte(serialPort_t *instance)
     }
 
     ch = instance->rxBuffer[instance->rxBufferTail];
-    instance->rxBufferTail = (instance->rxBufferTail + 1) % instance->rxBufferSize;
+    instance->rxBufferTail = serialBufferNext(instance->rxBufferTail, instance->rxBufferSize);
     return ch;
 }
 
@@ -457,7 +453,7 @@ void softSerialWriteByte(serialPort_t *s, uint8_t ch)
     }
 
     s->txBuffer[s->txBufferHead] = ch;
-    s->txBufferHead = (s->txBufferHead + 1) % s->txBufferSize;
+    s->txBufferHead = serialBufferNext(s->txBufferHead, s->txBufferSize);
 }
 
 void softSerialSetBaudRate(serialPort_t *s, uint32_t baudRate)
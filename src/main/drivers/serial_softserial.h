@@ -17,7 +17,7 @@
 
 #pragma once
 
-#define SOFTSERIAL_BUFFER_SIZE 256
+#define SOFTSERIAL_BUFFER_SIZE 256            // a power of two, see serialBufferNext()
 
 typedef enum {
     SOFTSERIAL1 = 0,
@@ -28,8 +28,8 @@ serialPort_t *openSoftSerial(softSerialPortIndex_e portIndex, serialReceiveCallb
 
 // serialPort API
 void softSerialWriteByte(serialPort_t *instance, uint8_t ch);
-uint8_t softSerialRxBytesWaiting(serialPort_t *instance);
-uint8_t softSerialTxBytesFree(serialPort_t *instance);
+uint16_t softSerialRxBytesWaiting(serialPort_t *instance);
+uint16_t softSerialTxBytesFree(serialPort_t *instance);
 uint8_t softSerialReadByte(serialPort_t *instance);
 void softSerialSetBaudRate(serialPort_t *s, uint32_t baudRate);
 bool isSoftSerialTransmitBufferEmpty(serialPort_t *s);
@@ -28,11 +28,13 @@
 
 #include "build/build_config.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 #include "gpio.h"
 #include "inverter.h"
 
 #include "dma.h"
+#include "system.h"
 #include "serial.h"
 #include "serial_uart.h"
 #include "serial_uart_impl.h"
@@ -145,6 +147,10 @@ static void uartReconfigure(uartPort_t *uartPort)
 
     USART_Init(uartPort->USARTx, &USART_InitStructure);
 
+    // start bit, 8 data bits, parity and stop bits
+    const uint32_t charBits = 1 + 8 + ((uartPort->port.options & SERIAL_PARITY_EVEN) ? 1 : 0) + ((uartPort->port.options & SERIAL_STOPBITS_2) ? 2 : 1);
+    uartPort->rxCharTime = charBits * 1000000 / uartPort->port.baudRate;
+
     usartConfigurePinInversion(uartPort);
 
     if(uartPort->port.options & SERIAL_BIDIR)
@@ -181,12 +187,15 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback,
         return (serialPort_t *)s;
     }
     s->txDMAEmpty = true;
+    s->txDMASegment = false;
+    s->txSegmentHead = s->txSegmentTail = 0;
 
     // common serial initialisation code should move to serialPort::init()
     s->port.rxBufferHead = s->port.rxBufferTail = 0;
     s->port.txBufferHead = s->port.txBufferTail = 0;
     // callback works for IRQ-based RX ONLY
     s->port.callback = callback;
+    s->port.frameCallback = NULL;
     s->port.mode = mode;
     s->port.baudRate = baudRate;
     s->port.options = options;
@@ -196,7 +205,9 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback,
     // Receive DMA or IRQ
     DMA_InitTypeDef DMA_InitStructure;
     if (mode & MODE_RX) {
-        if (s->rxDMAChannel) {
+        USART_ITConfig(s->USARTx, USART_IT_IDLE, DISABLE);
+
+        if (s->rxDMAChannel && !callback) {
             DMA_StructInit(&DMA_InitStructure);
             DMA_InitStructure.DMA_PeripheralBaseAddr = s->rxDMAPeripheralBaseAddr;
             DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
@@ -216,6 +227,9 @@ serialPort_t *uartOpen(USART_TypeDef *USARTx, serialReceiveCallbackPtr callback,
             USART_DMACmd(s->USARTx, USART_DMAReq_Rx, ENABLE);
             s->rxDMAPos = DMA_GetCurrDataCounter(s->rxDMAChannel);
         } else {
+            // the receive callback is called from the RXNE interrupt for each byte
+            s->rxDMAChannel = NULL;
+            USART_DMACmd(s->USARTx, USART_DMAReq_Rx, DISABLE);
             USART_ClearITPendingBit(s->USARTx, USART_IT_RXNE);
             USART_ITConfig(s->USARTx, USART_IT_RXNE, ENABLE);
         }
@@ -266,57 +280,141 @@ void uartSetMode(serialPort_t *instance, portMode_t mode)
     uartReconfigure(uartPort);
 }
 
+/*
+ * Queued segments are sent once the transmit buffer has been sent up to where it was when they were queued, the bytes
+ * written after them wait in the transmit buffer.
+ */
 void uartStartTxDMA(uartPort_t *s)
 {
+    uint32_t txBufferEnd = s->port.txBufferHead;
+
+    if (s->txSegmentTail != s->txSegmentHead) {
+        const uint32_t segmentStart = s->txSegmentStart[s->txSegmentTail];
+
+        if (s->port.txBufferTail == segmentStart) {
+            const serialTxSegment_t *segment = &s->txSegments[s->txSegmentTail];
+            s->txDMAChannel->CMAR = (uint32_t)segment->data;
+            s->txDMAChannel->CNDTR = segment->length;
+            s->txDMASegment = true;
+            s->txDMAEmpty = false;
+            DMA_Cmd(s->txDMAChannel, ENABLE);
+            return;
+        }
+        txBufferEnd = segmentStart;
+    }
+
     s->txDMAChannel->CMAR = (uint32_t)&s->port.txBuffer[s->port.txBufferTail];
-    if (s->port.txBufferHead > s->port.txBufferTail) {
-        s->txDMAChannel->CNDTR = s->port.txBufferHead - s->port.txBufferTail;
-        s->port.txBufferTail = s->port.txBufferHead;
+    if (txBufferEnd > s->port.txBufferTail) {
+        s->txDMAChannel->CNDTR = txBufferEnd - s->port.txBufferTail;
+        s->port.txBufferTail = txBufferEnd;
     } else {
         s->txDMAChannel->CNDTR = s->port.txBufferSize - s->port.txBufferTail;
         s->port.txBufferTail = 0;
     }
+    s->txDMASegment = false;
     s->txDMAEmpty = false;
     DMA_Cmd(s->txDMAChannel, ENABLE);
 }
 
-uint8_t uartTotalRxBytesWaiting(serialPort_t *instance)
+// called from the transmit DMA interrupt once the channel has been disabled
+void uartTxDMAComplete(uartPort_t *s)
 {
-    uartPort_t *s = (uartPort_t*)instance;
-    if (s->rxDMAChannel) {
-        uint32_t rxDMAHead = s->rxDMAChannel->CNDTR;
-        if (rxDMAHead >= s->rxDMAPos) {
-            return rxDMAHead - s->rxDMAPos;
-        } else {
-            return s->port.rxBufferSize + rxDMAHead - s->rxDMAPos;
+    if (s->txDMASegment) {
+        const serialTxSegment_t *segment = &s->txSegments[s->txSegmentTail];
+        const serialTxCompleteCallbackPtr callback = segment->callback;
+        void *context = segment->context;
+
+        s->txDMASegment = false;
+        s->txSegmentTail = serialBufferNext(s->txSegmentTail, UART_TX_SEGMENT_QUEUE_SIZE);
+
+        if (callback) {
+            callback(context);
+        }
+
+        // the callback may have queued more and started the DMA already
+        if (s->txDMAChannel->CCR & 1) {
+            return;
         }
     }
 
-    if (s->port.rxBufferHead >= s->port.rxBufferTail) {
-        return s->port.rxBufferHead - s->port.rxBufferTail;
-    } else {
-        return s->port.rxBufferSize + s->port.rxBufferHead - s->port.rxBufferTail;
+    if (s->port.txBufferHead != s->port.txBufferTail || s->txSegmentHead != s->txSegmentTail)
+        uartStartTxDMA(s);
+    else
+        s->txDMAEmpty = true;
+}
+
+/*
+ * Frames are delimited by the idle line interrupt, so the bytes are received by the DMA, or stored by the RXNE
+ * interrupt, without looking at them and the receiver protocol gets each frame once with the time it ended.
+ */
+bool uartSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr frameCallback)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+
+    if (!(s->port.mode & MODE_RX)) {
+        return false;
     }
+
+    // reopen without the receive callback, that uses the receive DMA when the port has a channel for it
+    uartOpen(s->USARTx, NULL, s->port.baudRate, s->port.mode, s->port.options);
+
+    s->port.frameCallback = frameCallback;
+    USART_ITConfig(s->USARTx, USART_IT_IDLE, ENABLE);
+
+    return true;
 }
 
-uint8_t uartTotalTxBytesFree(serialPort_t *instance)
+// called from the USART interrupt handler when the line has gone idle, the idle flag must be cleared by the caller
+void uartRxIdleHandler(uartPort_t *s)
 {
-    uartPort_t *s = (uartPort_t*)instance;
+    if (!s->port.frameCallback) {
+        USART_ITConfig(s->USARTx, USART_IT_IDLE, DISABLE);
+        return;
+    }
 
-    uint32_t bytesUsed;
+    const uint32_t frameEndAt = micros() - s->rxCharTime;
+    uint8_t frame[SERIAL_RX_FRAME_SIZE_MAX];
+    uint32_t length = 0;
 
-    if (s->port.txBufferHead >= s->port.txBufferTail) {
-        bytesUsed = s->port.txBufferHead - s->port.txBufferTail;
-    } else {
-        bytesUsed = s->port.txBufferSize + s->port.txBufferHead - s->port.txBufferTail;
+    while (uartTotalRxBytesWaiting(&s->port)) {
+        const uint8_t ch = uartRead(&s->port);
+        if (length < SERIAL_RX_FRAME_SIZE_MAX) {
+            frame[length] = ch;
+        }
+        length++;
+    }
+
+    if (length > 0 && length <= SERIAL_RX_FRAME_SIZE_MAX) {
+        s->port.frameCallback(frame, length, frameEndAt);
+    }
+}
+
+uint16_t uartTotalRxBytesWaiting(serialPort_t *instance)
+{
+    uartPort_t *s = (uartPort_t*)instance;
+    if (s->rxDMAChannel) {
+        // the DMA counts down from the end of the buffer, rxDMAPos is the count at the next byte to read
+        return (s->rxDMAPos - s->rxDMAChannel->CNDTR) & (s->port.rxBufferSize - 1);
     }
 
+    return serialBufferUsed(s->port.rxBufferHead, s->port.rxBufferTail, s->port.rxBufferSize);
+}
+
+uint16_t uartTotalTxBytesFree(serialPort_t *instance)
+{
+    uartPort_t *s = (uartPort_t*)instance;
+
+    uint32_t bytesUsed = serialBufferUsed(s->port.txBufferHead, s->port.txBufferTail, s->port.txBufferSize);
+
     if (s->txDMAChannel) {
         /*
          * When we queue up a DMA request, we advance the Tx buffer tail before the transfer finishes, so we must add
-         * the remaining size of that in-progress transfer here instead:
+         * the remaining size of that in-progress transfer here instead.  Segments are sent from the caller's memory
+         * and don't use the Tx buffer.
          */
-        bytesUsed += s->txDMAChannel->CNDTR;
+        if (!s->txDMASegment) {
+            bytesUsed += s->txDMAChannel->CNDTR;
+        }
 
         /*
          * If the Tx buffer is being written to very quickly, we might have advanced the head into the buffer
@@ -354,11 +452,7 @@ uint8_t uartRead(serialPort_t *instance)
             s->rxDMAPos = s->port.rxBufferSize;
     } else {
         ch = s->port.rxBuffer[s->port.rxBufferTail];
-        if (s->port.rxBufferTail + 1 >= s->port.rxBufferSize) {
-            s->port.rxBufferTail = 0;
-        } else {
-            s->port.rxBufferTail++;
-        }
+        s->port.rxBufferTail = serialBufferNext(s->port.rxBufferTail, s->port.rxBufferSize);
     }
 
     return ch;
@@ -368,11 +462,7 @@ void uartWrite(serialPort_t *instance, uint8_t ch)
 {
     uartPort_t *s = (uartPort_t *)instance;
     s->port.txBuffer[s->port.txBufferHead] = ch;
-    if (s->port.txBufferHead + 1 >= s->port.txBufferSize) {
-        s->port.txBufferHead = 0;
-    } else {
-        s->port.txBufferHead++;
-    }
+    s->port.txBufferHead = serialBufferNext(s->port.txBufferHead, s->port.txBufferSize);
 
     if (s->txDMAChannel) {
         if (!(s->txDMAChannel->CCR & 1))
@@ -382,6 +472,64 @@ void uartWrite(serialPort_t *instance, uint8_t ch)
     }
 }
 
+// copies as much as fits each time round and starts the transmission once per copy rather than once per byte
+void uartWriteBuf(serialPort_t *instance, void *data, int count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+    const uint8_t *p = data;
+
+    while (count > 0) {
+        uint32_t length = MIN(uartTotalTxBytesFree(instance), (uint32_t)count);
+        if (length == 0) {
+            continue;
+        }
+        count -= length;
+
+        while (length--) {
+            s->port.txBuffer[s->port.txBufferHead] = *p++;
+            s->port.txBufferHead = serialBufferNext(s->port.txBufferHead, s->port.txBufferSize);
+        }
+
+        if (s->txDMAChannel) {
+            if (!(s->txDMAChannel->CCR & 1))
+                uartStartTxDMA(s);
+        } else {
+            USART_ITConfig(s->USARTx, USART_IT_TXE, ENABLE);
+        }
+    }
+}
+
+/*
+ * The segments are sent by the transmit DMA from the caller's memory, ports without one and a full queue leave the
+ * caller to copy them.
+ */
+bool uartWriteSegments(serialPort_t *instance, const serialTxSegment_t *segments, int count)
+{
+    uartPort_t *s = (uartPort_t *)instance;
+
+    if (!s->txDMAChannel || count > serialBufferFree(s->txSegmentHead, s->txSegmentTail, UART_TX_SEGMENT_QUEUE_SIZE)) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (segments[i].length == 0) {
+            // nothing for the DMA to send, so there would be no transfer complete interrupt
+            if (segments[i].callback) {
+                segments[i].callback(segments[i].context);
+            }
+            continue;
+        }
+        s->txSegments[s->txSegmentHead] = segments[i];
+        s->txSegmentStart[s->txSegmentHead] = s->port.txBufferHead;
+        s->txSegmentHead = serialBufferNext(s->txSegmentHead, UART_TX_SEGMENT_QUEUE_SIZE);
+    }
+
+    if (s->txSegmentHead != s->txSegmentTail && !(s->txDMAChannel->CCR & 1))
+        uartStartTxDMA(s);
+
+    return true;
+}
+
 const struct serialPortVTable uartVTable[] = {
     {
         uartWrite,
@@ -391,8 +539,10 @@ const struct serialPortVTable uartVTable[] = {
         uartSetBaudRate,
         isUartTransmitBufferEmpty,
         uartSetMode,
-        .writeBuf = NULL,
+        .writeBuf = uartWriteBuf,
         .beginWrite = NULL,
         .endWrite = NULL,
+        .setReceiveFrameCallback = uartSetReceiveFrameCallback,
+        .writeSegments = uartWriteSegments,
     }
 };
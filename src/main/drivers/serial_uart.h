@@ -20,19 +20,55 @@
 // Since serial ports can be used for any function these buffer sizes should be equal
 // The two largest things that need to be sent are: 1, MSP responses, 2, UBLOX SVINFO packet.
 
-// Size must be a power of two due to various optimizations which use 'and' instead of 'mod'
-// Various serial routines return the buffer occupied size as uint8_t which would need to be extended in order to
-// increase size further.
+// Size must be a power of two, the buffers are wrapped by masking.  Targets with the RAM for fast blackbox logging
+// or MSP bulk transfers can define larger buffers, up to 32K.
+#ifndef UART1_RX_BUFFER_SIZE
 #define UART1_RX_BUFFER_SIZE    256
+#endif
+#ifndef UART1_TX_BUFFER_SIZE
 #define UART1_TX_BUFFER_SIZE    256
+#endif
+#ifndef UART2_RX_BUFFER_SIZE
 #define UART2_RX_BUFFER_SIZE    256
+#endif
+#ifndef UART2_TX_BUFFER_SIZE
 #define UART2_TX_BUFFER_SIZE    256
+#endif
+#ifndef UART3_RX_BUFFER_SIZE
 #define UART3_RX_BUFFER_SIZE    256
+#endif
+#ifndef UART3_TX_BUFFER_SIZE
 #define UART3_TX_BUFFER_SIZE    256
+#endif
+#ifndef UART4_RX_BUFFER_SIZE
 #define UART4_RX_BUFFER_SIZE    256
+#endif
+#ifndef UART4_TX_BUFFER_SIZE
 #define UART4_TX_BUFFER_SIZE    256
+#endif
+#ifndef UART5_RX_BUFFER_SIZE
 #define UART5_RX_BUFFER_SIZE    256
+#endif
+#ifndef UART5_TX_BUFFER_SIZE
 #define UART5_TX_BUFFER_SIZE    256
+#endif
+
+#if !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART1_RX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART1_TX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART2_RX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART2_TX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART3_RX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART3_TX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART4_RX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART4_TX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART5_RX_BUFFER_SIZE) || \
+    !SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(UART5_TX_BUFFER_SIZE)
+#error "UART buffer sizes must be a power of two"
+#endif
+
+// Segments queued to be sent by the transmit DMA from the caller's memory, a power of two.  One entry is kept empty to
+// tell a full queue from an empty one, so up to 7 segments are queued.
+#define UART_TX_SEGMENT_QUEUE_SIZE 8
 
 typedef struct {
     serialPort_t port;
@@ -45,6 +81,14 @@ typedef struct {
 
     uint32_t rxDMAPos;
     bool txDMAEmpty;
+    bool txDMASegment;                      // the DMA is sending txSegments[txSegmentTail], not the transmit buffer
+
+    serialTxSegment_t txSegments[UART_TX_SEGMENT_QUEUE_SIZE];
+    uint32_t txSegmentStart[UART_TX_SEGMENT_QUEUE_SIZE];   // the transmit buffer head when each segment was queued
+    uint8_t txSegmentHead;
+    uint8_t txSegmentTail;
+
+    uint32_t rxCharTime;                    // us, the line goes idle one character after the last stop bit
 
     uint32_t txDMAPeripheralBaseAddr;
     uint32_t rxDMAPeripheralBaseAddr;
@@ -61,8 +105,11 @@ void usartInitAllIOSignals(void);
 
 // serialPort API
 void uartWrite(serialPort_t *instance, uint8_t ch);
-uint8_t uartTotalRxBytesWaiting(serialPort_t *instance);
-uint8_t uartTotalTxBytesFree(serialPort_t *instance);
+void uartWriteBuf(serialPort_t *instance, void *data, int count);
+bool uartWriteSegments(serialPort_t *instance, const serialTxSegment_t *segments, int count);
+uint16_t uartTotalRxBytesWaiting(serialPort_t *instance);
+uint16_t uartTotalTxBytesFree(serialPort_t *instance);
 uint8_t uartRead(serialPort_t *instance);
 void uartSetBaudRate(serialPort_t *s, uint32_t baudRate);
 bool isUartTransmitBufferEmpty(serialPort_t *s);
+bool uartSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr frameCallback);
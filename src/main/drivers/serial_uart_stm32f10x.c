@@ -60,7 +60,8 @@ static uartPort_t uartPort4;
 static uartPort_t uartPort5;
 #endif
 
-// Using RX DMA disables the use of receive callbacks
+// The receive DMA is only used by frame receivers, ports with a receive callback are read by interrupt.
+// UART2 and UART3 can receive by DMA when USE_UART2_RX_DMA or USE_UART3_RX_DMA is defined in target.h.
 #define USE_UART1_RX_DMA
 
 #if defined(CC3D) // FIXME move board specific code to target.h files.
@@ -76,22 +77,25 @@ void usartIrqHandler(uartPort_t *s)
         if (s->port.callback) {
             s->port.callback(s->USARTx->DR);
         } else {
-            s->port.rxBuffer[s->port.rxBufferHead++] = s->USARTx->DR;
-            if (s->port.rxBufferHead >= s->port.rxBufferSize) {
-                s->port.rxBufferHead = 0;
-            }
+            s->port.rxBuffer[s->port.rxBufferHead] = s->USARTx->DR;
+            s->port.rxBufferHead = serialBufferNext(s->port.rxBufferHead, s->port.rxBufferSize);
         }
     }
     if (SR & USART_FLAG_TXE) {
         if (s->port.txBufferTail != s->port.txBufferHead) {
-            s->USARTx->DR = s->port.txBuffer[s->port.txBufferTail++];
-            if (s->port.txBufferTail >= s->port.txBufferSize) {
-                s->port.txBufferTail = 0;
-            }
+            s->USARTx->DR = s->port.txBuffer[s->port.txBufferTail];
+            s->port.txBufferTail = serialBufferNext(s->port.txBufferTail, s->port.txBufferSize);
         } else {
             USART_ITConfig(s->USARTx, USART_IT_TXE, DISABLE);
         }
     }
+    if ((SR & USART_FLAG_IDLE) && (s->USARTx->CR1 & USART_CR1_IDLEIE)) {
+        // the idle flag is cleared by reading SR then DR, a byte that arrived since is left for the RXNE interrupt
+        if (!(s->USARTx->SR & USART_FLAG_RXNE)) {
+            (void)s->USARTx->DR;
+        }
+        uartRxIdleHandler(s);
+    }
 }
 
 #ifdef USE_UART1
@@ -103,10 +107,7 @@ void UART_TX_DMA_IRQHandler(dmaChannel_t* descriptor, dmaCallbackHandler_t* hand
     DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
     DMA_Cmd(descriptor->channel, DISABLE);
 
-    if (s->port.txBufferHead != s->port.txBufferTail)
-        uartStartTxDMA(s);
-    else
-        s->txDMAEmpty = true;
+    uartTxDMAComplete(s);
 }
 
 // UART1 - Telemetry (RX/TX by DMA)
@@ -170,8 +171,7 @@ uartPort_t *serialUART1(uint32_t baudRate, portMode_t mode, portOptions_t option
     dmaHandlerInit(&uartPort1.dmaTxHandler, UART_TX_DMA_IRQHandler);
     dmaSetHandler(DMA1Channel4Descriptor, &uartPort1.dmaTxHandler, NVIC_PRIO_SERIALUART1_TXDMA);
 
-#ifndef USE_UART1_RX_DMA
-    // RX/TX Interrupt
+    // RX/TX Interrupt, also used for the idle line with RX DMA
     NVIC_InitTypeDef NVIC_InitStructure;
 
     NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQn;
@@ -179,7 +179,6 @@ uartPort_t *serialUART1(uint32_t baudRate, portMode_t mode, portOptions_t option
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(NVIC_PRIO_SERIALUART1);
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
-#endif
 
     return s;
 }
@@ -215,6 +214,9 @@ uartPort_t *serialUART2(uint32_t baudRate, portMode_t mode, portOptions_t option
     
     s->USARTx = USART2;
 
+#ifdef USE_UART2_RX_DMA
+    s->rxDMAChannel = DMA1_Channel6;
+#endif
     s->txDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
     s->rxDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
 
@@ -289,6 +291,9 @@ uartPort_t *serialUART3(uint32_t baudRate, portMode_t mode, portOptions_t option
 
     s->USARTx = USART3;
 
+#ifdef USE_UART3_RX_DMA
+    s->rxDMAChannel = DMA1_Channel3;
+#endif
     s->txDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
     s->rxDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
 
@@ -43,7 +43,8 @@
 #include "serial_uart_stm32f30x.h"
 
 
-// Using RX DMA disables the use of receive callbacks
+// Define these in target.h when the DMA channels are not used by anything else.
+// The receive DMA is only used by frame receivers, ports with a receive callback are read by interrupt.
 //#define USE_UART1_RX_DMA
 //#define USE_UART2_RX_DMA
 //#define USE_UART2_TX_DMA
@@ -72,10 +73,7 @@ static void handleUsartTxDma(dmaChannel_t* descriptor, dmaCallbackHandler_t* han
     DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
     DMA_Cmd(descriptor->channel, DISABLE);
 
-    if (s->port.txBufferHead != s->port.txBufferTail)
-        uartStartTxDMA(s);
-    else
-        s->txDMAEmpty = true;
+    uartTxDMAComplete(s);
 }
 
 #ifdef USE_UART1
@@ -139,13 +137,11 @@ uartPort_t *serialUART1(uint32_t baudRate, portMode_t mode, portOptions_t option
     dmaHandlerInit(&uartPort1.dmaTxHandler, handleUsartTxDma);
     dmaSetHandler(DMA1Channel4Descriptor, &uartPort1.dmaTxHandler, NVIC_PRIO_SERIALUART1_TXDMA);
 
-#ifndef USE_UART1_RX_DMA
     NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQn;
     NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(NVIC_PRIO_SERIALUART1_RXDMA);
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(NVIC_PRIO_SERIALUART1_RXDMA);
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
-#endif
 
     return s;
 }
@@ -215,13 +211,11 @@ uartPort_t *serialUART2(uint32_t baudRate, portMode_t mode, portOptions_t option
     dmaSetHandler(DMA1Channel7Descriptor, &uartPort2.dmaTxHandler, NVIC_PRIO_SERIALUART2_TXDMA);
 #endif
 
-#ifndef USE_UART2_RX_DMA
     NVIC_InitStructure.NVIC_IRQChannel = USART2_IRQn;
     NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(NVIC_PRIO_SERIALUART2_RXDMA);
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(NVIC_PRIO_SERIALUART2_RXDMA);
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
-#endif
 
     return s;
 }
@@ -291,13 +285,11 @@ uartPort_t *serialUART3(uint32_t baudRate, portMode_t mode, portOptions_t option
     dmaSetHandler(DMA1Channel2Descriptor, &uartPort3.dmaTxHandler, NVIC_PRIO_SERIALUART3_TXDMA);
 #endif
 
-#ifndef USE_UART3_RX_DMA
     NVIC_InitStructure.NVIC_IRQChannel = USART3_IRQn;
     NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(NVIC_PRIO_SERIALUART3_RXDMA);
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(NVIC_PRIO_SERIALUART3_RXDMA);
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
-#endif
 
     return s;
 }
@@ -311,24 +303,26 @@ void usartIrqHandler(uartPort_t *s)
         if (s->port.callback) {
             s->port.callback(s->USARTx->RDR);
         } else {
-            s->port.rxBuffer[s->port.rxBufferHead++] = s->USARTx->RDR;
-            if (s->port.rxBufferHead >= s->port.rxBufferSize) {
-                s->port.rxBufferHead = 0;
-            }
+            s->port.rxBuffer[s->port.rxBufferHead] = s->USARTx->RDR;
+            s->port.rxBufferHead = serialBufferNext(s->port.rxBufferHead, s->port.rxBufferSize);
         }
     }
 
     if (!s->txDMAChannel && (ISR & USART_FLAG_TXE)) {
         if (s->port.txBufferTail != s->port.txBufferHead) {
-            USART_SendData(s->USARTx, s->port.txBuffer[s->port.txBufferTail++]);
-            if (s->port.txBufferTail >= s->port.txBufferSize) {
-                s->port.txBufferTail = 0;
-            }
+            USART_SendData(s->USARTx, s->port.txBuffer[s->port.txBufferTail]);
+            s->port.txBufferTail = serialBufferNext(s->port.txBufferTail, s->port.txBufferSize);
         } else {
             USART_ITConfig(s->USARTx, USART_IT_TXE, DISABLE);
         }
     }
 
+    // the idle flag is also set on ports that don't receive frames, only those enable its interrupt
+    if ((ISR & USART_FLAG_IDLE) && (s->USARTx->CR1 & USART_CR1_IDLEIE)) {
+        USART_ClearITPendingBit(s->USARTx, USART_IT_IDLE);
+        uartRxIdleHandler(s);
+    }
+
     if (ISR & USART_FLAG_ORE)
     {
         USART_ClearITPendingBit (s->USARTx, USART_IT_ORE);
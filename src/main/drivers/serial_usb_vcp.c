@@ -61,11 +61,11 @@ static bool isUsbVcpTransmitBufferEmpty(serialPort_t *instance)
     return true;
 }
 
-static uint8_t usbVcpAvailable(serialPort_t *instance)
+static uint16_t usbVcpAvailable(serialPort_t *instance)
 {
     UNUSED(instance);
 
-    return receiveLength & 0xFF; // FIXME use uint32_t return type everywhere
+    return receiveLength;   // at most one 64 byte USB packet
 }
 
 static uint8_t usbVcpRead(serialPort_t *instance)
@@ -142,10 +142,10 @@ static void usbVcpBeginWrite(serialPort_t *instance)
     port->buffering = true;
 }
 
-uint8_t usbTxBytesFree()
+uint16_t usbTxBytesFree()
 {
     // Because we block upon transmit and don't buffer bytes, our "buffer" capacity is effectively unlimited.
-    return 255;
+    return UINT16_MAX;
 }
 
 static void usbVcpEndWrite(serialPort_t *instance)
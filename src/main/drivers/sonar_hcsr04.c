@@ -41,6 +41,7 @@
 
 #if defined(SONAR)
 STATIC_UNIT_TESTED volatile int32_t measurement = -1;
+static volatile uint32_t measurementAt;
 static uint32_t lastMeasurementAt;
 static sonarHardware_t const *sonarHardware;
 
@@ -60,6 +61,8 @@ void hcsr04_extiHandler(extiCallbackRec_t* cb)
         timing_stop = micros();
         if (timing_stop > timing_start) {
             measurement = timing_stop - timing_start;
+            // the ping reflected half way through the echo
+            measurementAt = timing_start + measurement / 2;
         }
     }
 }
@@ -122,6 +125,14 @@ void hcsr04_start_reading(void)
 #endif
 }
 
+/**
+ * Get the time at which the last pulse was reflected, in microseconds.
+ */
+uint32_t hcsr04_get_measurement_time(void)
+{
+    return measurementAt;
+}
+
 /**
  * Get the distance that was measured by the last pulse, in centimeters.
  */
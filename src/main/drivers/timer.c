@@ -29,6 +29,7 @@
 #include "gpio.h"
 #include "system.h"
 
+#include "dma.h"
 #include "timer.h"
 #include "timer_impl.h"
 
@@ -1030,3 +1031,123 @@ void timerForceOverflow(TIM_TypeDef *tim)
         tim->EGR |= TIM_EGR_UG;
     }
 }
+
+#ifdef USE_TIMER_DMA
+// DMA channels of the timer compare and capture requests, STM32F30x Reference Manual tables 78 and 79
+static const timerDmaMapping_t timerDmaMappings[] = {
+    { TIM1,  TIM_Channel_1, DMA1_Channel2, 0 },
+    { TIM1,  TIM_Channel_2, DMA1_Channel3, 0 },
+    { TIM1,  TIM_Channel_3, DMA1_Channel6, 0 },
+    { TIM1,  TIM_Channel_4, DMA1_Channel4, 0 },
+    { TIM2,  TIM_Channel_1, DMA1_Channel5, 0 },
+    { TIM2,  TIM_Channel_2, DMA1_Channel7, 0 },
+    { TIM2,  TIM_Channel_3, DMA1_Channel1, 0 },
+    { TIM2,  TIM_Channel_4, DMA1_Channel7, 0 },
+    { TIM3,  TIM_Channel_1, DMA1_Channel6, 0 },
+    { TIM3,  TIM_Channel_3, DMA1_Channel2, 0 },
+    { TIM3,  TIM_Channel_4, DMA1_Channel3, 0 },
+    { TIM4,  TIM_Channel_1, DMA1_Channel1, 0 },
+    { TIM4,  TIM_Channel_2, DMA1_Channel4, 0 },
+    { TIM4,  TIM_Channel_3, DMA1_Channel5, 0 },
+    { TIM8,  TIM_Channel_1, DMA2_Channel3, 0 },
+    { TIM8,  TIM_Channel_2, DMA2_Channel5, 0 },
+    { TIM8,  TIM_Channel_3, DMA2_Channel1, 0 },
+    { TIM8,  TIM_Channel_4, DMA2_Channel2, 0 },
+    { TIM15, TIM_Channel_1, DMA1_Channel5, 0 },
+    // TIM16 and TIM17 can be moved off the channels they share with TIM3/TIM1 and TIM4/TIM2, try that first
+    { TIM16, TIM_Channel_1, DMA1_Channel6, SYSCFG_DMARemap_TIM16 },
+    { TIM16, TIM_Channel_1, DMA1_Channel3, 0 },
+    { TIM17, TIM_Channel_1, DMA1_Channel7, SYSCFG_DMARemap_TIM17 },
+    { TIM17, TIM_Channel_1, DMA1_Channel1, 0 },
+};
+
+// channels of the other DMA users built into the target, a timer never gets them even when the feature is off
+static DMA_Channel_TypeDef * const timerDmaReservedChannels[] = {
+#ifdef USE_UART1
+    DMA1_Channel4,                  // UART1 TX
+#endif
+#ifdef USE_UART1_RX_DMA
+    DMA1_Channel5,
+#endif
+#ifdef USE_UART2_RX_DMA
+    DMA1_Channel6,
+#endif
+#ifdef USE_UART2_TX_DMA
+    DMA1_Channel7,
+#endif
+#ifdef USE_UART3_RX_DMA
+    DMA1_Channel3,
+#endif
+#ifdef USE_UART3_TX_DMA
+    DMA1_Channel2,
+#endif
+#ifdef USE_ADC
+    ADC_DMA_CHANNEL,
+#endif
+#if defined(LED_STRIP) && defined(WS2811_DMA_CHANNEL)
+    WS2811_DMA_CHANNEL,
+#elif defined(LED_STRIP)
+    DMA1_Channel3,                  // default of light_ws2811strip_stm32f30x.c
+#endif
+#if defined(TRANSPONDER) && defined(TRANSPONDER_DMA_CHANNEL)
+    TRANSPONDER_DMA_CHANNEL,
+#elif defined(TRANSPONDER)
+    DMA1_Channel3,                  // default of transponder_ir_stm32f30x.c
+#endif
+};
+
+static uint16_t timerDmaChannelsInUse = 0;
+
+static bool timerDmaChannelIsReserved(const DMA_Channel_TypeDef *dmaChannel)
+{
+    for (unsigned i = 0; i < ARRAYLEN(timerDmaReservedChannels); i++) {
+        if (timerDmaReservedChannels[i] == dmaChannel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t timerDmaSource(uint8_t channel)
+{
+    switch (channel) {
+        case TIM_Channel_1:
+            return TIM_DMA_CC1;
+        case TIM_Channel_2:
+            return TIM_DMA_CC2;
+        case TIM_Channel_3:
+            return TIM_DMA_CC3;
+        default:
+            return TIM_DMA_CC4;
+    }
+}
+
+/*
+ * Finds a free DMA channel for the capture/compare requests of a timer channel, remaps it if needed and enables its
+ * clock.  Returns NULL when all the channels the timer channel can use are taken or reserved.
+ */
+const timerDmaMapping_t *timerDmaAllocate(const timerHardware_t *timHw)
+{
+    for (unsigned i = 0; i < ARRAYLEN(timerDmaMappings); i++) {
+        const timerDmaMapping_t *mapping = &timerDmaMappings[i];
+        if (mapping->tim != timHw->tim || mapping->channel != timHw->channel || timerDmaChannelIsReserved(mapping->dmaChannel)) {
+            continue;
+        }
+
+        const uint16_t mask = 1 << (dmaFindChannelDescriptor(mapping->dmaChannel) - dmaChannels);
+        if (timerDmaChannelsInUse & mask) {
+            continue;
+        }
+        timerDmaChannelsInUse |= mask;
+
+        if (mapping->remap) {
+            RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+            SYSCFG_DMAChannelRemapConfig(mapping->remap, ENABLE);
+        }
+        RCC_AHBPeriphClockCmd(dmaFindChannelDescriptor(mapping->dmaChannel)->rcc, ENABLE);
+
+        return mapping;
+    }
+    return NULL;
+}
+#endif
@@ -118,3 +118,19 @@ void timerForceOverflow(TIM_TypeDef *tim);
 
 void configTimeBase(TIM_TypeDef *tim, uint16_t period, uint8_t mhz);  // TODO - just for migration
 
+#if defined(USE_DSHOT) || defined(USE_PPM_DMA)
+#define USE_TIMER_DMA
+#endif
+
+#ifdef USE_TIMER_DMA
+typedef struct timerDmaMapping_s {
+    TIM_TypeDef *tim;
+    uint8_t channel;
+    DMA_Channel_TypeDef *dmaChannel;
+    uint32_t remap;                         // SYSCFG DMA remap needed to use the channel, 0 for none
+} timerDmaMapping_t;
+
+const timerDmaMapping_t *timerDmaAllocate(const timerHardware_t *timHw);
+uint16_t timerDmaSource(uint8_t channel);
+#endif
+
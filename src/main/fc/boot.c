@@ -68,6 +68,7 @@
 #include "rx/spektrum.h"
 
 #include "fc/rc_controls.h"
+#include "fc/rc_smoothing.h"
 #include "fc/fc_serial.h"
 
 #include "io/serial.h"
@@ -400,7 +401,8 @@ void init(void)
     pwm_params.servoPwmRate = motorAndServoConfig()->servo_pwm_rate;
 #endif
 
-    pwm_params.useOneshot = feature(FEATURE_ONESHOT125);
+    pwm_params.motorPwmProtocol = getMotorPwmProtocol();
+    pwm_params.useOneshot = pwm_params.motorPwmProtocol >= PWM_TYPE_ONESHOT125 && pwm_params.motorPwmProtocol <= PWM_TYPE_MULTISHOT;
     pwm_params.motorPwmRate = motorAndServoConfig()->motor_pwm_rate;
     pwm_params.idlePulse = motorAndServoConfig()->mincommand;
     if (feature(FEATURE_3D))
@@ -420,7 +422,7 @@ void init(void)
     debug[3] = pwmIOConfiguration->ppmInputCount;
 #endif
 
-    if (!feature(FEATURE_ONESHOT125))
+    if (!pwm_params.useOneshot)
         motorControlEnable = true;
 
     systemState |= SYSTEM_STATE_MOTORS_READY;
@@ -564,6 +566,8 @@ void init(void)
 
     rxInit(modeActivationProfile()->modeActivationConditions);
 
+    rcSmoothingInit();
+
 #ifdef GPS
     if (feature(FEATURE_GPS)) {
         gpsInit();
@@ -695,7 +699,7 @@ void init(void)
 #ifdef SOFTSERIAL_LOOPBACK
 void processLoopback(void) {
     if (loopbackPort) {
-        uint8_t bytesWaiting;
+        uint16_t bytesWaiting;
         while ((bytesWaiting = serialRxBytesWaiting(loopbackPort))) {
             uint8_t b = serialRead(loopbackPort);
             serialWrite(loopbackPort, b);
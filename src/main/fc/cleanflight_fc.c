@@ -46,6 +46,8 @@
 #include "fc/rate_profile.h"
 #include "fc/rc_adjustments.h"
 #include "fc/rc_curves.h"
+#include "fc/rc_latency.h"
+#include "fc/rc_smoothing.h"
 #include "fc/fc_serial.h"
 #include "fc/fc_tasks.h"
 
@@ -84,6 +86,7 @@
 #include "flight/altitudehold.h"
 #include "flight/failsafe.h"
 #include "flight/gtune.h"
+#include "flight/autotune.h"
 #include "flight/navigation.h"
 
 #include "fc/runtime_config.h"
@@ -120,12 +123,9 @@ extern uint32_t currentTime;
 extern uint8_t PIDweight[3];
 extern uint8_t dynP8[3], dynI8[3], dynD8[3];
 
-static bool isRXDataNew;
 static pt1Filter_t filteredCycleTimeState;
 uint16_t filteredCycleTime;
 
-extern pidControllerFuncPtr pid_controller;
-
 void applyAndSaveAccelerometerTrimsDelta(rollAndPitchTrims_t *rollAndPitchTrimsDelta)
 {
     accelerometerConfig()->accelerometerTrims.values.roll += rollAndPitchTrimsDelta->values.roll;
@@ -158,6 +158,27 @@ void updateGtuneState(void)
 }
 #endif
 
+#ifdef AUTOTUNE
+
+void updateAutotuneState(void)
+{
+    if (rcModeIsActive(BOXAUTOTUNE) && ARMING_FLAG(ARMED)) {
+        if (!FLIGHT_MODE(AUTOTUNE_MODE)) {
+            ENABLE_FLIGHT_MODE(AUTOTUNE_MODE);
+            autotuneBegin();
+        }
+    } else if (FLIGHT_MODE(AUTOTUNE_MODE)) {
+        DISABLE_FLIGHT_MODE(AUTOTUNE_MODE);
+    }
+
+    // the gains found are kept when the craft is disarmed
+    if (!ARMING_FLAG(ARMED) && autotuneHasNewGains()) {
+        saveConfigAndNotify();
+        autotuneReset();
+    }
+}
+#endif
+
 bool isCalibrating(void)
 {
 #ifdef BARO
@@ -179,6 +200,8 @@ static void updateRcCommands(void)
 {
     int32_t prop2;
 
+    rcCommandFrameTime = rcDataFrameTime;
+
     // PITCH & ROLL only dynamic PID adjustment,  depending on throttle value
     if (rcData[THROTTLE] < currentControlRateProfile->tpa_breakpoint) {
         prop2 = 100;
@@ -222,9 +245,9 @@ static void updateRcCommands(void)
         }
 #ifndef SKIP_PID_MW23
         // FIXME axis indexes into pids.  use something like lookupPidIndex(rc_alias_e alias) to reduce coupling.
-        dynP8[axis] = (uint16_t)pidProfile()->P8[axis] * prop1 / 100;
-        dynI8[axis] = (uint16_t)pidProfile()->I8[axis] * prop1 / 100;
-        dynD8[axis] = (uint16_t)pidProfile()->D8[axis] * prop1 / 100;
+        dynP8[axis] = (uint16_t)pidRuntimeConfig.P8[axis] * prop1 / 100;
+        dynI8[axis] = (uint16_t)pidRuntimeConfig.I8[axis] * prop1 / 100;
+        dynD8[axis] = (uint16_t)pidRuntimeConfig.D8[axis] * prop1 / 100;
 #endif
 
         if (rcData[axis] < rxConfig()->midrc) {
@@ -335,6 +358,7 @@ void mwArm(void)
         if (!ARMING_FLAG(PREVENT_ARMING)) {
             ENABLE_ARMING_FLAG(ARMED);
             headFreeModeHold = DECIDEGREES_TO_DEGREES(attitude.values.yaw);
+            rcLatencyReset();
 
 #ifdef BLACKBOX
             if (feature(FEATURE_BLACKBOX)) {
@@ -613,39 +637,6 @@ void processRx(void)
 
 }
 
-void filterRc(void){
-    static int16_t lastCommand[4] = { 0, 0, 0, 0 };
-    static int16_t deltaRC[4] = { 0, 0, 0, 0 };
-    static int16_t factor, rcInterpolationFactor;
-    uint16_t rxRefreshRate;
-
-    // Set RC refresh rate for sampling and channels to filter
-    initRxRefreshRate(&rxRefreshRate);
-
-    rcInterpolationFactor = rxRefreshRate / filteredCycleTime + 1;
-
-    if (isRXDataNew) {
-        for (int channel=0; channel < 4; channel++) {
-            deltaRC[channel] = rcCommand[channel] -  (lastCommand[channel] - deltaRC[channel] * factor / rcInterpolationFactor);
-            lastCommand[channel] = rcCommand[channel];
-        }
-
-        isRXDataNew = false;
-        factor = rcInterpolationFactor - 1;
-    } else {
-        factor--;
-    }
-
-    // Interpolate steps of rcCommand
-    if (factor > 0) {
-        for (int channel=0; channel < 4; channel++) {
-            rcCommand[channel] = lastCommand[channel] - deltaRC[channel] * factor/rcInterpolationFactor;
-         }
-    } else {
-        factor = 0;
-    }
-}
-
 #if defined(BARO) || defined(SONAR)
 static bool haveUpdatedRcCommandsOnce = false;
 #endif
@@ -667,9 +658,7 @@ void taskMainPidLoop(void)
 
     updateRcCommands(); // this must be called here since applyAltHold directly manipulates rcCommands[]
 
-    if (rxConfig()->rcSmoothing) {
-        filterRc();
-    }
+    rcSmoothingApply(rcCommand, rcCommandFrameTime, currentTime);
 
 #if defined(BARO) || defined(SONAR)
     haveUpdatedRcCommandsOnce = true;
@@ -690,6 +679,10 @@ void taskMainPidLoop(void)
         updateGtuneState();
 #endif
 
+#ifdef AUTOTUNE
+        updateAutotuneState();
+#endif
+
 #if defined(BARO) || defined(SONAR)
         if (sensors(SENSOR_BARO) || sensors(SENSOR_SONAR)) {
             if (FLIGHT_MODE(BARO_MODE) || FLIGHT_MODE(SONAR_MODE)) {
@@ -726,14 +719,14 @@ void taskMainPidLoop(void)
     }
 #endif
 
-    // PID - note this is function pointer set by setPIDController()
-    pid_controller(
-        pidProfile(),
-        currentControlRateProfile,
-        imuConfig()->max_angle_inclination,
-        &accelerometerConfig()->accelerometerTrims,
-        rxConfig()
-    );
+    // PID - the controller is selected by pidSetController() and uses the settings prepared by pidInitConfig()
+    pidController();
+
+#ifdef AUTOTUNE
+    if (FLIGHT_MODE(AUTOTUNE_MODE)) {
+        autotuneUpdate(axisPID);
+    }
+#endif
 
     mixTable();
 
@@ -744,6 +737,7 @@ void taskMainPidLoop(void)
 
     if (motorControlEnable) {
         writeMotors();
+        rcLatencyRecord(rcCommandFrameTime, micros());
     }
 
 #ifdef USE_SDCARD
@@ -804,13 +798,6 @@ void taskUpdateBattery(void)
     static uint32_t vbatLastServiced = 0;
     static uint32_t ibatLastServiced = 0;
 
-    if (feature(FEATURE_VBAT)) {
-        if (cmp32(currentTime, vbatLastServiced) >= VBATINTERVAL) {
-            vbatLastServiced = currentTime;
-            updateBattery();
-        }
-    }
-
     if (feature(FEATURE_CURRENT_METER)) {
         int32_t ibatTimeSinceLastServiced = cmp32(currentTime, ibatLastServiced);
 
@@ -831,6 +818,14 @@ void taskUpdateBattery(void)
             }
         }
     }
+
+    // after the current meter so the sag compensation uses current measured over the same interval
+    if (feature(FEATURE_VBAT)) {
+        if (cmp32(currentTime, vbatLastServiced) >= VBATINTERVAL) {
+            vbatLastServiced = currentTime;
+            updateBattery();
+        }
+    }
 }
 
 bool taskUpdateRxCheck(uint32_t currentDeltaTime)
@@ -845,7 +840,8 @@ void taskUpdateRxMain(void)
     processRx();
     updateLEDs();
 
-    isRXDataNew = true;
+    // follow the measured frame rate, the period ages a waiting RX task and is the fallback when no frames arrive
+    rescheduleTask(TASK_SELF, rxGetFrameInterval());
 
 #ifdef BARO
     // updateRcCommands() sets rcCommand[], updateAltHoldState depends on valid rcCommand[] data.
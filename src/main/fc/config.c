@@ -39,6 +39,7 @@
 #include "drivers/compass.h"
 #include "drivers/system.h"
 #include "drivers/serial.h"
+#include "drivers/pwm_mapping.h"
 
 #include "fc/rate_profile.h"
 #include "fc/rc_controls.h"
@@ -51,6 +52,7 @@
 #include "sensors/sensors.h"
 #include "sensors/compass.h"
 #include "sensors/acceleration.h"
+#include "sensors/gyro.h"
 
 #include "telemetry/telemetry.h"
 
@@ -148,6 +150,19 @@ STATIC_UNIT_TESTED void resetConf(void)
     }
 }
 
+// must be called after changing the pid profile, the rates or the accelerometer trims
+void activatePidConfig(void)
+{
+    pidSetController(pidProfile()->pidController);
+    pidInitConfig(
+        pidProfile(),
+        currentControlRateProfile,
+        imuConfig()->max_angle_inclination,
+        &accelerometerConfig()->accelerometerTrims,
+        rxConfig()
+    );
+}
+
 static void activateConfig(void)
 {
     activateControlRateConfig();
@@ -156,7 +171,7 @@ static void activateConfig(void)
 
     useRcControlsConfig(modeActivationProfile()->modeActivationConditions);
 
-    pidSetController(pidProfile()->pidController);
+    activatePidConfig();
 
 #ifdef GPS
     gpsUsePIDs(pidProfile());
@@ -168,6 +183,7 @@ static void activateConfig(void)
 #ifdef USE_SERVOS
     mixerUseConfigs(servoProfile()->servoConf);
 #endif
+    mixerInitConfig();
 
     recalculateMagneticDeclination();
 
@@ -177,6 +193,8 @@ static void activateConfig(void)
     imuRuntimeConfig.acc_cut_hz = accelerometerConfig()->acc_cut_hz;
     imuRuntimeConfig.acc_unarmedcal = accelerometerConfig()->acc_unarmedcal;
     imuRuntimeConfig.small_angle = imuConfig()->small_angle;
+    imuRuntimeConfig.attitude_estimator = imuConfig()->attitude_estimator;
+    imuRuntimeConfig.attitude_update_hz = imuConfig()->attitude_update_hz;
 
     imuConfigure(
         &imuRuntimeConfig,
@@ -186,6 +204,54 @@ static void activateConfig(void)
     );
 }
 
+/*
+ * The ONESHOT125 feature selects OneShot125 when no other protocol is set.
+ */
+uint8_t getMotorPwmProtocol(void)
+{
+    if (motorAndServoConfig()->motor_pwm_protocol == PWM_TYPE_STANDARD && feature(FEATURE_ONESHOT125)) {
+        return PWM_TYPE_ONESHOT125;
+    }
+    return motorAndServoConfig()->motor_pwm_protocol;
+}
+
+/*
+ * Shortest loop time in which the longest pulse or frame of the protocol is sent before the next update starts, 0 for
+ * protocols that aren't synchronised with the loop.
+ */
+static uint16_t motorPwmProtocolMinLooptime(uint8_t motorPwmProtocol)
+{
+    switch (motorPwmProtocol) {
+        case PWM_TYPE_ONESHOT125:
+            return 500;     // 250us pulse
+        case PWM_TYPE_ONESHOT42:
+        case PWM_TYPE_DSHOT300:
+            return 125;     // 84us pulse, 53us frame
+        case PWM_TYPE_MULTISHOT:
+        case PWM_TYPE_DSHOT600:
+            return 63;      // 25us pulse, 27us frame
+        case PWM_TYPE_DSHOT150:
+            return 250;     // 107us frame
+        default:
+            return 0;
+    }
+}
+
+static void validateAndFixMotorUpdateRate(void)
+{
+    const uint16_t minLooptime = motorPwmProtocolMinLooptime(getMotorPwmProtocol());
+
+    if (imuConfig()->gyroSync) {
+        // the loop runs every gyroSyncDenominator gyro samples, see gyroSetSampleRate()
+        const uint16_t gyroSamplePeriod = gyroConfig()->gyro_lpf == 0 ? 125 : 1000;
+        while (imuConfig()->gyroSyncDenominator * gyroSamplePeriod < minLooptime) {
+            imuConfig()->gyroSyncDenominator++;
+        }
+    } else if (imuConfig()->looptime < minLooptime) {
+        imuConfig()->looptime = minLooptime;
+    }
+}
+
 static void validateAndFixConfig(void)
 {
     if (!(featureConfigured(FEATURE_RX_PARALLEL_PWM) || featureConfigured(FEATURE_RX_PPM) || featureConfigured(FEATURE_RX_SERIAL) || featureConfigured(FEATURE_RX_MSP))) {
@@ -214,6 +280,18 @@ static void validateAndFixConfig(void)
         mixerConfig()->pid_at_min_throttle = 0;
     }
 
+    // DShot has no neutral point for 3D mode, the neutral3d value would spin the motors while disarmed.
+    switch (getMotorPwmProtocol()) {
+        case PWM_TYPE_DSHOT150:
+        case PWM_TYPE_DSHOT300:
+        case PWM_TYPE_DSHOT600:
+            featureClear(FEATURE_3D);
+            break;
+        default:
+            break;
+    }
+
+    validateAndFixMotorUpdateRate();
 
 #ifdef STM32F10X
     // avoid overloading the CPU on F1 targets when using gyro sync and GPS.
@@ -46,6 +46,7 @@ typedef enum {
 } features_e;
 
 void handleOneshotFeatureChangeOnRestart(void);
+uint8_t getMotorPwmProtocol(void);
 
 void initEEPROM(void);
 void resetEEPROM(void);
@@ -53,6 +54,7 @@ void readEEPROM(void);
 void writeEEPROM();
 void ensureEEPROMContainsValidData(void);
 void saveConfigAndNotify(void);
+void activatePidConfig(void);
 
 void changeProfile(uint8_t profileIndex);
 
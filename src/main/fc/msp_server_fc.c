@@ -57,6 +57,7 @@
 #include "fc/rate_profile.h"
 #include "fc/rc_controls.h"
 #include "fc/rc_adjustments.h"
+#include "fc/rc_latency.h"
 #include "fc/fc_tasks.h"
 #include "fc/runtime_config.h"
 #include "fc/config.h"
@@ -150,6 +151,7 @@ static const box_t boxes[CHECKBOX_ITEM_COUNT] = {
     { "BLACKBOX",  BOXBLACKBOX,  26 },
     { "FAILSAFE",  BOXFAILSAFE,  27 },
     { "AIR MODE",  BOXAIRMODE,   28 },
+    { "AUTOTUNE",  BOXAUTOTUNE,  29 },
 };
 
 // mask of enabled IDs, calculated on start based on enabled features. boxId_e is used as bit index.
@@ -339,6 +341,10 @@ static void initActiveBoxIds(void)
     ena |= 1 << BOXGTUNE;
 #endif
 
+#ifdef AUTOTUNE
+    ena |= 1 << BOXAUTOTUNE;
+#endif
+
     // check that all enabled IDs are in boxes array (check is skipped when using findBoxBy<id>() functions
     for(boxId_e boxId = 0;  boxId < CHECKBOX_ITEM_COUNT; boxId++)
         if((ena & (1 << boxId))
@@ -557,6 +563,27 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
             break;
         }
 
+        case MSP_ACC_VIBRATION:
+            for (unsigned i = 0; i < 3; i++)
+                sbufWriteU16(dst, imuGetAccVibration(i));
+            sbufWriteU32(dst, accClipCount);
+            sbufWriteU8(dst, imuGetAccHealth());
+            break;
+
+        case MSP_RC_LATENCY: {
+            const rcLatencyStats_t *latency = rcLatencyGetStats();
+            sbufWriteU32(dst, latency->count);
+            sbufWriteU16(dst, latency->latest);
+            sbufWriteU16(dst, latency->min);
+            sbufWriteU16(dst, latency->average);
+            sbufWriteU16(dst, latency->max);
+            sbufWriteU16(dst, RC_LATENCY_HISTOGRAM_BUCKET_WIDTH_US);
+            sbufWriteU8(dst, RC_LATENCY_HISTOGRAM_BUCKET_COUNT);
+            for (unsigned i = 0; i < RC_LATENCY_HISTOGRAM_BUCKET_COUNT; i++)
+                sbufWriteU32(dst, latency->histogram[i]);
+            break;
+        }
+
 #ifdef USE_SERVOS
         case MSP_SERVO:
             sbufWriteData(dst, &servo, MAX_SUPPORTED_SERVOS * 2);
@@ -1032,6 +1059,7 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
         case MSP_SET_ACC_TRIM:
             accelerometerConfig()->accelerometerTrims.values.pitch = sbufReadU16(src);
             accelerometerConfig()->accelerometerTrims.values.roll  = sbufReadU16(src);
+            activatePidConfig();
             break;
 
         case MSP_SET_ARMING_CONFIG:
@@ -1045,7 +1073,7 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
 
         case MSP_SET_PID_CONTROLLER:
             pidProfile()->pidController = sbufReadU8(src);
-            pidSetController(pidProfile()->pidController);
+            activatePidConfig();
             break;
 
         case MSP_SET_PID:
@@ -1054,6 +1082,7 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
                     pidProfile()->I8[i] = sbufReadU8(src);
                     pidProfile()->D8[i] = sbufReadU8(src);
                 }
+            activatePidConfig();
             break;
 
         case MSP_SET_MODE_RANGE: {
@@ -1105,6 +1134,7 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
             currentControlRateProfile->thrMid8 = sbufReadU8(src);
             currentControlRateProfile->thrExpo8 = sbufReadU8(src);
             currentControlRateProfile->tpa_breakpoint = sbufReadU16(src);
+            activatePidConfig();
             if (len < 11)
                 break;
             currentControlRateProfile->rcYawExpo8 = sbufReadU8(src);
@@ -1140,6 +1170,9 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
             batteryConfig()->vbatmincellvoltage = sbufReadU8(src);  // vbatlevel_warn1 in MWC2.3 GUI
             batteryConfig()->vbatmaxcellvoltage = sbufReadU8(src);  // vbatlevel_warn2 in MWC2.3 GUI
             batteryConfig()->vbatwarningcellvoltage = sbufReadU8(src);  // vbatlevel when buzzer starts to alert
+
+            activatePidConfig();    // midrc is cached in the PID runtime config
+            mixerInitConfig();      // as are midrc, mincheck and the throttle limits in the mixer
             break;
         }
 
@@ -1205,6 +1238,7 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
 
         case MSP_SET_RESET_CURR_PID:
             PG_RESET_CURRENT(pidProfile);
+            activatePidConfig();
             break;
 
         case MSP_SET_SENSOR_ALIGNMENT:
@@ -1342,10 +1376,12 @@ int mspServerCommandHandler(mspPacket_t *cmd, mspPacket_t *reply)
             rxConfig()->midrc = sbufReadU16(src);
             rxConfig()->mincheck = sbufReadU16(src);
             rxConfig()->spektrum_sat_bind = sbufReadU8(src);
-            if (sbufBytesRemaining(src) < 2)
-                break;
-            rxConfig()->rx_min_usec = sbufReadU16(src);
-            rxConfig()->rx_max_usec = sbufReadU16(src);
+            if (sbufBytesRemaining(src) >= 2) {
+                rxConfig()->rx_min_usec = sbufReadU16(src);
+                rxConfig()->rx_max_usec = sbufReadU16(src);
+            }
+            activatePidConfig();    // midrc is cached in the PID runtime config
+            mixerInitConfig();      // as are midrc, mincheck and the throttle limits in the mixer
             break;
 
         case MSP_SET_FAILSAFE_CONFIG:
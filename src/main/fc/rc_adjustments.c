@@ -249,9 +249,19 @@ void applyStepAdjustment(controlRateConfig_t *controlRateConfig, uint8_t adjustm
         case ADJUSTMENT_VEL_D:
             setAdjustment(&pidProfile()->D8[PIDVEL],ADJUSTMENT_VEL_D,delta,PID_MIN,PID_MAX);
             break;
+        case ADJUSTMENT_FEED_FORWARD:
+            setAdjustment(&pidProfile()->feedForward,ADJUSTMENT_FEED_FORWARD,delta,PID_MIN,PID_MAX);
+            break;
+        case ADJUSTMENT_P_SETPOINT_WEIGHT:
+            setAdjustment(&pidProfile()->PTermSetpointWeight,ADJUSTMENT_P_SETPOINT_WEIGHT,delta,0,PTERM_SETPOINT_WEIGHT_MAX);
+            break;
+        case ADJUSTMENT_D_SETPOINT_WEIGHT:
+            setAdjustment(&pidProfile()->DTermSetpointWeight,ADJUSTMENT_D_SETPOINT_WEIGHT,delta,0,DTERM_SETPOINT_WEIGHT_MAX);
+            break;
         default:
             break;
     };
+    activatePidConfig();
 }
 
 void applySelectAdjustment(uint8_t adjustmentFunction, uint8_t position)
@@ -262,6 +272,7 @@ void applySelectAdjustment(uint8_t adjustmentFunction, uint8_t position)
         case ADJUSTMENT_RATE_PROFILE:
             if (getCurrentControlRateProfile() != position) {
                 changeControlRateProfile(position);
+                activatePidConfig();
                 blackboxLogInflightAdjustmentEvent(ADJUSTMENT_RATE_PROFILE, position);
                 applied = true;
             }
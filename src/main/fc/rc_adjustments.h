@@ -66,10 +66,13 @@ typedef enum {
     ADJUSTMENT_LEVEL_P,
     ADJUSTMENT_LEVEL_I,
     ADJUSTMENT_LEVEL_D,
+    ADJUSTMENT_FEED_FORWARD,
+    ADJUSTMENT_P_SETPOINT_WEIGHT,
+    ADJUSTMENT_D_SETPOINT_WEIGHT,
 
 } adjustmentFunction_e;
 
-#define ADJUSTMENT_FUNCTION_COUNT 39
+#define ADJUSTMENT_FUNCTION_COUNT 42
 
 typedef enum {
     ADJUSTMENT_MODE_STEP,
@@ -49,6 +49,7 @@ typedef enum {
     BOXBLACKBOX,
     BOXFAILSAFE,
     BOXAIRMODE,
+    BOXAUTOTUNE,
     CHECKBOX_ITEM_COUNT
 } boxId_e;
 
@@ -133,6 +134,7 @@ typedef struct modeActivationProfile_s {
 PG_DECLARE_PROFILE(modeActivationProfile_t, modeActivationProfile);
 
 extern int16_t rcCommand[4];
+extern uint32_t rcCommandFrameTime;
 
 typedef struct rcControlsConfig_s {
     uint8_t deadband;                       // introduce a deadband around the stick center for pitch and roll axis. Must be greater than zero.
@@ -0,0 +1,73 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common/maths.h"
+
+#include "fc/rc_latency.h"
+
+/*
+ * Time from the arrival of an RC frame to the first motor update calculated from it.
+ *
+ * The receiver drivers timestamp each frame, rx.c carries the timestamp with rcData[] as rcDataFrameTime
+ * and updateRcCommands() with rcCommand[] as rcCommandFrameTime.  The main loop records it after writing the motors,
+ * later motor updates using the same frame are not counted.
+ */
+
+static rcLatencyStats_t rcLatencyStats;
+static uint32_t lastRecordedFrameTime;
+
+void rcLatencyReset(void)
+{
+    memset(&rcLatencyStats, 0, sizeof(rcLatencyStats));
+    lastRecordedFrameTime = 0;
+}
+
+void rcLatencyRecord(uint32_t frameTime, uint32_t motorsWrittenAt)
+{
+    if (frameTime == 0 || frameTime == lastRecordedFrameTime) {
+        // no frame yet or this frame has been measured already
+        return;
+    }
+    lastRecordedFrameTime = frameTime;
+
+    const uint16_t latency = MIN(motorsWrittenAt - frameTime, UINT16_MAX);
+
+    if (rcLatencyStats.count == 0) {
+        rcLatencyStats.min = latency;
+        rcLatencyStats.average = latency;
+        rcLatencyStats.max = latency;
+    } else {
+        rcLatencyStats.min = MIN(rcLatencyStats.min, latency);
+        rcLatencyStats.average = ((uint32_t)rcLatencyStats.average * 31 + latency) / 32;
+        rcLatencyStats.max = MAX(rcLatencyStats.max, latency);
+    }
+    rcLatencyStats.latest = latency;
+    rcLatencyStats.count++;
+
+    const uint8_t bucket = MIN(latency / RC_LATENCY_HISTOGRAM_BUCKET_WIDTH_US, RC_LATENCY_HISTOGRAM_BUCKET_COUNT - 1);
+    rcLatencyStats.histogram[bucket]++;
+}
+
+const rcLatencyStats_t *rcLatencyGetStats(void)
+{
+    return &rcLatencyStats;
+}
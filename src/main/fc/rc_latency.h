@@ -0,0 +1,35 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#define RC_LATENCY_HISTOGRAM_BUCKET_COUNT 20
+#define RC_LATENCY_HISTOGRAM_BUCKET_WIDTH_US 500   // the last bucket counts everything above
+
+typedef struct rcLatencyStats_s {
+    uint32_t count;                 // frames measured
+    uint16_t latest;                // us
+    uint16_t min;                   // us
+    uint16_t average;               // us
+    uint16_t max;                   // us
+    uint32_t histogram[RC_LATENCY_HISTOGRAM_BUCKET_COUNT];
+} rcLatencyStats_t;
+
+void rcLatencyReset(void);
+void rcLatencyRecord(uint32_t frameTime, uint32_t motorsWrittenAt);
+const rcLatencyStats_t *rcLatencyGetStats(void);
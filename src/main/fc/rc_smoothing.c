@@ -0,0 +1,165 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "common/maths.h"
+
+#include "config/parameter_group.h"
+
+#include "rx/rx.h"
+
+#include "fc/rc_smoothing.h"
+
+/*
+ * Smooths rcCommand[] between receiver frames.
+ *
+ * Each frame is identified by the time it arrived (rcCommandFrameTime), so the smoothing follows the real frame
+ * timing rather than counting loop iterations, and the loop rate or frame jitter don't matter.  The frame interval
+ * measured by the receiver code sets the interpolation window and, with rc_smoothing_cutoff = 0, the filter cutoff.
+ */
+
+#define RC_SMOOTHING_CUTOFF_MIN 1                  // Hz
+#define RC_SMOOTHING_CUTOFF_MAX 255
+
+// a PT1 cascade with the same -3dB frequency as a single stage needs each stage at 1/sqrt(sqrt(2) - 1) of the cutoff
+#define PT2_CUTOFF_CORRECTION 1.553773974f
+
+static uint16_t frameInterval;              // us
+static uint8_t cutoff;                      // Hz
+
+static bool initialised;
+static uint32_t smoothedFrameTime;          // the frame the output is moving towards
+static uint32_t lastAppliedAt;
+static float pt1RC;
+static float pt2RC;
+
+static int16_t interpolateFrom[RC_SMOOTHING_CHANNEL_COUNT];
+static int16_t interpolateTo[RC_SMOOTHING_CHANNEL_COUNT];
+static float stage1[RC_SMOOTHING_CHANNEL_COUNT];
+static float stage2[RC_SMOOTHING_CHANNEL_COUNT];
+
+static void updateCutoff(void)
+{
+    if (rxConfig()->rcSmoothingCutoff) {
+        cutoff = rxConfig()->rcSmoothingCutoff;
+    } else {
+        // half the frame rate, the highest frequency the frames can carry
+        cutoff = constrain(1000000 / 2 / frameInterval, RC_SMOOTHING_CUTOFF_MIN, RC_SMOOTHING_CUTOFF_MAX);
+    }
+    pt1RC = 1.0f / (2.0f * M_PIf * cutoff);
+    pt2RC = pt1RC / PT2_CUTOFF_CORRECTION;
+}
+
+void rcSmoothingInit(void)
+{
+    frameInterval = rxGetFrameInterval();
+    initialised = false;
+    updateCutoff();
+}
+
+uint8_t rcSmoothingGetCutoff(void)
+{
+    return cutoff;
+}
+
+static int16_t interpolate(int channel, uint32_t elapsed, uint32_t interval)
+{
+    if (elapsed >= interval) {
+        return interpolateTo[channel];
+    }
+    // rounded, truncating would stop short of a constant input when the measured interval is a little long
+    const int32_t delta = (interpolateTo[channel] - interpolateFrom[channel]) * (int32_t)elapsed;
+    const int32_t rounding = delta < 0 ? -(int32_t)interval / 2 : (int32_t)interval / 2;
+    return interpolateFrom[channel] + (delta + rounding) / (int32_t)interval;
+}
+
+void rcSmoothingApply(int16_t *command, uint32_t frameTime, uint32_t currentTime)
+{
+    if (!initialised) {
+        for (int channel = 0; channel < RC_SMOOTHING_CHANNEL_COUNT; channel++) {
+            interpolateFrom[channel] = command[channel];
+            interpolateTo[channel] = command[channel];
+            stage1[channel] = command[channel];
+            stage2[channel] = command[channel];
+        }
+        smoothedFrameTime = frameTime;
+        lastAppliedAt = currentTime;
+        initialised = true;
+        return;
+    }
+
+    const float dT = (currentTime - lastAppliedAt) * 1e-6f;
+    lastAppliedAt = currentTime;
+
+    const uint32_t previousFrameTime = smoothedFrameTime;
+    const bool newFrame = frameTime != previousFrameTime;
+    if (newFrame) {
+        frameInterval = rxGetFrameInterval();
+        updateCutoff();
+        smoothedFrameTime = frameTime;
+    }
+
+    switch (rxConfig()->rcSmoothing) {
+    case RC_SMOOTHING_LINEAR: {
+        for (int channel = 0; channel < RC_SMOOTHING_CHANNEL_COUNT; channel++) {
+            if (newFrame) {
+                // start from where the line to the last frame was when this frame arrived
+                interpolateFrom[channel] = interpolate(channel, frameTime - previousFrameTime, frameInterval);
+            }
+            interpolateTo[channel] = command[channel];
+            command[channel] = interpolate(channel, currentTime - frameTime, frameInterval);
+            stage1[channel] = command[channel];
+            stage2[channel] = command[channel];
+        }
+        break;
+    }
+    case RC_SMOOTHING_PT1: {
+        const float k = dT / (pt1RC + dT);
+
+        for (int channel = 0; channel < RC_SMOOTHING_CHANNEL_COUNT; channel++) {
+            stage1[channel] += k * (command[channel] - stage1[channel]);
+            stage2[channel] = stage1[channel];
+            command[channel] = lrintf(stage1[channel]);
+            interpolateFrom[channel] = interpolateTo[channel] = command[channel];
+        }
+        break;
+    }
+    case RC_SMOOTHING_PT2: {
+        const float k = dT / (pt2RC + dT);
+
+        for (int channel = 0; channel < RC_SMOOTHING_CHANNEL_COUNT; channel++) {
+            stage1[channel] += k * (command[channel] - stage1[channel]);
+            stage2[channel] += k * (stage1[channel] - stage2[channel]);
+            command[channel] = lrintf(stage2[channel]);
+            interpolateFrom[channel] = interpolateTo[channel] = command[channel];
+        }
+        break;
+    }
+    default:
+        // keep following the input so switching the smoothing on doesn't cause a step
+        for (int channel = 0; channel < RC_SMOOTHING_CHANNEL_COUNT; channel++) {
+            stage1[channel] = command[channel];
+            stage2[channel] = command[channel];
+            interpolateFrom[channel] = interpolateTo[channel] = command[channel];
+        }
+        break;
+    }
+}
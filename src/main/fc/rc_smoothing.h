@@ -0,0 +1,32 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+typedef enum {
+    RC_SMOOTHING_OFF = 0,
+    RC_SMOOTHING_LINEAR,        // interpolate from the last output to each new frame over one frame interval
+    RC_SMOOTHING_PT1,           // first order low pass
+    RC_SMOOTHING_PT2,           // second order low pass, two PT1 stages, no overshoot
+} rcSmoothingType_e;
+
+#define RC_SMOOTHING_CHANNEL_COUNT 4
+
+void rcSmoothingInit(void);
+void rcSmoothingApply(int16_t *command, uint32_t frameTime, uint32_t currentTime);
+uint8_t rcSmoothingGetCutoff(void);
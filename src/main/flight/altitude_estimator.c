@@ -0,0 +1,138 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Vertical Kalman filter, altitude, velocity and accelerometer bias
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <platform.h>
+
+#include "common/maths.h"
+
+#include "flight/altitude_estimator.h"
+
+#if defined(BARO) || defined(SONAR)
+
+/*
+ * The accelerometer drives the prediction, it is treated as an input rather than a measurement so the filter does not
+ * need a model of the thrust.  Altitude measurements may arrive at any time and late, they are compared with the
+ * altitude the filter had when they were taken, extrapolated back using the velocity.
+ */
+
+#define ALTITUDE_ESTIMATOR_ACC_NOISE        40.0f       // cm/s/s per sqrt(Hz)
+#define ALTITUDE_ESTIMATOR_ACC_BIAS_NOISE   2.0f        // cm/s/s per sqrt(s)
+#define ALTITUDE_ESTIMATOR_INITIAL_ALTITUDE 100.0f      // cm
+#define ALTITUDE_ESTIMATOR_INITIAL_VELOCITY 50.0f       // cm/s
+#define ALTITUDE_ESTIMATOR_INITIAL_BIAS     50.0f       // cm/s/s
+#define ALTITUDE_ESTIMATOR_MAX_BIAS         200.0f      // cm/s/s
+
+void altitudeEstimatorInit(altitudeEstimator_t *estimator, float altitude)
+{
+    memset(estimator, 0, sizeof(*estimator));
+
+    estimator->altitude = altitude;
+
+    estimator->P[0][0] = sq(ALTITUDE_ESTIMATOR_INITIAL_ALTITUDE);
+    estimator->P[1][1] = sq(ALTITUDE_ESTIMATOR_INITIAL_VELOCITY);
+    estimator->P[2][2] = sq(ALTITUDE_ESTIMATOR_INITIAL_BIAS);
+}
+
+// acc is the earth frame vertical acceleration without gravity averaged over dt, cm/s/s
+void altitudeEstimatorPredict(altitudeEstimator_t *estimator, float acc, float dt)
+{
+    float (*P)[ALTITUDE_ESTIMATOR_STATE_COUNT] = estimator->P;
+
+    if (dt <= 0.0f) {
+        return;
+    }
+
+    acc -= estimator->accBias;
+    estimator->altitude += (estimator->velocity + 0.5f * acc * dt) * dt;
+    estimator->velocity += acc * dt;
+
+    /*
+     * P = F * P * F' + Q with F = [1 dt -dt^2/2; 0 1 -dt; 0 0 1], expanded by hand since most of F is constant.
+     * FP is F * P, the result is FP * F'.
+     */
+    const float halfDt2 = 0.5f * sq(dt);
+    float FP[ALTITUDE_ESTIMATOR_STATE_COUNT][ALTITUDE_ESTIMATOR_STATE_COUNT];
+
+    for (int j = 0; j < ALTITUDE_ESTIMATOR_STATE_COUNT; j++) {
+        FP[0][j] = P[0][j] + dt * P[1][j] - halfDt2 * P[2][j];
+        FP[1][j] = P[1][j] - dt * P[2][j];
+        FP[2][j] = P[2][j];
+    }
+
+    for (int i = 0; i < ALTITUDE_ESTIMATOR_STATE_COUNT; i++) {
+        P[i][0] = FP[i][0] + dt * FP[i][1] - halfDt2 * FP[i][2];
+        P[i][1] = FP[i][1] - dt * FP[i][2];
+        P[i][2] = FP[i][2];
+    }
+
+    // white acceleration noise integrated over dt
+    const float accNoise = sq(ALTITUDE_ESTIMATOR_ACC_NOISE);
+    P[0][0] += accNoise * dt * sq(dt) / 3.0f;
+    P[0][1] += accNoise * halfDt2;
+    P[1][0] += accNoise * halfDt2;
+    P[1][1] += accNoise * dt;
+    P[2][2] += sq(ALTITUDE_ESTIMATOR_ACC_BIAS_NOISE) * dt;
+}
+
+// age is how long ago the altitude was measured in seconds, noise is its standard deviation in cm
+void altitudeEstimatorFuseAltitude(altitudeEstimator_t *estimator, float altitude, float age, float noise)
+{
+    float (*P)[ALTITUDE_ESTIMATOR_STATE_COUNT] = estimator->P;
+
+    if (age > ALTITUDE_ESTIMATOR_MAX_AGE) {
+        return;
+    }
+    age = MAX(age, 0.0f);
+
+    // the measurement is of the altitude at the time it was taken, H = [1 -age 0]
+    const float H[ALTITUDE_ESTIMATOR_STATE_COUNT] = { 1.0f, -age, 0.0f };
+    float PHt[ALTITUDE_ESTIMATOR_STATE_COUNT];
+    float S = sq(noise);
+
+    for (int i = 0; i < ALTITUDE_ESTIMATOR_STATE_COUNT; i++) {
+        PHt[i] = P[i][0] * H[0] + P[i][1] * H[1];
+        S += H[i] * PHt[i];
+    }
+
+    const float innovation = altitude - (estimator->altitude - estimator->velocity * age);
+    const float recipS = 1.0f / S;
+    float K[ALTITUDE_ESTIMATOR_STATE_COUNT];
+
+    for (int i = 0; i < ALTITUDE_ESTIMATOR_STATE_COUNT; i++) {
+        K[i] = PHt[i] * recipS;
+    }
+
+    estimator->altitude += K[0] * innovation;
+    estimator->velocity += K[1] * innovation;
+    estimator->accBias = constrainf(estimator->accBias + K[2] * innovation, -ALTITUDE_ESTIMATOR_MAX_BIAS, ALTITUDE_ESTIMATOR_MAX_BIAS);
+
+    // P = P - K * H * P, and H * P = PHt' since P is symmetric
+    for (int i = 0; i < ALTITUDE_ESTIMATOR_STATE_COUNT; i++) {
+        for (int j = 0; j < ALTITUDE_ESTIMATOR_STATE_COUNT; j++) {
+            P[i][j] -= K[i] * PHt[j];
+        }
+    }
+}
+
+#endif
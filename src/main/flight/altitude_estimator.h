@@ -0,0 +1,38 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// measurement noise, standard deviation in cm
+#define ALTITUDE_ESTIMATOR_BARO_NOISE       30.0f
+#define ALTITUDE_ESTIMATOR_SONAR_NOISE      3.0f
+
+// measurements older than this are not fused, seconds
+#define ALTITUDE_ESTIMATOR_MAX_AGE          0.2f
+
+#define ALTITUDE_ESTIMATOR_STATE_COUNT 3
+
+typedef struct altitudeEstimator_s {
+    float altitude;                         // cm
+    float velocity;                         // cm/s
+    float accBias;                          // cm/s/s, subtracted from the earth frame vertical acceleration
+    float P[ALTITUDE_ESTIMATOR_STATE_COUNT][ALTITUDE_ESTIMATOR_STATE_COUNT];
+} altitudeEstimator_t;
+
+void altitudeEstimatorInit(altitudeEstimator_t *estimator, float altitude);
+void altitudeEstimatorPredict(altitudeEstimator_t *estimator, float acc, float dt);
+void altitudeEstimatorFuseAltitude(altitudeEstimator_t *estimator, float altitude, float age, float noise);
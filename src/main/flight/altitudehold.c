@@ -51,6 +51,7 @@
 #include "flight/mixer.h"
 #include "flight/pid.h"
 #include "flight/imu.h"
+#include "flight/altitude_estimator.h"
 
 #include "flight/altitudehold.h"
 
@@ -67,6 +68,7 @@ int32_t vario = 0;                      // variometer in cm/s
 static int16_t initialRawThrottleHold;
 static int16_t initialThrottleHold;
 static int32_t EstAlt;                // in cm
+static altitudeEstimator_t altitudeEstimator;
 
 PG_REGISTER_WITH_RESET_TEMPLATE(airplaneConfig_t, airplaneConfig, PG_AIRPLANE_ALT_HOLD_CONFIG, 0);
 
@@ -74,9 +76,6 @@ PG_RESET_TEMPLATE(airplaneConfig_t, airplaneConfig,
     .fixedwing_althold_dir = 1,
 );
 
-// 40hz update rate (20hz LPF on acc)
-#define BARO_UPDATE_FREQUENCY_40HZ (1000 * 25)
-
 #define DEGREES_80_IN_DECIDEGREES 800
 
 static void applyMultirotorAltHold(void)
@@ -209,110 +208,111 @@ int32_t calculateAltHoldThrottleAdjustment(int32_t vel_tmp, float accZ_tmp, floa
 
 void calculateEstimatedAltitude(uint32_t currentTime)
 {
-    static uint32_t previousTime;
-    uint32_t dTime;
-    int32_t baroVel;
-    float dt;
-    float vel_acc;
     int32_t vel_tmp;
     float accZ_tmp;
     static float accZ_old = 0.0f;
-    static float vel = 0.0f;
-    static float accAlt = 0.0f;
-    static int32_t lastBaroAlt;
-
-#ifdef SONAR
-    int32_t sonarAlt = SONAR_OUT_OF_RANGE;
-    static int32_t baroAlt_offset = 0;
-    float sonarTransition;
-#endif
-
-    dTime = currentTime - previousTime;
-    if (dTime < BARO_UPDATE_FREQUENCY_40HZ)
-        return;
-
-    previousTime = currentTime;
+    static bool isEstimatorInitialised = false;
+    bool isCalibrating = false;
 
 #ifdef BARO
-    if (!isBaroCalibrationComplete()) {
-        performBaroCalibrationCycle();
-        vel = 0;
-        accAlt = 0;
-    }
-
-    BaroAlt = baroCalculateAltitude();
-#else
-    BaroAlt = 0;
+    static uint32_t lastBaroSampleAt;
+    bool baroUpdated = false;
 #endif
-
 #ifdef SONAR
-    sonarAlt = sonarRead();
-    sonarAlt = sonarCalculateAltitude(sonarAlt, getCosTiltAngle());
-
-    if (sonarAlt > 0 && sonarAlt < sonarCfAltCm) {
-        // just use the SONAR
-        baroAlt_offset = BaroAlt - sonarAlt;
-        BaroAlt = sonarAlt;
-    } else {
-        BaroAlt -= baroAlt_offset;
-        if (sonarAlt > 0  && sonarAlt <= sonarMaxAltWithTiltCm) {
-            // SONAR in range, so use complementary filter
-            sonarTransition = (float)(sonarMaxAltWithTiltCm - sonarAlt) / (sonarMaxAltWithTiltCm - sonarCfAltCm);
-            BaroAlt = sonarAlt * sonarTransition + BaroAlt * (1.0f - sonarTransition);
-        }
-    }
+    static uint32_t lastSonarSampleAt;
+    static int32_t baroAlt_offset = 0;
+    bool sonarUpdated = false;
 #endif
 
-    dt = accTimeSum * 1e-6f; // delta acc reading time in seconds
+    if (!isEstimatorInitialised) {
+        altitudeEstimatorInit(&altitudeEstimator, 0);
+        isEstimatorInitialised = true;
+    }
 
-    // Integrator - velocity, cm/sec
+    // Predict with the average earth frame acceleration since the last call, this includes every accelerometer sample
     if (accSumCount) {
         accZ_tmp = (float)accSum[2] / (float)accSumCount;
     } else {
         accZ_tmp = 0;
     }
-    vel_acc = accZ_tmp * accVelScale * (float)accTimeSum;
-
-    // Integrator - Altitude in cm
-    accAlt += (vel_acc * 0.5f) * dt + vel * dt;                                                                 // integrate velocity to get distance (x= a/2 * t^2)
-    accAlt = accAlt * barometerConfig()->baro_cf_alt + (float)BaroAlt * (1.0f - barometerConfig()->baro_cf_alt);    // complementary filter for altitude estimation (baro & acc)
-    vel += vel_acc;
+    altitudeEstimatorPredict(&altitudeEstimator, accZ_tmp * accVelScale * 1000000.0f, accTimeSum * 1e-6f);
 
 #ifdef DEBUG_ALT_HOLD
-    debug[1] = accSum[2] / accSumCount; // acceleration
-    debug[2] = vel;                     // velocity
-    debug[3] = accAlt;                  // height
+    debug[1] = accZ_tmp;                            // acceleration
 #endif
 
     imuResetAccelerationSum();
 
+    // Baro and sonar run asynchronously, only new samples are used
 #ifdef BARO
-    if (!isBaroCalibrationComplete()) {
-        return;
+    if (sensors(SENSOR_BARO) && baroGetLatestSampleTime() != lastBaroSampleAt) {
+        lastBaroSampleAt = baroGetLatestSampleTime();
+
+        if (!isBaroCalibrationComplete()) {
+            performBaroCalibrationCycle();
+        }
+        BaroAlt = baroCalculateAltitude();
+        baroUpdated = true;
     }
+
+    if (sensors(SENSOR_BARO) && !isBaroCalibrationComplete()) {
+        isCalibrating = true;
+    }
+#else
+    BaroAlt = 0;
 #endif
 
 #ifdef SONAR
-    if (sonarAlt > 0 && sonarAlt < sonarCfAltCm) {
-        // the sonar has the best range
-        EstAlt = BaroAlt;
-    } else {
-        EstAlt = accAlt;
+    if (sensors(SENSOR_SONAR) && sonarGetLatestMeasurementTime() != lastSonarSampleAt) {
+        lastSonarSampleAt = sonarGetLatestMeasurementTime();
+
+        sonarCalculateAltitude(sonarRead(), getCosTiltAngle());
+        sonarUpdated = true;
     }
+
+    int32_t sonarAlt = sonarGetLatestAltitude();
+
+    if (sonarUpdated && sonarAlt > 0 && sonarAlt <= sonarMaxAltWithTiltCm) {
+        // the sonar is trusted less towards the edge of its range
+        float sonarTransition = 0.0f;
+        if (sonarAlt > sonarCfAltCm) {
+            sonarTransition = (float)(sonarAlt - sonarCfAltCm) / (sonarMaxAltWithTiltCm - sonarCfAltCm);
+        }
+        float sonarNoise = ALTITUDE_ESTIMATOR_SONAR_NOISE + sonarTransition * ALTITUDE_ESTIMATOR_BARO_NOISE;
+
+        altitudeEstimatorFuseAltitude(&altitudeEstimator, sonarAlt, (currentTime - lastSonarSampleAt) * 1e-6f, sonarNoise);
+    }
+#endif
+
+#ifdef BARO
+    if (isCalibrating) {
+        altitudeEstimatorInit(&altitudeEstimator, 0);
+    } else if (baroUpdated) {
+        float baroAge = (currentTime - lastBaroSampleAt) * 1e-6f;
+#ifdef SONAR
+        if (sonarAlt > 0 && sonarAlt < sonarCfAltCm) {
+            // the sonar has the best range, keep the baro aligned with it for when the sonar goes out of range
+            baroAlt_offset = BaroAlt - lrintf(altitudeEstimator.altitude);
+        } else {
+            altitudeEstimatorFuseAltitude(&altitudeEstimator, BaroAlt - baroAlt_offset, baroAge, ALTITUDE_ESTIMATOR_BARO_NOISE);
+        }
 #else
-    EstAlt = accAlt;
+        altitudeEstimatorFuseAltitude(&altitudeEstimator, BaroAlt, baroAge, ALTITUDE_ESTIMATOR_BARO_NOISE);
+#endif
+    }
 #endif
 
-    baroVel = (BaroAlt - lastBaroAlt) * 1000000.0f / dTime;
-    lastBaroAlt = BaroAlt;
+#ifdef DEBUG_ALT_HOLD
+    debug[2] = altitudeEstimator.velocity;          // velocity
+    debug[3] = altitudeEstimator.altitude;          // height
+#endif
 
-    baroVel = constrain(baroVel, -1500, 1500);  // constrain baro velocity +/- 1500cm/s
-    baroVel = applyDeadband(baroVel, 10);       // to reduce noise near zero
+    if (isCalibrating) {
+        return;
+    }
 
-    // apply Complimentary Filter to keep the calculated velocity based on baro velocity (i.e. near real velocity).
-    // By using CF it's possible to correct the drift of integrated accZ (velocity) without loosing the phase, i.e without delay
-    vel = vel * barometerConfig()->baro_cf_vel + baroVel * (1.0f - barometerConfig()->baro_cf_vel);
-    vel_tmp = lrintf(vel);
+    EstAlt = lrintf(altitudeEstimator.altitude);
+    vel_tmp = lrintf(altitudeEstimator.velocity);
 
     // set vario
     vario = applyDeadband(vel_tmp, 5);
@@ -0,0 +1,303 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <platform.h>
+
+#ifdef AUTOTUNE
+
+#include "build/build_config.h"
+
+#include "common/axis.h"
+#include "common/maths.h"
+#include "common/filter.h"
+
+#include "config/parameter_group.h"
+#include "config/parameter_group_ids.h"
+#include "config/profile.h"
+#include "config/config_reset.h"
+
+#include "drivers/sensor.h"
+#include "drivers/accgyro.h"
+
+#include "sensors/sensors.h"
+#include "sensors/gyro.h"
+#include "sensors/acceleration.h"
+
+#include "rx/rx.h"
+
+#include "io/beeper.h"
+
+#include "fc/rc_controls.h"
+#include "fc/rate_profile.h"
+#include "fc/rc_adjustments.h"
+#include "fc/config.h"
+#include "fc/runtime_config.h"
+
+#include "flight/pid.h"
+#include "flight/pid_kernel.h"
+#include "flight/imu.h"
+
+#include "autotune.h"
+
+/*
+ * Relay feedback autotune (Astrom and Hagglund).
+ *
+ * The rate PID of one axis at a time is replaced by a relay that drives the axis with +/- autotune_relay_amplitude,
+ * switching whenever the rate error crosses the hysteresis band.  The loop settles into a limit cycle at the
+ * frequency where the phase lag of the craft is 180 degrees.  The period of the cycle is the ultimate period Tu
+ * and the describing function of the relay gives the ultimate gain Ku = 4 * d / (pi * sqrt(a^2 - e^2)), where d is
+ * the relay amplitude, a is the amplitude of the rate oscillation and e the hysteresis.  Ku is in the units of the
+ * rate PID (motor command per gyroADC / 4), so the tuning rules give the PID profile gains directly.
+ *
+ * The relay only runs with the sticks centred within autotune_stick_deadband, the throttle above min_check and the craft within autotune_max_angle,
+ * otherwise the PID flies the craft and the measurement of the axis starts over.  Roll, pitch and yaw are tuned in
+ * turn, yaw as a PI controller.  Failsafe ends the autotune and puts back the gains it started with.
+ */
+
+#define AUTOTUNE_SKIP_CYCLES        2       // start up transient
+#define AUTOTUNE_AXIS_TIMEOUT       10.0f   // seconds, give up on an axis that does not oscillate
+
+PG_REGISTER_PROFILE_WITH_RESET_TEMPLATE(autotuneConfig_t, autotuneConfig, PG_AUTOTUNE_CONFIG, 0);
+
+PG_RESET_TEMPLATE(autotuneConfig_t, autotuneConfig,
+    .autotune_rule = AUTOTUNE_RULE_TYREUS_LUYBEN,
+    .autotune_relay_amplitude = 100,
+    .autotune_hysteresis = 10,
+    .autotune_max_angle = 300,
+    .autotune_cycles = 6,
+    .autotune_stick_deadband = 10,
+);
+
+extern float dT;
+
+static autotuneRelay_t relay;
+static uint8_t autotuneAxis = FD_INDEX_COUNT;
+static bool newGains;
+
+// the gains when autotune was switched on, put back if failsafe ends it
+static uint8_t originalP8[FD_INDEX_COUNT];
+static uint8_t originalI8[FD_INDEX_COUNT];
+static uint8_t originalD8[FD_INDEX_COUNT];
+static bool originalNewGains;
+
+void autotuneRelayInit(autotuneRelay_t *relay, int16_t amplitude, int16_t hysteresis)
+{
+    memset(relay, 0, sizeof(*relay));
+    relay->amplitude = amplitude;
+    relay->hysteresis = hysteresis;
+    relay->output = -amplitude;
+}
+
+int16_t autotuneRelayUpdate(autotuneRelay_t *relay, int32_t setpoint, int32_t rate, float dt)
+{
+    const int32_t error = setpoint - rate;
+
+    relay->elapsed += dt;
+    relay->cycleTime += dt;
+    relay->cycleMax = MAX(relay->cycleMax, rate);
+    relay->cycleMin = MIN(relay->cycleMin, rate);
+
+    if (relay->output < 0 && error > relay->hysteresis) {
+        // a cycle runs from one rising switch to the next
+        if (relay->switchCount < AUTOTUNE_SKIP_CYCLES) {
+            relay->switchCount++;
+        } else {
+            relay->periodSum += relay->cycleTime;
+            relay->peakToPeakSum += relay->cycleMax - relay->cycleMin;
+            relay->cycleCount++;
+        }
+        relay->output = relay->amplitude;
+        relay->cycleTime = 0.0f;
+        relay->cycleMax = rate;
+        relay->cycleMin = rate;
+    } else if (relay->output > 0 && error < -relay->hysteresis) {
+        relay->output = -relay->amplitude;
+    }
+
+    return relay->output;
+}
+
+bool autotuneRelayResult(const autotuneRelay_t *relay, float *ultimateGain, float *ultimatePeriod)
+{
+    if (relay->cycleCount == 0) {
+        return false;
+    }
+
+    const float amplitude = relay->peakToPeakSum / (2 * relay->cycleCount);
+    if (amplitude <= relay->hysteresis) {
+        return false;
+    }
+
+    *ultimateGain = 4 * relay->amplitude / (M_PIf * sqrtf(sq(amplitude) - sq(relay->hysteresis)));
+    *ultimatePeriod = relay->periodSum / relay->cycleCount;
+    return true;
+}
+
+static uint8_t autotuneGainToPidProfile(float gain, float scale)
+{
+    return constrain(lrintf(gain / scale), PID_MIN, PID_MAX);
+}
+
+void autotuneCalculateGains(autotuneRule_e rule, bool usesDTerm, float ultimateGain, float ultimatePeriod, uint8_t *P8, uint8_t *I8, uint8_t *D8)
+{
+    float Kp, Ti, Td;
+
+    if (rule == AUTOTUNE_RULE_ZIEGLER_NICHOLS) {
+        if (usesDTerm) {
+            Kp = 0.6f * ultimateGain;
+            Ti = 0.5f * ultimatePeriod;
+            Td = 0.125f * ultimatePeriod;
+        } else {
+            Kp = 0.45f * ultimateGain;
+            Ti = ultimatePeriod / 1.2f;
+            Td = 0.0f;
+        }
+    } else {
+        // less aggressive, trades some response for much more damping than Ziegler-Nichols
+        if (usesDTerm) {
+            Kp = ultimateGain / 2.2f;
+            Ti = 2.2f * ultimatePeriod;
+            Td = ultimatePeriod / 6.3f;
+        } else {
+            Kp = ultimateGain / 3.2f;
+            Ti = 2.2f * ultimatePeriod;
+            Td = 0.0f;
+        }
+    }
+
+    *P8 = autotuneGainToPidProfile(Kp, PID_LUX_PTERM_SCALE);
+    *I8 = autotuneGainToPidProfile(Kp / Ti, PID_LUX_ITERM_SCALE);
+    *D8 = autotuneGainToPidProfile(Kp * Td, PID_LUX_DTERM_SCALE);
+}
+
+static void autotuneStartAxis(uint8_t axis)
+{
+    autotuneAxis = axis;
+    autotuneRelayInit(&relay, autotuneConfig()->autotune_relay_amplitude, autotuneConfig()->autotune_hysteresis);
+}
+
+void autotuneBegin(void)
+{
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        originalP8[axis] = pidProfile()->P8[axis];
+        originalI8[axis] = pidProfile()->I8[axis];
+        originalD8[axis] = pidProfile()->D8[axis];
+    }
+    originalNewGains = newGains;
+
+    autotuneStartAxis(FD_ROLL);
+}
+
+static void autotuneAbort(void)
+{
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        pidProfile()->P8[axis] = originalP8[axis];
+        pidProfile()->I8[axis] = originalI8[axis];
+        pidProfile()->D8[axis] = originalD8[axis];
+    }
+    activatePidConfig();
+    newGains = originalNewGains;
+    autotuneAxis = FD_INDEX_COUNT;
+}
+
+void autotuneReset(void)
+{
+    autotuneAxis = FD_INDEX_COUNT;
+    newGains = false;
+}
+
+bool autotuneHasNewGains(void)
+{
+    return newGains;
+}
+
+static bool autotuneIsInSafeEnvelope(void)
+{
+    if (rcData[THROTTLE] < rxConfig()->mincheck) {
+        return false;
+    }
+
+    // stick noise and a trimmed transmitter must not keep restarting the axis
+    const int16_t stickDeadband = autotuneConfig()->autotune_stick_deadband;
+    if (ABS(rcCommand[ROLL]) > stickDeadband || ABS(rcCommand[PITCH]) > stickDeadband || ABS(rcCommand[YAW]) > stickDeadband) {
+        return false;
+    }
+
+    const int16_t maxAngle = autotuneConfig()->autotune_max_angle;
+    return ABS(attitude.values.roll) <= maxAngle && ABS(attitude.values.pitch) <= maxAngle;
+}
+
+static void autotuneFinishAxis(void)
+{
+    float ultimateGain, ultimatePeriod;
+
+    // an axis that gave no usable result keeps its gains
+    if (autotuneRelayResult(&relay, &ultimateGain, &ultimatePeriod)) {
+        autotuneCalculateGains(autotuneConfig()->autotune_rule, autotuneAxis != FD_YAW, ultimateGain, ultimatePeriod,
+                &pidProfile()->P8[autotuneAxis], &pidProfile()->I8[autotuneAxis], &pidProfile()->D8[autotuneAxis]);
+        activatePidConfig();
+        newGains = true;
+        beeperConfirmationBeeps(autotuneAxis + 1);
+    }
+
+    autotuneStartAxis(autotuneAxis + 1);
+}
+
+/*
+ * Called after the PID controller while AUTOTUNE_MODE is active, replaces the output for the axis being tuned.
+ */
+void autotuneUpdate(int16_t *axisPID)
+{
+    if (autotuneAxis >= FD_INDEX_COUNT) {
+        return;
+    }
+
+    // the sticks are centred while failsafe lands the craft, the relay must not keep shaking it
+    if (FLIGHT_MODE(FAILSAFE_MODE)) {
+        autotuneAbort();
+        return;
+    }
+
+    if (!autotuneIsInSafeEnvelope()) {
+        autotuneStartAxis(autotuneAxis);
+        return;
+    }
+
+    const uint8_t axis = autotuneAxis;
+    int32_t setpoint = 0;
+    if (axis != FD_YAW) {
+        // pull the craft back to level as in ANGLE mode, slowly compared to the oscillation
+        setpoint = ((pidRuntimeConfig.angleTrim[axis] - attitude.raw[axis]) * pidRuntimeConfig.levelP8) >> 4;
+    }
+
+    axisPID[axis] = autotuneRelayUpdate(&relay, setpoint, gyroADC[axis] / 4, dT);
+
+    // the I term is not flying the axis, don't let it wind up before it is handed back
+    pidState.lastITerm[axis] = 0;
+    pidState.lastITermf[axis] = 0.0f;
+
+    if (relay.cycleCount >= autotuneConfig()->autotune_cycles || relay.elapsed > AUTOTUNE_AXIS_TIMEOUT) {
+        autotuneFinishAxis();
+    }
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifdef AUTOTUNE
+
+typedef enum {
+    AUTOTUNE_RULE_ZIEGLER_NICHOLS = 0,
+    AUTOTUNE_RULE_TYREUS_LUYBEN
+} autotuneRule_e;
+
+typedef struct autotuneConfig_s {
+    uint8_t  autotune_rule;                 // autotuneRule_e
+    uint16_t autotune_relay_amplitude;      // [10..300] PID output injected by the relay
+    uint8_t  autotune_hysteresis;           // [0..100] Rate error needed to switch the relay, rejects gyro noise
+    uint16_t autotune_max_angle;            // [50..450] Inclination in 0.1 degrees above which the relay is paused
+    uint8_t  autotune_cycles;               // [2..20] Oscillation cycles averaged for each axis
+    uint8_t  autotune_stick_deadband;       // [0..100] Stick deflection in rcCommand units still taken as centred
+} autotuneConfig_t;
+
+PG_DECLARE_PROFILE(autotuneConfig_t, autotuneConfig);
+
+typedef struct autotuneRelay_s {
+    int16_t amplitude;
+    int16_t hysteresis;
+    int16_t output;                         // +amplitude or -amplitude
+    uint8_t switchCount;                    // rising switches seen, the first cycles are the start up transient
+    uint8_t cycleCount;                     // cycles measured
+    float cycleTime;                        // seconds since the last rising switch
+    int32_t cycleMax;
+    int32_t cycleMin;
+    float periodSum;                        // seconds
+    float peakToPeakSum;                    // rate units
+    float elapsed;                          // seconds since the relay was started
+} autotuneRelay_t;
+
+void autotuneRelayInit(autotuneRelay_t *relay, int16_t amplitude, int16_t hysteresis);
+int16_t autotuneRelayUpdate(autotuneRelay_t *relay, int32_t setpoint, int32_t rate, float dt);
+bool autotuneRelayResult(const autotuneRelay_t *relay, float *ultimateGain, float *ultimatePeriod);
+void autotuneCalculateGains(autotuneRule_e rule, bool usesDTerm, float ultimateGain, float ultimatePeriod, uint8_t *P8, uint8_t *I8, uint8_t *D8);
+
+void autotuneBegin(void);
+void autotuneReset(void);
+void autotuneUpdate(int16_t *axisPID);
+bool autotuneHasNewGains(void);
+
+#endif
@@ -210,6 +210,7 @@ void calculate_Gtune(uint8_t axis)
 #endif
 
                 pidProfile()->P8[axis] = newP;                                // new P value
+                activatePidConfig();
             }
             OldError[axis] = error;
         }
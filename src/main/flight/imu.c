@@ -51,6 +51,7 @@
 #include "flight/mixer.h"
 #include "flight/pid.h"
 #include "flight/imu.h"
+#include "flight/imu_ekf.h"
 
 #include "io/gps.h"
 
@@ -75,10 +76,22 @@ float smallAngleCosZ = 0;
 
 static bool isAccelUpdatedAtLeastOnce = false;
 
+// Vibration is the RMS of the acceleration above ACC_VIBRATION_HPF_HZ, averaged with a ACC_VIBRATION_RMS_HZ low pass filter.
+#define ACC_VIBRATION_HPF_HZ    5
+#define ACC_VIBRATION_RMS_HZ    2
+// Full accelerometer gain below ACC_VIBRATION_GOOD, none above ACC_VIBRATION_BAD (g)
+#define ACC_VIBRATION_GOOD      0.3f
+#define ACC_VIBRATION_BAD       3.0f
+// The accelerometer is ignored for this long after the sensor clips
+#define ACC_CLIP_HOLD_US        500000
+
+STATIC_UNIT_TESTED float accVibration[XYZ_AXIS_COUNT];    // g RMS
+STATIC_UNIT_TESTED uint8_t accHealth = 100;               // percent, scales the accelerometer gain of the attitude filter
+
 static imuRuntimeConfig_t *imuRuntimeConfig;
 static accDeadband_t *accDeadband;
 
-PG_REGISTER_WITH_RESET_TEMPLATE(imuConfig_t, imuConfig, PG_IMU_CONFIG, 0);
+PG_REGISTER_WITH_RESET_TEMPLATE(imuConfig_t, imuConfig, PG_IMU_CONFIG, 2);
 PG_REGISTER_PROFILE_WITH_RESET_TEMPLATE(throttleCorrectionConfig_t, throttleCorrectionConfig, PG_THROTTLE_CORRECTION_CONFIG, 0);
 
 PG_RESET_TEMPLATE(imuConfig_t, imuConfig,
@@ -88,6 +101,8 @@ PG_RESET_TEMPLATE(imuConfig_t, imuConfig,
     .gyroSyncDenominator = 1,
     .small_angle = 25,
     .max_angle_inclination = 500,    // 50 degrees
+    .attitude_estimator = IMU_ESTIMATOR_MAHONY,
+    .attitude_update_hz = 500,
 );
 
 PG_RESET_TEMPLATE(throttleCorrectionConfig_t, throttleCorrectionConfig,
@@ -102,6 +117,27 @@ attitudeEulerAngles_t attitude = { { 0, 0, 0 } };     // absolute angle inclinat
 
 static float gyroScale;
 
+/*
+ * The gyro is integrated every loop into a body frame rotation vector, the attitude filter runs on the accumulated
+ * rotation at attitude_update_hz.  Summing the gyro samples alone would ignore the rotation of the body between them,
+ * which under coning motion shows up as a drift, so the accumulated rotation includes a coning correction.
+ */
+STATIC_UNIT_TESTED float deltaAngle[XYZ_AXIS_COUNT];          // rad, since the last attitude update
+static float previousGyroDeltaAngle[XYZ_AXIS_COUNT];           // rad, the previous gyro sample
+STATIC_UNIT_TESTED uint32_t deltaAngleTime;                    // us, since the last attitude update
+static uint32_t attitudeUpdateInterval;                        // us
+
+#ifdef USE_IMU_EKF
+#define IMU_EKF_ACC_NOISE           0.05f       // normalised accelerometer, g
+// Increases the accelerometer noise when the craft is accelerating, in proportion to the error in |acc| (g)
+#define IMU_EKF_ACC_MAGNITUDE_NOISE 50.0f
+#define IMU_EKF_MAG_NOISE           0.1f        // heading, rad
+#define IMU_EKF_GPS_COURSE_NOISE    0.1f        // heading, rad
+
+STATIC_UNIT_TESTED imuEkf_t imuEkf;
+static bool imuEkfSelected = false;
+#endif
+
 STATIC_UNIT_TESTED void imuComputeRotationMatrix(void)
 {
     float q1q1 = sq(q1);
@@ -139,6 +175,16 @@ void imuConfigure(
     accDeadband = initialAccDeadband;
     fc_acc = calculateAccZLowPassFilterRCTimeConstant(accz_lpf_cutoff);
     throttleAngleScale = calculateThrottleAngleScale(throttle_correction_angle);
+    attitudeUpdateInterval = imuRuntimeConfig->attitude_update_hz ? 1000000 / imuRuntimeConfig->attitude_update_hz : 0;
+
+#ifdef USE_IMU_EKF
+    // start from the current attitude when the EKF is selected, it keeps its gyro bias while it stays selected
+    const bool ekfSelected = imuRuntimeConfig->attitude_estimator == IMU_ESTIMATOR_EKF;
+    if (ekfSelected && !imuEkfSelected) {
+        imuEkfInit(&imuEkf, q0, q1, q2, q3);
+    }
+    imuEkfSelected = ekfSelected;
+#endif
 }
 
 void imuInit(void)
@@ -229,6 +275,54 @@ static float invSqrt(float x)
     return 1.0f / sqrtf(x);
 }
 
+// Uses the unfiltered readings since acc_cut_hz removes most of the vibration from accSmooth
+STATIC_UNIT_TESTED void imuUpdateAccVibration(float dT)
+{
+    static pt1Filter_t accLowPass[XYZ_AXIS_COUNT];
+    static pt1Filter_t accMeanSquare[XYZ_AXIS_COUNT];
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        float accG = (float)accADC[axis] / acc.acc_1G;
+        float accHighPass = accG - pt1FilterApply4(&accLowPass[axis], accG, ACC_VIBRATION_HPF_HZ, dT);
+
+        accVibration[axis] = sqrtf(pt1FilterApply4(&accMeanSquare[axis], sq(accHighPass), ACC_VIBRATION_RMS_HZ, dT));
+    }
+}
+
+STATIC_UNIT_TESTED uint8_t imuCalculateAccHealth(uint32_t currentTime)
+{
+    static uint32_t lastClipCount = 0;
+    static uint32_t lastClipAt = 0;
+    static bool clipped = false;
+
+    if (accClipCount != lastClipCount) {
+        lastClipCount = accClipCount;
+        lastClipAt = currentTime;
+        clipped = true;
+    }
+
+    if (clipped && currentTime - lastClipAt < ACC_CLIP_HOLD_US) {
+        return 0;
+    }
+    clipped = false;
+
+    float vibration = sqrtf(sq(accVibration[X]) + sq(accVibration[Y]) + sq(accVibration[Z]));
+    float health = (ACC_VIBRATION_BAD - vibration) / (ACC_VIBRATION_BAD - ACC_VIBRATION_GOOD);
+
+    return lrintf(constrainf(health, 0.0f, 1.0f) * 100);
+}
+
+// in 0.01g steps
+uint16_t imuGetAccVibration(int axis)
+{
+    return lrintf(MIN(accVibration[axis] * 100, UINT16_MAX));
+}
+
+uint8_t imuGetAccHealth(void)
+{
+    return accHealth;
+}
+
 static bool imuUseFastGains(void)
 {
     return !ARMING_FLAG(ARMED) && millis() < 20000;
@@ -244,8 +338,8 @@ static float imuGetPGainScaleFactor(void)
     }
 }
 
-static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
-                                bool useAcc, float ax, float ay, float az,
+STATIC_UNIT_TESTED void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
+                                bool useAcc, float accWeight, float ax, float ay, float az,
                                 bool useMag, float mx, float my, float mz,
                                 bool useYaw, float yawError)
 {
@@ -302,10 +396,10 @@ static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
         ay *= recipNorm;
         az *= recipNorm;
 
-        // Error is sum of cross product between estimated direction and measured direction of gravity
-        ex += (ay * rMat[2][2] - az * rMat[2][1]);
-        ey += (az * rMat[2][0] - ax * rMat[2][2]);
-        ez += (ax * rMat[2][1] - ay * rMat[2][0]);
+        // Error is sum of cross product between estimated direction and measured direction of gravity, trusted less when vibrating
+        ex += (ay * rMat[2][2] - az * rMat[2][1]) * accWeight;
+        ey += (az * rMat[2][0] - ax * rMat[2][2]) * accWeight;
+        ez += (ax * rMat[2][1] - ay * rMat[2][0]) * accWeight;
     }
 
     // Compute and apply integral feedback if enabled
@@ -356,6 +450,49 @@ static void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
     imuComputeRotationMatrix();
 }
 
+#ifdef USE_IMU_EKF
+STATIC_UNIT_TESTED void imuEkfAHRSupdate(float dt, float gx, float gy, float gz,
+                                bool useAcc, float accWeight, float ax, float ay, float az,
+                                bool useMag, float mx, float my, float mz,
+                                bool useYaw, float yawError)
+{
+    imuEkfIntegrateGyro(&imuEkf, gx, gy, gz, dt);
+    imuEkfPropagateCovariance(&imuEkf);
+
+    float accMagnitude = sqrtf(sq(ax) + sq(ay) + sq(az));
+    if (useAcc && accWeight > 0.0f && accMagnitude > 0.01f) {
+        float accMagnitudeError = accMagnitude / acc.acc_1G - 1.0f;
+        float noise = (sq(IMU_EKF_ACC_NOISE) + sq(IMU_EKF_ACC_MAGNITUDE_NOISE * accMagnitudeError)) / accWeight;
+
+        imuEkfFuseGravity(&imuEkf, ax / accMagnitude, ay / accMagnitude, az / accMagnitude, noise);
+    }
+
+    // same measurements as the Mahony filter, see imuMahonyAHRSupdate()
+    if (useMag && (sq(mx) + sq(my) + sq(mz)) > 0.01f) {
+        float hx = rMat[0][0] * mx + rMat[0][1] * my + rMat[0][2] * mz;
+        float hy = rMat[1][0] * mx + rMat[1][1] * my + rMat[1][2] * mz;
+
+        imuEkfFuseHeading(&imuEkf, atan2_approx(-hy, hx), sq(IMU_EKF_MAG_NOISE));
+    }
+
+    if (useYaw) {
+        while (yawError >  M_PIf) yawError -= (2.0f * M_PIf);
+        while (yawError < -M_PIf) yawError += (2.0f * M_PIf);
+
+        imuEkfFuseHeading(&imuEkf, yawError, sq(IMU_EKF_GPS_COURSE_NOISE));
+    }
+
+    imuEkfApplyCorrection(&imuEkf);
+
+    q0 = imuEkf.q[0];
+    q1 = imuEkf.q[1];
+    q2 = imuEkf.q[2];
+    q3 = imuEkf.q[3];
+
+    imuComputeRotationMatrix();
+}
+#endif
+
 STATIC_UNIT_TESTED void imuUpdateEulerAngles(void)
 {
     /* Compute pitch/roll angles */
@@ -405,7 +542,28 @@ static bool isMagnetometerHealthy(void)
 }
 #endif
 
-static void imuCalculateEstimatedAttitude(void)
+// dt in seconds, the rotation of the gyro sample is the rate times dt
+STATIC_UNIT_TESTED void imuAccumulateDeltaAngle(float gx, float gy, float gz, float dt)
+{
+    const float dx = gx * dt;
+    const float dy = gy * dt;
+    const float dz = gz * dt;
+
+    // coning correction 0.5 * (alpha + previous / 6) x delta, see Savage, Strapdown Inertial Navigation Integration Algorithm Design
+    const float ax = deltaAngle[X] + previousGyroDeltaAngle[X] * (1.0f / 6.0f);
+    const float ay = deltaAngle[Y] + previousGyroDeltaAngle[Y] * (1.0f / 6.0f);
+    const float az = deltaAngle[Z] + previousGyroDeltaAngle[Z] * (1.0f / 6.0f);
+
+    deltaAngle[X] += dx + 0.5f * (ay * dz - az * dy);
+    deltaAngle[Y] += dy + 0.5f * (az * dx - ax * dz);
+    deltaAngle[Z] += dz + 0.5f * (ax * dy - ay * dx);
+
+    previousGyroDeltaAngle[X] = dx;
+    previousGyroDeltaAngle[Y] = dy;
+    previousGyroDeltaAngle[Z] = dz;
+}
+
+STATIC_UNIT_TESTED void imuCalculateEstimatedAttitude(void)
 {
     static pt1Filter_t accLPFState[3];
     static uint32_t previousIMUUpdateTime;
@@ -416,18 +574,40 @@ static void imuCalculateEstimatedAttitude(void)
     bool useYaw = false;
 
     uint32_t currentTime = micros();
-    uint32_t deltaT = currentTime - previousIMUUpdateTime;
+    uint32_t gyroDeltaT = currentTime - previousIMUUpdateTime;
     previousIMUUpdateTime = currentTime;
 
+    imuAccumulateDeltaAngle(gyroADC[X] * gyroScale, gyroADC[Y] * gyroScale, gyroADC[Z] * gyroScale, gyroDeltaT * 1e-6f);
+    deltaAngleTime += gyroDeltaT;
+
+    if (deltaAngleTime < attitudeUpdateInterval) {
+        return;
+    }
+
+    // the rest of the attitude update runs at the lower rate
+    uint32_t deltaT = deltaAngleTime;
+    float dT = deltaT * 1e-6f;
+    float gx = deltaAngle[X] / dT;
+    float gy = deltaAngle[Y] / dT;
+    float gz = deltaAngle[Z] / dT;
+
+    deltaAngle[X] = 0;
+    deltaAngle[Y] = 0;
+    deltaAngle[Z] = 0;
+    deltaAngleTime = 0;
+
     // Smooth and use only valid accelerometer readings
     for (axis = 0; axis < 3; axis++) {
         if (imuRuntimeConfig->acc_cut_hz > 0) {
-            accSmooth[axis] = pt1FilterApply4(&accLPFState[axis], accADC[axis], imuRuntimeConfig->acc_cut_hz, deltaT * 1e-6f);
+            accSmooth[axis] = pt1FilterApply4(&accLPFState[axis], accADC[axis], imuRuntimeConfig->acc_cut_hz, dT);
         } else {
             accSmooth[axis] = accADC[axis];
         }
     }
 
+    imuUpdateAccVibration(dT);
+    accHealth = imuCalculateAccHealth(currentTime);
+
     if (imuIsAccelerometerHealthy()) {
         useAcc = true;
     }
@@ -445,11 +625,20 @@ static void imuCalculateEstimatedAttitude(void)
     }
 #endif
 
-    imuMahonyAHRSupdate(deltaT * 1e-6f,
-                        gyroADC[X] * gyroScale, gyroADC[Y] * gyroScale, gyroADC[Z] * gyroScale,
-                        useAcc, accSmooth[X], accSmooth[Y], accSmooth[Z],
-                        useMag, magADC[X], magADC[Y], magADC[Z],
-                        useYaw, rawYawError);
+#ifdef USE_IMU_EKF
+    if (imuRuntimeConfig->attitude_estimator == IMU_ESTIMATOR_EKF) {
+        imuEkfAHRSupdate(dT, gx, gy, gz,
+                            useAcc, accHealth / 100.0f, accSmooth[X], accSmooth[Y], accSmooth[Z],
+                            useMag, magADC[X], magADC[Y], magADC[Z],
+                            useYaw, rawYawError);
+    } else
+#endif
+    {
+        imuMahonyAHRSupdate(dT, gx, gy, gz,
+                            useAcc, accHealth / 100.0f, accSmooth[X], accSmooth[Y], accSmooth[Z],
+                            useMag, magADC[X], magADC[Y], magADC[Z],
+                            useYaw, rawYawError);
+    }
 
     imuUpdateEulerAngles();
 
@@ -41,6 +41,11 @@ typedef union {
 
 extern attitudeEulerAngles_t attitude;
 
+typedef enum {
+    IMU_ESTIMATOR_MAHONY = 0,
+    IMU_ESTIMATOR_EKF
+} imuEstimator_e;
+
 typedef struct imuConfig_s {
     // IMU configuration
     uint16_t looptime;                      // imu loop time in us
@@ -50,6 +55,8 @@ typedef struct imuConfig_s {
     uint16_t dcm_ki;                        // DCM filter integral gain ( x 10000)
     uint8_t small_angle;                    // Angle used for mag hold threshold.
     uint16_t max_angle_inclination;         // max inclination allowed in angle (level) mode. default 500 (50 degrees).
+    uint8_t attitude_estimator;             // see imuEstimator_e, the EKF is only available on targets that define USE_IMU_EKF
+    uint16_t attitude_update_hz;            // rate of the attitude filter, the gyro is integrated every loop
 } imuConfig_t;
 
 PG_DECLARE(imuConfig_t, imuConfig);
@@ -67,6 +74,8 @@ typedef struct imuRuntimeConfig_s {
     float dcm_ki;
     float dcm_kp;
     uint8_t small_angle;
+    uint8_t attitude_estimator;
+    uint16_t attitude_update_hz;
 } imuRuntimeConfig_t;
 
 void imuInit(void);
@@ -92,3 +101,6 @@ void imuResetAccelerationSum(void);
 
 bool imuIsAircraftArmable(uint8_t arming_angle);
 
+uint16_t imuGetAccVibration(int axis);
+uint8_t imuGetAccHealth(void);
+
@@ -0,0 +1,241 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Multiplicative (error state) quaternion EKF with gyro bias states
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <platform.h>
+
+#include "common/axis.h"
+#include "common/maths.h"
+
+#include "flight/imu_ekf.h"
+
+#ifdef USE_IMU_EKF
+
+/*
+ * The quaternion and gyro bias are the full state, the filter estimates the error in them.  The attitude error is a
+ * small rotation in the body frame so the covariance is only 6x6.  The caller accumulates the gyro every loop and
+ * runs the filter at a lower rate, see attitude_update_hz.  Each measurement vector
+ * is fused one component at a time which avoids inverting a matrix.
+ */
+
+#define IMU_EKF_GYRO_NOISE          0.002f      // rad/s
+#define IMU_EKF_GYRO_BIAS_NOISE     0.0005f     // rad/s per sqrt(s)
+#define IMU_EKF_INITIAL_ATTITUDE    0.5f        // rad
+#define IMU_EKF_INITIAL_GYRO_BIAS   0.05f       // rad/s
+#define IMU_EKF_MAX_GYRO_BIAS       0.2f        // rad/s
+
+void imuEkfInit(imuEkf_t *ekf, float q0, float q1, float q2, float q3)
+{
+    memset(ekf, 0, sizeof(*ekf));
+
+    ekf->q[0] = q0;
+    ekf->q[1] = q1;
+    ekf->q[2] = q2;
+    ekf->q[3] = q3;
+
+    for (int i = 0; i < 3; i++) {
+        ekf->P[i][i] = sq(IMU_EKF_INITIAL_ATTITUDE);
+        ekf->P[i + 3][i + 3] = sq(IMU_EKF_INITIAL_GYRO_BIAS);
+    }
+}
+
+static void imuEkfNormalise(imuEkf_t *ekf)
+{
+    float recipNorm = 1.0f / sqrtf(sq(ekf->q[0]) + sq(ekf->q[1]) + sq(ekf->q[2]) + sq(ekf->q[3]));
+
+    ekf->q[0] *= recipNorm;
+    ekf->q[1] *= recipNorm;
+    ekf->q[2] *= recipNorm;
+    ekf->q[3] *= recipNorm;
+}
+
+// rotates q by the small body frame rotation (x, y, z), radians
+static void imuEkfRotate(imuEkf_t *ekf, float x, float y, float z)
+{
+    float qa = ekf->q[0];
+    float qb = ekf->q[1];
+    float qc = ekf->q[2];
+    float qd = ekf->q[3];
+
+    x *= 0.5f;
+    y *= 0.5f;
+    z *= 0.5f;
+
+    ekf->q[0] += (-qb * x - qc * y - qd * z);
+    ekf->q[1] += (qa * x + qc * z - qd * y);
+    ekf->q[2] += (qa * y - qb * z + qd * x);
+    ekf->q[3] += (qa * z + qb * y - qc * x);
+
+    imuEkfNormalise(ekf);
+}
+
+void imuEkfIntegrateGyro(imuEkf_t *ekf, float gx, float gy, float gz, float dt)
+{
+    ekf->rate[X] = gx - ekf->gyroBias[X];
+    ekf->rate[Y] = gy - ekf->gyroBias[Y];
+    ekf->rate[Z] = gz - ekf->gyroBias[Z];
+
+    imuEkfRotate(ekf, ekf->rate[X] * dt, ekf->rate[Y] * dt, ekf->rate[Z] * dt);
+
+    ekf->dT += dt;
+}
+
+void imuEkfPropagateCovariance(imuEkf_t *ekf)
+{
+    float dt = ekf->dT;
+    float A[3][3];
+    float APaa[3][3];
+    float Pab[3][3];
+
+    if (dt <= 0.0f) {
+        return;
+    }
+
+    /*
+     * The transition matrix is [A -I*dt; 0 I], the attitude error rotates with the body (A = I - [rate x]*dt) and
+     * is driven by the bias error.  Expanding P = phi * P * phi' in 3x3 blocks avoids the multiplications by zero:
+     *
+     * Pab' = A * Pab - Pbb * dt
+     * Paa' = (A * Paa - Pba * dt) * A' - Pab' * dt
+     */
+    A[0][0] = 1.0f;                 A[0][1] =  ekf->rate[Z] * dt;   A[0][2] = -ekf->rate[Y] * dt;
+    A[1][0] = -ekf->rate[Z] * dt;   A[1][1] = 1.0f;                 A[1][2] =  ekf->rate[X] * dt;
+    A[2][0] =  ekf->rate[Y] * dt;   A[2][1] = -ekf->rate[X] * dt;   A[2][2] = 1.0f;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            float sumPaa = -ekf->P[i + 3][j] * dt;
+            float sumPab = -ekf->P[i + 3][j + 3] * dt;
+            for (int k = 0; k < 3; k++) {
+                sumPaa += A[i][k] * ekf->P[k][j];
+                sumPab += A[i][k] * ekf->P[k][j + 3];
+            }
+            APaa[i][j] = sumPaa;
+            Pab[i][j] = sumPab;
+        }
+    }
+
+    // P is symmetric so only the upper triangle of Paa is calculated
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            float sum = -Pab[i][j] * dt;
+            for (int k = 0; k < 3; k++) {
+                sum += APaa[i][k] * A[j][k];
+            }
+            ekf->P[i][j] = sum;
+            ekf->P[j][i] = sum;
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            ekf->P[i][j + 3] = Pab[i][j];
+            ekf->P[j + 3][i] = Pab[i][j];
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        ekf->P[i][i] += sq(IMU_EKF_GYRO_NOISE) * dt;
+        ekf->P[i + 3][i + 3] += sq(IMU_EKF_GYRO_BIAS_NOISE) * dt;
+    }
+
+    ekf->dT = 0.0f;
+}
+
+static void imuEkfFuseScalar(imuEkf_t *ekf, const float H[IMU_EKF_STATE_COUNT], float innovation, float noise)
+{
+    float PHt[IMU_EKF_STATE_COUNT];
+    float S = noise;
+
+    for (int i = 0; i < IMU_EKF_STATE_COUNT; i++) {
+        float sum = 0.0f;
+        for (int j = 0; j < IMU_EKF_STATE_COUNT; j++) {
+            sum += ekf->P[i][j] * H[j];
+        }
+        PHt[i] = sum;
+        S += H[i] * sum;
+        // account for the measurements already fused this update
+        innovation -= H[i] * ekf->correction[i];
+    }
+
+    float recipS = 1.0f / S;
+
+    for (int i = 0; i < IMU_EKF_STATE_COUNT; i++) {
+        float K = PHt[i] * recipS;
+
+        ekf->correction[i] += K * innovation;
+        for (int j = 0; j < IMU_EKF_STATE_COUNT; j++) {
+            ekf->P[i][j] -= K * PHt[j];
+        }
+    }
+}
+
+// The estimated direction of gravity (up) in the body frame is the last row of the rotation matrix
+static void imuEkfEstimatedUp(const imuEkf_t *ekf, float *vx, float *vy, float *vz)
+{
+    const float *q = ekf->q;
+
+    *vx = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    *vy = 2.0f * (q[2] * q[3] + q[0] * q[1]);
+    *vz = 1.0f - 2.0f * sq(q[1]) - 2.0f * sq(q[2]);
+}
+
+// a is the normalised accelerometer reading, noise is its variance
+void imuEkfFuseGravity(imuEkf_t *ekf, float ax, float ay, float az, float noise)
+{
+    float vx, vy, vz;
+    imuEkfEstimatedUp(ekf, &vx, &vy, &vz);
+
+    // d(up)/d(attitude error) = [up x]
+    const float Hx[IMU_EKF_STATE_COUNT] = { 0.0f, -vz,   vy,   0.0f, 0.0f, 0.0f };
+    const float Hy[IMU_EKF_STATE_COUNT] = { vz,   0.0f, -vx,   0.0f, 0.0f, 0.0f };
+    const float Hz[IMU_EKF_STATE_COUNT] = { -vy,  vx,   0.0f,  0.0f, 0.0f, 0.0f };
+
+    imuEkfFuseScalar(ekf, Hx, ax - vx, noise);
+    imuEkfFuseScalar(ekf, Hy, ay - vy, noise);
+    imuEkfFuseScalar(ekf, Hz, az - vz, noise);
+}
+
+// headingError is the rotation about the earth z axis that corrects the heading, radians
+void imuEkfFuseHeading(imuEkf_t *ekf, float headingError, float noise)
+{
+    float vx, vy, vz;
+    imuEkfEstimatedUp(ekf, &vx, &vy, &vz);
+
+    const float H[IMU_EKF_STATE_COUNT] = { vx, vy, vz, 0.0f, 0.0f, 0.0f };
+
+    imuEkfFuseScalar(ekf, H, headingError, noise);
+}
+
+void imuEkfApplyCorrection(imuEkf_t *ekf)
+{
+    imuEkfRotate(ekf, ekf->correction[0], ekf->correction[1], ekf->correction[2]);
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        ekf->gyroBias[axis] = constrainf(ekf->gyroBias[axis] + ekf->correction[axis + 3], -IMU_EKF_MAX_GYRO_BIAS, IMU_EKF_MAX_GYRO_BIAS);
+    }
+
+    memset(ekf->correction, 0, sizeof(ekf->correction));
+}
+
+#endif
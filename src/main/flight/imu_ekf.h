@@ -0,0 +1,37 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// attitude error (body frame, rad) followed by gyro bias error (rad/s)
+#define IMU_EKF_STATE_COUNT 6
+
+typedef struct imuEkf_s {
+    float q[4];                                             // sensor frame relative to earth frame, same convention as the Mahony filter
+    float gyroBias[XYZ_AXIS_COUNT];                         // rad/s
+    float P[IMU_EKF_STATE_COUNT][IMU_EKF_STATE_COUNT];      // error state covariance
+    float correction[IMU_EKF_STATE_COUNT];                  // error state accumulated by the measurement updates
+    float rate[XYZ_AXIS_COUNT];                             // bias corrected body rate used for the last integration, rad/s
+    float dT;                                               // time integrated since the covariance was last propagated, seconds
+} imuEkf_t;
+
+void imuEkfInit(imuEkf_t *ekf, float q0, float q1, float q2, float q3);
+void imuEkfIntegrateGyro(imuEkf_t *ekf, float gx, float gy, float gz, float dt);
+void imuEkfPropagateCovariance(imuEkf_t *ekf);
+void imuEkfFuseGravity(imuEkf_t *ekf, float ax, float ay, float az, float noise);
+void imuEkfFuseHeading(imuEkf_t *ekf, float headingError, float noise);
+void imuEkfApplyCorrection(imuEkf_t *ekf);
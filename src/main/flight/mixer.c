@@ -35,6 +35,7 @@
 #include "drivers/system.h"
 #include "drivers/pwm_output.h"
 #include "drivers/pwm_mapping.h"
+#include "drivers/dshot.h"
 #include "drivers/sensor.h"
 #include "drivers/accgyro.h"
 #include "drivers/system.h"
@@ -72,8 +73,37 @@ bool motorLimitReached;
 
 motorMixer_t currentMixer[MAX_SUPPORTED_MOTORS];
 
+// currentMixer with the yaw direction folded in, mixTable() multiplies it by the throttle and the PID outputs
+static motorMixer_t mixerMatrix[MAX_SUPPORTED_MOTORS];
+
+// the settings used by mixTable(), so it doesn't go through the parameter groups every loop
+typedef struct mixerRuntimeConfig_s {
+    int16_t minthrottle;
+    int16_t maxthrottle;
+    int16_t mincommand;
+    int16_t midrc;
+    int16_t mincheck;
+    int16_t deadband3dLow;
+    int16_t deadband3dHigh;
+    int16_t deadband3dThrottle;
+    int16_t yawJumpPreventionLimit;
+    bool pidAtMinThrottle;
+    bool thrustLinear;
+    int32_t thrustLookupScale;              // lookup table segments per motor output step, 16.16 fixed point
+} mixerRuntimeConfig_t;
+
+static mixerRuntimeConfig_t mixerRuntimeConfig;
+
+#define THRUST_LOOKUP_LENGTH 17
+
+// thrust of evenly spaced motor outputs over minthrottle to maxthrottle, in the same units as the motor output
+static int16_t thrustLookup[THRUST_LOOKUP_LENGTH];
+static int16_t thrustOutputLookup[THRUST_LOOKUP_LENGTH];
+// motor output per thrust of each segment, 16.16 fixed point
+static int32_t thrustInverseSlope[THRUST_LOOKUP_LENGTH - 1];
+
 PG_REGISTER_ARR(motorMixer_t, MAX_SUPPORTED_MOTORS, customMotorMixer, PG_MOTOR_MIXER, 0);
-PG_REGISTER_WITH_RESET_TEMPLATE(mixerConfig_t, mixerConfig, PG_MIXER_CONFIG, 0);
+PG_REGISTER_WITH_RESET_TEMPLATE(mixerConfig_t, mixerConfig, PG_MIXER_CONFIG, 1);
 PG_REGISTER_WITH_RESET_TEMPLATE(motor3DConfig_t, motor3DConfig, PG_MOTOR_3D_CONFIG, 0);
 
 PG_RESET_TEMPLATE(motor3DConfig_t, motor3DConfig,
@@ -89,6 +119,7 @@ PG_RESET_TEMPLATE(mixerConfig_t, mixerConfig,
     .pid_at_min_throttle = 1,
     .yaw_motor_direction = 1,
     .yaw_jump_prevention_limit = 200,
+    .thrust_linear = 0,
 
     .tri_unarmed_servo = 1,
     .servo_lowpass_freq = 400.0f,
@@ -99,6 +130,7 @@ PG_RESET_TEMPLATE(mixerConfig_t, mixerConfig,
     .pid_at_min_throttle = 1,
     .yaw_motor_direction = 1,
     .yaw_jump_prevention_limit = 200,
+    .thrust_linear = 0,
 );
 #endif
 
@@ -325,6 +357,100 @@ void mixerInit(motorMixer_t *initialCustomMixers)
     customMixers = initialCustomMixers;
 }
 
+/*
+ * The thrust of a propeller is roughly quadratic in the motor command. With thrust_linear = k%
+ * the normalised thrust of a normalised motor output u is modelled as t = (1 - k) * u + k * u^2.
+ * Between the table entries the thrust is interpolated linearly, the inverse of each segment gives
+ * the motor output for a thrust, so a thrust converted back gives the same motor output.
+ */
+static void generateThrustLookup(void)
+{
+    const int16_t outputRange = mixerRuntimeConfig.maxthrottle - mixerRuntimeConfig.minthrottle;
+    const float k = mixerConfig()->thrust_linear / 100.0f;
+
+    mixerRuntimeConfig.thrustLinear = k > 0 && outputRange >= THRUST_LOOKUP_LENGTH;
+    if (!mixerRuntimeConfig.thrustLinear) {
+        return;
+    }
+
+    mixerRuntimeConfig.thrustLookupScale = ((THRUST_LOOKUP_LENGTH - 1) << 16) / outputRange;
+
+    for (int i = 0; i < THRUST_LOOKUP_LENGTH; i++) {
+        const float output = (float)i / (THRUST_LOOKUP_LENGTH - 1);
+
+        thrustOutputLookup[i] = mixerRuntimeConfig.minthrottle + lrintf(output * outputRange);
+        thrustLookup[i] = mixerRuntimeConfig.minthrottle + lrintf(((1.0f - k) * output + k * output * output) * outputRange);
+    }
+
+    for (int i = 0; i < THRUST_LOOKUP_LENGTH - 1; i++) {
+        const int32_t thrustStep = MAX(thrustLookup[i + 1] - thrustLookup[i], 1);
+        thrustInverseSlope[i] = ((thrustOutputLookup[i + 1] - thrustOutputLookup[i]) << 16) / thrustStep;
+    }
+}
+
+// integer only, values outside minthrottle to maxthrottle are returned unchanged
+static int16_t motorOutputToThrust(int16_t output)
+{
+    const mixerRuntimeConfig_t *config = &mixerRuntimeConfig;
+
+    if (output <= config->minthrottle || output >= config->maxthrottle) {
+        return output;
+    }
+
+    const int32_t position = (output - config->minthrottle) * config->thrustLookupScale;
+    const int32_t index = MIN(position >> 16, THRUST_LOOKUP_LENGTH - 2);
+    const int32_t fraction = position & 0xFFFF;
+
+    return thrustLookup[index] + (((thrustLookup[index + 1] - thrustLookup[index]) * fraction + 0x8000) >> 16);
+}
+
+static int16_t thrustToMotorOutput(int16_t thrust)
+{
+    const mixerRuntimeConfig_t *config = &mixerRuntimeConfig;
+
+    if (thrust <= config->minthrottle || thrust >= config->maxthrottle) {
+        return thrust;
+    }
+
+    // find the segment, the thrust increases with the motor output
+    int low = 0;
+    int high = THRUST_LOOKUP_LENGTH - 1;
+    while (high - low > 1) {
+        const int middle = (low + high) / 2;
+        if (thrustLookup[middle] <= thrust) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return thrustOutputLookup[low] + (((thrust - thrustLookup[low]) * thrustInverseSlope[low] + 0x8000) >> 16);
+}
+
+// must be called after loading currentMixer or changing the mixer, motor, 3D or rx settings
+void mixerInitConfig(void)
+{
+    for (int i = 0; i < motorCount; i++) {
+        mixerMatrix[i].throttle = currentMixer[i].throttle;
+        mixerMatrix[i].roll = currentMixer[i].roll;
+        mixerMatrix[i].pitch = currentMixer[i].pitch;
+        mixerMatrix[i].yaw = -mixerConfig()->yaw_motor_direction * currentMixer[i].yaw;
+    }
+
+    mixerRuntimeConfig.minthrottle = motorAndServoConfig()->minthrottle;
+    mixerRuntimeConfig.maxthrottle = motorAndServoConfig()->maxthrottle;
+    mixerRuntimeConfig.mincommand = motorAndServoConfig()->mincommand;
+    mixerRuntimeConfig.midrc = rxConfig()->midrc;
+    mixerRuntimeConfig.mincheck = rxConfig()->mincheck;
+    mixerRuntimeConfig.deadband3dLow = motor3DConfig()->deadband3d_low;
+    mixerRuntimeConfig.deadband3dHigh = motor3DConfig()->deadband3d_high;
+    mixerRuntimeConfig.deadband3dThrottle = rcControlsConfig()->deadband3d_throttle;
+    mixerRuntimeConfig.yawJumpPreventionLimit = mixerConfig()->yaw_jump_prevention_limit;
+    mixerRuntimeConfig.pidAtMinThrottle = mixerConfig()->pid_at_min_throttle;
+
+    generateThrustLookup();
+}
+
 #if !defined(USE_SERVOS) || defined(USE_QUAD_MIXER_ONLY)
 void mixerUsePWMIOConfiguration(pwmIOConfiguration_t *pwmIOConfiguration)
 {
@@ -334,6 +460,7 @@ void mixerUsePWMIOConfiguration(pwmIOConfiguration_t *pwmIOConfiguration)
     for (i = 0; i < motorCount; i++) {
         currentMixer[i] = mixerQuadX[i];
     }
+    mixerInitConfig();
     mixerResetDisarmedMotors();
 }
 #endif
@@ -359,23 +486,57 @@ void mixerLoadMix(int index, motorMixer_t *customMixers)
 
 #endif
 
+// DShot has no neutral point, stopped motors are sent the stop command even in 3D mode
+static int16_t mixerStoppedMotorValue(void)
+{
+#ifdef USE_DSHOT
+    if (isMotorProtocolDshot()) {
+        return motorAndServoConfig()->mincommand;
+    }
+#endif
+
+    return feature(FEATURE_3D) ? motor3DConfig()->neutral3d : motorAndServoConfig()->mincommand;
+}
+
 void mixerResetDisarmedMotors(void)
 {
     int i;
     // set disarmed motor values
     for (i = 0; i < MAX_SUPPORTED_MOTORS; i++)
-        motor_disarmed[i] = feature(FEATURE_3D) ? motor3DConfig()->neutral3d : motorAndServoConfig()->mincommand;
+        motor_disarmed[i] = mixerStoppedMotorValue();
+}
+
+#ifdef USE_DSHOT
+// mincommand and below stop the motor, above it the range up to PWM_RANGE_MAX maps onto the DShot throttle values
+static uint16_t mixerMotorToDshot(int16_t value)
+{
+    if (value <= mixerRuntimeConfig.mincommand) {
+        return DSHOT_CMD_MOTOR_STOP;
+    }
+
+    return scaleRange(MIN(value, PWM_RANGE_MAX), mixerRuntimeConfig.mincommand, PWM_RANGE_MAX, DSHOT_MIN_THROTTLE, DSHOT_MAX_THROTTLE);
 }
+#endif
 
 void writeMotors(void)
 {
     uint8_t i;
 
+#ifdef USE_DSHOT
+    if (isMotorProtocolDshot()) {
+        for (i = 0; i < motorCount; i++)
+            pwmWriteMotor(i, mixerMotorToDshot(motor[i]));
+
+        pwmCompleteDshotMotorUpdate(motorCount);
+        return;
+    }
+#endif
+
     for (i = 0; i < motorCount; i++)
         pwmWriteMotor(i, motor[i]);
 
 
-    if (feature(FEATURE_ONESHOT125)) {
+    if (isMotorProtocolOneshot()) {
         pwmCompleteOneshotMotorUpdate(motorCount);
     }
 }
@@ -392,7 +553,7 @@ void writeAllMotors(int16_t mc)
 
 void stopMotors(void)
 {
-    writeAllMotors(feature(FEATURE_3D) ? motor3DConfig()->neutral3d : motorAndServoConfig()->mincommand);
+    writeAllMotors(mixerStoppedMotorValue());
 
     delay(50); // give the timers and ESCs a chance to react.
 }
@@ -402,116 +563,120 @@ void StopPwmAllMotors()
     pwmShutdownPulsesForAllMotors(motorCount);
 }
 
-uint16_t mixConstrainMotorForFailsafeCondition(uint8_t motorIndex)
+static uint16_t mixConstrainMotorForFailsafeCondition(uint8_t motorIndex)
 {
-    return constrain(motor[motorIndex], motorAndServoConfig()->mincommand, motorAndServoConfig()->maxthrottle);
+    return constrain(motor[motorIndex], mixerRuntimeConfig.mincommand, mixerRuntimeConfig.maxthrottle);
 }
 
 void mixTable(void)
 {
+    static int16_t throttlePrevious = 0;   // Store the last throttle direction for deadband transitions in 3D.
+    const mixerRuntimeConfig_t *config = &mixerRuntimeConfig;
+    const bool isFailsafeActive = failsafeIsActive();
+    const bool isAirmodeActive = rcModeIsActive(BOXAIRMODE);
     uint32_t i;
 
-    bool isFailsafeActive = failsafeIsActive();
-
-    if (motorCount >= 4 && mixerConfig()->yaw_jump_prevention_limit < YAW_JUMP_PREVENTION_LIMIT_HIGH) {
+    if (motorCount >= 4 && config->yawJumpPreventionLimit < YAW_JUMP_PREVENTION_LIMIT_HIGH) {
         // prevent "yaw jump" during yaw correction
-        axisPID[FD_YAW] = constrain(axisPID[FD_YAW], -mixerConfig()->yaw_jump_prevention_limit - ABS(rcCommand[YAW]), mixerConfig()->yaw_jump_prevention_limit + ABS(rcCommand[YAW]));
+        axisPID[FD_YAW] = constrain(axisPID[FD_YAW], -config->yawJumpPreventionLimit - ABS(rcCommand[YAW]), config->yawJumpPreventionLimit + ABS(rcCommand[YAW]));
     }
 
-    if (rcModeIsActive(BOXAIRMODE)) {
-        // Initial mixer concept by bdoiron74 reused and optimized for Air Mode
-        int16_t rollPitchYawMix[MAX_SUPPORTED_MOTORS];
-        int16_t rollPitchYawMixMax = 0; // assumption: symetrical about zero.
-        int16_t rollPitchYawMixMin = 0;
+    // Find roll/pitch/yaw desired output, the product of the mixer matrix and the PID outputs
+    const float roll = axisPID[FD_ROLL];
+    const float pitch = axisPID[FD_PITCH];
+    const float yaw = axisPID[FD_YAW];
+    float rollPitchYawMix[MAX_SUPPORTED_MOTORS];
+    float rollPitchYawMixMax = 0; // assumption: symetrical about zero.
+    float rollPitchYawMixMin = 0;
 
-        // Find roll/pitch/yaw desired output
-        for (i = 0; i < motorCount; i++) {
-            rollPitchYawMix[i] =
-                axisPID[FD_PITCH] * currentMixer[i].pitch +
-                axisPID[FD_ROLL] * currentMixer[i].roll +
-                -mixerConfig()->yaw_motor_direction * axisPID[FD_YAW] * currentMixer[i].yaw;
+    for (i = 0; i < motorCount; i++) {
+        rollPitchYawMix[i] = mixerMatrix[i].roll * roll + mixerMatrix[i].pitch * pitch + mixerMatrix[i].yaw * yaw;
 
-            if (rollPitchYawMix[i] > rollPitchYawMixMax) rollPitchYawMixMax = rollPitchYawMix[i];
-            if (rollPitchYawMix[i] < rollPitchYawMixMin) rollPitchYawMixMin = rollPitchYawMix[i];
-        }
+        if (rollPitchYawMix[i] > rollPitchYawMixMax) rollPitchYawMixMax = rollPitchYawMix[i];
+        if (rollPitchYawMix[i] < rollPitchYawMixMin) rollPitchYawMixMin = rollPitchYawMix[i];
+    }
 
-        // Scale roll/pitch/yaw uniformly to fit within throttle range
-        int16_t rollPitchYawMixRange = rollPitchYawMixMax - rollPitchYawMixMin;
-        int16_t throttleRange, throttle;
-        int16_t throttleMin, throttleMax;
-        static int16_t throttlePrevious = 0;   // Store the last throttle direction for deadband transitions in 3D.
+    // Find the throttle and the range of the motor outputs, in 3D mode either below or above the deadband
+    int16_t throttle = rcCommand[THROTTLE];
+    int16_t outputMin = config->minthrottle;
+    int16_t outputMax = config->maxthrottle;
+
+    // With thrust linearisation the mix is done in thrust and the motor outputs are converted at the end.
+    // Convert the throttle to thrust so it gives the same motor output as without the linearisation,
+    // the airmode range scaling below then works in thrust as well.
+    const bool isThrustLinear = config->thrustLinear && !feature(FEATURE_3D);
+    if (isThrustLinear) {
+        throttle = motorOutputToThrust(throttle);
+    }
 
-        // Find min and max throttle based on condition. Use rcData for 3D to prevent loss of power due to min_check
-        if (feature(FEATURE_3D)) {
-            if (!ARMING_FLAG(ARMED)) throttlePrevious = rxConfig()->midrc; // When disarmed set to mid_rc. It always results in positive direction after arming.
+    if (feature(FEATURE_3D)) {
+        const int16_t deadbandLow = config->midrc - config->deadband3dThrottle;
+        const int16_t deadbandHigh = config->midrc + config->deadband3dThrottle;
+        const bool isOutOfDeadband = rcData[THROTTLE] <= deadbandLow || rcData[THROTTLE] >= deadbandHigh;
+        bool isReversed;
 
-            if ((rcData[THROTTLE] <= (rxConfig()->midrc - rcControlsConfig()->deadband3d_throttle))) { // Out of band handling
-                throttleMax = motor3DConfig()->deadband3d_low;
-                throttleMin = motorAndServoConfig()->minthrottle;
-                throttlePrevious = throttle = rcData[THROTTLE];
-            } else if (rcData[THROTTLE] >= (rxConfig()->midrc + rcControlsConfig()->deadband3d_throttle)) { // Positive handling
-                throttleMax = motorAndServoConfig()->maxthrottle;
-                throttleMin = motor3DConfig()->deadband3d_high;
+        if (isAirmodeActive) {
+            // Use rcData for 3D to prevent loss of power due to min_check
+            if (!ARMING_FLAG(ARMED)) throttlePrevious = config->midrc; // When disarmed set to mid_rc. It always results in positive direction after arming.
+
+            if (isOutOfDeadband) {
                 throttlePrevious = throttle = rcData[THROTTLE];
-            } else if ((throttlePrevious <= (rxConfig()->midrc - rcControlsConfig()->deadband3d_throttle)))  { // Deadband handling from negative to positive
-                throttle = throttleMax = motor3DConfig()->deadband3d_low;
-                throttleMin = motorAndServoConfig()->minthrottle;
-            } else {  // Deadband handling from positive to negative
-                throttleMax = motorAndServoConfig()->maxthrottle;
-                throttle = throttleMin = motor3DConfig()->deadband3d_high;
+            }
+            isReversed = throttlePrevious <= deadbandLow;
+            if (!isOutOfDeadband) {
+                // hold the edge of the deadband on the side the throttle came from
+                throttle = isReversed ? config->deadband3dLow : config->deadband3dHigh;
             }
         } else {
-            throttle = rcCommand[THROTTLE];
-            throttleMin = motorAndServoConfig()->minthrottle;
-            throttleMax = motorAndServoConfig()->maxthrottle;
+            isReversed = rcData[THROTTLE] <= config->midrc;
         }
 
-        throttleRange = throttleMax - throttleMin;
+        if (isReversed) {
+            outputMin = isAirmodeActive ? config->minthrottle : config->mincommand;
+            outputMax = config->deadband3dLow;
+        } else {
+            outputMin = config->deadband3dHigh;
+            outputMax = config->maxthrottle;
+        }
+
+        if (!isAirmodeActive && !isOutOfDeadband && !config->pidAtMinThrottle) {
+            // motors idle at the edge of the deadband
+            outputMin = outputMax = isReversed ? config->deadband3dLow : config->deadband3dHigh;
+        }
+    }
+
+    if (isAirmodeActive) {
+        // Initial mixer concept by bdoiron74 reused and optimized for Air Mode
+        // Scale roll/pitch/yaw uniformly to fit within throttle range
+        const float rollPitchYawMixRange = rollPitchYawMixMax - rollPitchYawMixMin;
+        const int16_t throttleRange = outputMax - outputMin;
+        int16_t throttleMin, throttleMax;
 
         if (rollPitchYawMixRange > throttleRange) {
             motorLimitReached = true;
-            float mixReduction = (float) throttleRange / rollPitchYawMixRange;
+            const float mixReduction = throttleRange / rollPitchYawMixRange;
             for (i = 0; i < motorCount; i++) {
-                rollPitchYawMix[i] =  lrintf((float) rollPitchYawMix[i] * mixReduction);
+                rollPitchYawMix[i] *= mixReduction;
             }
             // Get the maximum correction by setting throttle offset to center.
-            throttleMin = throttleMax = throttleMin + (throttleRange / 2);
+            throttleMin = throttleMax = outputMin + (throttleRange / 2);
         } else {
             motorLimitReached = false;
-            throttleMin = throttleMin + (rollPitchYawMixRange / 2);
-            throttleMax = throttleMax - (rollPitchYawMixRange / 2);
+            throttleMin = outputMin + lrintf(rollPitchYawMixRange / 2);
+            throttleMax = outputMax - lrintf(rollPitchYawMixRange / 2);
         }
 
         // Now add in the desired throttle, but keep in a range that doesn't clip adjusted
         // roll/pitch/yaw. This could move throttle down, but also up for those low throttle flips.
         for (i = 0; i < motorCount; i++) {
-            motor[i] = rollPitchYawMix[i] + constrain(throttle * currentMixer[i].throttle, throttleMin, throttleMax);
-
-            if (isFailsafeActive) {
-                motor[i] = mixConstrainMotorForFailsafeCondition(i);
-            } else if (feature(FEATURE_3D)) {
-                if (throttlePrevious <= (rxConfig()->midrc - rcControlsConfig()->deadband3d_throttle)) {
-                    motor[i] = constrain(motor[i], motorAndServoConfig()->minthrottle, motor3DConfig()->deadband3d_low);
-                } else {
-                    motor[i] = constrain(motor[i], motor3DConfig()->deadband3d_high, motorAndServoConfig()->maxthrottle);
-                }
-            } else {
-                motor[i] = constrain(motor[i], motorAndServoConfig()->minthrottle, motorAndServoConfig()->maxthrottle);
-            }
+            motor[i] = lrintf(rollPitchYawMix[i]) + constrain(lrintf(throttle * mixerMatrix[i].throttle), throttleMin, throttleMax);
         }
     } else {
         // motors for non-servo mixes
+        int16_t maxMotor = INT16_MIN;
         for (i = 0; i < motorCount; i++) {
-            motor[i] =
-                rcCommand[THROTTLE] * currentMixer[i].throttle +
-                axisPID[FD_PITCH] * currentMixer[i].pitch +
-                axisPID[FD_ROLL] * currentMixer[i].roll +
-                -mixerConfig()->yaw_motor_direction * axisPID[FD_YAW] * currentMixer[i].yaw;
-        }
+            motor[i] = lrintf(throttle * mixerMatrix[i].throttle + rollPitchYawMix[i]);
 
-        // Find the maximum motor output.
-        int16_t maxMotor = motor[0];
-        for (i = 1; i < motorCount; i++) {
             // If one motor is above the maxthrottle threshold, we reduce the value
             // of all motors by the amount of overshoot.  That way, only one motor
             // is at max and the relative power of each motor is preserved.
@@ -520,45 +685,39 @@ void mixTable(void)
             }
         }
 
-        int16_t maxThrottleDifference = 0;
-        if (maxMotor > motorAndServoConfig()->maxthrottle) {
-            maxThrottleDifference = maxMotor - motorAndServoConfig()->maxthrottle;
+        if (maxMotor > config->maxthrottle) {
+            // this is a way to still have good gyro corrections if at least one motor reaches its max.
+            const int16_t maxThrottleDifference = maxMotor - config->maxthrottle;
+            for (i = 0; i < motorCount; i++) {
+                motor[i] -= maxThrottleDifference;
+            }
         }
+    }
 
-        for (i = 0; i < motorCount; i++) {
-            // this is a way to still have good gyro corrections if at least one motor reaches its max.
-            motor[i] -= maxThrottleDifference;
-
-            if (feature(FEATURE_3D)) {
-                if (mixerConfig()->pid_at_min_throttle
-                        || rcData[THROTTLE] <= rxConfig()->midrc - rcControlsConfig()->deadband3d_throttle
-                        || rcData[THROTTLE] >= rxConfig()->midrc + rcControlsConfig()->deadband3d_throttle) {
-                    if (rcData[THROTTLE] > rxConfig()->midrc) {
-                        motor[i] = constrain(motor[i], motor3DConfig()->deadband3d_high, motorAndServoConfig()->maxthrottle);
-                    } else {
-                        motor[i] = constrain(motor[i], motorAndServoConfig()->mincommand, motor3DConfig()->deadband3d_low);
-                    }
-                } else {
-                    if (rcData[THROTTLE] > rxConfig()->midrc) {
-                        motor[i] = motor3DConfig()->deadband3d_high;
-                    } else {
-                        motor[i] = motor3DConfig()->deadband3d_low;
-                    }
-                }
-            } else {
-                if (isFailsafeActive) {
-                    motor[i] = mixConstrainMotorForFailsafeCondition(i);
-                } else {
-                    // If we're at minimum throttle and FEATURE_MOTOR_STOP enabled,
-                    // do not spin the motors.
-                    motor[i] = constrain(motor[i], motorAndServoConfig()->minthrottle, motorAndServoConfig()->maxthrottle);
-                    if ((rcData[THROTTLE]) < rxConfig()->mincheck) {
-                        if (feature(FEATURE_MOTOR_STOP)) {
-                            motor[i] = motorAndServoConfig()->mincommand;
-                        } else if (mixerConfig()->pid_at_min_throttle == 0) {
-                            motor[i] = motorAndServoConfig()->minthrottle;
-                        }
-                    }
+    const bool isThrottleLow = !isAirmodeActive && !feature(FEATURE_3D) && rcData[THROTTLE] < config->mincheck;
+    // without airmode the 3D range is kept in failsafe, otherwise reversed motors would be driven forwards
+    const bool isFailsafeConstrained = isFailsafeActive && (isAirmodeActive || !feature(FEATURE_3D));
+
+    for (i = 0; i < motorCount; i++) {
+        if (isFailsafeConstrained) {
+            if (isThrustLinear) {
+                motor[i] = thrustToMotorOutput(motor[i]);
+            }
+            motor[i] = mixConstrainMotorForFailsafeCondition(i);
+        } else {
+            motor[i] = constrain(motor[i], outputMin, outputMax);
+
+            if (isThrustLinear) {
+                motor[i] = thrustToMotorOutput(motor[i]);
+            }
+
+            // If we're at minimum throttle and FEATURE_MOTOR_STOP enabled,
+            // do not spin the motors.
+            if (isThrottleLow) {
+                if (feature(FEATURE_MOTOR_STOP)) {
+                    motor[i] = config->mincommand;
+                } else if (!config->pidAtMinThrottle) {
+                    motor[i] = config->minthrottle;
                 }
             }
         }
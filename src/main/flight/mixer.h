@@ -82,6 +82,7 @@ typedef struct mixerConfig_s {
     uint8_t pid_at_min_throttle;            // when enabled pids are used at minimum throttle
     int8_t yaw_motor_direction;
     uint16_t yaw_jump_prevention_limit;      // make limit configurable (original fixed value was 100)
+    uint8_t thrust_linear;                  // percentage of the motor thrust that is quadratic in the motor command, 0 disables the linearisation
 #ifdef USE_SERVOS
     uint8_t tri_unarmed_servo;              // send tail servo correction pulses even when unarmed
     float servo_lowpass_freq;             // lowpass servo filter frequency selection; 1/1000ths of loop freq
@@ -107,6 +108,7 @@ extern int16_t motor_disarmed[MAX_SUPPORTED_MOTORS];
 extern bool motorLimitReached;
 
 void mixerInit(motorMixer_t *customMotorMixers);
+void mixerInitConfig(void);
 void writeAllMotors(int16_t mc);
 void mixerLoadMix(int index, motorMixer_t *customMixers);
 void mixerResetDisarmedMotors(void);
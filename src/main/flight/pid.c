@@ -46,6 +46,7 @@
 #include "fc/rate_profile.h"
 
 #include "flight/pid.h"
+#include "flight/pid_kernel.h"
 
 int16_t axisPID[3];
 
@@ -56,23 +57,22 @@ int32_t axisPID_P[3], axisPID_I[3], axisPID_D[3];
 // PIDweight is a scale factor for PIDs which is derived from the throttle and TPA setting, and 100 = 100% scale means no PID reduction
 uint8_t PIDweight[3];
 
-int32_t lastITerm[3], ITermLimit[3];
-float lastITermf[3], ITermLimitf[3];
+pidState_t pidState;
 
-pt1Filter_t deltaFilter[3];
-pt1Filter_t yawFilter;
+pidRuntimeConfig_t pidRuntimeConfig;
 
+static pidControllerType_e pidControllerType = PID_CONTROLLER_MWREWRITE;
 
-void pidLuxFloat(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
-        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig);
-void pidMultiWiiRewrite(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
-        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig);
-void pidMultiWii23(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
-        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig);
+// constants to scale pidLuxFloat so output is same as pidMultiWiiRewrite
+static const float luxPTermScale = PID_LUX_PTERM_SCALE;
+static const float luxITermScale = PID_LUX_ITERM_SCALE;
+static const float luxDTermScale = PID_LUX_DTERM_SCALE;
 
-pidControllerFuncPtr pid_controller = pidMultiWiiRewrite;
+void pidLuxFloat(const pidRuntimeConfig_t *pidConfig);
+void pidMultiWiiRewrite(const pidRuntimeConfig_t *pidConfig);
+void pidMultiWii23(const pidRuntimeConfig_t *pidConfig);
 
-PG_REGISTER_PROFILE_WITH_RESET_TEMPLATE(pidProfile_t, pidProfile, PG_PID_PROFILE, 0);
+PG_REGISTER_PROFILE_WITH_RESET_TEMPLATE(pidProfile_t, pidProfile, PG_PID_PROFILE, 1);
 
 PG_RESET_TEMPLATE(pidProfile_t, pidProfile,
     .pidController = PID_CONTROLLER_MWREWRITE,
@@ -109,32 +109,101 @@ PG_RESET_TEMPLATE(pidProfile_t, pidProfile,
     .dterm_lpf = 100,   // DTERM filtering ON by default
     .yaw_lpf = 80,
     .deltaMethod = PID_DELTA_FROM_MEASUREMENT,
+    .feedForward = 0,
+    .feedForwardLpf = 40,
+    .PTermSetpointWeight = 100,
+    .DTermSetpointWeight = 0,
 );
 
 void pidResetITerm(void)
 {
     for (int axis = 0; axis < 3; axis++) {
-        lastITerm[axis] = 0;
-        lastITermf[axis] = 0.0f;
+        pidState.lastITerm[axis] = 0;
+        pidState.lastITermf[axis] = 0.0f;
     }
 }
 
+void pidInitConfig(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
+        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig)
+{
+    pidRuntimeConfig_t *pidConfig = &pidRuntimeConfig;
+
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        pidConfig->P8[axis] = pidProfile->P8[axis];
+        pidConfig->I8[axis] = pidProfile->I8[axis];
+        pidConfig->D8[axis] = pidProfile->D8[axis];
+        pidConfig->Kp[axis] = luxPTermScale * pidProfile->P8[axis];
+        pidConfig->Ki[axis] = luxITermScale * pidProfile->I8[axis];
+        pidConfig->Kd[axis] = luxDTermScale * pidProfile->D8[axis];
+        // only yaw has a P term filter and limit
+        pidConfig->PTermLpf[axis] = (axis == FD_YAW) ? pidProfile->yaw_lpf : 0;
+        pidConfig->PTermLimit[axis] = (axis == FD_YAW) ? pidProfile->yaw_p_limit : 0;
+
+        pidConfig->rateFactor[axis] = controlRateConfig->rates[axis] + 27;
+        pidConfig->rateScale[axis] = pidConfig->rateFactor[axis] / (axis == FD_YAW ? 32.0f : 16.0f);
+    }
+    pidConfig->yawRateFactor = 2 * controlRateConfig->rates[FD_YAW] + 30;
+
+    pidConfig->levelP8 = pidProfile->P8[PIDLEVEL];
+    pidConfig->levelI8 = pidProfile->I8[PIDLEVEL];
+    pidConfig->levelD8 = pidProfile->D8[PIDLEVEL];
+    pidConfig->horizonTransition = 10 * pidProfile->D8[PIDLEVEL] / 80;
+    pidConfig->levelGain = pidProfile->P8[PIDLEVEL] / 16.0f;
+    if (pidProfile->D8[PIDLEVEL] == 0) {
+        pidConfig->horizonGain = 0.0f;
+        pidConfig->horizonTransitionf = 0.0f;
+    } else {
+        pidConfig->horizonGain = pidProfile->I8[PIDLEVEL] / 16.0f;
+        pidConfig->horizonTransitionf = 100 / pidProfile->D8[PIDLEVEL];
+    }
+
+    pidConfig->yaw_p_limit = pidProfile->yaw_p_limit;
+    pidConfig->dterm_lpf = pidProfile->dterm_lpf;
+    pidConfig->yaw_lpf = pidProfile->yaw_lpf;
+    // taking the D term from the error is the same as giving it the whole setpoint
+    pidConfig->PTermSetpointWeight = pidProfile->PTermSetpointWeight;
+    pidConfig->DTermSetpointWeight = (pidProfile->deltaMethod == PID_DELTA_FROM_ERROR) ? 100 : pidProfile->DTermSetpointWeight;
+    pidConfig->PTermSetpointWeightf = pidConfig->PTermSetpointWeight / 100.0f;
+    pidConfig->DTermSetpointWeightf = pidConfig->DTermSetpointWeight / 100.0f;
+    pidConfig->feedForward = pidProfile->feedForward;
+    pidConfig->Kf = luxDTermScale * pidProfile->feedForward;
+    pidConfig->feedForwardLpf = pidProfile->feedForwardLpf;
+
+    pidConfig->max_angle_inclination = max_angle_inclination;
+    pidConfig->angleTrim[AI_ROLL] = angleTrim->raw[AI_ROLL];
+    pidConfig->angleTrim[AI_PITCH] = angleTrim->raw[AI_PITCH];
+    pidConfig->midrc = rxConfig->midrc;
+}
+
 void pidSetController(pidControllerType_e type)
 {
-    switch (type) {
+    pidControllerType = type;
+}
+
+void pidController(void)
+{
+#if defined(USE_PID_LUXFLOAT_ONLY)
+    pidLuxFloat(&pidRuntimeConfig);
+#elif defined(USE_PID_MWREWRITE_ONLY)
+    pidMultiWiiRewrite(&pidRuntimeConfig);
+#elif defined(USE_PID_MW23_ONLY)
+    pidMultiWii23(&pidRuntimeConfig);
+#else
+    switch (pidControllerType) {
         default:
         case PID_CONTROLLER_MWREWRITE:
-            pid_controller = pidMultiWiiRewrite;
+            pidMultiWiiRewrite(&pidRuntimeConfig);
             break;
 #ifndef SKIP_PID_LUXFLOAT
         case PID_CONTROLLER_LUX_FLOAT:
-            pid_controller = pidLuxFloat;
+            pidLuxFloat(&pidRuntimeConfig);
             break;
 #endif
 #ifndef SKIP_PID_MW23
         case PID_CONTROLLER_MW23:
-            pid_controller = pidMultiWii23;
+            pidMultiWii23(&pidRuntimeConfig);
             break;
 #endif
     }
+#endif
 }
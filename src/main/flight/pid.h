@@ -21,10 +21,18 @@
 #define PID_MAX_D 512
 #define PID_MAX_TOTAL_PID 1000
 
+// scale the PID profile gains to the pidLuxFloat gains, which give the same output as pidMultiWiiRewrite
+#define PID_LUX_PTERM_SCALE (1.0f / 128)
+#define PID_LUX_ITERM_SCALE (1000000.0f / 0x1000000)
+#define PID_LUX_DTERM_SCALE ((0.000001f * (float)0xFFFF) / 512)
+
 #define GYRO_I_MAX 256                      // Gyro I limiter
 #define YAW_P_LIMIT_MIN 100                 // Maximum value for yaw P limiter
 #define YAW_P_LIMIT_MAX 500                 // Maximum value for yaw P limiter
 
+#define PTERM_SETPOINT_WEIGHT_MAX 200       // percent
+#define DTERM_SETPOINT_WEIGHT_MAX 100       // percent
+
 typedef enum {
     PIDROLL,
     PIDPITCH,
@@ -62,15 +70,68 @@ typedef struct pidProfile_s {
     uint16_t dterm_lpf;                     // dterm filtering
     uint16_t yaw_lpf;                       // additional yaw filter when yaw axis too noisy
     uint8_t  deltaMethod;
+    uint8_t  feedForward;                   // gain on the rate of change of the setpoint, same scale as D
+    uint16_t feedForwardLpf;                // feed forward filtering
+    uint8_t  PTermSetpointWeight;           // percentage of the setpoint seen by the P term
+    uint8_t  DTermSetpointWeight;           // percentage of the setpoint seen by the D term, when deltaMethod is from measurement
 } pidProfile_t;
 
 PG_DECLARE_PROFILE(pidProfile_t, pidProfile);
 
-struct controlRateConfig_s;
-union rollAndPitchTrims_u;
-struct rxConfig_s;
-typedef void (*pidControllerFuncPtr)(const pidProfile_t *pidProfile, const struct controlRateConfig_s *controlRateConfig,
-        uint16_t max_angle_inclination, const union rollAndPitchTrims_u *angleTrim, const struct rxConfig_s *rxConfig);            // pid controller function prototype
+/*
+ * The settings used by the PID controllers with the scaling done up front, pidInitConfig() rebuilds it whenever the
+ * PID profile, the rates or the trims change so the controllers do not derive it from the parameter groups every loop.
+ */
+typedef struct pidRuntimeConfig_s {
+    uint8_t  P8[FD_INDEX_COUNT];
+    uint8_t  I8[FD_INDEX_COUNT];
+    uint8_t  D8[FD_INDEX_COUNT];
+    uint8_t  levelP8;
+    uint8_t  levelI8;
+    uint8_t  levelD8;
+    int32_t  rateFactor[FD_INDEX_COUNT];        // rate + 27, rcCommand * rateFactor >> 4 (>> 5 for yaw) is the angle rate
+    int32_t  horizonTransition;                 // 10 * D8[PIDLEVEL] / 80, as used by pidMultiWiiRewrite
+    int32_t  yawRateFactor;                     // 2 * rate + 30, as used by pidMultiWii23
+    // pidLuxFloat gains, scaled so the output is the same as pidMultiWiiRewrite
+    float    Kp[FD_INDEX_COUNT];
+    float    Ki[FD_INDEX_COUNT];
+    float    Kd[FD_INDEX_COUNT];
+    float    rateScale[FD_INDEX_COUNT];         // angle rate per unit of rcCommand
+    float    levelGain;                         // ANGLE mode
+    float    horizonGain;                       // HORIZON mode, zero when D8[PIDLEVEL] disables the self level
+    float    horizonTransitionf;                // 100 / D8[PIDLEVEL], as used by pidLuxFloat
+    uint16_t yaw_p_limit;
+    uint16_t dterm_lpf;
+    uint16_t yaw_lpf;
+    int32_t  PTermSetpointWeight;               // percent, P acts on PTermSetpointWeight * setpoint - gyro
+    int32_t  DTermSetpointWeight;               // percent, D acts on DTermSetpointWeight * setpoint - gyro
+    float    PTermSetpointWeightf;
+    float    DTermSetpointWeightf;
+    uint8_t  feedForward;
+    float    Kf;                                // pidLuxFloat feed forward gain
+    uint16_t feedForwardLpf;
+    uint16_t PTermLpf[FD_INDEX_COUNT];          // yaw_lpf on yaw, otherwise zero
+    uint16_t PTermLimit[FD_INDEX_COUNT];        // yaw_p_limit on yaw, otherwise zero
+    uint16_t max_angle_inclination;
+    int16_t  angleTrim[ANGLE_INDEX_COUNT];
+    uint16_t midrc;
+} pidRuntimeConfig_t;
+
+extern pidRuntimeConfig_t pidRuntimeConfig;
+
+/*
+ * Defining one of USE_PID_LUXFLOAT_ONLY, USE_PID_MWREWRITE_ONLY or USE_PID_MW23_ONLY in target.h builds just that
+ * controller, pidController() then calls it directly so it can be inlined into the main loop.
+ */
+#if defined(USE_PID_LUXFLOAT_ONLY) || defined(USE_PID_MW23_ONLY)
+#define SKIP_PID_MWREWRITE
+#endif
+#if defined(USE_PID_MWREWRITE_ONLY) || defined(USE_PID_MW23_ONLY)
+#define SKIP_PID_LUXFLOAT
+#endif
+#if defined(USE_PID_LUXFLOAT_ONLY) || defined(USE_PID_MWREWRITE_ONLY)
+#define SKIP_PID_MW23
+#endif
 
 extern int16_t axisPID[FD_INDEX_COUNT];
 extern int32_t axisPID_P[FD_INDEX_COUNT], axisPID_I[FD_INDEX_COUNT], axisPID_D[FD_INDEX_COUNT];
@@ -78,7 +139,13 @@ extern int32_t axisPID_P[FD_INDEX_COUNT], axisPID_I[FD_INDEX_COUNT], axisPID_D[F
 float pidScaleITermToRcInput(int axis);
 void pidFilterIsSetCheck(const pidProfile_t *pidProfile);
 
+struct controlRateConfig_s;
+union rollAndPitchTrims_u;
+struct rxConfig_s;
+void pidInitConfig(const pidProfile_t *pidProfile, const struct controlRateConfig_s *controlRateConfig,
+        uint16_t max_angle_inclination, const union rollAndPitchTrims_u *angleTrim, const struct rxConfig_s *rxConfig);
 void pidSetController(pidControllerType_e type);
+void pidController(void);
 void pidResetITermAngle(void);
 void pidResetITerm(void);
 
@@ -0,0 +1,263 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define SRC_MAIN_FLIGHT_PID_KERNEL_C_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <platform.h>
+
+#include "build/build_config.h"
+
+#include "common/axis.h"
+#include "common/maths.h"
+#include "common/filter.h"
+
+#include "config/parameter_group.h"
+
+#include "drivers/gyro_sync.h"
+
+#include "rx/rx.h"
+
+#include "fc/rc_controls.h"
+#include "fc/rate_profile.h"
+#include "fc/runtime_config.h"
+
+#include "flight/pid.h"
+#include "flight/pid_kernel.h"
+#include "config/config_unittest.h"
+#include "flight/mixer.h"
+
+/*
+ * The rate PID shared by the controllers.  pidKernel() is the integer arithmetic of pidMultiWiiRewrite and
+ * pidKernelf() the float arithmetic of pidLuxFloat, scaled so their outputs match.  Both work out one term for all
+ * three axes before moving on to the next, the only difference between the axes is in the runtime config (yaw is
+ * the only axis with a P term filter and limit) so there is no per-axis branching.
+ *
+ * The P and D terms act on a weighted error, setpointWeight * angleRate - gyroRate.  A D term weight of zero is the
+ * same as taking the delta from the measurement and 100% the same as taking it from the error.  The feed forward term
+ * is the rate of change of the setpoint, so the motors respond to the sticks without waiting for an error to build up.
+ */
+
+extern float dT;
+extern uint8_t PIDweight[3];
+extern uint8_t motorCount;
+
+#ifdef BLACKBOX
+extern int32_t axisPID_P[3], axisPID_I[3], axisPID_D[3];
+#endif
+
+#ifndef SKIP_PID_MWREWRITE
+void pidKernel(pidState_t *state, const pidRuntimeConfig_t *pidConfig,
+        const int32_t gyroRate[FD_INDEX_COUNT], const int32_t angleRate[FD_INDEX_COUNT], int16_t output[FD_INDEX_COUNT])
+{
+    int32_t rateError[FD_INDEX_COUNT];
+    int32_t PTerm[FD_INDEX_COUNT];
+    int32_t ITerm[FD_INDEX_COUNT];
+    int32_t DTerm[FD_INDEX_COUNT];
+    int32_t FTerm[FD_INDEX_COUNT];
+
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        rateError[axis] = angleRate[axis] - gyroRate[axis];
+    }
+
+    // -----calculate P component
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        const int32_t PTermError = angleRate[axis] * pidConfig->PTermSetpointWeight / 100 - gyroRate[axis];
+        PTerm[axis] = (PTermError * pidConfig->P8[axis] * PIDweight[axis] / 100) >> 7;
+        if (pidConfig->PTermLpf[axis]) {
+            PTerm[axis] = pt1FilterApply4(&state->PTermFilter[axis], PTerm[axis], pidConfig->PTermLpf[axis], dT);
+        }
+        // Constrain YAW by yaw_p_limit value if not servo driven, in that case servolimits apply
+        if (pidConfig->PTermLimit[axis] && motorCount >= 4) {
+            PTerm[axis] = constrain(PTerm[axis], -pidConfig->PTermLimit[axis], pidConfig->PTermLimit[axis]);
+        }
+    }
+
+    // -----calculate I component
+    // There should be no division before accumulating the error to integrator, because the precision would be reduced.
+    // Precision is critical, as I prevents from long-time drift. Thus, 32 bits integrator (Q19.13 format) is used.
+    // Time correction (to avoid different I scaling for different builds based on average cycle time)
+    // is normalized to cycle time = 2048 (2^11).
+    const bool antiWindup = rcModeIsActive(BOXAIRMODE);
+    const bool limitITerm = STATE(ANTI_WINDUP) || motorLimitReached;
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        int32_t ITermQ13 = state->lastITerm[axis] + ((rateError[axis] * (uint16_t)targetLooptime) >> 11) * pidConfig->I8[axis];
+        // limit maximum integrator value to prevent WindUp - accumulating extreme values when system is saturated.
+        // I coefficient (I8) moved before integration to make limiting independent from PID settings
+        ITermQ13 = constrain(ITermQ13, (int32_t)(-PID_MAX_I << 13), (int32_t)(PID_MAX_I << 13));
+        // Anti windup protection
+        if (antiWindup) {
+            if (limitITerm) {
+                ITermQ13 = constrain(ITermQ13, -state->ITermLimit[axis], state->ITermLimit[axis]);
+            } else {
+                state->ITermLimit[axis] = ABS(ITermQ13);
+            }
+        }
+        state->lastITerm[axis] = ITermQ13;
+        ITerm[axis] = ITermQ13 >> 13; // take integer part of Q19.13 value
+    }
+
+    // -----calculate D component
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        if (pidConfig->D8[axis] == 0) {
+            // optimisation for when D8 is zero, often used by YAW axis
+            DTerm[axis] = 0;
+            continue;
+        }
+        const int32_t DTermError = angleRate[axis] * pidConfig->DTermSetpointWeight / 100 - gyroRate[axis];
+        int32_t delta = DTermError - state->lastRateForDelta[axis];
+        state->lastRateForDelta[axis] = DTermError;
+        // Divide delta by targetLooptime to get differential (ie dr/dt)
+        delta = (delta * ((uint16_t)0xFFFF / ((uint16_t)targetLooptime >> 4))) >> 5;
+        if (pidConfig->dterm_lpf) {
+            // DTerm delta low pass filter
+            delta = lrintf(pt1FilterApply4(&state->deltaFilter[axis], (float)delta, pidConfig->dterm_lpf, dT));
+        }
+        DTerm[axis] = (delta * pidConfig->D8[axis] * PIDweight[axis] / 100) >> 8;
+        DTerm[axis] = constrain(DTerm[axis], -PID_MAX_D, PID_MAX_D);
+    }
+
+    // -----calculate feed forward component
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        // the setpoint is tracked even when feed forward is off, so turning it on in flight does not cause a spike
+        int32_t delta = angleRate[axis] - state->lastSetpoint[axis];
+        state->lastSetpoint[axis] = angleRate[axis];
+        if (pidConfig->feedForward == 0) {
+            FTerm[axis] = 0;
+            continue;
+        }
+        // scaled the same as the D term
+        delta = (delta * ((uint16_t)0xFFFF / ((uint16_t)targetLooptime >> 4))) >> 5;
+        if (pidConfig->feedForwardLpf) {
+            delta = lrintf(pt1FilterApply4(&state->feedForwardFilter[axis], (float)delta, pidConfig->feedForwardLpf, dT));
+        }
+        FTerm[axis] = (delta * pidConfig->feedForward * PIDweight[axis] / 100) >> 8;
+        FTerm[axis] = constrain(FTerm[axis], -PID_MAX_D, PID_MAX_D);
+    }
+
+    // -----calculate total PID output
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        output[axis] = PTerm[axis] + ITerm[axis] + DTerm[axis] + FTerm[axis];
+#ifdef BLACKBOX
+        axisPID_P[axis] = PTerm[axis];
+        axisPID_I[axis] = ITerm[axis];
+        axisPID_D[axis] = DTerm[axis];
+#endif
+    }
+    GET_PID_KERNEL_LOCALS();
+}
+#endif
+
+#ifndef SKIP_PID_LUXFLOAT
+void pidKernelf(pidState_t *state, const pidRuntimeConfig_t *pidConfig,
+        const float gyroRate[FD_INDEX_COUNT], const float angleRate[FD_INDEX_COUNT], int16_t output[FD_INDEX_COUNT])
+{
+    float rateError[FD_INDEX_COUNT];
+    float PTerm[FD_INDEX_COUNT];
+    float ITerm[FD_INDEX_COUNT];
+    float DTerm[FD_INDEX_COUNT];
+    float FTerm[FD_INDEX_COUNT];
+
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        rateError[axis] = angleRate[axis] - gyroRate[axis];
+    }
+
+    // -----calculate P component
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        const float PTermError = pidConfig->PTermSetpointWeightf * angleRate[axis] - gyroRate[axis];
+        PTerm[axis] = pidConfig->Kp[axis] * PTermError * PIDweight[axis] / 100;
+        if (pidConfig->PTermLpf[axis]) {
+            PTerm[axis] = pt1FilterApply4(&state->PTermFilter[axis], PTerm[axis], pidConfig->PTermLpf[axis], dT);
+        }
+        // Constrain YAW by yaw_p_limit value if not servo driven, in that case servolimits apply
+        if (pidConfig->PTermLimit[axis] && motorCount >= 4) {
+            PTerm[axis] = constrainf(PTerm[axis], -pidConfig->PTermLimit[axis], pidConfig->PTermLimit[axis]);
+        }
+    }
+
+    // -----calculate I component
+    const bool antiWindup = rcModeIsActive(BOXAIRMODE);
+    const bool limitITerm = STATE(ANTI_WINDUP) || motorLimitReached;
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        ITerm[axis] = state->lastITermf[axis] + pidConfig->Ki[axis] * rateError[axis] * dT;
+        // limit maximum integrator value to prevent WindUp - accumulating extreme values when system is saturated.
+        // I coefficient (I8) moved before integration to make limiting independent from PID settings
+        ITerm[axis] = constrainf(ITerm[axis], -PID_MAX_I, PID_MAX_I);
+        // Anti windup protection
+        if (antiWindup) {
+            if (limitITerm) {
+                ITerm[axis] = constrainf(ITerm[axis], -state->ITermLimitf[axis], state->ITermLimitf[axis]);
+            } else {
+                state->ITermLimitf[axis] = ABS(ITerm[axis]);
+            }
+        }
+        state->lastITermf[axis] = ITerm[axis];
+    }
+
+    // -----calculate D component
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        if (pidConfig->D8[axis] == 0) {
+            // optimisation for when D8 is zero, often used by YAW axis
+            DTerm[axis] = 0;
+            continue;
+        }
+        const float DTermError = pidConfig->DTermSetpointWeightf * angleRate[axis] - gyroRate[axis];
+        float delta = DTermError - state->lastRateForDeltaf[axis];
+        state->lastRateForDeltaf[axis] = DTermError;
+        // Divide delta by dT to get differential (ie dr/dt)
+        delta *= (1.0f / dT);
+        if (pidConfig->dterm_lpf) {
+            // DTerm delta low pass filter
+            delta = pt1FilterApply4(&state->deltaFilter[axis], delta, pidConfig->dterm_lpf, dT);
+        }
+        DTerm[axis] = pidConfig->Kd[axis] * delta * PIDweight[axis] / 100;
+        DTerm[axis] = constrainf(DTerm[axis], -PID_MAX_D, PID_MAX_D);
+    }
+
+    // -----calculate feed forward component
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        // the setpoint is tracked even when feed forward is off, so turning it on in flight does not cause a spike
+        float delta = angleRate[axis] - state->lastSetpointf[axis];
+        state->lastSetpointf[axis] = angleRate[axis];
+        if (pidConfig->feedForward == 0) {
+            FTerm[axis] = 0;
+            continue;
+        }
+        delta *= (1.0f / dT);
+        if (pidConfig->feedForwardLpf) {
+            delta = pt1FilterApply4(&state->feedForwardFilter[axis], delta, pidConfig->feedForwardLpf, dT);
+        }
+        FTerm[axis] = pidConfig->Kf * delta * PIDweight[axis] / 100;
+        FTerm[axis] = constrainf(FTerm[axis], -PID_MAX_D, PID_MAX_D);
+    }
+
+    // -----calculate total PID output
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        output[axis] = lrintf(PTerm[axis] + ITerm[axis] + DTerm[axis] + FTerm[axis]);
+#ifdef BLACKBOX
+        axisPID_P[axis] = PTerm[axis];
+        axisPID_I[axis] = ITerm[axis];
+        axisPID_D[axis] = DTerm[axis];
+#endif
+    }
+    GET_PID_KERNELF_LOCALS();
+}
+#endif
@@ -0,0 +1,44 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * The state of the roll, pitch and yaw PIDs.  Each quantity is an array indexed by axis, so the kernels can work on
+ * one term for all the axes at a time.
+ */
+typedef struct pidState_s {
+    int32_t lastITerm[FD_INDEX_COUNT];          // Q19.13 for pidKernel()
+    int32_t ITermLimit[FD_INDEX_COUNT];
+    int32_t lastRateForDelta[FD_INDEX_COUNT];
+    int32_t lastSetpoint[FD_INDEX_COUNT];
+    float lastITermf[FD_INDEX_COUNT];
+    float ITermLimitf[FD_INDEX_COUNT];
+    float lastRateForDeltaf[FD_INDEX_COUNT];
+    float lastSetpointf[FD_INDEX_COUNT];
+    pt1Filter_t deltaFilter[FD_INDEX_COUNT];
+    pt1Filter_t PTermFilter[FD_INDEX_COUNT];
+    pt1Filter_t feedForwardFilter[FD_INDEX_COUNT];
+} pidState_t;
+
+extern pidState_t pidState;
+
+// rates are in the units of pidMultiWiiRewrite, degrees per second * 4.1
+void pidKernel(pidState_t *state, const pidRuntimeConfig_t *pidConfig,
+        const int32_t gyroRate[FD_INDEX_COUNT], const int32_t angleRate[FD_INDEX_COUNT], int16_t output[FD_INDEX_COUNT]);
+void pidKernelf(pidState_t *state, const pidRuntimeConfig_t *pidConfig,
+        const float gyroRate[FD_INDEX_COUNT], const float angleRate[FD_INDEX_COUNT], int16_t output[FD_INDEX_COUNT]);
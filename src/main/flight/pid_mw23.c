@@ -24,8 +24,6 @@
 
 #include "build/build_config.h"
 
-#ifndef SKIP_PID_MW23
-
 #include "common/axis.h"
 #include "common/maths.h"
 #include "common/filter.h"
@@ -48,11 +46,14 @@
 #include "fc/runtime_config.h"
 
 #include "flight/pid.h"
+#include "flight/pid_kernel.h"
 #include "flight/imu.h"
 #include "flight/navigation.h"
 #include "flight/gtune.h"
 #include "flight/mixer.h"
 
+#ifndef SKIP_PID_MW23
+
 static int32_t ITermAngle[2];
 
 uint8_t dynP8[3], dynI8[3], dynD8[3];
@@ -63,9 +64,6 @@ extern uint8_t motorCount;
 #ifdef BLACKBOX
 extern int32_t axisPID_P[3], axisPID_I[3], axisPID_D[3];
 #endif
-extern int32_t lastITerm[3], ITermLimit[3];
-
-extern pt1Filter_t deltaFilter[3];
 
 
 void pidResetITermAngle(void)
@@ -74,15 +72,11 @@ void pidResetITermAngle(void)
     ITermAngle[AI_PITCH] = 0;
 }
 
-void pidMultiWii23(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
-        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig)
+void pidMultiWii23(const pidRuntimeConfig_t *pidConfig)
 {
-    UNUSED(rxConfig);
-
     int axis, prop = 0;
     int32_t rc, error, errorAngle, delta, gyroError;
     int32_t PTerm, ITerm, PTermACC, ITermACC, DTerm;
-    static int16_t lastErrorForDelta[2];
     static int32_t delta1[2], delta2[2];
 
     if (FLIGHT_MODE(HORIZON_MODE)) {
@@ -97,43 +91,43 @@ void pidMultiWii23(const pidProfile_t *pidProfile, const controlRateConfig_t *co
         gyroError = gyroADC[axis] / 4;
 
         error = rc - gyroError;
-        lastITerm[axis]  = constrain(lastITerm[axis] + error, -16000, +16000);   // WindUp   16 bits is ok here
+        pidState.lastITerm[axis]  = constrain(pidState.lastITerm[axis] + error, -16000, +16000);   // WindUp   16 bits is ok here
 
         if (ABS(gyroADC[axis]) > (640 * 4)) {
-            lastITerm[axis] = 0;
+            pidState.lastITerm[axis] = 0;
         }
 
         // Anti windup protection
         if (rcModeIsActive(BOXAIRMODE)) {
             if (STATE(ANTI_WINDUP) || motorLimitReached) {
-                lastITerm[axis] = constrain(lastITerm[axis], -ITermLimit[axis], ITermLimit[axis]);
+                pidState.lastITerm[axis] = constrain(pidState.lastITerm[axis], -pidState.ITermLimit[axis], pidState.ITermLimit[axis]);
             } else {
-                ITermLimit[axis] = ABS(lastITerm[axis]);
+                pidState.ITermLimit[axis] = ABS(pidState.lastITerm[axis]);
             }
         }
 
-        ITerm = (lastITerm[axis] >> 7) * pidProfile->I8[axis] >> 6;   // 16 bits is ok here 16000/125 = 128 ; 128*250 = 32000
+        ITerm = (pidState.lastITerm[axis] >> 7) * pidConfig->I8[axis] >> 6;   // 16 bits is ok here 16000/125 = 128 ; 128*250 = 32000
 
-        PTerm = (int32_t)rc * pidProfile->P8[axis] >> 6;
+        PTerm = (int32_t)rc * pidConfig->P8[axis] >> 6;
 
         if (FLIGHT_MODE(ANGLE_MODE) || FLIGHT_MODE(HORIZON_MODE)) {   // axis relying on ACC
             // 50 degrees max inclination
 #ifdef GPS
-            errorAngle = constrain(2 * rcCommand[axis] + GPS_angle[axis], -((int) max_angle_inclination),
-                +max_angle_inclination) - attitude.raw[axis] + angleTrim->raw[axis];
+            errorAngle = constrain(2 * rcCommand[axis] + GPS_angle[axis], -((int) pidConfig->max_angle_inclination),
+                +pidConfig->max_angle_inclination) - attitude.raw[axis] + pidConfig->angleTrim[axis];
 #else
-            errorAngle = constrain(2 * rcCommand[axis], -((int) max_angle_inclination),
-                +max_angle_inclination) - attitude.raw[axis] + angleTrim->raw[axis];
+            errorAngle = constrain(2 * rcCommand[axis], -((int) pidConfig->max_angle_inclination),
+                +pidConfig->max_angle_inclination) - attitude.raw[axis] + pidConfig->angleTrim[axis];
 #endif
 
             ITermAngle[axis]  = constrain(ITermAngle[axis] + errorAngle, -10000, +10000);                                                // WindUp     //16 bits is ok here
 
-            PTermACC = ((int32_t)errorAngle * pidProfile->P8[PIDLEVEL]) >> 7;   // 32 bits is needed for calculation: errorAngle*P8 could exceed 32768   16 bits is ok for result
+            PTermACC = ((int32_t)errorAngle * pidConfig->levelP8) >> 7;   // 32 bits is needed for calculation: errorAngle*P8 could exceed 32768   16 bits is ok for result
 
-            int16_t limit = pidProfile->D8[PIDLEVEL] * 5;
+            int16_t limit = pidConfig->levelD8 * 5;
             PTermACC = constrain(PTermACC, -limit, +limit);
 
-            ITermACC = ((int32_t)ITermAngle[axis] * pidProfile->I8[PIDLEVEL]) >> 12;  // 32 bits is needed for calculation:10000*I8 could exceed 32768   16 bits is ok for result
+            ITermACC = ((int32_t)ITermAngle[axis] * pidConfig->levelI8) >> 12;  // 32 bits is needed for calculation:10000*I8 could exceed 32768   16 bits is ok for result
 
             ITerm = ITermACC + ((ITerm - ITermACC) * prop >> 9);
             PTerm = PTermACC + ((PTerm - PTermACC) * prop >> 9);
@@ -143,12 +137,12 @@ void pidMultiWii23(const pidProfile_t *pidProfile, const controlRateConfig_t *co
 
         //-----calculate D-term based on the configured approach (delta from measurement or deltafromError)
         // Delta from measurement
-        delta = -(gyroError - lastErrorForDelta[axis]);
-        lastErrorForDelta[axis] = gyroError;
-        if (pidProfile->dterm_lpf) {
+        delta = -(gyroError - pidState.lastRateForDelta[axis]);
+        pidState.lastRateForDelta[axis] = gyroError;
+        if (pidConfig->dterm_lpf) {
             // Dterm delta low pass
             DTerm = delta;
-            DTerm = lrintf(pt1FilterApply4(&deltaFilter[axis], (float)DTerm, pidProfile->dterm_lpf, dT)) * 3;  // Keep same scaling as unfiltered DTerm
+            DTerm = lrintf(pt1FilterApply4(&pidState.deltaFilter[axis], (float)DTerm, pidConfig->dterm_lpf, dT)) * 3;  // Keep same scaling as unfiltered DTerm
         } else {
             // When dterm filter disabled apply moving average to reduce noise
             DTerm  = delta1[axis] + delta2[axis] + delta;
@@ -173,24 +167,24 @@ void pidMultiWii23(const pidProfile_t *pidProfile, const controlRateConfig_t *co
     }
 
     //YAW
-    rc = (int32_t)rcCommand[YAW] * (2 * controlRateConfig->rates[YAW] + 30)  >> 5;
+    rc = (int32_t)rcCommand[YAW] * pidConfig->yawRateFactor >> 5;
 #ifdef ALIENWFLIGHT
     error = rc - gyroADC[FD_YAW];
 #else
     error = rc - (gyroADC[FD_YAW] / 4);
 #endif
-    lastITerm[FD_YAW]  += (int32_t)error * pidProfile->I8[FD_YAW];
-    lastITerm[FD_YAW]  = constrain(lastITerm[FD_YAW], 2 - ((int32_t)1 << 28), -2 + ((int32_t)1 << 28));
-    if (ABS(rc) > 50) lastITerm[FD_YAW] = 0;
+    pidState.lastITerm[FD_YAW]  += (int32_t)error * pidConfig->I8[FD_YAW];
+    pidState.lastITerm[FD_YAW]  = constrain(pidState.lastITerm[FD_YAW], 2 - ((int32_t)1 << 28), -2 + ((int32_t)1 << 28));
+    if (ABS(rc) > 50) pidState.lastITerm[FD_YAW] = 0;
 
-    PTerm = (int32_t)error * pidProfile->P8[FD_YAW] >> 6; // TODO: Bitwise shift on a signed integer is not recommended
+    PTerm = (int32_t)error * pidConfig->P8[FD_YAW] >> 6; // TODO: Bitwise shift on a signed integer is not recommended
 
     // Constrain YAW by D value if not servo driven in that case servolimits apply
-    if(motorCount >= 4 && pidProfile->yaw_p_limit < YAW_P_LIMIT_MAX) {
-        PTerm = constrain(PTerm, -pidProfile->yaw_p_limit, pidProfile->yaw_p_limit);
+    if(motorCount >= 4 && pidConfig->yaw_p_limit < YAW_P_LIMIT_MAX) {
+        PTerm = constrain(PTerm, -pidConfig->yaw_p_limit, pidConfig->yaw_p_limit);
     }
 
-    ITerm = constrain((int16_t)(lastITerm[FD_YAW] >> 13), -GYRO_I_MAX, +GYRO_I_MAX);
+    ITerm = constrain((int16_t)(pidState.lastITerm[FD_YAW] >> 13), -GYRO_I_MAX, +GYRO_I_MAX);
 
     axisPID[FD_YAW] =  PTerm + ITerm;
 
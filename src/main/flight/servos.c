@@ -291,6 +291,7 @@ void mixerUsePWMIOConfiguration(pwmIOConfiguration_t *pwmIOConfiguration)
         }
     }
 
+    mixerInitConfig();
     mixerResetDisarmedMotors();
 }
 
@@ -479,6 +479,12 @@ static void showBatteryPage(void)
         i2c_OLED_set_line(rowIndex++);
         i2c_OLED_send_string(lineBuffer);
 
+        uint16_t cellVoltage = batteryGetCellVoltage();
+        tfp_sprintf(lineBuffer, "Cell: %d.%02d Rint: %dm", cellVoltage / 1000, (cellVoltage % 1000) / 10, batteryGetInternalResistance());
+        padLineBuffer();
+        i2c_OLED_set_line(rowIndex++);
+        i2c_OLED_send_string(lineBuffer);
+
         uint8_t batteryPercentage = calculateBatteryPercentage();
         i2c_OLED_set_line(rowIndex++);
         drawHorizonalPercentageBar(SCREEN_CHARACTER_COLUMN_COUNT, batteryPercentage);
@@ -509,6 +515,12 @@ static void showSensorsPage(void)
         padLineBuffer();
         i2c_OLED_set_line(rowIndex++);
         i2c_OLED_send_string(lineBuffer);
+
+        // vibration in 0.01g RMS
+        tfp_sprintf(lineBuffer, format, "VIB", imuGetAccVibration(X), imuGetAccVibration(Y), imuGetAccVibration(Z));
+        padLineBuffer();
+        i2c_OLED_set_line(rowIndex++);
+        i2c_OLED_send_string(lineBuffer);
     }
 
     if (sensors(SENSOR_GYRO)) {
@@ -541,6 +553,13 @@ static void showSensorsPage(void)
         i2c_OLED_send_string(lineBuffer);
     }
 #endif
+
+    if (sensors(SENSOR_ACC) && rowIndex < SCREEN_CHARACTER_ROW_COUNT) {
+        tfp_sprintf(lineBuffer, "CLP %9u HLT %3d", accClipCount, imuGetAccHealth());
+        padLineBuffer();
+        i2c_OLED_set_line(rowIndex++);
+        i2c_OLED_send_string(lineBuffer);
+    }
 }
 
 #ifndef SKIP_TASK_STATISTICS
@@ -27,6 +27,8 @@
 #include "config/parameter_group_ids.h"
 #include "config/config_reset.h"
 
+#include "drivers/pwm_mapping.h"
+
 #include "motor_and_servo.h"
 
 #define BRUSHED_MOTORS_PWM_RATE 16000
@@ -38,7 +40,7 @@
 #define DEFAULT_PWM_RATE BRUSHLESS_MOTORS_PWM_RATE
 #endif
 
-PG_REGISTER_WITH_RESET_TEMPLATE(motorAndServoConfig_t, motorAndServoConfig, PG_MOTOR_AND_SERVO_CONFIG, 0);
+PG_REGISTER_WITH_RESET_TEMPLATE(motorAndServoConfig_t, motorAndServoConfig, PG_MOTOR_AND_SERVO_CONFIG, 2);
 
 PG_RESET_TEMPLATE(motorAndServoConfig_t, motorAndServoConfig,
     .minthrottle = 1150,
@@ -47,4 +49,5 @@ PG_RESET_TEMPLATE(motorAndServoConfig_t, motorAndServoConfig,
     .servoCenterPulse = 1500,
     .motor_pwm_rate = DEFAULT_PWM_RATE,
     .servo_pwm_rate = 50,
+    .motor_pwm_protocol = PWM_TYPE_STANDARD,
 );
@@ -27,6 +27,7 @@ typedef struct motorAndServoConfig_s {
 
     uint16_t motor_pwm_rate;                // The update rate of motor outputs (50-498Hz)
     uint16_t servo_pwm_rate;                // The update rate of servo outputs (50-498Hz)
+    uint8_t motor_pwm_protocol;             // Pulse width based or digital protocol of the motor outputs, see motorPwmProtocolTypes_e
 } motorAndServoConfig_t;
 
 PG_DECLARE(motorAndServoConfig_t, motorAndServoConfig);
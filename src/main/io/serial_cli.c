@@ -48,6 +48,9 @@
 #include "drivers/gpio.h"
 #include "drivers/timer.h"
 #include "drivers/pwm_rx.h"
+#include "drivers/pwm_mapping.h"
+#include "drivers/pwm_output.h"
+#include "drivers/dshot.h"
 #include "drivers/sdcard.h"
 
 #include "drivers/buf_writer.h"
@@ -70,8 +73,11 @@
 
 #include "rx/rx.h"
 #include "rx/spektrum.h"
+#include "rx/rx_frame.h"
+#include "rx/crsf.h"
 
 #include "sensors/battery.h"
+#include "sensors/battery_estimator.h"
 #include "sensors/boardalignment.h"
 #include "sensors/sensors.h"
 #include "sensors/acceleration.h"
@@ -83,6 +89,7 @@
 
 #include "flight/pid.h"
 #include "flight/gtune.h"
+#include "flight/autotune.h"
 #include "flight/imu.h"
 #include "flight/mixer.h"
 #include "flight/servos.h"
@@ -111,6 +118,7 @@ uint8_t cliMode = 0;
 #ifdef USE_CLI
 
 extern uint16_t cycleTime; // FIXME dependency on mw.c
+extern uint8_t motorCount;
 
 void gpsEnablePassthrough(serialPort_t *gpsPassthroughPort);
 
@@ -124,6 +132,9 @@ static void cliAdjustmentRange(char *cmdline);
 static void cliMotorMix(char *cmdline);
 static void cliDefaults(char *cmdline);
 static void cliDump(char *cmdLine);
+#ifdef USE_DSHOT
+static void cliDshotCommand(char *cmdline);
+#endif
 static void cliExit(char *cmdline);
 static void cliFeature(char *cmdline);
 static void cliMotor(char *cmdline);
@@ -261,6 +272,10 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("mode_color", "configure mode and special colors", NULL, cliModeColor),
 #endif
     CLI_COMMAND_DEF("defaults", "reset to defaults and reboot", NULL, cliDefaults),
+#ifdef USE_DSHOT
+    CLI_COMMAND_DEF("dshotcmd", "send a DShot command",
+        "<motor index> <command>", cliDshotCommand),
+#endif
     CLI_COMMAND_DEF("dump", "dump configuration",
         "[master|profile|rates]", cliDump),
     CLI_COMMAND_DEF("exit", NULL, NULL, cliExit),
@@ -381,7 +396,8 @@ static const char * const lookupTableSerialRX[] = {
     "SUMH",
     "XB-B",
     "XB-B-RJ01",
-    "IBUS"
+    "IBUS",
+    "CRSF"
 };
 
 static const char * const lookupTableGyroFilter[] = {
@@ -401,6 +417,26 @@ static const char * const lookupTablePidDeltaMethod[] = {
     "MEASUREMENT", "ERROR"
 };
 
+#ifdef USE_IMU_EKF
+static const char * const lookupTableImuEstimator[] = {
+    "MAHONY", "EKF"
+};
+#endif
+
+static const char * const lookupTableMotorPwmProtocol[] = {
+    "STANDARD", "ONESHOT125", "ONESHOT42", "MULTISHOT", "DSHOT150", "DSHOT300", "DSHOT600"
+};
+
+static const char * const lookupTableRcSmoothing[] = {
+    "OFF", "LINEAR", "PT1", "PT2"
+};
+
+#ifdef AUTOTUNE
+static const char * const lookupTableAutotuneRule[] = {
+    "ZIEGLER_NICHOLS", "TYREUS_LUYBEN"
+};
+#endif
+
 typedef struct lookupTableEntry_s {
     const char * const *values;
     const uint8_t valueCount;
@@ -424,6 +460,14 @@ typedef enum {
     TABLE_GYRO_FILTER,
     TABLE_GYRO_LPF,
     TABLE_PID_DELTA_METHOD,
+#ifdef USE_IMU_EKF
+    TABLE_IMU_ESTIMATOR,
+#endif
+    TABLE_MOTOR_PWM_PROTOCOL,
+    TABLE_RC_SMOOTHING,
+#ifdef AUTOTUNE
+    TABLE_AUTOTUNE_RULE,
+#endif
 } lookupTableIndex_e;
 
 static const lookupTableEntry_t lookupTables[] = {
@@ -444,6 +488,14 @@ static const lookupTableEntry_t lookupTables[] = {
     { lookupTableGyroFilter, sizeof(lookupTableGyroFilter) / sizeof(char *) },
     { lookupTableGyroLpf, sizeof(lookupTableGyroLpf) / sizeof(char *) },
     { lookupTablePidDeltaMethod, sizeof(lookupTablePidDeltaMethod) / sizeof(char *) },
+#ifdef USE_IMU_EKF
+    { lookupTableImuEstimator, sizeof(lookupTableImuEstimator) / sizeof(char *) },
+#endif
+    { lookupTableMotorPwmProtocol, sizeof(lookupTableMotorPwmProtocol) / sizeof(char *) },
+    { lookupTableRcSmoothing, sizeof(lookupTableRcSmoothing) / sizeof(char *) },
+#ifdef AUTOTUNE
+    { lookupTableAutotuneRule, sizeof(lookupTableAutotuneRule) / sizeof(char *) },
+#endif
 };
 
 #define VALUE_TYPE_OFFSET 0
@@ -510,7 +562,8 @@ const clivalue_t valueTable[] = {
     { "rssi_channel",               VAR_INT8   | MASTER_VALUE, .config.minmax = { 0,  MAX_SUPPORTED_RC_CHANNEL_COUNT } , PG_RX_CONFIG, offsetof(rxConfig_t, rssi_channel)},
     { "rssi_scale",                 VAR_UINT8  | MASTER_VALUE, .config.minmax = { RSSI_SCALE_MIN,  RSSI_SCALE_MAX } , PG_RX_CONFIG, offsetof(rxConfig_t, rssi_scale)},
     { "rssi_ppm_invert",            VAR_INT8   | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON } , PG_RX_CONFIG, offsetof(rxConfig_t, rssi_ppm_invert)},
-    { "rc_smoothing",               VAR_INT8   | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON } , PG_RX_CONFIG, offsetof(rxConfig_t, rcSmoothing)},
+    { "rc_smoothing",               VAR_INT8   | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_RC_SMOOTHING } , PG_RX_CONFIG, offsetof(rxConfig_t, rcSmoothing)},
+    { "rc_smoothing_cutoff",        VAR_UINT8  | MASTER_VALUE, .config.minmax = { 0,  255 } , PG_RX_CONFIG, offsetof(rxConfig_t, rcSmoothingCutoff)},
     { "rx_min_usec",                VAR_UINT16 | MASTER_VALUE, .config.minmax = { PWM_PULSE_MIN,  PWM_PULSE_MAX } , PG_RX_CONFIG, offsetof(rxConfig_t, rx_min_usec)},
     { "rx_max_usec",                VAR_UINT16 | MASTER_VALUE, .config.minmax = { PWM_PULSE_MIN,  PWM_PULSE_MAX } , PG_RX_CONFIG, offsetof(rxConfig_t, rx_max_usec)},
     { "serialrx_provider",          VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_SERIAL_RX } , PG_RX_CONFIG, offsetof(rxConfig_t, serialrx_provider)},
@@ -525,6 +578,7 @@ const clivalue_t valueTable[] = {
     { "servo_center_pulse",         VAR_UINT16 | MASTER_VALUE, .config.minmax = { PWM_RANGE_ZERO,  PWM_RANGE_MAX } , PG_MOTOR_AND_SERVO_CONFIG, offsetof(motorAndServoConfig_t, servoCenterPulse)},
     { "motor_pwm_rate",             VAR_UINT16 | MASTER_VALUE, .config.minmax = { 50,  32000 } , PG_MOTOR_AND_SERVO_CONFIG, offsetof(motorAndServoConfig_t, motor_pwm_rate)},
     { "servo_pwm_rate",             VAR_UINT16 | MASTER_VALUE, .config.minmax = { 50,  498 } , PG_MOTOR_AND_SERVO_CONFIG, offsetof(motorAndServoConfig_t, servo_pwm_rate)},
+    { "motor_pwm_protocol",         VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_MOTOR_PWM_PROTOCOL } , PG_MOTOR_AND_SERVO_CONFIG, offsetof(motorAndServoConfig_t, motor_pwm_protocol)},
 
 
     { "3d_deadband_low",            VAR_UINT16 | MASTER_VALUE, .config.minmax = { PWM_RANGE_ZERO,  PWM_RANGE_MAX } , PG_MOTOR_3D_CONFIG, offsetof(motor3DConfig_t, deadband3d_low)}, // FIXME upper limit should match code in the mixer, 1500 currently
@@ -582,6 +636,8 @@ const clivalue_t valueTable[] = {
 #endif
 
     { "battery_capacity",           VAR_UINT16 | MASTER_VALUE, .config.minmax = { 0,  20000 } , PG_BATTERY_CONFIG, offsetof(batteryConfig_t, batteryCapacity)},
+    { "vbat_sag_compensation",      VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON } , PG_BATTERY_CONFIG, offsetof(batteryConfig_t, vbatsagcompensation)},
+    { "battery_internal_resistance", VAR_UINT16 | MASTER_VALUE, .config.minmax = { 0,  BATTERY_ESTIMATOR_MAX_RESISTANCE } , PG_BATTERY_CONFIG, offsetof(batteryConfig_t, batteryInternalResistance)},
     { "vbat_scale",                 VAR_UINT8  | MASTER_VALUE, .config.minmax = { VBAT_SCALE_MIN,  VBAT_SCALE_MAX } , PG_BATTERY_CONFIG, offsetof(batteryConfig_t, vbatscale)},
     { "vbat_max_cell_voltage",      VAR_UINT8  | MASTER_VALUE, .config.minmax = { 10,  50 } , PG_BATTERY_CONFIG, offsetof(batteryConfig_t, vbatmaxcellvoltage)},
     { "vbat_min_cell_voltage",      VAR_UINT8  | MASTER_VALUE, .config.minmax = { 10,  50 } , PG_BATTERY_CONFIG, offsetof(batteryConfig_t, vbatmincellvoltage)},
@@ -606,6 +662,10 @@ const clivalue_t valueTable[] = {
     { "moron_threshold",            VAR_UINT8  | MASTER_VALUE, .config.minmax = { 0,  128 } , PG_GYRO_CONFIG, offsetof(gyroConfig_t, gyroMovementCalibrationThreshold)},
     { "imu_dcm_kp",                 VAR_UINT16 | MASTER_VALUE, .config.minmax = { 0,  20000 } , PG_IMU_CONFIG, offsetof(imuConfig_t, dcm_kp)},
     { "imu_dcm_ki",                 VAR_UINT16 | MASTER_VALUE, .config.minmax = { 0,  20000 } , PG_IMU_CONFIG, offsetof(imuConfig_t, dcm_ki)},
+#ifdef USE_IMU_EKF
+    { "imu_estimator",              VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_IMU_ESTIMATOR } , PG_IMU_CONFIG, offsetof(imuConfig_t, attitude_estimator)},
+#endif
+    { "imu_update_hz",              VAR_UINT16 | MASTER_VALUE, .config.minmax = { 100,  8000 } , PG_IMU_CONFIG, offsetof(imuConfig_t, attitude_update_hz)},
 
     { "alt_hold_deadband",          VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 1,  250 } , PG_RC_CONTROLS_CONFIG, offsetof(rcControlsConfig_t, alt_hold_deadband)},
     { "alt_hold_fast_change",       VAR_UINT8  | PROFILE_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON } , PG_RC_CONTROLS_CONFIG, offsetof(rcControlsConfig_t, alt_hold_fast_change)},
@@ -621,6 +681,7 @@ const clivalue_t valueTable[] = {
     { "pid_at_min_throttle",        VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON } , PG_MIXER_CONFIG, offsetof(mixerConfig_t, pid_at_min_throttle)},
     { "yaw_motor_direction",        VAR_INT8   | MASTER_VALUE, .config.minmax = { -1,  1 } , PG_MIXER_CONFIG, offsetof(mixerConfig_t, yaw_motor_direction)},
     { "yaw_jump_prevention_limit",  VAR_UINT16 | MASTER_VALUE, .config.minmax = { YAW_JUMP_PREVENTION_LIMIT_LOW,  YAW_JUMP_PREVENTION_LIMIT_HIGH } , PG_MIXER_CONFIG, offsetof(mixerConfig_t, yaw_jump_prevention_limit)},
+    { "thrust_linear",              VAR_UINT8  | MASTER_VALUE, .config.minmax = { 0,  100 } , PG_MIXER_CONFIG, offsetof(mixerConfig_t, thrust_linear)},
 
 #ifdef USE_SERVOS
     { "tri_unarmed_servo",          VAR_INT8   | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON } , PG_MIXER_CONFIG, offsetof(mixerConfig_t, tri_unarmed_servo)},
@@ -665,8 +726,6 @@ const clivalue_t valueTable[] = {
 #ifdef BARO
     { "baro_tab_size",              VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 0,  BARO_SAMPLE_COUNT_MAX } , PG_BAROMETER_CONFIG, offsetof(barometerConfig_t, baro_sample_count)},
     { "baro_noise_lpf",             VAR_FLOAT  | PROFILE_VALUE, .config.minmax = { 0 , 1 } , PG_BAROMETER_CONFIG, offsetof(barometerConfig_t, baro_noise_lpf)},
-    { "baro_cf_vel",                VAR_FLOAT  | PROFILE_VALUE, .config.minmax = { 0 , 1 } , PG_BAROMETER_CONFIG, offsetof(barometerConfig_t, baro_cf_vel)},
-    { "baro_cf_alt",                VAR_FLOAT  | PROFILE_VALUE, .config.minmax = { 0 , 1 } , PG_BAROMETER_CONFIG, offsetof(barometerConfig_t, baro_cf_alt)},
 
     { "baro_hardware",              VAR_UINT8  | MASTER_VALUE, .config.minmax = { 0,  BARO_MAX } , PG_SENSOR_SELECTION_CONFIG, offsetof(sensorSelectionConfig_t, baro_hardware)},
 #endif
@@ -705,6 +764,10 @@ const clivalue_t valueTable[] = {
     { "yaw_p_limit",                VAR_UINT16 | PROFILE_VALUE, .config.minmax = { YAW_P_LIMIT_MIN, YAW_P_LIMIT_MAX } , PG_PID_PROFILE, offsetof(pidProfile_t, yaw_p_limit)},
     { "yaw_lpf",                    VAR_UINT16 | PROFILE_VALUE, .config.minmax = {0, 500 } , PG_PID_PROFILE, offsetof(pidProfile_t, yaw_lpf)},
     { "dterm_cut_hz",               VAR_UINT16 | PROFILE_VALUE, .config.minmax = {0, 500 } , PG_PID_PROFILE, offsetof(pidProfile_t, dterm_lpf)},
+    { "feed_forward",               VAR_UINT8  | PROFILE_VALUE, .config.minmax = { PID_MIN,  PID_MAX } , PG_PID_PROFILE, offsetof(pidProfile_t, feedForward)},
+    { "feed_forward_cut_hz",        VAR_UINT16 | PROFILE_VALUE, .config.minmax = {0, 500 } , PG_PID_PROFILE, offsetof(pidProfile_t, feedForwardLpf)},
+    { "p_setpoint_weight",          VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 0,  PTERM_SETPOINT_WEIGHT_MAX } , PG_PID_PROFILE, offsetof(pidProfile_t, PTermSetpointWeight)},
+    { "d_setpoint_weight",          VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 0,  DTERM_SETPOINT_WEIGHT_MAX } , PG_PID_PROFILE, offsetof(pidProfile_t, DTermSetpointWeight)},
 
 #ifdef GTUNE
     { "gtune_loP_rll",              VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 10,  200 } , PG_GTUNE_CONFIG, offsetof(gtuneConfig_t, gtune_lolimP[FD_ROLL])},
@@ -718,6 +781,15 @@ const clivalue_t valueTable[] = {
     { "gtune_average_cycles",       VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 8,  128 } , PG_GTUNE_CONFIG, offsetof(gtuneConfig_t, gtune_average_cycles)},
 #endif
 
+#ifdef AUTOTUNE
+    { "autotune_rule",              VAR_UINT8  | PROFILE_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_AUTOTUNE_RULE } , PG_AUTOTUNE_CONFIG, offsetof(autotuneConfig_t, autotune_rule)},
+    { "autotune_relay_amplitude",   VAR_UINT16 | PROFILE_VALUE, .config.minmax = { 10,  300 } , PG_AUTOTUNE_CONFIG, offsetof(autotuneConfig_t, autotune_relay_amplitude)},
+    { "autotune_hysteresis",        VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 0,  100 } , PG_AUTOTUNE_CONFIG, offsetof(autotuneConfig_t, autotune_hysteresis)},
+    { "autotune_max_angle",         VAR_UINT16 | PROFILE_VALUE, .config.minmax = { 50,  450 } , PG_AUTOTUNE_CONFIG, offsetof(autotuneConfig_t, autotune_max_angle)},
+    { "autotune_cycles",            VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 2,  20 } , PG_AUTOTUNE_CONFIG, offsetof(autotuneConfig_t, autotune_cycles)},
+    { "autotune_stick_deadband",    VAR_UINT8  | PROFILE_VALUE, .config.minmax = { 0,  100 } , PG_AUTOTUNE_CONFIG, offsetof(autotuneConfig_t, autotune_stick_deadband)},
+#endif
+
 #ifdef BLACKBOX
     { "blackbox_rate_num",          VAR_UINT8  | MASTER_VALUE, .config.minmax = { 1,  32 } , PG_BLACKBOX_CONFIG, offsetof(blackboxConfig_t, rate_num)},
     { "blackbox_rate_denom",        VAR_UINT8  | MASTER_VALUE, .config.minmax = { 1,  32 } , PG_BLACKBOX_CONFIG, offsetof(blackboxConfig_t, rate_denom)},
@@ -2134,6 +2206,55 @@ static void cliMotor(char *cmdline)
     cliPrintf("motor %d: %d\r\n", motor_index, motor_disarmed[motor_index]);
 }
 
+#ifdef USE_DSHOT
+static void cliDshotCommand(char *cmdline)
+{
+    int motor_index = 0;
+    int command = 0;
+    int index = 0;
+    char *pch = NULL;
+    char *saveptr;
+
+    pch = strtok_r(cmdline, " ", &saveptr);
+    while (pch != NULL) {
+        switch (index) {
+            case 0:
+                motor_index = atoi(pch);
+                break;
+            case 1:
+                command = atoi(pch);
+                break;
+        }
+        index++;
+        pch = strtok_r(NULL, " ", &saveptr);
+    }
+
+    if (index != 2) {
+        cliShowParseError();
+        return;
+    }
+
+    if (!isMotorProtocolDshot()) {
+        cliPrint("DShot not active\r\n");
+        return;
+    }
+
+    if (motor_index < 0 || motor_index >= motorCount) {
+        cliShowArgumentRangeError("index", 0, motorCount - 1);
+        return;
+    }
+
+    if (command < DSHOT_CMD_MOTOR_STOP || command > DSHOT_CMD_MAX) {
+        cliShowArgumentRangeError("command", DSHOT_CMD_MOTOR_STOP, DSHOT_CMD_MAX);
+        return;
+    }
+
+    // sent instead of the stop frames of the disarmed motor
+    pwmWriteDshotCommand(motor_index, command);
+    cliPrintf("motor %d: command %d\r\n", motor_index, command);
+}
+#endif
+
 static void cliPlaySound(char *cmdline)
 {
 #if FLASH_SIZE <= 64
@@ -2428,6 +2549,8 @@ static void cliSet(char *cmdline)
 
                 if (changeValue) {
                     cliSetVar(val, tmp);
+                    activatePidConfig();    // rates and midrc are cached in the PID runtime config
+                    mixerInitConfig();      // the mixer caches the motor, 3D and rx limits
 
                     cliPrintf("%s set to ", valueTable[i].name);
                     cliPrintVar(val, 0);
@@ -2518,6 +2641,22 @@ static void cliStatus(char *cmdline)
 #endif
 
     cliPrintf("Cycle Time: %d, I2C Errors: %d, registry size: %d\r\n", cycleTime, i2cErrorCounter, PG_REGISTRY_SIZE);
+
+#ifdef SERIAL_RX
+    if (feature(FEATURE_RX_SERIAL) && rxFrameIsActive()) {
+        const rxFrameStats_t *rxStats = rxFrameGetStats();
+        cliPrintf("RX frames: %d, lost: %d, corrupt: %d, checksum errors: %d, interval min/avg/max: %d/%d/%d us\r\n",
+            rxStats->frameCount, rxStats->lostFrameCount, rxStats->corruptFrameCount, rxStats->checksumErrorCount,
+            rxStats->frameIntervalMin, rxStats->frameIntervalAverage, rxStats->frameIntervalMax);
+    }
+    if (feature(FEATURE_RX_SERIAL) && rxConfig()->serialrx_provider == SERIALRX_CRSF) {
+        const crsfFrameStats_t *crsfStats = crsfGetFrameStats();
+        const crsfLinkStatistics_t *link = crsfGetLinkStatistics();
+        cliPrintf("CRSF frames: %d, crc errors: %d, corrupt: %d, LQ: %d%%, RSSI: -%d dBm, SNR: %d dB\r\n",
+            crsfStats->frameCount, crsfStats->crcErrorCount, crsfStats->corruptFrameCount,
+            link->uplinkLinkQuality, link->activeAntenna ? link->uplinkRssi2 : link->uplinkRssi1, link->uplinkSnr);
+    }
+#endif
 }
 
 #ifndef SKIP_TASK_STATISTICS
@@ -136,30 +136,47 @@ static uint8_t mspSerialChecksumBuf(uint8_t checksum, uint8_t *data, int len)
     return checksum;
 }
 
+static void mspSerialEncodeComplete(void *context)
+{
+    mspPort_t *msp = context;
+    msp->outPending = false;
+}
+
+// the packet data must be in msp->outBuf, it is sent from there
 void mspSerialEncode(mspPort_t *msp, mspPacket_t *packet)
 {
-    serialBeginWrite(msp->port);
-    int len = sbufBytesRemaining(&packet->buf);
-    uint8_t hdr[] = {'$', 'M', packet->result < 0 ? '!' : (msp->mode == MSP_MODE_SERVER ? '>' : '<'), len, packet->cmd};
+    const int len = sbufBytesRemaining(&packet->buf);
+
+    msp->outHeader[0] = '$';
+    msp->outHeader[1] = 'M';
+    msp->outHeader[2] = packet->result < 0 ? '!' : (msp->mode == MSP_MODE_SERVER ? '>' : '<');
+    msp->outHeader[3] = len;
+    msp->outHeader[4] = packet->cmd;
+
     uint8_t csum = 0;                                       // initial checksum value
-    serialWriteBuf(msp->port, hdr, sizeof(hdr));
-    csum = mspSerialChecksumBuf(csum, hdr + 3, 2);          // checksum starts from len field
-    if(len > 0) {
-        serialWriteBuf(msp->port, sbufPtr(&packet->buf), len);
-        csum = mspSerialChecksumBuf(csum, sbufPtr(&packet->buf), len);
-    }
-    serialWrite(msp->port, csum);
+    csum = mspSerialChecksumBuf(csum, msp->outHeader + 3, 2);   // checksum starts from len field
+    csum = mspSerialChecksumBuf(csum, sbufPtr(&packet->buf), len);
+    msp->outChecksum = csum;
+
+    const serialTxSegment_t segments[] = {
+        { msp->outHeader, sizeof(msp->outHeader), NULL, NULL },
+        { sbufPtr(&packet->buf), len, NULL, NULL },
+        { &msp->outChecksum, sizeof(msp->outChecksum), mspSerialEncodeComplete, msp },
+    };
+
+    // ports without a transmit DMA copy the reply and complete it straight away
+    msp->outPending = true;
+    serialBeginWrite(msp->port);
+    serialWriteSegments(msp->port, segments, ARRAYLEN(segments));
     serialEndWrite(msp->port);
 }
 
 STATIC_UNIT_TESTED void mspSerialProcessReceivedCommand(mspPort_t *msp)
 {
-    uint8_t outBuf[MSP_PORT_OUTBUF_SIZE];
-
     mspPacket_t message = {
         .buf = {
-            .ptr = outBuf,
-            .end = ARRAYEND(outBuf),
+            .ptr = msp->outBuf,
+            .end = ARRAYEND(msp->outBuf),
         },
         .cmd = -1,
         .result = 0,
@@ -272,11 +289,11 @@ void mspSerialProcess(void)
 {
     for (int i = 0; i < MAX_MSP_PORT_COUNT; i++) {
         mspPort_t *msp = &mspPorts[i];
-        if (!msp->port) {
+        if (!msp->port || msp->outPending) {
             continue;
         }
 
-        uint8_t bytesWaiting;
+        uint16_t bytesWaiting;
         while ((bytesWaiting = serialRxBytesWaiting(msp->port))) {
             uint8_t c = serialRead(msp->port);
             bool consumed = mspSerialProcessReceivedByte(msp, c);
@@ -305,11 +322,10 @@ void mspSerialProcess(void)
         // TODO consider extracting this outside the loop and create a new loop in mspClientProcess and rename mspProcess to mspServerProcess
         if (msp->c_state == IDLE && msp->commandSenderFn && !bytesWaiting) {
 
-            uint8_t outBuf[MSP_PORT_OUTBUF_SIZE];
             mspPacket_t message = {
                 .buf = {
-                    .ptr = outBuf,
-                    .end = ARRAYEND(outBuf),
+                    .ptr = msp->outBuf,
+                    .end = ARRAYEND(msp->outBuf),
                 },
                 .cmd = -1,
                 .result = 0,
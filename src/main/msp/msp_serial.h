@@ -88,6 +88,12 @@ typedef struct mspPort_s {
     uint8_t dataSize;
     uint8_t cmdMSP;
     uint8_t inBuf[MSP_PORT_INBUF_SIZE];
+
+    // the reply is sent from here by the transmit DMA, nothing is received until it has gone
+    volatile bool outPending;
+    uint8_t outHeader[5];
+    uint8_t outChecksum;
+    uint8_t outBuf[MSP_PORT_OUTBUF_SIZE];
 } mspPort_t;
 
 extern mspPort_t mspPorts[MAX_MSP_PORT_COUNT];
@@ -115,11 +115,6 @@ void taskUpdateBattery(void)
     static uint32_t vbatLastServiced = 0;
     static uint32_t ibatLastServiced = 0;
 
-    if (cmp32(currentTime, vbatLastServiced) >= VBATINTERVAL) {
-        vbatLastServiced = currentTime;
-        updateBattery();
-    }
-
     int32_t ibatTimeSinceLastServiced = cmp32(currentTime, ibatLastServiced);
 
     if (ibatTimeSinceLastServiced >= IBATINTERVAL) {
@@ -127,4 +122,9 @@ void taskUpdateBattery(void)
 
         updateCurrentMeter(ibatTimeSinceLastServiced);
     }
+
+    if (cmp32(currentTime, vbatLastServiced) >= VBATINTERVAL) {
+        vbatLastServiced = currentTime;
+        updateBattery();
+    }
 }
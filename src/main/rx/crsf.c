@@ -0,0 +1,311 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Driver for CRSF (TBS Crossfire) receivers.
+ *
+ * Frames are <address> <length> <type> <payload> <crc>, the length counts the type, payload and crc bytes and the
+ * crc is CRC8 DVB-S2 over the type and payload.  The port is bidirectional at 420 kbaud, the receiver sends RC
+ * channel and link statistics frames and the flight controller sends telemetry frames back to it.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <platform.h>
+
+#include "build/build_config.h"
+#include "build/atomic.h"
+
+#include "common/crc.h"
+#include "common/maths.h"
+
+#include "config/parameter_group.h"
+
+#include "drivers/system.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/crsf.h"
+
+#define CRSF_MAX_CHANNEL 16
+
+#define CRSF_FRAME_ADDRESS_OFFSET 0
+#define CRSF_FRAME_LENGTH_OFFSET 1
+#define CRSF_FRAME_TYPE_OFFSET 2
+#define CRSF_FRAME_PAYLOAD_OFFSET 3
+
+#define CRSF_FRAME_LENGTH_MIN 2         // type and crc
+#define CRSF_FRAME_LENGTH_MAX (CRSF_FRAME_SIZE_MAX - 2)
+
+#define CRSF_RC_CHANNELS_PAYLOAD_SIZE 22
+#define CRSF_LINK_STATISTICS_PAYLOAD_SIZE 10
+
+// 64 bytes take 1.5 ms at 420 kbaud
+#define CRSF_TIME_NEEDED_PER_FRAME_US 1750
+
+// 172 is 988 us, 992 is 1500 us and 1811 is 2012 us, the same range as SBUS
+#define CRSF_SCALE_TO_US(value) ((((uint32_t)(value) * 1024) / 1639) + 881)
+
+static bool crsfLinkStatisticsReceived = false;
+static void crsfDataReceive(uint16_t c);
+static void crsfFrameReceive(const uint8_t *frame, uint8_t length, uint32_t frameEndAt);
+static uint16_t crsfReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
+
+static serialPort_t *crsfPort;
+
+static uint16_t crsfChannelData[CRSF_MAX_CHANNEL];
+
+static uint8_t crsfFrame[CRSF_FRAME_SIZE_MAX];
+
+#define CRSF_PAYLOAD_NONE 0xFF
+
+// channel payloads are stored in one buffer while the other is unpacked, so a new frame can't tear the channels
+static uint8_t crsfChannelPayload[2][CRSF_RC_CHANNELS_PAYLOAD_SIZE];
+static uint8_t crsfChannelReceiveIndex;
+static volatile uint8_t crsfChannelReadyIndex = CRSF_PAYLOAD_NONE;   // buffer of the last payload not yet unpacked
+
+static crsfLinkStatistics_t crsfLinkStatistics;
+static crsfFrameStats_t crsfFrameStats;
+
+bool crsfInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
+{
+    for (int i = 0; i < CRSF_MAX_CHANNEL; i++) {
+        crsfChannelData[i] = rxConfig()->midrc;
+    }
+    memset(&crsfLinkStatistics, 0, sizeof(crsfLinkStatistics));
+    memset(&crsfFrameStats, 0, sizeof(crsfFrameStats));
+    crsfChannelReceiveIndex = 0;
+    crsfChannelReadyIndex = CRSF_PAYLOAD_NONE;
+    crsfLinkStatisticsReceived = false;
+
+    if (callback)
+        *callback = crsfReadRawRC;
+    rxRuntimeConfig->channelCount = CRSF_MAX_CHANNEL;
+
+    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    if (!portConfig) {
+        return false;
+    }
+
+    crsfPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, crsfDataReceive, CRSF_BAUDRATE, MODE_RXTX, SERIAL_NOT_INVERTED);
+    if (!crsfPort) {
+        return false;
+    }
+
+    // receive whole frames when the port can delimit them, otherwise byte by byte
+    serialSetReceiveFrameCallback(crsfPort, crsfFrameReceive);
+
+    return true;
+}
+
+const crsfLinkStatistics_t *crsfGetLinkStatistics(void)
+{
+    return &crsfLinkStatistics;
+}
+
+const crsfFrameStats_t *crsfGetFrameStats(void)
+{
+    return &crsfFrameStats;
+}
+
+static uint8_t crsfFrameCrc(const uint8_t *frame)
+{
+    const uint8_t crcOffset = frame[CRSF_FRAME_LENGTH_OFFSET] + 1;
+    uint8_t crc = 0;
+
+    for (int i = CRSF_FRAME_TYPE_OFFSET; i < crcOffset; i++) {
+        crc = crc8_dvb_s2(crc, frame[i]);
+    }
+    return crc;
+}
+
+// called with a whole frame of a valid length
+static void crsfProcessFrame(const uint8_t *frame, uint32_t frameEndAt)
+{
+    const uint8_t frameLength = frame[CRSF_FRAME_LENGTH_OFFSET];
+    const uint8_t payloadLength = frameLength - CRSF_FRAME_LENGTH_MIN;
+    const uint8_t *payload = &frame[CRSF_FRAME_PAYLOAD_OFFSET];
+
+    if (crsfFrameCrc(frame) != frame[frameLength + 1]) {
+        crsfFrameStats.crcErrorCount++;
+        return;
+    }
+
+    switch (frame[CRSF_FRAME_TYPE_OFFSET]) {
+        case CRSF_FRAMETYPE_RC_CHANNELS_PACKED:
+            if (payloadLength != CRSF_RC_CHANNELS_PAYLOAD_SIZE) {
+                crsfFrameStats.corruptFrameCount++;
+                return;
+            }
+            memcpy(crsfChannelPayload[crsfChannelReceiveIndex], payload, CRSF_RC_CHANNELS_PAYLOAD_SIZE);
+            crsfFrameStats.frameCount++;
+            rxFrameTime = frameEndAt;
+            crsfChannelReadyIndex = crsfChannelReceiveIndex;
+            crsfChannelReceiveIndex ^= 1;
+            break;
+
+        case CRSF_FRAMETYPE_LINK_STATISTICS:
+            if (payloadLength != CRSF_LINK_STATISTICS_PAYLOAD_SIZE) {
+                crsfFrameStats.corruptFrameCount++;
+                return;
+            }
+            crsfLinkStatistics.uplinkRssi1 = payload[0];
+            crsfLinkStatistics.uplinkRssi2 = payload[1];
+            crsfLinkStatistics.uplinkLinkQuality = payload[2];
+            crsfLinkStatistics.uplinkSnr = (int8_t)payload[3];
+            crsfLinkStatistics.activeAntenna = payload[4];
+            crsfLinkStatistics.rfMode = payload[5];
+            crsfLinkStatistics.uplinkTxPower = payload[6];
+            crsfLinkStatistics.downlinkRssi = payload[7];
+            crsfLinkStatistics.downlinkLinkQuality = payload[8];
+            crsfLinkStatistics.downlinkSnr = (int8_t)payload[9];
+            crsfFrameStats.linkStatisticsCount++;
+            crsfLinkStatisticsReceived = true;
+            break;
+
+        default:
+            // other frame types are for other devices on the bus
+            break;
+    }
+}
+
+// Receive ISR callback
+static void crsfDataReceive(uint16_t c)
+{
+    static uint8_t crsfFramePosition = 0;
+    static uint32_t crsfFrameStartAt = 0;
+    const uint32_t now = micros();
+
+    if (crsfFramePosition > 0 && (now - crsfFrameStartAt) > CRSF_TIME_NEEDED_PER_FRAME_US) {
+        crsfFrameStats.corruptFrameCount++;
+        crsfFramePosition = 0;
+    }
+
+    if (crsfFramePosition == 0) {
+        if (c != CRSF_ADDRESS_FLIGHT_CONTROLLER) {
+            return;
+        }
+        crsfFrameStartAt = now;
+    }
+
+    crsfFrame[crsfFramePosition++] = (uint8_t)c;
+
+    if (crsfFramePosition == CRSF_FRAME_LENGTH_OFFSET + 1) {
+        if (c < CRSF_FRAME_LENGTH_MIN || c > CRSF_FRAME_LENGTH_MAX) {
+            crsfFrameStats.corruptFrameCount++;
+            crsfFramePosition = 0;
+        }
+    } else if (crsfFramePosition > CRSF_FRAME_LENGTH_OFFSET + 1 && crsfFramePosition == crsfFrame[CRSF_FRAME_LENGTH_OFFSET] + 2) {
+        crsfProcessFrame(crsfFrame, now);
+        crsfFramePosition = 0;
+    }
+}
+
+// Receive ISR frame callback, the receiver may send more than one frame without a pause
+static void crsfFrameReceive(const uint8_t *frame, uint8_t length, uint32_t frameEndAt)
+{
+    while (length > 0) {
+        if (length < CRSF_FRAME_LENGTH_MIN + 2 || frame[CRSF_FRAME_ADDRESS_OFFSET] != CRSF_ADDRESS_FLIGHT_CONTROLLER) {
+            crsfFrameStats.corruptFrameCount++;
+            return;
+        }
+
+        const uint8_t frameLength = frame[CRSF_FRAME_LENGTH_OFFSET];
+        if (frameLength < CRSF_FRAME_LENGTH_MIN || frameLength + 2 > length) {
+            crsfFrameStats.corruptFrameCount++;
+            return;
+        }
+
+        crsfProcessFrame(frame, frameEndAt);
+
+        frame += frameLength + 2;
+        length -= frameLength + 2;
+    }
+}
+
+uint8_t crsfFrameStatus(void)
+{
+    if (crsfLinkStatisticsReceived) {
+        crsfLinkStatisticsReceived = false;
+        // the link quality is the best measure of the link, the RSSI of a long range link is low even when it's good
+        rssi = (constrain(crsfLinkStatistics.uplinkLinkQuality, 0, 100) * 1023) / 100;
+    }
+
+    // taking the buffer stops the receive ISR from handing it over again
+    const uint8_t readyIndex = ATOMIC_XCHG(&crsfChannelReadyIndex, CRSF_PAYLOAD_NONE);
+    if (readyIndex == CRSF_PAYLOAD_NONE) {
+        return SERIAL_RX_FRAME_PENDING;
+    }
+    const uint8_t *channelPayload = crsfChannelPayload[readyIndex];
+
+    // unpack the 11 bit channels, packed LSB first, in one pass over the payload
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    uint8_t channel = 0;
+
+    for (int i = 0; i < CRSF_RC_CHANNELS_PAYLOAD_SIZE; i++) {
+        bits |= (uint32_t)channelPayload[i] << bitCount;
+        bitCount += 8;
+        if (bitCount >= 11) {
+            crsfChannelData[channel++] = CRSF_SCALE_TO_US(bits & 0x7FF);
+            bits >>= 11;
+            bitCount -= 11;
+        }
+    }
+
+    return SERIAL_RX_FRAME_COMPLETE;
+}
+
+static uint16_t crsfReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
+{
+    UNUSED(rxRuntimeConfig);
+    return crsfChannelData[chan];
+}
+
+bool crsfRxIsActive(void)
+{
+    return crsfPort != NULL;
+}
+
+void crsfRxSendFrame(uint8_t type, const uint8_t *payload, uint8_t payloadLength)
+{
+    uint8_t frame[CRSF_FRAME_SIZE_MAX];
+    const uint8_t frameSize = payloadLength + 4;
+
+    if (!crsfPort || payloadLength > CRSF_PAYLOAD_SIZE_MAX) {
+        return;
+    }
+
+    // a frame that doesn't fit is dropped rather than waiting for the transmitter, the next one carries newer data
+    if (serialTxBytesFree(crsfPort) < frameSize) {
+        return;
+    }
+
+    frame[CRSF_FRAME_ADDRESS_OFFSET] = CRSF_ADDRESS_FLIGHT_CONTROLLER;
+    frame[CRSF_FRAME_LENGTH_OFFSET] = payloadLength + CRSF_FRAME_LENGTH_MIN;
+    frame[CRSF_FRAME_TYPE_OFFSET] = type;
+    memcpy(&frame[CRSF_FRAME_PAYLOAD_OFFSET], payload, payloadLength);
+    frame[frameSize - 1] = crsfFrameCrc(frame);
+
+    serialWriteBuf(crsfPort, frame, frameSize);
+}
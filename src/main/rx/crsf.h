@@ -0,0 +1,63 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#define CRSF_BAUDRATE 420000
+
+#define CRSF_ADDRESS_FLIGHT_CONTROLLER 0xC8
+
+#define CRSF_FRAME_SIZE_MAX 64          // address, length, type, payload and crc
+#define CRSF_PAYLOAD_SIZE_MAX (CRSF_FRAME_SIZE_MAX - 4)
+
+typedef enum {
+    CRSF_FRAMETYPE_BATTERY_SENSOR = 0x08,
+    CRSF_FRAMETYPE_LINK_STATISTICS = 0x14,
+    CRSF_FRAMETYPE_RC_CHANNELS_PACKED = 0x16,
+    CRSF_FRAMETYPE_ATTITUDE = 0x1E,
+} crsfFrameType_e;
+
+typedef struct crsfLinkStatistics_s {
+    uint8_t uplinkRssi1;                // -dBm
+    uint8_t uplinkRssi2;                // -dBm
+    uint8_t uplinkLinkQuality;          // % of the uplink frames received
+    int8_t uplinkSnr;                   // dB
+    uint8_t activeAntenna;
+    uint8_t rfMode;                     // 0 = 4 Hz, 1 = 50 Hz, 2 = 150 Hz
+    uint8_t uplinkTxPower;
+    uint8_t downlinkRssi;               // -dBm
+    uint8_t downlinkLinkQuality;        // %
+    int8_t downlinkSnr;                 // dB
+} crsfLinkStatistics_t;
+
+typedef struct crsfFrameStats_s {
+    uint32_t frameCount;                // RC channel frames
+    uint32_t linkStatisticsCount;
+    uint32_t crcErrorCount;
+    uint32_t corruptFrameCount;         // bad address or length, or cut short
+} crsfFrameStats_t;
+
+bool crsfInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback);
+uint8_t crsfFrameStatus(void);
+
+const crsfLinkStatistics_t *crsfGetLinkStatistics(void);
+const crsfFrameStats_t *crsfGetFrameStats(void);
+
+// the telemetry back-channel, frames to the receiver on the same port
+bool crsfRxIsActive(void);
+void crsfRxSendFrame(uint8_t type, const uint8_t *payload, uint8_t payloadLength);
@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <platform.h>
 
@@ -31,14 +32,13 @@
 
 #include "config/parameter_group.h"
 
-#include "drivers/dma.h"
 #include "drivers/system.h"
 
 #include "drivers/serial.h"
-#include "drivers/serial_uart.h"
 #include "io/serial.h"
 
 #include "rx/rx.h"
+#include "rx/rx_frame.h"
 #include "rx/ibus.h"
 
 #define IBUS_MAX_CHANNEL 10
@@ -47,10 +47,18 @@
 
 #define IBUS_BAUDRATE 115200
 
-static bool ibusFrameDone = false;
+// 32 bytes with the length as the sync byte and a checksum of the first 30 bytes
+static const rxFrameDescriptor_t ibusFrameDescriptor = {
+    .syncByte = IBUS_SYNCBYTE,
+    .syncByteMask = 0xFF,
+    .frameSize = IBUS_BUFFSIZE,
+    .frameSizeMax = IBUS_BUFFSIZE,
+    .checksum = RX_FRAME_CHECKSUM_IBUS,
+    .interFrameGapUs = 3000,
+};
+
 static uint32_t ibusChannelData[IBUS_MAX_CHANNEL];
 
-static void ibusDataReceive(uint16_t c);
 static uint16_t ibusReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
 bool ibusInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
@@ -60,70 +68,24 @@ bool ibusInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
 
     rxRuntimeConfig->channelCount = IBUS_MAX_CHANNEL;
 
-    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
-    if (!portConfig) {
-        return false;
-    }
-
-    serialPort_t *ibusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, ibusDataReceive, IBUS_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
-
-    return ibusPort != NULL;
-}
-
-static uint8_t ibus[IBUS_BUFFSIZE] = { 0, };
-
-// Receive ISR callback
-static void ibusDataReceive(uint16_t c)
-{
-    uint32_t ibusTime;
-    static uint32_t ibusTimeLast;
-    static uint8_t ibusFramePosition;
-
-    ibusTime = micros();
-
-    if ((ibusTime - ibusTimeLast) > 3000)
-        ibusFramePosition = 0;
-
-    ibusTimeLast = ibusTime;
-
-    if (ibusFramePosition == 0 && c != IBUS_SYNCBYTE)
-        return;
-
-    ibus[ibusFramePosition] = (uint8_t)c;
-
-    if (ibusFramePosition == IBUS_BUFFSIZE - 1) {
-        ibusFrameDone = true;
-    } else {
-        ibusFramePosition++;
-    }
+    return rxFrameOpenPort(&ibusFrameDescriptor, IBUS_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED) != NULL;
 }
 
 uint8_t ibusFrameStatus(void)
 {
     uint8_t i, offset;
-    uint8_t frameStatus = SERIAL_RX_FRAME_PENDING;
-    uint16_t chksum, rxsum;
+    uint8_t length;
 
-    if (!ibusFrameDone) {
-        return frameStatus;
+    const uint8_t *ibus = rxFrameGet(&ibusFrameDescriptor, &length);
+    if (!ibus) {
+        return SERIAL_RX_FRAME_PENDING;
     }
 
-    ibusFrameDone = false;
-
-    chksum = 0xFFFF;
-    for (i = 0; i < 30; i++)
-        chksum -= ibus[i];
-        
-    rxsum = ibus[30] + (ibus[31] << 8);
-
-    if (chksum == rxsum) {
-        for (i = 0, offset = 2; i < IBUS_MAX_CHANNEL; i++, offset += 2) {
-            ibusChannelData[i] = ibus[offset] + (ibus[offset + 1] << 8);
-        }
-        frameStatus = SERIAL_RX_FRAME_COMPLETE;
+    for (i = 0, offset = 2; i < IBUS_MAX_CHANNEL; i++, offset += 2) {
+        ibusChannelData[i] = ibus[offset] + (ibus[offset + 1] << 8);
     }
 
-    return frameStatus;
+    return SERIAL_RX_FRAME_COMPLETE;
 }
 
 static uint16_t ibusReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
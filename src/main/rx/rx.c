@@ -58,6 +58,7 @@
 #include "rx/xbus.h"
 #include "rx/ibus.h"
 #include "rx/srxl.h"
+#include "rx/crsf.h"
 
 #include "rx/rx.h"
 
@@ -66,6 +67,8 @@
 const char rcChannelLetters[] = "AERT12345678abcdefgh";
 
 uint16_t rssi = 0;                  // range: [0;1023]
+uint32_t rxFrameTime = 0;
+uint32_t rcDataFrameTime = 0;
 
 static bool rxDataReceived = false;
 static bool rxSignalReceived = false;
@@ -75,6 +78,7 @@ static bool rxIsInFailsafeMode = true;
 static bool rxIsInFailsafeModeNotDataDriven = true;
 
 static uint32_t rxUpdateAt = 0;
+static uint32_t rxDataFrameTime = 0;              // arrival of the last data driven frame
 static uint32_t needRxSignalBefore = 0;
 static uint32_t suspendRxSignalUntil = 0;
 static uint8_t  skipRxSamples = 0;
@@ -92,11 +96,22 @@ uint32_t rcInvalidPulsPeriod[MAX_SUPPORTED_RC_CHANNEL_COUNT];
 #define SKIP_RC_ON_SUSPEND_PERIOD 1500000           // 1.5 second period in usec (call frequency independent)
 #define SKIP_RC_SAMPLES_ON_RESUME  2                // flush 2 samples to drop wrong measurements (timing independent)
 
-static uint8_t rcSampleIndex = 0;
+#define RX_FRAME_INTERVAL_MIN 1000               // us
+#define RX_FRAME_INTERVAL_MAX 50000              // longer gaps are lost frames rather than the frame rate
+#define RX_FRAME_INTERVAL_OUTLIER_LIMIT 8        // a run of outliers this long is a new frame rate
+#define RX_SIGNAL_TIMEOUT_FRAMES 10              // frames missed before the signal counts as lost
+#define RX_SIGNAL_TIMEOUT_MIN DELAY_50_HZ
+
+static uint8_t rcSampleIndex = 0;                // the slot of the oldest PPM/PWM sample
+static uint8_t rcSampleCount = 0;
+
+static uint32_t rxFrameIntervalAverage16;        // 1/16 us
+static uint32_t rxLastFrameAt;
+static uint8_t rxFrameIntervalOutliers;
 
 rxRuntimeConfig_t rxRuntimeConfig;
 
-PG_REGISTER_WITH_RESET_TEMPLATE(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+PG_REGISTER_WITH_RESET_TEMPLATE(rxConfig_t, rxConfig, PG_RX_CONFIG, 1);
 
 PG_REGISTER_ARR_WITH_RESET_FN(rxFailsafeChannelConfig_t, MAX_SUPPORTED_RC_CHANNEL_COUNT, failsafeChannelConfigs, PG_FAILSAFE_CHANNEL_CONFIG, 0);
 PG_REGISTER_ARR_WITH_RESET_FN(rxChannelRangeConfiguration_t, NON_AUX_CHANNEL_COUNT, channelRanges, PG_CHANNEL_RANGE_CONFIG, 0);
@@ -139,7 +154,7 @@ static uint16_t nullReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t channe
 }
 
 static rcReadRawDataPtr rcReadRawFunc = nullReadRawRC;
-static uint16_t rxRefreshRate;
+static uint16_t rxRefreshRate;                   // the nominal frame interval of the protocol, us
 
 void serialRxInit(rxConfig_t *rxConfig);
 
@@ -178,6 +193,7 @@ void rxInit(modeActivationCondition_t *modeActivationConditions)
     uint16_t value;
 
     rcSampleIndex = 0;
+    rcSampleCount = 0;
 
     for (i = 0; i < MAX_SUPPORTED_RC_CHANNEL_COUNT; i++) {
         rcData[i] = rxConfig()->midrc;
@@ -216,6 +232,9 @@ void rxInit(modeActivationCondition_t *modeActivationConditions)
         rxRefreshRate = 20000;
         rxPwmInit(&rxRuntimeConfig, &rcReadRawFunc);
     }
+
+    rxFrameIntervalAverage16 = constrain(rxRefreshRate ? rxRefreshRate : DELAY_50_HZ, RX_FRAME_INTERVAL_MIN, RX_FRAME_INTERVAL_MAX) << 4;
+    rxFrameIntervalOutliers = 0;
 }
 
 #ifdef SERIAL_RX
@@ -252,8 +271,13 @@ void serialRxInit(rxConfig_t *rxConfig)
             enabled = xBusInit(&rxRuntimeConfig, &rcReadRawFunc);
             break;
         case SERIALRX_IBUS:
+            rxRefreshRate = 7000;
             enabled = ibusInit(&rxRuntimeConfig, &rcReadRawFunc);
             break;
+        case SERIALRX_CRSF:
+            rxRefreshRate = 6667;
+            enabled = crsfInit(&rxRuntimeConfig, &rcReadRawFunc);
+            break;
     }
 
     if (!enabled) {
@@ -289,6 +313,8 @@ uint8_t serialRxFrameStatus(void)
             return xBusFrameStatus();
         case SERIALRX_IBUS:
             return ibusFrameStatus();
+        case SERIALRX_CRSF:
+            return crsfFrameStatus();
     }
     return SERIAL_RX_FRAME_PENDING;
 }
@@ -342,6 +368,45 @@ void resumeRxSignal(void)
     failsafeOnRxResume();
 }
 
+/*
+ * Measures the frame interval from the arrival of each frame, starting from the nominal rate of the protocol.
+ *
+ * A missed frame or a frame split by a glitch is an outlier and doesn't move the average, a run of them is a receiver
+ * running at a different rate than the protocol's nominal one and restarts the average from there.
+ */
+STATIC_UNIT_TESTED void rxUpdateFrameInterval(uint32_t frameTime)
+{
+    const uint32_t frameInterval = frameTime - rxLastFrameAt;
+    rxLastFrameAt = frameTime;
+
+    if (frameInterval < RX_FRAME_INTERVAL_MIN || frameInterval > RX_FRAME_INTERVAL_MAX) {
+        return;
+    }
+
+    const uint32_t average = rxFrameIntervalAverage16 >> 4;
+    if (frameInterval < average - average / 2 || frameInterval > average + average / 2) {
+        if (++rxFrameIntervalOutliers < RX_FRAME_INTERVAL_OUTLIER_LIMIT) {
+            return;
+        }
+        rxFrameIntervalAverage16 = frameInterval << 4;
+    }
+    rxFrameIntervalOutliers = 0;
+
+    // exponential average over about 16 frames
+    rxFrameIntervalAverage16 += frameInterval - (rxFrameIntervalAverage16 >> 4);
+}
+
+uint16_t rxGetFrameInterval(void)
+{
+    return rxFrameIntervalAverage16 >> 4;
+}
+
+// some frames lost in a row on a fast link is a lost signal, slow links keep their fixed timeout
+static uint32_t rxSignalTimeout(uint32_t maxTimeout)
+{
+    return MIN(MAX((uint32_t)rxGetFrameInterval() * RX_SIGNAL_TIMEOUT_FRAMES, RX_SIGNAL_TIMEOUT_MIN), maxTimeout);
+}
+
 void updateRx(uint32_t currentTime)
 {
     resetRxSignalReceivedFlagIfNeeded(currentTime);
@@ -359,7 +424,9 @@ void updateRx(uint32_t currentTime)
             rxDataReceived = true;
             rxIsInFailsafeMode = (frameStatus & SERIAL_RX_FRAME_FAILSAFE) != 0;
             rxSignalReceived = !rxIsInFailsafeMode;
-            needRxSignalBefore = currentTime + DELAY_10_HZ;
+            rxUpdateFrameInterval(rxFrameTime);
+            needRxSignalBefore = rxFrameTime + rxSignalTimeout(DELAY_10_HZ);
+            rxDataFrameTime = rxFrameTime;
         }
     }
 #endif
@@ -370,7 +437,9 @@ void updateRx(uint32_t currentTime)
         if (rxDataReceived) {
             rxSignalReceived = true;
             rxIsInFailsafeMode = false;
-            needRxSignalBefore = currentTime + DELAY_5_HZ;
+            rxUpdateFrameInterval(currentTime);
+            needRxSignalBefore = currentTime + rxSignalTimeout(DELAY_5_HZ);
+            rxDataFrameTime = currentTime;
         }
     }
 
@@ -378,7 +447,8 @@ void updateRx(uint32_t currentTime)
         if (isPPMDataBeingReceived()) {
             rxSignalReceivedNotDataDriven = true;
             rxIsInFailsafeModeNotDataDriven = false;
-            needRxSignalBefore = currentTime + DELAY_10_HZ;
+            rxUpdateFrameInterval(currentTime);
+            needRxSignalBefore = currentTime + rxSignalTimeout(DELAY_10_HZ);
             resetPPMDataReceivedState();
         }
     }
@@ -387,7 +457,7 @@ void updateRx(uint32_t currentTime)
         if (isPWMDataBeingReceived()) {
             rxSignalReceivedNotDataDriven = true;
             rxIsInFailsafeModeNotDataDriven = false;
-            needRxSignalBefore = currentTime + DELAY_10_HZ;
+            needRxSignalBefore = currentTime + rxSignalTimeout(DELAY_10_HZ);
         }
     }
 
@@ -395,33 +465,24 @@ void updateRx(uint32_t currentTime)
 
 bool shouldProcessRx(uint32_t currentTime)
 {
-    return rxDataReceived || ((int32_t)(currentTime - rxUpdateAt) >= 0); // data driven or 50Hz
+    return rxDataReceived || ((int32_t)(currentTime - rxUpdateAt) >= 0); // data driven or once per frame
 }
 
 static uint16_t calculateNonDataDrivenChannel(uint8_t chan, uint16_t sample)
 {
     static uint16_t rcSamples[MAX_SUPPORTED_RX_PARALLEL_PWM_OR_PPM_CHANNEL_COUNT][PPM_AND_PWM_SAMPLE_COUNT];
-    static bool rxSamplesCollected = false;
-
-    uint8_t currentSampleIndex = rcSampleIndex % PPM_AND_PWM_SAMPLE_COUNT;
+    static uint16_t rcSampleSums[MAX_SUPPORTED_RX_PARALLEL_PWM_OR_PPM_CHANNEL_COUNT];
 
-    // update the recent samples and compute the average of them
-    rcSamples[chan][currentSampleIndex] = sample;
+    // replace the oldest of the recent samples, the running sum always matches them
+    rcSampleSums[chan] += sample - rcSamples[chan][rcSampleIndex];
+    rcSamples[chan][rcSampleIndex] = sample;
 
     // avoid returning an incorrect average which would otherwise occur before enough samples
-    if (!rxSamplesCollected) {
-        if (rcSampleIndex < PPM_AND_PWM_SAMPLE_COUNT) {
-            return sample;
-        }
-        rxSamplesCollected = true;
+    if (rcSampleCount < PPM_AND_PWM_SAMPLE_COUNT) {
+        return sample;
     }
 
-    uint16_t rcDataMean = 0;
-    uint8_t sampleIndex;
-    for (sampleIndex = 0; sampleIndex < PPM_AND_PWM_SAMPLE_COUNT; sampleIndex++)
-        rcDataMean += rcSamples[chan][sampleIndex];
-
-    return rcDataMean / PPM_AND_PWM_SAMPLE_COUNT;
+    return rcSampleSums[chan] / PPM_AND_PWM_SAMPLE_COUNT;
 }
 
 static uint16_t getRxfailValue(uint8_t channel)
@@ -562,7 +623,7 @@ static void detectAndApplySignalLossBehaviour(void)
 
 void calculateRxChannelsAndUpdateFailsafe(uint32_t currentTime)
 {
-    rxUpdateAt = currentTime + DELAY_50_HZ;
+    rxUpdateAt = currentTime + rxGetFrameInterval();
 
     // only proceed when no more samples to skip and suspend period is over
     if (skipRxSamples) {
@@ -575,7 +636,13 @@ void calculateRxChannelsAndUpdateFailsafe(uint32_t currentTime)
     readRxChannelsApplyRanges();
     detectAndApplySignalLossBehaviour();
 
-    rcSampleIndex++;
+    // PPM and PWM channels are sampled rather than delivered with each frame
+    rcDataFrameTime = isRxDataDriven() ? rxDataFrameTime : currentTime;
+
+    rcSampleIndex = (rcSampleIndex + 1) % PPM_AND_PWM_SAMPLE_COUNT;
+    if (rcSampleCount < PPM_AND_PWM_SAMPLE_COUNT) {
+        rcSampleCount++;
+    }
 }
 
 void parseRcChannels(const char *input, rxConfig_t *rxConfig)
@@ -604,16 +671,11 @@ void updateRSSIPWM(void)
     rssi = (uint16_t)((constrain(pwmRssi - 1000, 0, 1000) / 1000.0f) * 1023.0f);
 }
 
-#define RSSI_ADC_SAMPLE_COUNT 16
-//#define RSSI_SCALE (0xFFF / 100.0f)
-
 void updateRSSIADC(uint32_t currentTime)
 {
 #ifndef ADC_RSSI
     UNUSED(currentTime);
 #else
-    static uint8_t adcRssiSamples[RSSI_ADC_SAMPLE_COUNT];
-    static uint8_t adcRssiSampleIndex = 0;
     static uint32_t rssiUpdateAt = 0;
 
     if ((int32_t)(currentTime - rssiUpdateAt) < 0) {
@@ -621,23 +683,13 @@ void updateRSSIADC(uint32_t currentTime)
     }
     rssiUpdateAt = currentTime + DELAY_50_HZ;
 
-    int16_t adcRssiMean = 0;
-    uint16_t adcRssiSample = adcGetChannel(ADC_RSSI);
-    uint8_t rssiPercentage = adcRssiSample / rxConfig()->rssi_scale;
-
-    adcRssiSampleIndex = (adcRssiSampleIndex + 1) % RSSI_ADC_SAMPLE_COUNT;
-
-    adcRssiSamples[adcRssiSampleIndex] = rssiPercentage;
+    // the ADC driver averages every conversion made since the previous read
+    adcSample_t adcSample;
+    adcReadChannel(ADC_RSSI, &adcSample);
 
-    uint8_t sampleIndex;
-
-    for (sampleIndex = 0; sampleIndex < RSSI_ADC_SAMPLE_COUNT; sampleIndex++) {
-        adcRssiMean += adcRssiSamples[sampleIndex];
-    }
+    int16_t rssiPercentage = adcSample.value / (rxConfig()->rssi_scale << ADC_OVERSAMPLE_SHIFT);
 
-    adcRssiMean = adcRssiMean / RSSI_ADC_SAMPLE_COUNT;
-
-    rssi = (uint16_t)((constrain(adcRssiMean, 0, 100) / 100.0f) * 1023.0f);
+    rssi = (uint16_t)((constrain(rssiPercentage, 0, 100) / 100.0f) * 1023.0f);
 #endif
 }
 
@@ -651,8 +703,3 @@ void updateRSSI(uint32_t currentTime)
     }
 }
 
-void initRxRefreshRate(uint16_t *rxRefreshRatePtr)
-{
-    *rxRefreshRatePtr = rxRefreshRate;
-}
-
@@ -52,7 +52,8 @@ typedef enum {
     SERIALRX_SRXL = 5, //formerly XBUS_MODE_B
     SERIALRX_XBUS_MODE_B_RJ01 = 6,
     SERIALRX_IBUS = 7,
-    SERIALRX_PROVIDER_MAX = SERIALRX_IBUS
+    SERIALRX_CRSF = 8,
+    SERIALRX_PROVIDER_MAX = SERIALRX_CRSF
 } SerialRXType;
 
 #define SERIALRX_PROVIDER_COUNT (SERIALRX_PROVIDER_MAX + 1)
@@ -75,6 +76,8 @@ typedef enum {
 extern const char rcChannelLetters[];
 
 extern int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];       // interval [1000;2000]
+extern uint32_t rxFrameTime;                                // micros() at the end of the last serial receiver frame
+extern uint32_t rcDataFrameTime;                            // micros() when the frame now in rcData[] was received
 
 #define MAX_MAPPABLE_RX_INPUTS 8
 
@@ -116,7 +119,8 @@ typedef struct rxConfig_s {
     uint8_t rssi_channel;
     uint8_t rssi_scale;
     uint8_t rssi_ppm_invert;
-    uint8_t rcSmoothing;                    // Enable/Disable RC filtering
+    uint8_t rcSmoothing;                    // RC smoothing between frames, see rcSmoothingType_e
+    uint8_t rcSmoothingCutoff;              // Hz, 0 = from the measured frame rate
     uint16_t midrc;                         // Some radios have not a neutral point centered on 1500. can be changed here
     uint16_t mincheck;                      // minimum rc end
     uint16_t maxcheck;                      // maximum rc end
@@ -153,6 +157,6 @@ void resetAllRxChannelRangeConfigurations(rxChannelRangeConfiguration_t *rxChann
 void suspendRxSignal(void);
 void resumeRxSignal(void);
 
-void initRxRefreshRate(uint16_t *rxRefreshRatePtr);
+uint16_t rxGetFrameInterval(void);
 
 extern uint16_t rssi;
@@ -0,0 +1,281 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <platform.h>
+
+#include "build/build_config.h"
+#include "build/atomic.h"
+
+#include "common/crc.h"
+#include "common/maths.h"
+
+#include "config/parameter_group.h"
+
+#include "drivers/system.h"
+
+#include "drivers/serial.h"
+#include "io/serial.h"
+
+#include "rx/rx.h"
+#include "rx/rx_frame.h"
+
+static const rxFrameDescriptor_t *activeDescriptor;
+
+#define RX_FRAME_NONE 0xFF
+
+// frames are received into one buffer while the other is decoded, so a complete frame is never copied
+static uint8_t frameBuffer[2][RX_FRAME_SIZE_MAX];
+static uint8_t frameLengths[2];
+static uint32_t frameEndTimes[2];
+static uint8_t receiveIndex;
+static volatile uint8_t readyIndex = RX_FRAME_NONE;    // buffer of the last complete frame not yet returned
+
+static uint8_t framePosition;
+static uint8_t frameSize;
+static uint32_t lastByteAt;
+
+static rxFrameStats_t rxFrameStats;
+static uint32_t frameIntervalAverage16;     // 1/16 us
+
+static void rxFrameDataReceive(uint16_t c);
+static void rxFrameReceive(const uint8_t *frame, uint8_t length, uint32_t frameEndAt);
+
+static void rxFrameResetReceiver(void)
+{
+    framePosition = 0;
+    receiveIndex = 0;
+    readyIndex = RX_FRAME_NONE;
+}
+
+serialPort_t *rxFrameOpenPort(const rxFrameDescriptor_t *descriptor, uint32_t baudRate, portMode_t mode, portOptions_t options)
+{
+    activeDescriptor = NULL;
+    rxFrameResetReceiver();
+    rxFrameResetStats();
+
+    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
+    if (!portConfig) {
+        return NULL;
+    }
+
+    activeDescriptor = descriptor;
+
+    serialPort_t *port = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, rxFrameDataReceive, baudRate, mode, options);
+    if (!port) {
+        activeDescriptor = NULL;
+        return NULL;
+    }
+
+    // receive whole frames when the port can delimit them, otherwise byte by byte
+    serialSetReceiveFrameCallback(port, rxFrameReceive);
+
+    return port;
+}
+
+bool rxFrameIsActive(void)
+{
+    return activeDescriptor != NULL;
+}
+
+void rxFrameResetStats(void)
+{
+    memset(&rxFrameStats, 0, sizeof(rxFrameStats));
+    frameIntervalAverage16 = 0;
+}
+
+const rxFrameStats_t *rxFrameGetStats(void)
+{
+    return &rxFrameStats;
+}
+
+void rxFrameCountLost(void)
+{
+    rxFrameStats.lostFrameCount++;
+}
+
+static bool rxFrameSyncByteMatches(const rxFrameDescriptor_t *descriptor, uint8_t c)
+{
+    return (c & descriptor->syncByteMask) == descriptor->syncByte;
+}
+
+// the size once the first lengthOffset + 1 bytes are known, 0 if it is out of range
+static uint8_t rxFrameSize(const rxFrameDescriptor_t *descriptor, const uint8_t *frame)
+{
+    if (!descriptor->lengthMask) {
+        return descriptor->frameSize;
+    }
+
+    const uint16_t size = descriptor->frameSize + (frame[descriptor->lengthOffset] & descriptor->lengthMask) * descriptor->lengthMultiplier;
+    if (size > descriptor->frameSizeMax) {
+        return 0;
+    }
+    return size;
+}
+
+static void rxFrameComplete(uint8_t length, uint32_t now)
+{
+    if (rxFrameStats.frameCount > 0) {
+        const uint32_t interval = now - rxFrameStats.lastFrameAt;
+
+        // gaps longer than this are an outage rather than the frame rate
+        if (interval < UINT16_MAX) {
+            if (frameIntervalAverage16 == 0) {
+                rxFrameStats.frameIntervalMin = interval;
+                rxFrameStats.frameIntervalMax = interval;
+                frameIntervalAverage16 = interval << 4;
+            } else {
+                rxFrameStats.frameIntervalMin = MIN(rxFrameStats.frameIntervalMin, interval);
+                rxFrameStats.frameIntervalMax = MAX(rxFrameStats.frameIntervalMax, interval);
+                // exponential average over about 16 frames
+                frameIntervalAverage16 += interval - (frameIntervalAverage16 >> 4);
+            }
+            rxFrameStats.frameIntervalAverage = frameIntervalAverage16 >> 4;
+        }
+    }
+
+    rxFrameStats.frameCount++;
+    rxFrameStats.lastFrameAt = now;
+
+    frameLengths[receiveIndex] = length;
+    frameEndTimes[receiveIndex] = now;
+    readyIndex = receiveIndex;
+    receiveIndex ^= 1;
+}
+
+// Receive ISR callback
+static void rxFrameDataReceive(uint16_t c)
+{
+    const rxFrameDescriptor_t *descriptor = activeDescriptor;
+    const uint32_t now = micros();
+
+    if (!descriptor) {
+        return;
+    }
+
+    if (framePosition > 0 && (now - lastByteAt) >= descriptor->interFrameGapUs) {
+        rxFrameStats.corruptFrameCount++;
+        framePosition = 0;
+    }
+    lastByteAt = now;
+
+    if (framePosition == 0) {
+        if (!rxFrameSyncByteMatches(descriptor, c)) {
+            return;
+        }
+        frameSize = descriptor->frameSize;
+    }
+
+    uint8_t *frame = frameBuffer[receiveIndex];
+    frame[framePosition++] = (uint8_t)c;
+
+    if (descriptor->lengthMask && framePosition == descriptor->lengthOffset + 1) {
+        frameSize = rxFrameSize(descriptor, frame);
+        if (!frameSize) {
+            rxFrameStats.corruptFrameCount++;
+            framePosition = 0;
+            return;
+        }
+    }
+
+    if (framePosition == frameSize) {
+        framePosition = 0;
+        rxFrameComplete(frameSize, now);
+    }
+}
+
+// Receive ISR frame callback
+static void rxFrameReceive(const uint8_t *frame, uint8_t length, uint32_t frameEndAt)
+{
+    const rxFrameDescriptor_t *descriptor = activeDescriptor;
+
+    if (!descriptor) {
+        return;
+    }
+
+    if (length <= descriptor->lengthOffset || !rxFrameSyncByteMatches(descriptor, frame[0]) || rxFrameSize(descriptor, frame) != length) {
+        rxFrameStats.corruptFrameCount++;
+        return;
+    }
+
+    memcpy(frameBuffer[receiveIndex], frame, length);
+    rxFrameComplete(length, frameEndAt);
+}
+
+static bool rxFrameChecksumIsValid(uint8_t checksum, const uint8_t *frame, uint8_t length)
+{
+    switch (checksum) {
+        case RX_FRAME_CHECKSUM_CRC16_CCITT: {
+            uint16_t crc = 0;
+            for (int i = 0; i < length; i++) {
+                crc = crc16_CCITT(crc, frame[i]);
+            }
+            return crc == 0;
+        }
+        case RX_FRAME_CHECKSUM_CRC8_DALLAS: {
+            uint8_t crc = 0;
+            for (int i = 0; i < length - 1; i++) {
+                crc = crc8_dallas(crc, frame[i]);
+            }
+            return crc == frame[length - 1];
+        }
+        case RX_FRAME_CHECKSUM_IBUS: {
+            uint16_t sum = 0xFFFF;
+            for (int i = 0; i < length - 2; i++) {
+                sum -= frame[i];
+            }
+            return sum == (frame[length - 2] | (frame[length - 1] << 8));
+        }
+        default:
+            return true;
+    }
+}
+
+/*
+ * Returns the last frame received if it wasn't returned already and the checksum is good, NULL otherwise.  The frame
+ * is valid while the next frame is received into the other buffer, it is overwritten as soon as the frame after that
+ * starts, so decode it straight away.
+ */
+const uint8_t *rxFrameGet(const rxFrameDescriptor_t *descriptor, uint8_t *length)
+{
+    // also protects a protocol that wasn't initialised, see serialRxFrameStatus()
+    if (descriptor != activeDescriptor) {
+        return NULL;
+    }
+
+    // take the frame in one step, a frame completed by the ISR meanwhile is returned by the next call
+    const uint8_t index = ATOMIC_XCHG(&readyIndex, RX_FRAME_NONE);
+    if (index == RX_FRAME_NONE) {
+        return NULL;
+    }
+
+    const uint8_t *frame = frameBuffer[index];
+
+    if (!rxFrameChecksumIsValid(descriptor->checksum, frame, frameLengths[index])) {
+        rxFrameStats.checksumErrorCount++;
+        return NULL;
+    }
+
+    *length = frameLengths[index];
+    rxFrameTime = frameEndTimes[index];
+    return frame;
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+/*
+ * Common framing for the serial receivers.
+ *
+ * A protocol describes its frames with an rxFrameDescriptor_t and opens the receiver port with rxFrameOpenPort().  The
+ * bytes or the idle line delimited frames from the port are assembled into frames, checked for the sync byte, the
+ * length and the checksum, and counted.  The protocol's xxxFrameStatus() gets each good frame with rxFrameGet() and
+ * decodes it in place in task context.
+ *
+ * Only one serial receiver is active, so the frame buffers and the counters are shared by all the protocols.
+ */
+
+#define RX_FRAME_SIZE_MAX 64              // the largest serial receiver frame, CRSF_FRAME_SIZE_MAX
+
+typedef enum {
+    RX_FRAME_CHECKSUM_NONE = 0,
+    RX_FRAME_CHECKSUM_CRC16_CCITT,      // big endian CRC16 CCITT of the frame, the CRC of the whole frame is 0
+    RX_FRAME_CHECKSUM_CRC8_DALLAS,      // the last byte is the CRC8 (Dallas/Maxim) of the bytes before it
+    RX_FRAME_CHECKSUM_IBUS,             // little endian 0xFFFF minus the sum of the bytes before it
+} rxFrameChecksum_e;
+
+typedef struct rxFrameDescriptor_s {
+    uint8_t syncByte;                   // first byte of each frame
+    uint8_t syncByteMask;               // bits of the first byte that must match syncByte, 0 for frames without one
+    uint8_t frameSize;                  // size of a fixed size frame, or of the frame without the variable part
+    uint8_t frameSizeMax;               // at most RX_FRAME_SIZE_MAX
+    uint8_t lengthOffset;               // variable size frames are frameSize + (frame[lengthOffset] & lengthMask) * lengthMultiplier
+    uint8_t lengthMask;                 // 0 for fixed size frames
+    uint8_t lengthMultiplier;
+    uint8_t checksum;                   // see rxFrameChecksum_e
+    uint16_t interFrameGapUs;           // a pause this long between two bytes starts a new frame
+} rxFrameDescriptor_t;
+
+typedef struct rxFrameStats_s {
+    uint32_t frameCount;                // complete frames, good or not
+    uint32_t corruptFrameCount;         // wrong sync byte or length, or cut short by a pause
+    uint32_t checksumErrorCount;
+    uint32_t lostFrameCount;            // frames the receiver flagged as lost, counted by the protocol
+    uint32_t lastFrameAt;               // micros() at the end of the last frame
+    uint16_t frameIntervalMin;          // us
+    uint16_t frameIntervalMax;          // us
+    uint16_t frameIntervalAverage;      // us
+} rxFrameStats_t;
+
+serialPort_t *rxFrameOpenPort(const rxFrameDescriptor_t *descriptor, uint32_t baudRate, portMode_t mode, portOptions_t options);
+
+const uint8_t *rxFrameGet(const rxFrameDescriptor_t *descriptor, uint8_t *length);
+void rxFrameCountLost(void);
+
+const rxFrameStats_t *rxFrameGetStats(void);
+void rxFrameResetStats(void);
+bool rxFrameIsActive(void);
@@ -31,12 +31,12 @@
 #include "drivers/light_led.h"
 
 #include "drivers/serial.h"
-#include "drivers/serial_uart.h"
 #include "io/serial.h"
 
 #include "fc/config.h"
 
 #include "rx/rx.h"
+#include "rx/rx_frame.h"
 #include "rx/spektrum.h"
 
 // driver for spektrum satellite receiver / sbus
@@ -50,14 +50,19 @@
 
 #define SPEKTRUM_BAUDRATE 115200
 
+// no sync byte or checksum, the frames are delimited by the pause between them
+static const rxFrameDescriptor_t spektrumFrameDescriptor = {
+    .syncByteMask = 0,
+    .frameSize = SPEK_FRAME_SIZE,
+    .frameSizeMax = SPEK_FRAME_SIZE,
+    .checksum = RX_FRAME_CHECKSUM_NONE,
+    .interFrameGapUs = SPEKTRUM_NEEDED_FRAME_INTERVAL,
+};
+
 static uint8_t spek_chan_shift;
 static uint8_t spek_chan_mask;
-static bool rcFrameComplete = false;
 static bool spekHiRes = false;
 
-static volatile uint8_t spekFrame[SPEK_FRAME_SIZE];
-
-static void spektrumDataReceive(uint16_t c);
 static uint16_t spektrumReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
 static rxRuntimeConfig_t *rxRuntimeConfigPtr;
@@ -86,39 +91,7 @@ bool spektrumInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback
     if (callback)
         *callback = spektrumReadRawRC;
 
-    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
-    if (!portConfig) {
-        return false;
-    }
-
-    serialPort_t *spektrumPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, spektrumDataReceive, SPEKTRUM_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
-
-    return spektrumPort != NULL;
-}
-
-// Receive ISR callback
-static void spektrumDataReceive(uint16_t c)
-{
-    uint32_t spekTime, spekTimeInterval;
-    static uint32_t spekTimeLast = 0;
-    static uint8_t spekFramePosition = 0;
-
-    spekTime = micros();
-    spekTimeInterval = spekTime - spekTimeLast;
-    spekTimeLast = spekTime;
-
-    if (spekTimeInterval > SPEKTRUM_NEEDED_FRAME_INTERVAL) {
-        spekFramePosition = 0;
-    }
-
-    if (spekFramePosition < SPEK_FRAME_SIZE) {
-        spekFrame[spekFramePosition++] = (uint8_t)c;
-        if (spekFramePosition == SPEK_FRAME_SIZE) {
-            rcFrameComplete = true;
-        } else {
-            rcFrameComplete = false;
-        }
-    }
+    return rxFrameOpenPort(&spektrumFrameDescriptor, SPEKTRUM_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED) != NULL;
 }
 
 static uint32_t spekChannelData[SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT];
@@ -126,13 +99,13 @@ static uint32_t spekChannelData[SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT];
 uint8_t spektrumFrameStatus(void)
 {
     uint8_t b;
+    uint8_t length;
 
-    if (!rcFrameComplete) {
+    const uint8_t *spekFrame = rxFrameGet(&spektrumFrameDescriptor, &length);
+    if (!spekFrame) {
         return SERIAL_RX_FRAME_PENDING;
     }
 
-    rcFrameComplete = false;
-
     for (b = 3; b < SPEK_FRAME_SIZE; b += 2) {
         uint8_t spekChannel = 0x0F & (spekFrame[b - 1] >> spek_chan_shift);
         if (spekChannel < rxRuntimeConfigPtr->channelCount && spekChannel < SPEKTRUM_MAX_SUPPORTED_CHANNEL_COUNT) {
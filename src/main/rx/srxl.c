@@ -27,15 +27,12 @@
 #include "drivers/system.h"
 
 #include "drivers/serial.h"
-#include "drivers/dma.h"
-#include "drivers/serial_uart.h"
 #include "io/serial.h"
 
 #include "rx/rx.h"
+#include "rx/rx_frame.h"
 #include "rx/srxl.h"
 
-#include "common/crc.h"
-
 
 
 #define SRXL_CHANNEL_COUNT_A1 12
@@ -71,121 +68,64 @@
 // Use formula: 800 + value * 1400 / 4096 (i.e. a shift by 12)
 #define SRXL_CONVERT_TO_USEC(V)	(800 + ((V * 1400) >> 12))
 
-static bool srxlFrameReceived = false;
-static bool srxlDataIncoming = false;
-static uint8_t srxlFramePosition;
-static uint8_t srxlFrameLength;
-static uint8_t srxlChannelCount;
-
-static void srxlDataReceive(uint16_t c);
+// The low nibble of the start byte gives the number of channels, 0xA1 is 27 and 0xA2 is 35 bytes
+static const rxFrameDescriptor_t srxlFrameDescriptor = {
+    .syncByte = 0xA0,
+    .syncByteMask = 0xFC,
+    .frameSize = SRXL_FRAME_SIZE_A1 - 8,
+    .frameSizeMax = SRXL_FRAME_SIZE_A2,
+    .lengthOffset = 0,
+    .lengthMask = 0x03,
+    .lengthMultiplier = 8,
+    .checksum = RX_FRAME_CHECKSUM_CRC16_CCITT,
+    .interFrameGapUs = SRXL_MAX_FRAME_TIME,
+};
 
-// Use max values for ram areas
-static volatile uint8_t srxlFrame[SRXL_FRAME_SIZE_A2];	//size 35 for 16 channels in SRXL 0xA2
 static uint16_t srxlChannelData[SRXL_CHANNEL_COUNT_MAX];
 static uint16_t srxlReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
 bool srxlInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
 {
-    uint32_t baudRate;
     rxRuntimeConfig->channelCount = SRXL_CHANNEL_COUNT_MAX;
-    srxlFrameReceived = false;
-    srxlDataIncoming = false;
-    srxlFramePosition = 0;
-    baudRate = SRXL_BAUDRATE;
-    srxlFrameLength = SRXL_FRAME_SIZE_A2;		//default for 12 channel
-    srxlChannelCount = SRXL_CHANNEL_COUNT_MAX;
 
     if (callback) {
         *callback = srxlReadRawRC;
     }
 
-    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
-    if (!portConfig) {
-        return false;
-    }
-
-    serialPort_t *srxlPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, srxlDataReceive, baudRate, MODE_RX, SERIAL_NOT_INVERTED);
-
-    return srxlPort != NULL;
-}
-
-
-// Receive ISR callback
-static void srxlDataReceive(uint16_t c)
-{
-    uint32_t now;
-    static uint32_t srxlTimeLast, srxlTimeInterval;
-
-    // Check if we shall reset frame position due to time
-    now = micros();
-    srxlTimeInterval = now - srxlTimeLast;
-    srxlTimeLast = now;
-    if (srxlTimeInterval > SRXL_MAX_FRAME_TIME) {
-        srxlFramePosition = 0;
-        srxlDataIncoming = false;
-    }
-
-    // Check if we shall start a frame?
-    if (srxlFramePosition == 0)	{
-        if (c == SRXL_START_OF_FRAME_BYTE_A1) {
-    		    srxlDataIncoming = true;
-    		    srxlFrameLength = SRXL_FRAME_SIZE_A1;	//decrease framesize (when receiver change, otherwise board must reboot)
-            srxlChannelCount = SRXL_CHANNEL_COUNT_A1;
-        }
-        else if (c == SRXL_START_OF_FRAME_BYTE_A2) {//16channel packet
-    		    srxlDataIncoming = true;
-    		    srxlFrameLength = SRXL_FRAME_SIZE_A2;	//increase framesize
-			      srxlChannelCount = SRXL_CHANNEL_COUNT_A2;
-        }
-    }
-
-    // Only do this if we are receiving to a frame
-    if (srxlDataIncoming == true) {
-        // Store in frame copy
-        srxlFrame[srxlFramePosition] = (uint8_t)c;
-        srxlFramePosition++;
-    }
-
-    // Done?
-    if (srxlFramePosition == srxlFrameLength) {
-        srxlFrameReceived = true;
-        srxlDataIncoming = false;
-        srxlFramePosition = 0;
-    }
+    return rxFrameOpenPort(&srxlFrameDescriptor, SRXL_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED) != NULL;
 }
 
-// Indicate time to read a frame from the data...
 uint8_t srxlFrameStatus(void)
 {
     uint8_t i = 0;
     uint16_t value;
     uint8_t frameAddr;
-    uint16_t crc_calc = 0;
+    uint8_t srxlChannelCount;
+    uint8_t length;
 
-    if (!srxlFrameReceived) {
+    const uint8_t *srxlFrame = rxFrameGet(&srxlFrameDescriptor, &length);
+    if (!srxlFrame) {
         return SERIAL_RX_FRAME_PENDING;
     }
 
-    srxlFrameReceived = false;
-	   //is CRC OK
-    for (i = 0; i < srxlFrameLength; i++) {
-        crc_calc =  crc16_CCITT(crc_calc, srxlFrame[i]);
-        }
-
-     //crc_calc is 0 if crc check is OK
-     if(crc_calc == 0) {
-		      // save data
-        for (i = 0; i < srxlChannelCount; i++) {
-            frameAddr = 1 + i * 2;
-            value = ((uint16_t)srxlFrame[frameAddr]) << 8;
-            value = value + ((uint16_t)srxlFrame[frameAddr + 1]);
-
-            // Convert to internal format
-            srxlChannelData[i] = SRXL_CONVERT_TO_USEC(value);
-        }
-        return SERIAL_RX_FRAME_COMPLETE;
+    if (srxlFrame[0] == SRXL_START_OF_FRAME_BYTE_A1) {
+        srxlChannelCount = SRXL_CHANNEL_COUNT_A1;
+    } else if (srxlFrame[0] == SRXL_START_OF_FRAME_BYTE_A2) {
+        srxlChannelCount = SRXL_CHANNEL_COUNT_A2;
+    } else {
+        return SERIAL_RX_FRAME_PENDING;
+    }
+
+    // save data
+    for (i = 0; i < srxlChannelCount; i++) {
+        frameAddr = 1 + i * 2;
+        value = ((uint16_t)srxlFrame[frameAddr]) << 8;
+        value = value + ((uint16_t)srxlFrame[frameAddr + 1]);
+
+        // Convert to internal format
+        srxlChannelData[i] = SRXL_CONVERT_TO_USEC(value);
     }
-    return SERIAL_RX_FRAME_PENDING;
+    return SERIAL_RX_FRAME_COMPLETE;
 }
 
 static uint16_t srxlReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
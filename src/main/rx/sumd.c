@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <platform.h>
 
@@ -25,14 +26,13 @@
 
 #include "config/parameter_group.h"
 
-#include "drivers/dma.h"
 #include "drivers/system.h"
 
 #include "drivers/serial.h"
-#include "drivers/serial_uart.h"
 #include "io/serial.h"
 
 #include "rx/rx.h"
+#include "rx/rx_frame.h"
 #include "rx/sumd.h"
 
 // driver for SUMD receiver using UART2
@@ -45,11 +45,30 @@
 
 #define SUMD_BAUDRATE 115200
 
-static bool sumdFrameDone = false;
+#define SUMD_OFFSET_STATUS 1
+#define SUMD_OFFSET_CHANNEL_COUNT 2
+#define SUMD_OFFSET_CHANNEL_1_HIGH 3
+#define SUMD_OFFSET_CHANNEL_1_LOW 4
+#define SUMD_BYTES_PER_CHANNEL 2
+
+#define SUMD_FRAME_STATE_OK 0x01
+#define SUMD_FRAME_STATE_FAILSAFE 0x81
+
+// header, channels and the CRC16 of the header and channels
+static const rxFrameDescriptor_t sumdFrameDescriptor = {
+    .syncByte = SUMD_SYNCBYTE,
+    .syncByteMask = 0xFF,
+    .frameSize = 5,
+    .frameSizeMax = SUMD_BUFFSIZE,
+    .lengthOffset = SUMD_OFFSET_CHANNEL_COUNT,
+    .lengthMask = 0xFF,
+    .lengthMultiplier = SUMD_BYTES_PER_CHANNEL,
+    .checksum = RX_FRAME_CHECKSUM_CRC16_CCITT,
+    .interFrameGapUs = 4000,
+};
+
 static uint16_t sumdChannels[SUMD_MAX_CHANNEL];
-static uint16_t crc;
 
-static void sumdDataReceive(uint16_t c);
 static uint16_t sumdReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
 bool sumdInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
@@ -59,96 +78,21 @@ bool sumdInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
 
     rxRuntimeConfig->channelCount = SUMD_MAX_CHANNEL;
 
-    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
-    if (!portConfig) {
-        return false;
-    }
-
-    serialPort_t *sumdPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, sumdDataReceive, SUMD_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
-
-    return sumdPort != NULL;
-}
-
-#define CRC_POLYNOME 0x1021
-
-// CRC calculation, adds a 8 bit unsigned to 16 bit crc
-static void CRC16(uint8_t value)
-{
-    uint8_t i;
-
-    crc = crc ^ (int16_t)value << 8;
-    for (i = 0; i < 8; i++) {
-    if (crc & 0x8000)
-        crc = (crc << 1) ^ CRC_POLYNOME;
-    else
-        crc = (crc << 1);
-    }
-}
-
-static uint8_t sumd[SUMD_BUFFSIZE] = { 0, };
-static uint8_t sumdChannelCount;
-
-// Receive ISR callback
-static void sumdDataReceive(uint16_t c)
-{
-    uint32_t sumdTime;
-    static uint32_t sumdTimeLast;
-    static uint8_t sumdIndex;
-
-    sumdTime = micros();
-    if ((sumdTime - sumdTimeLast) > 4000)
-        sumdIndex = 0;
-    sumdTimeLast = sumdTime;
-
-    if (sumdIndex == 0) {
-        if (c != SUMD_SYNCBYTE)
-            return;
-        else
-        {
-            sumdFrameDone = false; // lazy main loop didnt fetch the stuff
-            crc = 0;
-        }
-    }
-    if (sumdIndex == 2)
-        sumdChannelCount = (uint8_t)c;
-    if (sumdIndex < SUMD_BUFFSIZE)
-        sumd[sumdIndex] = (uint8_t)c;
-    sumdIndex++;
-    if (sumdIndex < sumdChannelCount * 2 + 4)
-        CRC16((uint8_t)c);
-    else
-        if (sumdIndex == sumdChannelCount * 2 + 5) {
-            sumdIndex = 0;
-            sumdFrameDone = true;
-        }
+    return rxFrameOpenPort(&sumdFrameDescriptor, SUMD_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED) != NULL;
 }
 
-#define SUMD_OFFSET_CHANNEL_1_HIGH 3
-#define SUMD_OFFSET_CHANNEL_1_LOW 4
-#define SUMD_BYTES_PER_CHANNEL 2
-
-
-#define SUMD_FRAME_STATE_OK 0x01
-#define SUMD_FRAME_STATE_FAILSAFE 0x81
-
 uint8_t sumdFrameStatus(void)
 {
     uint8_t channelIndex;
+    uint8_t frameStatus;
+    uint8_t length;
 
-    uint8_t frameStatus = SERIAL_RX_FRAME_PENDING;
-
-    if (!sumdFrameDone) {
-        return frameStatus;
+    const uint8_t *sumd = rxFrameGet(&sumdFrameDescriptor, &length);
+    if (!sumd) {
+        return SERIAL_RX_FRAME_PENDING;
     }
 
-    sumdFrameDone = false;
-
-    // verify CRC
-    if (crc != ((sumd[SUMD_BYTES_PER_CHANNEL * sumdChannelCount + SUMD_OFFSET_CHANNEL_1_HIGH] << 8) |
-            (sumd[SUMD_BYTES_PER_CHANNEL * sumdChannelCount + SUMD_OFFSET_CHANNEL_1_LOW])))
-        return frameStatus;
-
-    switch (sumd[1]) {
+    switch (sumd[SUMD_OFFSET_STATUS]) {
         case SUMD_FRAME_STATE_FAILSAFE:
             frameStatus = SERIAL_RX_FRAME_COMPLETE | SERIAL_RX_FRAME_FAILSAFE;
             break;
@@ -156,9 +100,10 @@ uint8_t sumdFrameStatus(void)
             frameStatus = SERIAL_RX_FRAME_COMPLETE;
             break;
         default:
-            return frameStatus;
+            return SERIAL_RX_FRAME_PENDING;
     }
 
+    uint8_t sumdChannelCount = sumd[SUMD_OFFSET_CHANNEL_COUNT];
     if (sumdChannelCount > SUMD_MAX_CHANNEL)
         sumdChannelCount = SUMD_MAX_CHANNEL;
 
@@ -24,6 +24,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <platform.h>
 
@@ -54,6 +55,7 @@ static uint8_t sumhFrame[SUMH_FRAME_SIZE];
 static uint32_t sumhChannels[SUMH_MAX_CHANNEL_COUNT];
 
 static void sumhDataReceive(uint16_t c);
+static void sumhFrameReceive(const uint8_t *frame, uint8_t length, uint32_t frameEndAt);
 static uint16_t sumhReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
 static serialPort_t *sumhPort;
@@ -79,8 +81,14 @@ bool sumhInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
     }
 
     sumhPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, sumhDataReceive, SUMH_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
+    if (!sumhPort) {
+        return false;
+    }
 
-    return sumhPort != NULL;
+    // receive whole frames when the port can delimit them, otherwise byte by byte
+    serialSetReceiveFrameCallback(sumhPort, sumhFrameReceive);
+
+    return true;
 }
 
 // Receive ISR callback
@@ -101,11 +109,24 @@ static void sumhDataReceive(uint16_t c)
     if (sumhFramePosition == SUMH_FRAME_SIZE - 1) {
         // FIXME at this point the value of 'c' is unused and un tested, what should it be, is it important?
         sumhFrameDone = true;
+        rxFrameTime = sumhTime;
     } else {
         sumhFramePosition++;
     }
 }
 
+// Receive ISR frame callback
+static void sumhFrameReceive(const uint8_t *frame, uint8_t length, uint32_t frameEndAt)
+{
+    if (length != SUMH_FRAME_SIZE) {
+        return;
+    }
+
+    memcpy(sumhFrame, frame, SUMH_FRAME_SIZE);
+    sumhFrameDone = true;
+    rxFrameTime = frameEndAt;
+}
+
 uint8_t sumhFrameStatus(void)
 {
     uint8_t channelIndex;
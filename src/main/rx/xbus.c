@@ -23,14 +23,13 @@
 
 #include "config/parameter_group.h"
 
-#include "drivers/dma.h"
 #include "drivers/system.h"
 
 #include "drivers/serial.h"
-#include "drivers/serial_uart.h"
 #include "io/serial.h"
 
 #include "rx/rx.h"
+#include "rx/rx_frame.h"
 #include "rx/xbus.h"
 
 #include "common/crc.h"
@@ -43,7 +42,6 @@
 #define XBUS_RJ01_OFFSET_BYTES 3
 
 #define XBUS_MESSAGE_LENGTH_POSITION 1
-#define XBUS_BAUDRATE 115200
 #define XBUS_RJ01_BAUDRATE 250000
 #define XBUS_MAX_FRAME_TIME 8000
 
@@ -57,73 +55,35 @@
 // Use formula: 800 + value * 1400 / 4096 (i.e. a shift by 12)
 #define XBUS_CONVERT_TO_USEC(V)	(800 + ((V * 1400) >> 12))
 
-static bool xBusFrameReceived = false;
-static bool xBusDataIncoming = false;
-static uint8_t xBusFramePosition;
-static uint8_t xBusFrameLength;
-static uint8_t xBusChannelCount;
+// The outer frame of the RJ01, the length byte counts all but 3 bytes of the frame
+static const rxFrameDescriptor_t xBusFrameDescriptor = {
+    .syncByte = XBUS_START_OF_FRAME_BYTE,
+    .syncByteMask = 0xFF,
+    .frameSize = XBUS_RJ01_OFFSET_BYTES,
+    .frameSizeMax = XBUS_MAX_FRAME_SIZE,
+    .lengthOffset = XBUS_MESSAGE_LENGTH_POSITION,
+    .lengthMask = 0xFF,
+    .lengthMultiplier = 1,
+    .checksum = RX_FRAME_CHECKSUM_CRC8_DALLAS,
+    .interFrameGapUs = XBUS_MAX_FRAME_TIME,
+};
 
-
-// Use max values for ram areas
-static volatile uint8_t xBusFrame[XBUS_MAX_FRAME_SIZE];
 static uint16_t xBusChannelData[XBUS_RJ01_CHANNEL_COUNT];
 
-static void xBusDataReceive(uint16_t c);
 static uint16_t xBusReadRawRC(rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan);
 
 bool xBusInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback)
 {
-    uint32_t baudRate;
-
-
     rxRuntimeConfig->channelCount = XBUS_RJ01_CHANNEL_COUNT;
-    xBusFrameReceived = false;
-    xBusDataIncoming = false;
-    xBusFramePosition = 0;
-    baudRate = XBUS_RJ01_BAUDRATE;
-    xBusChannelCount = XBUS_RJ01_CHANNEL_COUNT;
-    
-    
 
     if (callback) {
         *callback = xBusReadRawRC;
     }
 
-    serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
-    if (!portConfig) {
-        return false;
-    }
-
-    serialPort_t *xBusPort = openSerialPort(portConfig->identifier, FUNCTION_RX_SERIAL, xBusDataReceive, baudRate, MODE_RX, SERIAL_NOT_INVERTED);
-
-    return xBusPort != NULL;
-}
-
-// Full Xbus message CRC8 calculations
-uint8_t xBusCRC8(uint8_t inData, uint8_t seed)
-{
-    uint8_t bitsLeft;
-    uint8_t temp;
-
-    for (bitsLeft = 8; bitsLeft > 0; bitsLeft--) {
-        temp = ((seed ^ inData) & 0x01);
-
-        if (temp == 0) {
-            seed >>= 1;
-        } else {
-            seed ^= 0x18;
-            seed >>= 1;
-            seed |= 0x80;
-        }
-
-        inData >>= 1;
-    }
-
-    return seed;
+    return rxFrameOpenPort(&xBusFrameDescriptor, XBUS_RJ01_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED) != NULL;
 }
 
-
-static void xBusUnpackModeBFrame(uint8_t offsetBytes)
+static bool xBusUnpackModeBFrame(const uint8_t *xBusFrame)
 {
     // Calculate the CRC of the incoming frame
     uint16_t crc = 0;
@@ -133,31 +93,29 @@ static void xBusUnpackModeBFrame(uint8_t offsetBytes)
 
     // crc should be 0, if we have no biterrors
     for (i = 0; i < XBUS_FRAME_SIZE; i++) {
-        crc = crc16_CCITT(crc, xBusFrame[i+offsetBytes]);
+        crc = crc16_CCITT(crc, xBusFrame[i]);
     }
 
+    if (crc != 0) {
+        return false;
+    }
 
-    if (crc == 0) {
-        // Unpack the data, we have a valid frame, only 12 channel unpack also when receive 16 channel
-        for (i = 0; i < xBusChannelCount; i++) {
-
-            frameAddr = offsetBytes + 1 + i * 2;
-            value = ((uint16_t)xBusFrame[frameAddr]) << 8;
-            value = value + ((uint16_t)xBusFrame[frameAddr + 1]);
+    // Unpack the data, we have a valid frame, only 12 channel unpack also when receive 16 channel
+    for (i = 0; i < XBUS_RJ01_CHANNEL_COUNT; i++) {
 
-            // Convert to internal format
-            xBusChannelData[i] = XBUS_CONVERT_TO_USEC(value);
-        }
+        frameAddr = 1 + i * 2;
+        value = ((uint16_t)xBusFrame[frameAddr]) << 8;
+        value = value + ((uint16_t)xBusFrame[frameAddr + 1]);
 
+        // Convert to internal format
+        xBusChannelData[i] = XBUS_CONVERT_TO_USEC(value);
     }
-
+    return true;
 }
 
-static void xBusUnpackRJ01Frame(void)
+uint8_t xBusFrameStatus(void)
 {
-    // Calculate the CRC of the incoming frame
-    uint8_t outerCrc = 0;
-    uint8_t i = 0;
+    uint8_t length;
 
     // When using the Align RJ01 receiver with
     // a MODE B setting in the radio (XG14 tested)
@@ -173,87 +131,18 @@ static void xBusUnpackRJ01Frame(void)
     // of the RJ01 MODEB packages are discarded.
     // However, the LAST byte (CRC_OUTER) is infact an 8-bit
     // CRC for the whole package, using the Dallas-One-Wire CRC
-    // method.
+    // method, checked with the frame.
+    const uint8_t *xBusFrame = rxFrameGet(&xBusFrameDescriptor, &length);
 
-    // CRC calculation & check for full message (CRC_OUTER)
-    //
-    for (i = 0; i < xBusFrameLength - 1; i++) {
-        outerCrc = xBusCRC8(outerCrc, xBusFrame[i]);
-    }
-
-    if (outerCrc != xBusFrame[xBusFrameLength - 1])
-    {
-        // CRC does not match, skip this frame
-        return;
+    if (!xBusFrame || length < XBUS_RJ01_OFFSET_BYTES + XBUS_FRAME_SIZE + 1) {
+        return SERIAL_RX_FRAME_PENDING;
     }
 
     // Now unpack the "embedded MODE B frame"
-    xBusUnpackModeBFrame(XBUS_RJ01_OFFSET_BYTES);
-}
-
-// Receive ISR callback
-static void xBusDataReceive(uint16_t c)
-{
-    uint32_t now;
-    static uint32_t xBusTimeLast, xBusTimeInterval;
-
-    // Check if we shall reset frame position due to time
-    now = micros();
-    xBusTimeInterval = now - xBusTimeLast;
-    xBusTimeLast = now;
-    if (xBusTimeInterval > XBUS_MAX_FRAME_TIME) {
-        xBusFramePosition = 0;
-        xBusDataIncoming = false;
-    }
-
-    // Too long message?
-    if (xBusFramePosition >= XBUS_MAX_FRAME_SIZE) {
-        // Something wrong...stop in order to avoid
-        // overwriting the buffer
-        xBusFramePosition = 0;
-        xBusDataIncoming = false;
-    }
-
-    // Check if we shall start a frame?
-    if ((xBusFramePosition == 0) && (c == XBUS_START_OF_FRAME_BYTE)) {
-        xBusDataIncoming = true;
-    }
-
-    // Only do this if we are receiving to a frame
-    if (xBusDataIncoming == true) {
-        // Store in frame buffer
-        xBusFrame[xBusFramePosition] = (uint8_t)c;
-
-        // Figure out the FRAME LENGTH (it might vary depending on receiver)
-        // Note: This is only in XBUS_RJ01 mode.
-        if (xBusFramePosition == XBUS_MESSAGE_LENGTH_POSITION) {
-            xBusFrameLength = xBusFrame[xBusFramePosition]
-                              + XBUS_RJ01_OFFSET_BYTES;
-        }
-
-        xBusFramePosition++;
-    }
-
-    // Done?
-    if (xBusFramePosition == xBusFrameLength) {
-        xBusFrameReceived = true;
-    }
-}
-
-// Indicate time to read a frame from the data...
-uint8_t xBusFrameStatus(void)
-{
-    if (!xBusFrameReceived) {
+    if (!xBusUnpackModeBFrame(&xBusFrame[XBUS_RJ01_OFFSET_BYTES])) {
         return SERIAL_RX_FRAME_PENDING;
     }
 
-    xBusUnpackRJ01Frame();
-
-    xBusDataIncoming = false;
-    xBusFramePosition = 0;
-
-    xBusFrameReceived = false;
-
     return SERIAL_RX_FRAME_COMPLETE;
 }
 
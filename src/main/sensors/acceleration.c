@@ -23,6 +23,7 @@
 #include "build/build_config.h"
 
 #include "common/axis.h"
+#include "common/maths.h"
 
 #include "config/parameter_group.h"
 #include "config/parameter_group_ids.h"
@@ -68,6 +69,7 @@ void pgResetFn_accelerometerConfig(accelerometerConfig_t *instance)
 }
 
 int32_t accADC[XYZ_AXIS_COUNT];
+uint32_t accClipCount = 0;      // number of readings where at least one axis was at the limit of the sensor range
 
 acc_t acc;                       // acc access functions
 sensor_align_e accAlign = 0;
@@ -195,6 +197,29 @@ void applyAccelerationTrims(flightDynamicsTrims_t *accelerationTrims)
     accADC[Z] -= accelerationTrims->raw[Z];
 }
 
+// Raw readings within 1/32 of the full scale of the sensor are assumed to be saturated
+#define ACC_CLIPPING_MARGIN_SHIFT 5
+// used when the driver doesn't give the full scale
+#define ACC_CLIPPING_THRESHOLD_DEFAULT 32000
+
+static void detectClipping(int16_t *accADCRaw)
+{
+    int axis;
+    int32_t threshold = ACC_CLIPPING_THRESHOLD_DEFAULT;
+
+    if (acc.acc_range) {
+        const int32_t fullScale = (int32_t)acc.acc_1G * acc.acc_range;
+        threshold = MIN(fullScale - (fullScale >> ACC_CLIPPING_MARGIN_SHIFT), ACC_CLIPPING_THRESHOLD_DEFAULT);
+    }
+
+    for (axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if (ABS(accADCRaw[axis]) >= threshold) {
+            accClipCount++;
+            return;
+        }
+    }
+}
+
 static void convertRawACCADCReadingsToInternalType(int16_t *accADCRaw)
 {
     int axis;
@@ -212,6 +237,7 @@ void updateAccelerationReadings(rollAndPitchTrims_t *rollAndPitchTrims)
         return;
     }
 
+    detectClipping(accADCRaw);
     convertRawACCADCReadingsToInternalType(accADCRaw);
 
     alignSensors(accADC, accADC, accAlign);
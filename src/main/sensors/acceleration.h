@@ -37,6 +37,7 @@ extern sensor_align_e accAlign;
 extern acc_t acc;
 
 extern int32_t accADC[XYZ_AXIS_COUNT];
+extern uint32_t accClipCount;
 
 typedef struct rollAndPitchTrims_s {
     int16_t roll;
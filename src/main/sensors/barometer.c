@@ -45,17 +45,16 @@ int32_t BaroAlt = 0;
 
 #ifdef BARO
 
-PG_REGISTER_PROFILE_WITH_RESET_TEMPLATE(barometerConfig_t, barometerConfig, PG_BAROMETER_CONFIG, 0);
+PG_REGISTER_PROFILE_WITH_RESET_TEMPLATE(barometerConfig_t, barometerConfig, PG_BAROMETER_CONFIG, 1);
 
 static int32_t baroGroundAltitude = 0;
 static int32_t baroGroundPressure = 0;
 static uint32_t baroPressureSum = 0;
+static uint32_t baroSampleAt = 0;
 
 PG_RESET_TEMPLATE(barometerConfig_t, barometerConfig,
     .baro_sample_count = 21,
     .baro_noise_lpf = 0.6f,
-    .baro_cf_vel = 0.985f,
-    .baro_cf_alt = 0.965f,
 );
 
 
@@ -149,12 +148,19 @@ uint32_t baroUpdate(void)
             baro.start_ut();
             baro.calculate(&baroPressure, &baroTemperature);
             baroPressureSum = recalculateBarometerTotal(barometerConfig()->baro_sample_count, baroPressureSum, baroPressure);
+            baroSampleAt = micros();
             state = BAROMETER_NEEDS_SAMPLES;
             return baro.ut_delay;
         break;
     }
 }
 
+// the time of the last pressure sample, in microseconds
+uint32_t baroGetLatestSampleTime(void)
+{
+    return baroSampleAt;
+}
+
 int32_t baroCalculateAltitude(void)
 {
     int32_t BaroAlt_tmp;
@@ -40,6 +40,7 @@
 #include "io/beeper.h"
 
 #include "sensors/battery.h"
+#include "sensors/battery_estimator.h"
 
 
 // FIXME there is too much going on in here - the code is not re-usable and has lots of shared configuration, suggest splitting into these topics.
@@ -64,10 +65,15 @@ uint16_t amperageLatestADC = 0;     // most recent raw reading from current ADC
 int32_t amperage = 0;               // amperage read by current sensor in centiampere (1/100th A)
 int32_t mAhDrawn = 0;               // milliampere hours drawn from the battery since start
 
+static uint16_t vbatMillivolts = 0;       // most recent unfiltered voltage, used by the estimator
+static uint16_t vbatCompensated = 0;      // sag compensated resting voltage in 0.1V steps
+static uint8_t batteryInitialStateOfCharge = 100;
+
 static batteryState_e batteryState;
 static biquad_t vbatFilterState;
+static batteryEstimator_t batteryEstimator;
 
-PG_REGISTER_WITH_RESET_TEMPLATE(batteryConfig_t, batteryConfig, PG_BATTERY_CONFIG, 0);
+PG_REGISTER_WITH_RESET_TEMPLATE(batteryConfig_t, batteryConfig, PG_BATTERY_CONFIG, 1);
 
 PG_RESET_TEMPLATE(batteryConfig_t, batteryConfig,
     .vbatscale = VBAT_SCALE_DEFAULT,
@@ -78,6 +84,8 @@ PG_RESET_TEMPLATE(batteryConfig_t, batteryConfig,
     .vbatwarningcellvoltage = 35,
     .currentMeterScale = 400, // for Allegro ACS758LCB-100U (40mV/A)
     .currentMeterType = CURRENT_SENSOR_ADC,
+    .vbatsagcompensation = 1,
+    .batteryInternalResistance = 40,
 );
 
 uint16_t batteryAdcToVoltage(uint16_t src)
@@ -87,25 +95,62 @@ uint16_t batteryAdcToVoltage(uint16_t src)
     return ((((uint32_t)src * batteryConfig()->vbatscale * 33 + (0xFFF * 5)) / (0xFFF * batteryConfig()->vbatresdivval)) / batteryConfig()->vbatresdivmultiplier);
 }
 
+// src is an oversampled reading, ADC_OVERSAMPLED_BITS wide, result is in millivolts
+static uint16_t batteryOversampledAdcToMillivolts(uint16_t src)
+{
+    return (((uint64_t)src * batteryConfig()->vbatscale * 3300 + ((0xFFF << ADC_OVERSAMPLE_SHIFT) * 5)) / ((0xFFF << ADC_OVERSAMPLE_SHIFT) * batteryConfig()->vbatresdivval)) / batteryConfig()->vbatresdivmultiplier;
+}
+
 static void updateBatteryVoltage(void)
 {
 #ifdef ADC_BATTERY
     uint16_t vbatSample;
-    // store the battery voltage with some other recent battery voltage readings
-    vbatSample = vbatLatestADC = adcGetChannel(ADC_BATTERY);
+    adcSample_t adcSample;
+
+    // the ADC driver returns the mean of all conversions since the last call
+    adcReadChannel(ADC_BATTERY, &adcSample);
+    vbatMillivolts = batteryOversampledAdcToMillivolts(adcSample.value);
+    vbatSample = vbatLatestADC = adcSample.value >> ADC_OVERSAMPLE_SHIFT;
     vbatSample = applyBiQuadFilter(vbatSample, &vbatFilterState);
     vbat = batteryAdcToVoltage(vbatSample);
 #endif
 }
 
+// the virtual current meter derives the current from the throttle, the pack resistance can't be learnt from that
+static bool isSagCompensationActive(void)
+{
+    return batteryConfig()->vbatsagcompensation && feature(FEATURE_CURRENT_METER) && batteryConfig()->currentMeterType == CURRENT_SENSOR_ADC;
+}
+
+static uint8_t batteryStateOfCharge(uint16_t cellMillivolts)
+{
+    return batteryCellStateOfCharge(cellMillivolts, batteryConfig()->vbatmincellvoltage * 100, batteryConfig()->vbatmaxcellvoltage * 100);
+}
+
+static void updateBatteryEstimator(uint32_t deltaTimeUs)
+{
+    batteryEstimatorUpdate(&batteryEstimator, vbatMillivolts, isSagCompensationActive() ? amperage : 0, deltaTimeUs);
+
+    if (isSagCompensationActive()) {
+        vbatCompensated = (batteryEstimatorRestingVoltage(&batteryEstimator) + 50) / 100;
+    } else {
+        vbatCompensated = vbat;
+    }
+}
+
 #define VBATTERY_STABLE_DELAY 40
 /* Batt Hysteresis of +/-100mV */
 #define VBATT_HYSTERESIS 1
 
 void updateBattery(void)
 {
+    static uint32_t lastUpdateAt = 0;
+    uint32_t now = micros();
+
     updateBatteryVoltage();
-    
+    updateBatteryEstimator(now - lastUpdateAt);
+    lastUpdateAt = now;
+
     /* battery has just been connected*/
     if (batteryState == BATTERY_NOT_PRESENT && vbat > VBATT_PRESENT_THRESHOLD_MV)
     {
@@ -126,6 +171,11 @@ void updateBattery(void)
         batteryCellCount = cells;
         batteryWarningVoltage = batteryCellCount * batteryConfig()->vbatwarningcellvoltage;
         batteryCriticalVoltage = batteryCellCount * batteryConfig()->vbatmincellvoltage;
+
+        // the battery is unloaded at this point so the measured voltage is the resting voltage
+        batteryEstimatorInit(&batteryEstimator, batteryConfig()->batteryInternalResistance);
+        updateBatteryEstimator(0);
+        batteryInitialStateOfCharge = batteryStateOfCharge(vbatMillivolts / batteryCellCount);
     }
     /* battery has been disconnected - can take a while for filter cap to disharge so we use a threshold of VBATT_PRESENT_THRESHOLD_MV */
     else if (batteryState != BATTERY_NOT_PRESENT && vbat <= VBATT_PRESENT_THRESHOLD_MV)
@@ -136,26 +186,27 @@ void updateBattery(void)
         batteryCriticalVoltage = 0;
     }    
 
+    // sag compensation stops punch-outs from triggering alarms
     switch(batteryState)
     {
         case BATTERY_OK:
-            if (vbat <= (batteryWarningVoltage - VBATT_HYSTERESIS)) {
+            if (vbatCompensated <= (batteryWarningVoltage - VBATT_HYSTERESIS)) {
                 batteryState = BATTERY_WARNING;
                 beeper(BEEPER_BAT_LOW);
             }
             break;
         case BATTERY_WARNING:
-            if (vbat <= (batteryCriticalVoltage - VBATT_HYSTERESIS)) {
+            if (vbatCompensated <= (batteryCriticalVoltage - VBATT_HYSTERESIS)) {
                 batteryState = BATTERY_CRITICAL;
                 beeper(BEEPER_BAT_CRIT_LOW);
-            } else if (vbat > (batteryWarningVoltage + VBATT_HYSTERESIS)){
+            } else if (vbatCompensated > (batteryWarningVoltage + VBATT_HYSTERESIS)){
                 batteryState = BATTERY_OK;
             } else {
                 beeper(BEEPER_BAT_LOW);
             }
             break;
         case BATTERY_CRITICAL:
-            if (vbat > (batteryCriticalVoltage + VBATT_HYSTERESIS)){
+            if (vbatCompensated > (batteryCriticalVoltage + VBATT_HYSTERESIS)){
                 batteryState = BATTERY_WARNING;
                 beeper(BEEPER_BAT_LOW);
             } else {
@@ -167,6 +218,25 @@ void updateBattery(void)
     }
 }
 
+uint16_t batteryGetCompensatedVoltage(void)
+{
+    return vbatCompensated;
+}
+
+// per cell sag compensated resting voltage, in millivolts
+uint16_t batteryGetCellVoltage(void)
+{
+    if (!batteryCellCount) {
+        return 0;
+    }
+    return batteryEstimatorRestingVoltage(&batteryEstimator) / batteryCellCount;
+}
+
+uint16_t batteryGetInternalResistance(void)
+{
+    return batteryEstimatorInternalResistance(&batteryEstimator);
+}
+
 batteryState_e getBatteryState(void)
 {
     return batteryState;
@@ -187,15 +257,19 @@ void batteryInit(void)
     batteryCriticalVoltage = 0;
 
     BiQuadNewLpf(VBATT_LPF_FREQ, &vbatFilterState, 50000);
+    batteryEstimatorInit(&batteryEstimator, batteryConfig()->batteryInternalResistance);
+    batteryInitialStateOfCharge = 100;
 
 }
 
 #define ADCVREF 3300   // in mV
+
+// src is an oversampled reading, ADC_OVERSAMPLED_BITS wide
 int32_t currentSensorToCentiamps(uint16_t src)
 {
     int32_t millivolts;
 
-    millivolts = ((uint32_t)src * ADCVREF) / 4096;
+    millivolts = ((uint32_t)src * ADCVREF) >> ADC_OVERSAMPLED_BITS;
     millivolts -= batteryConfig()->currentMeterOffset;
 
     return (millivolts * 1000) / (int32_t)batteryConfig()->currentMeterScale; // current in 0.01A steps
@@ -206,12 +280,23 @@ void updateCurrentMeter(int32_t lastUpdateAt)
 #ifndef ADC_CURRENT
     UNUSED(lastUpdateAt);
 #else
-    static int32_t amperageRaw = 0;
     static int64_t mAhdrawnRaw = 0;
+    static uint32_t lastSampleAt = 0;
+    adcSample_t adcSample;
 
-    amperageRaw -= amperageRaw / 8;
-    amperageRaw += (amperageLatestADC = adcGetChannel(ADC_CURRENT));
-    amperage = currentSensorToCentiamps(amperageRaw / 8);
+    adcReadChannel(ADC_CURRENT, &adcSample);
+    if (!adcSample.blockCount) {
+        return; // nothing new, the time elapsed will be accounted for with the next sample
+    }
+
+    amperageLatestADC = adcSample.value >> ADC_OVERSAMPLE_SHIFT;
+    amperage = currentSensorToCentiamps(adcSample.value);
+
+    // integrate over the interval covered by the conversions rather than the task interval
+    if (lastSampleAt) {
+        lastUpdateAt = adcSample.timestamp - lastSampleAt;
+    }
+    lastSampleAt = adcSample.timestamp;
 
     mAhdrawnRaw += (MAX(0, amperage) * lastUpdateAt) / 1000;
     mAhDrawn = mAhdrawnRaw / (3600 * 100);
@@ -238,14 +323,17 @@ void updateVirtualCurrentMeter(int32_t lastUpdateAt, throttleStatus_e throttleSt
     mAhDrawn = mAhdrawnRaw / (3600 * 100);
 }
 
+// uses the LiPo discharge curve rather than a linear interpolation between the min and max cell voltages
 uint8_t calculateBatteryPercentage(void)
 {
-    return constrain((((uint32_t)vbat - (batteryConfig()->vbatmincellvoltage * batteryCellCount)) * 100) / ((batteryConfig()->vbatmaxcellvoltage - batteryConfig()->vbatmincellvoltage) * batteryCellCount), 0, 100);
+    return batteryStateOfCharge(batteryGetCellVoltage());
 }
 
+// accounts for packs that were not fully charged when connected
 uint8_t calculateBatteryCapacityRemainingPercentage(void)
 {
     uint16_t batteryCapacity = batteryConfig()->batteryCapacity;
+    float remainingCapacity = batteryCapacity * batteryInitialStateOfCharge / 100.0f - constrain(mAhDrawn, 0, 0xFFFF);
 
-    return constrain((batteryCapacity - constrain(mAhDrawn, 0, 0xFFFF)) * 100.0f / batteryCapacity , 0, 100);
+    return constrain(remainingCapacity * 100.0f / batteryCapacity, 0, 100);
 }
@@ -45,6 +45,9 @@ typedef struct batteryConfig_s {
     // FIXME this doesn't belong in here since it's a concern of MSP, not of the battery code.
     uint8_t multiwiiCurrentMeterOutput;     // if set to 1 output the amperage in milliamp steps instead of 0.01A steps via msp
     uint16_t batteryCapacity;               // mAh
+
+    uint8_t vbatsagcompensation;            // use the sag compensated resting voltage for alarms and percentages, requires a current meter
+    uint16_t batteryInternalResistance;     // initial estimate of the pack internal resistance in milliohms, refined in flight
 } batteryConfig_t;
 
 PG_DECLARE(batteryConfig_t, batteryConfig);
@@ -66,6 +69,9 @@ extern int32_t amperage;
 extern int32_t mAhDrawn;
 
 uint16_t batteryAdcToVoltage(uint16_t src);
+uint16_t batteryGetCompensatedVoltage(void);
+uint16_t batteryGetCellVoltage(void);
+uint16_t batteryGetInternalResistance(void);
 batteryState_e getBatteryState(void);
 const  char * getBatteryStateString(void);
 void updateBattery(void);
@@ -73,7 +79,7 @@ void batteryInit(void);
 
 void updateCurrentMeter(int32_t lastUpdateAt);
 void updateVirtualCurrentMeter(int32_t lastUpdateAt, throttleStatus_e throttleStatus);
-int32_t currentMeterToCentiamps(uint16_t src);
+int32_t currentSensorToCentiamps(uint16_t src);
 
 uint8_t calculateBatteryPercentage(void);
 uint8_t calculateBatteryCapacityRemainingPercentage(void);
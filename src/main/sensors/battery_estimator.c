@@ -0,0 +1,118 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "sensors/battery_estimator.h"
+
+/*
+ * Estimates the open circuit (resting) voltage of the pack while it is under load.
+ *
+ * The pack is modelled as an ideal voltage source behind an internal resistance, V = Voc - I * R.
+ * R is learnt from the voltage change that accompanies each sufficiently large current step, the
+ * resting voltage is then V + I * R smoothed with a slow low pass filter.  The voltage and current
+ * must be sampled over the same interval for the learnt resistance to be meaningful.
+ */
+
+#define BATTERY_ESTIMATOR_MIN_CURRENT_STEP  300     // centiamps, smaller steps are dominated by noise
+#define BATTERY_ESTIMATOR_LEARNING_RATE     0.1f
+#define BATTERY_ESTIMATOR_RESTING_TAU       1.0f    // seconds
+
+void batteryEstimatorInit(batteryEstimator_t *estimator, uint16_t initialResistance)
+{
+    memset(estimator, 0, sizeof(*estimator));
+    estimator->internalResistance = MIN(initialResistance, BATTERY_ESTIMATOR_MAX_RESISTANCE);
+}
+
+void batteryEstimatorUpdate(batteryEstimator_t *estimator, int32_t millivolts, int32_t centiamps, uint32_t deltaTimeUs)
+{
+    if (estimator->initialised) {
+        int32_t currentStep = centiamps - estimator->lastCentiamps;
+
+        if (ABS(currentStep) >= BATTERY_ESTIMATOR_MIN_CURRENT_STEP) {
+            // mV / A = milliohms, the current is in 0.01A steps
+            float resistance = -(float)(millivolts - estimator->lastMillivolts) * 100.0f / currentStep;
+
+            if (resistance > 0.0f && resistance < BATTERY_ESTIMATOR_MAX_RESISTANCE) {
+                estimator->internalResistance += (resistance - estimator->internalResistance) * BATTERY_ESTIMATOR_LEARNING_RATE;
+            }
+        }
+    }
+
+    estimator->lastMillivolts = millivolts;
+    estimator->lastCentiamps = centiamps;
+
+    // A * milliohms = millivolts, never compensate for charging current
+    float openCircuitVoltage = millivolts + MAX(0, centiamps) * estimator->internalResistance / 100.0f;
+
+    if (!estimator->initialised) {
+        estimator->restingVoltage = openCircuitVoltage;
+        estimator->initialised = true;
+        return;
+    }
+
+    float dT = deltaTimeUs * 1e-6f;
+    estimator->restingVoltage += (openCircuitVoltage - estimator->restingVoltage) * (dT / (BATTERY_ESTIMATOR_RESTING_TAU + dT));
+}
+
+uint16_t batteryEstimatorRestingVoltage(const batteryEstimator_t *estimator)
+{
+    return lrintf(estimator->restingVoltage);
+}
+
+uint16_t batteryEstimatorInternalResistance(const batteryEstimator_t *estimator)
+{
+    return lrintf(estimator->internalResistance);
+}
+
+// Typical LiPo resting cell voltage at 0%, 10% .. 100% state of charge, in millivolts
+static const uint16_t lipoCellStateOfChargeCurve[] = {
+    3300, 3600, 3700, 3750, 3790, 3830, 3870, 3920, 3980, 4060, 4200
+};
+
+#define LIPO_CURVE_STEP_PERCENT (100 / (ARRAYLEN(lipoCellStateOfChargeCurve) - 1))
+#define LIPO_CURVE_MIN lipoCellStateOfChargeCurve[0]
+#define LIPO_CURVE_MAX lipoCellStateOfChargeCurve[ARRAYLEN(lipoCellStateOfChargeCurve) - 1]
+
+// the LiPo curve is stretched over the configured empty and full cell voltages, so LiHV and Li-ion cells keep working
+uint8_t batteryCellStateOfCharge(uint16_t cellMillivolts, uint16_t minCellMillivolts, uint16_t maxCellMillivolts)
+{
+    if (cellMillivolts <= minCellMillivolts || maxCellMillivolts <= minCellMillivolts) {
+        return 0;
+    }
+    if (cellMillivolts >= maxCellMillivolts) {
+        return 100;
+    }
+
+    const uint32_t curveMillivolts = LIPO_CURVE_MIN + (uint32_t)(cellMillivolts - minCellMillivolts) * (LIPO_CURVE_MAX - LIPO_CURVE_MIN) / (maxCellMillivolts - minCellMillivolts);
+
+    for (unsigned i = 1; i < ARRAYLEN(lipoCellStateOfChargeCurve); i++) {
+        uint16_t upper = lipoCellStateOfChargeCurve[i];
+        if (curveMillivolts < upper) {
+            uint16_t lower = lipoCellStateOfChargeCurve[i - 1];
+            return (i - 1) * LIPO_CURVE_STEP_PERCENT + (curveMillivolts - lower) * LIPO_CURVE_STEP_PERCENT / (upper - lower);
+        }
+    }
+
+    return 100;
+}
@@ -0,0 +1,36 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define BATTERY_ESTIMATOR_MAX_RESISTANCE 1000   // milliohms, anything above this is a measurement error
+
+typedef struct batteryEstimator_s {
+    float restingVoltage;           // millivolts, open circuit estimate with the I*R sag removed
+    float internalResistance;       // milliohms, whole pack, learnt from load steps
+    int32_t lastMillivolts;
+    int32_t lastCentiamps;
+    bool initialised;
+} batteryEstimator_t;
+
+void batteryEstimatorInit(batteryEstimator_t *estimator, uint16_t initialResistance);
+void batteryEstimatorUpdate(batteryEstimator_t *estimator, int32_t millivolts, int32_t centiamps, uint32_t deltaTimeUs);
+
+uint16_t batteryEstimatorRestingVoltage(const batteryEstimator_t *estimator);
+uint16_t batteryEstimatorInternalResistance(const batteryEstimator_t *estimator);
+
+uint8_t batteryCellStateOfCharge(uint16_t cellMillivolts, uint16_t minCellMillivolts, uint16_t maxCellMillivolts);
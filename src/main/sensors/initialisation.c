@@ -702,6 +702,7 @@ bool sensorsAutodetect(void)
     // Now time to init things, acc first
     if (sensors(SENSOR_ACC)) {
         acc.acc_1G = 256; // set default
+        acc.acc_range = 0; // unknown, clipping is detected at the int16 limits
         acc.init(&acc);
     }
     // this is safe because either mpu6050 or mpu3050 or lg3d20 sets it, and in case of fail, we never get here.
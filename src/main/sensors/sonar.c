@@ -41,8 +41,6 @@
 
 // Sonar measurements are in cm, a value of SONAR_OUT_OF_RANGE indicates sonar is not in range.
 // Inclination is adjusted by imu
-    float baro_cf_vel;                      // apply Complimentary Filter to keep the calculated velocity based on baro velocity (i.e. near real velocity)
-    float baro_cf_alt;                      // apply CF to use ACC for height estimation
 
 #ifdef SONAR
 int16_t sonarMaxRangeCm;
@@ -152,6 +150,14 @@ int32_t sonarRead(void)
     return applySonarMedianFilter(distance);
 }
 
+/**
+ * Get the time at which the last distance was measured, in microseconds.  A new measurement has a different time.
+ */
+uint32_t sonarGetLatestMeasurementTime(void)
+{
+    return hcsr04_get_measurement_time();
+}
+
 /**
  * Apply tilt correction to the given raw sonar reading in order to compensate for the tilt of the craft when estimating
  * the altitude. Returns the computed altitude in centimeters.
@@ -25,6 +25,7 @@ extern int16_t sonarMaxAltWithTiltCm;
 
 void sonarUpdate(void);
 int32_t sonarRead(void);
+uint32_t sonarGetLatestMeasurementTime(void);
 int32_t sonarCalculateAltitude(int32_t sonarDistance, float cosTiltAngle);
 int32_t sonarGetLatestAltitude(void);
 
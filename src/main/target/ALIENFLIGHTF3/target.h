@@ -160,8 +160,12 @@
 #define SERIAL_RX
 //#define GPS
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 //#define DISPLAY
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 #define USE_EXTI
 
@@ -199,9 +199,13 @@
 #define ENABLE_BLACKBOX_LOGGING_ON_SDCARD_BY_DEFAULT
 #define DISPLAY
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define TELEMETRY
 #define SERIAL_RX
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 
 // IO - assuming 303 in 64pin package, TODO
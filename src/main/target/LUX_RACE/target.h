@@ -137,6 +137,9 @@
 #define BLACKBOX
 #define GPS
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define LED_STRIP
 
 #define LED_STRIP_TIMER TIM16
@@ -162,6 +165,7 @@
 #define TELEMETRY
 #define SERIAL_RX
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 #define USE_EXTI
 
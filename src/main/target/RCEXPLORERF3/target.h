@@ -183,8 +183,11 @@
 #define TELEMETRY
 #define SERIAL_RX
 #define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define DISPLAY
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 #define USE_EXTI
 
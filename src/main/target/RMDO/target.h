@@ -154,11 +154,15 @@
 
 #define GPS
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define BLACKBOX
 #define TELEMETRY
 #define SERIAL_RX
 #define DISPLAY
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 #define USE_EXTI
 
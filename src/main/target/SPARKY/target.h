@@ -123,10 +123,14 @@
 #define BLACKBOX
 #define GPS
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define DISPLAY
 #define SERIAL_RX
 #define TELEMETRY
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 #define USE_EXTI
 
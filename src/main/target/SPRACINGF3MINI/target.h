@@ -83,6 +83,7 @@
 #define USE_VCP
 #define USE_UART1
 #define USE_UART2
+#define USE_UART2_RX_DMA    // DMA1_Channel6, the TIM16 DShot output falls back to DMA1_Channel3
 #define USE_UART3
 #define USE_SOFTSERIAL1
 #define SERIAL_PORT_COUNT 5
@@ -222,8 +223,12 @@
 #define TELEMETRY
 #define SERIAL_RX
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define DISPLAY
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 #define USE_EXTI
 
@@ -180,9 +180,13 @@
 #define BLACKBOX
 #define GPS
 #define GTUNE
+#define AUTOTUNE
+#define USE_DSHOT
+#define USE_PPM_DMA
 #define TELEMETRY
 #define SERIAL_RX
 #define USE_SERVOS
+#define USE_IMU_EKF
 #define USE_CLI
 
 #define USE_SERIAL_4WAY_BLHELI_INTERFACE
@@ -0,0 +1,154 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * CRSF telemetry, sent back to the receiver on the CRSF receiver port.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <platform.h>
+
+#include "build/build_config.h"
+
+#ifdef TELEMETRY
+
+#include "common/maths.h"
+#include "common/axis.h"
+
+#include "config/parameter_group.h"
+#include "config/feature.h"
+
+#include "drivers/system.h"
+#include "drivers/sensor.h"
+#include "drivers/accgyro.h"
+#include "drivers/serial.h"
+
+#include "fc/config.h"
+#include "fc/rc_controls.h"
+
+#include "sensors/sensors.h"
+#include "sensors/acceleration.h"
+#include "sensors/battery.h"
+
+#include "io/serial.h"
+
+#include "flight/imu.h"
+
+#include "rx/rx.h"
+#include "rx/crsf.h"
+
+#include "telemetry/telemetry.h"
+#include "telemetry/crsf.h"
+
+#define CRSF_TELEMETRY_CYCLE_MS 50      // one frame, battery and attitude take turns
+
+#define CRSF_BATTERY_SENSOR_PAYLOAD_SIZE 8
+#define CRSF_ATTITUDE_PAYLOAD_SIZE 6
+
+static bool crsfTelemetryEnabled;
+
+static uint8_t *crsfSerialise16(uint8_t *dst, uint16_t v)
+{
+    // CRSF is big endian
+    *dst++ = v >> 8;
+    *dst++ = (uint8_t)v;
+    return dst;
+}
+
+/*
+ * voltage in 0.1 V, current in 0.1 A, capacity drawn in mAh as 24 bits and the remaining charge in %.
+ */
+static void crsfSendBatterySensor(void)
+{
+    uint8_t payload[CRSF_BATTERY_SENSOR_PAYLOAD_SIZE];
+    uint8_t *p = payload;
+
+    p = crsfSerialise16(p, vbat);
+    p = crsfSerialise16(p, amperage / 10);
+    const uint32_t capacity = constrain(mAhDrawn, 0, 0xFFFFFF);
+    *p++ = capacity >> 16;
+    p = crsfSerialise16(p, capacity);
+    *p++ = calculateBatteryPercentage();
+
+    crsfRxSendFrame(CRSF_FRAMETYPE_BATTERY_SENSOR, payload, sizeof(payload));
+}
+
+#define DECIDEGREES_TO_CRSF_ANGLE(angle) ((int16_t)lrintf((angle) * (RAD / 10.0f) * 10000.0f))
+
+// the IMU keeps the yaw in 0..3599, beyond 1800 decidegrees the angle in radians * 10000 doesn't fit an int16_t
+static int16_t crsfWrapDecidegrees(int16_t angle)
+{
+    if (angle > 1800) {
+        angle -= 3600;
+    } else if (angle < -1800) {
+        angle += 3600;
+    }
+    return angle;
+}
+
+/*
+ * pitch, roll and yaw in radians * 10000, -pi..pi.
+ */
+static void crsfSendAttitude(void)
+{
+    uint8_t payload[CRSF_ATTITUDE_PAYLOAD_SIZE];
+    uint8_t *p = payload;
+
+    p = crsfSerialise16(p, DECIDEGREES_TO_CRSF_ANGLE(attitude.values.pitch));
+    p = crsfSerialise16(p, DECIDEGREES_TO_CRSF_ANGLE(attitude.values.roll));
+    p = crsfSerialise16(p, DECIDEGREES_TO_CRSF_ANGLE(crsfWrapDecidegrees(attitude.values.yaw)));
+
+    crsfRxSendFrame(CRSF_FRAMETYPE_ATTITUDE, payload, sizeof(payload));
+}
+
+void initCrsfTelemetry(void)
+{
+    crsfTelemetryEnabled = false;
+}
+
+void checkCrsfTelemetryState(void)
+{
+    // the receiver port is always open, so the telemetry doesn't depend on the arming state
+    crsfTelemetryEnabled = feature(FEATURE_RX_SERIAL) && rxConfig()->serialrx_provider == SERIALRX_CRSF && crsfRxIsActive();
+}
+
+void handleCrsfTelemetry(void)
+{
+    static uint32_t crsfLastCycleTime;
+    static uint8_t crsfScheduleIndex;
+
+    if (!crsfTelemetryEnabled) {
+        return;
+    }
+
+    const uint32_t now = millis();
+    if ((now - crsfLastCycleTime) < CRSF_TELEMETRY_CYCLE_MS) {
+        return;
+    }
+    crsfLastCycleTime = now;
+
+    if (crsfScheduleIndex++ & 1) {
+        crsfSendAttitude();
+    } else {
+        crsfSendBatterySensor();
+    }
+}
+#endif
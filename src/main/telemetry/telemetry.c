@@ -46,6 +46,7 @@
 #include "telemetry/smartport.h"
 #include "telemetry/ltm.h"
 #include "telemetry/mavlink.h"
+#include "telemetry/crsf.h"
 
 PG_REGISTER_WITH_RESET_TEMPLATE(telemetryConfig_t, telemetryConfig, PG_TELEMETRY_CONFIG, 0);
 
@@ -68,6 +69,7 @@ void telemetryInit(void)
     initSmartPortTelemetry();
     initLtmTelemetry();
     initMAVLinkTelemetry();
+    initCrsfTelemetry();
     telemetryCheckState();
 }
 
@@ -92,6 +94,7 @@ void telemetryCheckState(void)
     checkSmartPortTelemetryState();
     checkLtmTelemetryState();
     checkMAVLinkTelemetryState();
+    checkCrsfTelemetryState();
 }
 
 void telemetryProcess(uint16_t deadband3d_throttle)
@@ -101,6 +104,7 @@ void telemetryProcess(uint16_t deadband3d_throttle)
     handleSmartPortTelemetry();
     handleLtmTelemetry();
     handleMAVLinkTelemetry();
+    handleCrsfTelemetry();
 }
 
 #endif
@@ -21,12 +21,20 @@
 //#define DEBUG_BATTERY
 
 extern "C" {
+    #include <platform.h>
+
     #include "config/parameter_group.h"
     #include "config/parameter_group_ids.h"
 
     #include "fc/rc_controls.h"
 
+    #include "drivers/adc.h"
+
+    #include "common/maths.h"
+    #include "common/utils.h"
+
     #include "sensors/battery.h"
+    #include "sensors/battery_estimator.h"
     #include "io/beeper.h"
 }
 
@@ -56,6 +64,8 @@ TEST(BatteryTest, BatteryADCToVoltage)
         .currentMeterType = CURRENT_SENSOR_NONE,
         .multiwiiCurrentMeterOutput = 0,
         .batteryCapacity = 2200,
+        .vbatsagcompensation = 0,
+        .batteryInternalResistance = 40,
     };
     memcpy(batteryConfig(), &testBatteryConfig, sizeof(*batteryConfig()));
 
@@ -117,6 +127,8 @@ TEST(BatteryTest, BatteryState)
         .currentMeterType = CURRENT_SENSOR_NONE,
         .multiwiiCurrentMeterOutput = 0,
         .batteryCapacity = 2200,
+        .vbatsagcompensation = 0,
+        .batteryInternalResistance = 40,
     };
     memcpy(batteryConfig(), &testBatteryConfig, sizeof(*batteryConfig()));
 
@@ -177,6 +189,8 @@ TEST(BatteryTest, CellCount)
         .currentMeterType = CURRENT_SENSOR_NONE,
         .multiwiiCurrentMeterOutput = 0,
         .batteryCapacity = 2200,
+        .vbatsagcompensation = 0,
+        .batteryInternalResistance = 40,
     };
 
     memcpy(batteryConfig(), &testBatteryConfig, sizeof(*batteryConfig()));
@@ -199,6 +213,220 @@ TEST(BatteryTest, CellCount)
     }
 }
 
+adcSample_t currentMeterAdcSample;
+
+/* Test that mAh are integrated over the time covered by the ADC samples, not the task interval */
+TEST(BatteryTest, CurrentMeterIntegratesOverAdcSampleTimestamps)
+{
+    batteryConfig_t testBatteryConfig = {
+        .vbatscale = VBAT_SCALE_DEFAULT,
+        .vbatresdivval = VBAT_RESDIVVAL_DEFAULT,
+        .vbatresdivmultiplier = VBAT_RESDIVMULTIPLIER_DEFAULT,
+        .vbatmaxcellvoltage = 43,
+        .vbatmincellvoltage = 33,
+        .vbatwarningcellvoltage = 35,
+        .currentMeterScale = 400,
+        .currentMeterOffset = 0,
+        .currentMeterType = CURRENT_SENSOR_ADC,
+        .multiwiiCurrentMeterOutput = 0,
+        .batteryCapacity = 2200,
+        .vbatsagcompensation = 0,
+        .batteryInternalResistance = 40,
+    };
+    memcpy(batteryConfig(), &testBatteryConfig, sizeof(*batteryConfig()));
+
+    batteryInit();
+    mAhDrawn = 0;
+
+    // given
+    currentMeterAdcSample.value = 1986;         // 400mV at 40mV/A, oversampled to 14 bits
+    currentMeterAdcSample.blockCount = 1;
+    currentMeterAdcSample.timestamp = 1000;
+
+    // when
+    updateCurrentMeter(0);  // first sample, no elapsed time yet
+
+    // then
+    EXPECT_EQ(1000, amperage);
+    EXPECT_EQ(1986 >> ADC_OVERSAMPLE_SHIFT, amperageLatestADC);
+    EXPECT_EQ(0, mAhDrawn);
+
+    // when 3.6 seconds elapse, the task interval passed in must be ignored in favour of the ADC timestamps
+    for (int i = 0; i < 36; i++) {
+        currentMeterAdcSample.timestamp += 100000;
+        updateCurrentMeter(1);
+    }
+
+    // then 10A for 3.6s
+    EXPECT_EQ(10, mAhDrawn);
+
+    // when no new conversions have completed
+    currentMeterAdcSample.blockCount = 0;
+    updateCurrentMeter(1000000);
+
+    // then nothing is integrated until they do
+    EXPECT_EQ(10, mAhDrawn);
+
+    currentMeterAdcSample.blockCount = 3;
+    currentMeterAdcSample.timestamp += 360000;
+    updateCurrentMeter(1);
+
+    EXPECT_EQ(11, mAhDrawn);
+}
+
+typedef struct batteryTraceSample_s {
+    int32_t millivolts;
+    int32_t centiamps;
+} batteryTraceSample_t;
+
+/*
+ * Synthetic 4S pack trace at the TASK_BATTERY rate (10Hz), hovering with two 1 second punch-outs.  The voltage is
+ * generated from a resting voltage that falls from 15.60V to 15.44V, an internal resistance of about 55 milliohms
+ * and some noise.
+ */
+#define BATTERY_TRACE_INTERVAL_US 100000
+#define BATTERY_TRACE_RESISTANCE 55
+static const batteryTraceSample_t punchOutTrace[] = {
+    { 15565,   90 }, { 15551,   79 }, { 15520,  111 }, { 15564,   74 },
+    { 15522,  104 }, { 15156,  793 }, { 15176,  773 }, { 15135,  802 },
+    { 15146,  772 }, { 15141,  797 }, { 15146,  774 }, { 15153,  775 },
+    { 15123,  797 }, { 15124,  822 }, { 15159,  777 }, { 15143,  784 },
+    { 15125,  810 }, { 15095,  830 }, { 15123,  806 }, { 15110,  795 },
+    { 13079, 4484 }, { 13092, 4505 }, { 13087, 4478 }, { 13070, 4496 },
+    { 13062, 4504 }, { 13065, 4506 }, { 13081, 4505 }, { 13053, 4513 },
+    { 13085, 4476 }, { 13068, 4506 }, { 15105,  782 }, { 15113,  776 },
+    { 15074,  815 }, { 15076,  806 }, { 15078,  809 }, { 15095,  801 },
+    { 15083,  804 }, { 15070,  819 }, { 15087,  799 }, { 15065,  829 },
+    { 15077,  793 }, { 15096,  785 }, { 15093,  781 }, { 15055,  819 },
+    { 15088,  775 }, { 15077,  789 }, { 15080,  801 }, { 15078,  791 },
+    { 15059,  798 }, { 15044,  808 }, { 13038, 4477 }, { 13015, 4496 },
+    { 13006, 4518 }, { 13044, 4479 }, { 13014, 4501 }, { 13045, 4472 },
+    { 12993, 4512 }, { 13003, 4518 }, { 13015, 4506 }, { 13003, 4526 },
+    { 15040,  790 }, { 15026,  814 }, { 15031,  808 }, { 15040,  807 },
+    { 15019,  799 }, { 15004,  823 }, { 15004,  830 }, { 15033,  800 },
+    { 15004,  812 }, { 15044,  773 }, { 15006,  814 }, { 15014,  811 },
+    { 15019,  813 }, { 15009,  798 }, { 15000,  815 }, { 15001,  826 },
+    { 14997,  792 }, { 14988,  830 }, { 14998,  792 }, { 14985,  809 },
+};
+
+static int32_t punchOutTraceRestingVoltage(unsigned index)
+{
+    return 15600 - index * 2;
+}
+
+TEST(BatteryEstimatorTest, CompensatesVoltageSagDuringPunchOuts)
+{
+    // given
+    batteryEstimator_t estimator;
+    batteryEstimatorInit(&estimator, BATTERY_TRACE_RESISTANCE);
+
+    for (unsigned i = 0; i < ARRAYLEN(punchOutTrace); i++) {
+        // when
+        batteryEstimatorUpdate(&estimator, punchOutTrace[i].millivolts, punchOutTrace[i].centiamps, BATTERY_TRACE_INTERVAL_US);
+
+        // then
+        int32_t error = batteryEstimatorRestingVoltage(&estimator) - punchOutTraceRestingVoltage(i);
+#ifdef DEBUG_BATTERY
+        printf("sample %d: %dmV %dcA, resting: %dmV, error: %dmV\n", i, punchOutTrace[i].millivolts, punchOutTrace[i].centiamps, batteryEstimatorRestingVoltage(&estimator), error);
+#endif
+        EXPECT_LT(ABS(error), 50);
+    }
+}
+
+TEST(BatteryEstimatorTest, PunchOutDoesNotLookLikeAnEmptyPack)
+{
+    // given
+    batteryEstimator_t estimator;
+    batteryEstimatorInit(&estimator, BATTERY_TRACE_RESISTANCE);
+
+    // when
+    for (unsigned i = 0; i < 25; i++) {
+        batteryEstimatorUpdate(&estimator, punchOutTrace[i].millivolts, punchOutTrace[i].centiamps, BATTERY_TRACE_INTERVAL_US);
+    }
+
+    // then the measured cell voltage is below a typical 3.3V critical level but the resting voltage is not
+    EXPECT_LT(punchOutTrace[24].millivolts / 4, 3300);
+    EXPECT_GT(batteryEstimatorRestingVoltage(&estimator) / 4, 3850);
+    EXPECT_GT(batteryCellStateOfCharge(batteryEstimatorRestingVoltage(&estimator) / 4, 3300, 4200), 50);
+}
+
+TEST(BatteryEstimatorTest, LearnsInternalResistanceFromCurrentSteps)
+{
+    // given
+    batteryEstimator_t estimator;
+    batteryEstimatorInit(&estimator, 20);
+
+    // when
+    for (unsigned i = 0; i < ARRAYLEN(punchOutTrace); i++) {
+        batteryEstimatorUpdate(&estimator, punchOutTrace[i].millivolts, punchOutTrace[i].centiamps, BATTERY_TRACE_INTERVAL_US);
+    }
+
+    // then the five current steps in the trace move the estimate towards the real resistance
+    EXPECT_GT(batteryEstimatorInternalResistance(&estimator), 30);
+    EXPECT_LT(batteryEstimatorInternalResistance(&estimator), BATTERY_TRACE_RESISTANCE);
+
+    // when the punch-outs are repeated for the rest of the flight
+    for (int punchOut = 0; punchOut < 10; punchOut++) {
+        for (unsigned i = 20; i < 40; i++) {
+            batteryEstimatorUpdate(&estimator, punchOutTrace[i].millivolts, punchOutTrace[i].centiamps, BATTERY_TRACE_INTERVAL_US);
+        }
+    }
+
+    // then
+    EXPECT_NEAR(BATTERY_TRACE_RESISTANCE, batteryEstimatorInternalResistance(&estimator), 3);
+}
+
+TEST(BatteryEstimatorTest, IgnoresSmallCurrentChangesAndCharging)
+{
+    // given
+    batteryEstimator_t estimator;
+    batteryEstimatorInit(&estimator, 40);
+
+    // when the current only changes by noise
+    batteryEstimatorUpdate(&estimator, 15000, 800, BATTERY_TRACE_INTERVAL_US);
+    batteryEstimatorUpdate(&estimator, 14000, 900, BATTERY_TRACE_INTERVAL_US);
+
+    // then
+    EXPECT_EQ(40, batteryEstimatorInternalResistance(&estimator));
+
+    // when the voltage rises with the current
+    batteryEstimatorUpdate(&estimator, 15000, 4000, BATTERY_TRACE_INTERVAL_US);
+
+    // then
+    EXPECT_EQ(40, batteryEstimatorInternalResistance(&estimator));
+}
+
+TEST(BatteryEstimatorTest, CellStateOfCharge)
+{
+    EXPECT_EQ(0, batteryCellStateOfCharge(0, 3300, 4200));
+    EXPECT_EQ(0, batteryCellStateOfCharge(3300, 3300, 4200));
+    EXPECT_EQ(5, batteryCellStateOfCharge(3450, 3300, 4200));
+    EXPECT_EQ(50, batteryCellStateOfCharge(3830, 3300, 4200));
+    EXPECT_EQ(55, batteryCellStateOfCharge(3850, 3300, 4200));
+    EXPECT_EQ(90, batteryCellStateOfCharge(4060, 3300, 4200));
+    EXPECT_EQ(99, batteryCellStateOfCharge(4199, 3300, 4200));
+    EXPECT_EQ(100, batteryCellStateOfCharge(4200, 3300, 4200));
+    EXPECT_EQ(100, batteryCellStateOfCharge(4350, 3300, 4200));
+}
+
+TEST(BatteryEstimatorTest, CellStateOfChargeFollowsTheConfiguredCellRange)
+{
+    // LiHV, 3.3V to 4.35V
+    EXPECT_EQ(0, batteryCellStateOfCharge(3300, 3300, 4350));
+    EXPECT_NEAR(50, batteryCellStateOfCharge(3918, 3300, 4350), 1);
+    EXPECT_LT(batteryCellStateOfCharge(4200, 3300, 4350), 100);
+    EXPECT_EQ(100, batteryCellStateOfCharge(4350, 3300, 4350));
+
+    // Li-ion, 2.8V to 4.2V
+    EXPECT_EQ(0, batteryCellStateOfCharge(2800, 2800, 4200));
+    EXPECT_GT(batteryCellStateOfCharge(3300, 2800, 4200), 0);
+    EXPECT_NEAR(50, batteryCellStateOfCharge(3625, 2800, 4200), 1);
+    EXPECT_EQ(100, batteryCellStateOfCharge(4200, 2800, 4200));
+
+    // a broken configuration
+    EXPECT_EQ(0, batteryCellStateOfCharge(3800, 4200, 3300));
+}
+
 //#define DEBUG_ROLLOVER_PATTERNS
 /**
  * These next two tests do not test any production code (!) but serves as an example of how to use a signed variable for timing purposes.
@@ -296,10 +524,20 @@ throttleStatus_e calculateThrottleStatus(rxConfig_t *rxConfig, uint16_t deadband
     return THROTTLE_HIGH;
 }
 
-uint16_t adcGetChannel(uint8_t channel)
+void adcReadChannel(uint8_t channel, adcSample_t *sample)
+{
+    if (channel == ADC_CURRENT) {
+        *sample = currentMeterAdcSample;
+        return;
+    }
+    sample->value = currentADCReading << ADC_OVERSAMPLE_SHIFT;
+    sample->blockCount = 1;
+    sample->timestamp = 0;
+}
+
+uint32_t micros(void)
 {
-    UNUSED(channel);
-    return currentADCReading;
+    return 0;
 }
 
 void delay(uint32_t ms)
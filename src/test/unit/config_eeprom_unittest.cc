@@ -417,12 +417,14 @@ void resumeRxSignal(void) {}
 void resetAllRxChannelRangeConfigurations(rxChannelRangeConfiguration_t *) {}
 void resetAdjustmentStates(void) {}
 void pidSetController(pidControllerType_e) {}
+void pidInitConfig(const pidProfile_t *, const controlRateConfig_t *, uint16_t, const rollAndPitchTrims_t *, const rxConfig_t *) {}
 void parseRcChannels(const char *, rxConfig_t *) {}
 #ifdef USE_SERVOS
 void mixerUseConfigs(servoParam_t *) {}
 #else
 void mixerUseConfigs(void) {}
 #endif
+void mixerInitConfig(void) {}
 bool isSerialConfigValid(serialConfig_t *) {return true;}
 void imuConfigure(imuRuntimeConfig_t *, accDeadband_t *,float ,uint16_t) {}
 void gpsUseProfile(gpsProfile_t *) {}
@@ -432,6 +434,7 @@ void generatePitchRollCurve(controlRateConfig_t *) {}
 void generateThrottleCurve(controlRateConfig_t *) {}
 void delay(uint32_t) {}
 
+controlRateConfig_t *currentControlRateProfile;
 void setControlRateProfile(uint8_t) {}
 void resetControlRateConfig(controlRateConfig_t *) {}
 void configureRateProfileSelection(uint8_t, uint8_t) {}
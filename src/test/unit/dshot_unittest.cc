@@ -0,0 +1,139 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <limits.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "build/build_config.h"
+
+    #include "drivers/dshot.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static void expectFrame(const uint16_t *buffer, uint16_t frame, dshotProtocol_e protocol)
+{
+    for (int bit = 0; bit < DSHOT_FRAME_BITS; bit++) {
+        const bool isOne = frame & (1 << (DSHOT_FRAME_BITS - 1 - bit));
+        EXPECT_EQ(isOne ? DSHOT_BIT_1(protocol) : DSHOT_BIT_0(protocol), buffer[bit]) << "bit " << bit;
+    }
+}
+
+TEST(DShotTest, BitTimings)
+{
+    // timer ticks at DSHOT_TIMER_MHZ, the bit rates are 150, 300 and 600 kbit/s
+    EXPECT_EQ(160, DSHOT_BIT_PERIOD(DSHOT150));
+    EXPECT_EQ(80, DSHOT_BIT_PERIOD(DSHOT300));
+    EXPECT_EQ(40, DSHOT_BIT_PERIOD(DSHOT600));
+
+    EXPECT_EQ(30, DSHOT_BIT_1(DSHOT600));
+    EXPECT_EQ(15, DSHOT_BIT_0(DSHOT600));
+    EXPECT_EQ(120, DSHOT_BIT_1(DSHOT150));
+    EXPECT_EQ(60, DSHOT_BIT_0(DSHOT150));
+}
+
+TEST(DShotTest, PrepareFrame)
+{
+    // value 1046, no telemetry: packet 0x82c, crc 0x8 ^ 0x2 ^ 0xc = 0x6
+    EXPECT_EQ(0x82c6, dshotPrepareFrame(1046, false));
+
+    // the telemetry request is the lowest bit of the packet
+    EXPECT_EQ(0x82d7, dshotPrepareFrame(1046, true));
+
+    EXPECT_EQ(0x0000, dshotPrepareFrame(DSHOT_CMD_MOTOR_STOP, false));
+    EXPECT_EQ(0x0606, dshotPrepareFrame(DSHOT_MIN_THROTTLE, false));
+    EXPECT_EQ(0xffee, dshotPrepareFrame(DSHOT_MAX_THROTTLE, false));
+}
+
+TEST(DShotTest, CrcOfEveryValue)
+{
+    for (int value = 0; value <= DSHOT_MAX_THROTTLE; value++) {
+        for (int telemetry = 0; telemetry <= 1; telemetry++) {
+            const uint16_t frame = dshotPrepareFrame(value, telemetry);
+
+            EXPECT_EQ(value, frame >> 5);
+            EXPECT_EQ(telemetry, (frame >> 4) & 1);
+
+            // the XOR of all four nibbles of a valid frame is 0, which is how the ESC checks it
+            EXPECT_EQ(0, (frame ^ (frame >> 4) ^ (frame >> 8) ^ (frame >> 12)) & 0x0f);
+        }
+    }
+}
+
+TEST(DShotTest, EncodeFrame)
+{
+    uint16_t buffer[DSHOT_DMA_BUFFER_SIZE] = { 0 };
+
+    for (int protocol = DSHOT150; protocol < DSHOT_PROTOCOL_COUNT; protocol++) {
+        const uint16_t frame = dshotPrepareFrame(1046, false);
+
+        dshotEncodeFrame(buffer, frame, (dshotProtocol_e)protocol);
+
+        expectFrame(buffer, frame, (dshotProtocol_e)protocol);
+
+        // MSB first, 0x82c6 starts 1000 0010
+        EXPECT_EQ(DSHOT_BIT_1(protocol), buffer[0]);
+        EXPECT_EQ(DSHOT_BIT_0(protocol), buffer[1]);
+        EXPECT_EQ(DSHOT_BIT_1(protocol), buffer[6]);
+        EXPECT_EQ(DSHOT_BIT_0(protocol), buffer[7]);
+    }
+}
+
+TEST(DShotTest, EncodeEveryNibble)
+{
+    uint16_t buffer[DSHOT_DMA_BUFFER_SIZE] = { 0 };
+
+    for (int protocol = DSHOT150; protocol < DSHOT_PROTOCOL_COUNT; protocol++) {
+        for (int nibble = 0; nibble < 16; nibble++) {
+            const uint16_t frame = nibble | (nibble << 4) | (nibble << 8) | (nibble << 12);
+
+            dshotEncodeFrame(buffer, frame, (dshotProtocol_e)protocol);
+
+            expectFrame(buffer, frame, (dshotProtocol_e)protocol);
+        }
+    }
+}
+
+TEST(DShotTest, EncodeLeavesPause)
+{
+    uint16_t buffer[DSHOT_DMA_BUFFER_SIZE];
+    memset(buffer, 0, sizeof(buffer));
+
+    dshotEncodeFrame(buffer, 0xffff, DSHOT600);
+
+    // the line stays low after the frame
+    for (int i = DSHOT_FRAME_BITS; i < DSHOT_DMA_BUFFER_SIZE; i++) {
+        EXPECT_EQ(0, buffer[i]);
+    }
+}
+
+TEST(DShotTest, CommandRepeats)
+{
+    EXPECT_EQ(1, dshotCommandRepeats(DSHOT_CMD_BEEP1));
+    EXPECT_EQ(1, dshotCommandRepeats(DSHOT_CMD_LED0_ON));
+
+    // commands that change the ESC settings must be received several times
+    EXPECT_EQ(DSHOT_COMMAND_REPEATS, dshotCommandRepeats(DSHOT_CMD_SPIN_DIRECTION_REVERSED));
+    EXPECT_EQ(DSHOT_COMMAND_REPEATS, dshotCommandRepeats(DSHOT_CMD_SAVE_SETTINGS));
+    EXPECT_EQ(DSHOT_COMMAND_REPEATS, dshotCommandRepeats(DSHOT_CMD_3D_MODE_ON));
+}
@@ -19,6 +19,8 @@
 #include <stdbool.h>
 
 #include <limits.h>
+#include <math.h>
+#include <string.h>
 
 #include <platform.h>
 
@@ -33,6 +35,7 @@ extern "C" {
 
     #include "common/axis.h"
     #include "common/maths.h"
+    #include "common/utils.h"
 
     #include "config/parameter_group_ids.h"
     #include "config/parameter_group.h"
@@ -54,6 +57,7 @@ extern "C" {
     #include "flight/pid.h"
     #include "flight/imu.h"
     #include "flight/altitudehold.h"
+    #include "flight/altitude_estimator.h"
 
     #include "fc/runtime_config.h"
 
@@ -145,6 +149,248 @@ TEST(AltitudeHoldTest, applyMultirotorAltHold)
     EXPECT_EQ(1500, rcCommand[THROTTLE]);
 }
 
+/*
+ * Replay of a simulated flight at the 40Hz altitude task rate: hover, a 1.5 metre climb at up to 1 m/s, hover.  The
+ * accelerometer has a bias of 15 cm/s/s and vibration noise, the baro altitude arrives one sample late.
+ */
+typedef struct altitudeTraceSample_s {
+    int16_t acc;                // earth frame, without gravity, cm/s/s
+    int16_t baroAlt;            // cm
+    int16_t altitude;           // reference, cm
+    int16_t velocity;           // reference, cm/s
+} altitudeTraceSample_t;
+
+#define ALTITUDE_TRACE_DT           0.025f
+#define ALTITUDE_TRACE_CLIMB_START  80          // sample
+#define ALTITUDE_TRACE_CLIMB_SETTLED 180        // the climb ends at sample 160
+#define ALTITUDE_TRACE_ACC_BIAS     15
+
+static const altitudeTraceSample_t climbTrace[] = {
+    {   30,    1,    0,    0 }, {  -21,   14,    0,    0 }, {   24,    6,    0,    0 },
+    {   21,   25,    0,    0 }, {   45,   20,    0,    0 }, {    6,   -7,    0,    0 },
+    {  -17,   -4,    0,    0 }, {  -71,   26,    0,    0 }, {   20,    2,    0,    0 },
+    {   43,   -6,    0,    0 }, {   24,   13,    0,    0 }, {  -34,   28,    0,    0 },
+    {   20,   10,    0,    0 }, {  -18,  -10,    0,    0 }, {   70,   -8,    0,    0 },
+    {    3,    8,    0,    0 }, {   62,  -39,    0,    0 }, {   63,    5,    0,    0 },
+    {   44,  -16,    0,    0 }, {   26,   26,    0,    0 }, {   13,  -10,    0,    0 },
+    {    2,   -8,    0,    0 }, {   41,    3,    0,    0 }, {    0,   13,    0,    0 },
+    {  -19,  -23,    0,    0 }, {   95,  -10,    0,    0 }, {   68,   -1,    0,    0 },
+    {    9,    9,    0,    0 }, {  -12,  -13,    0,    0 }, {    9,   -6,    0,    0 },
+    {   39,   32,    0,    0 }, {  -22,  -14,    0,    0 }, {   40,    9,    0,    0 },
+    {   52,  -12,    0,    0 }, {   35,   -1,    0,    0 }, {  -37,    8,    0,    0 },
+    {  -35,    9,    0,    0 }, {    1,   -3,    0,    0 }, {   85,   25,    0,    0 },
+    {   29,    7,    0,    0 }, {   -9,   20,    0,    0 }, {   36,  -14,    0,    0 },
+    {  -38,    0,    0,    0 }, {   10,   14,    0,    0 }, {  -17,  -14,    0,    0 },
+    {   29,    2,    0,    0 }, {   46,   18,    0,    0 }, {  -13,  -38,    0,    0 },
+    {   18,  -11,    0,    0 }, {   23,  -43,    0,    0 }, {   12,    2,    0,    0 },
+    {   -2,    9,    0,    0 }, {   19,    4,    0,    0 }, {   58,   21,    0,    0 },
+    {   54,    6,    0,    0 }, {   20,    9,    0,    0 }, {   26,  -11,    0,    0 },
+    {   28,   15,    0,    0 }, {    3,  -17,    0,    0 }, {   34,  -12,    0,    0 },
+    {  -32,   -4,    0,    0 }, {  -31,    6,    0,    0 }, {   -1,    2,    0,    0 },
+    {   52,   18,    0,    0 }, {   13,  -36,    0,    0 }, {    0,  -18,    0,    0 },
+    {   45,   25,    0,    0 }, {   38,   11,    0,    0 }, {   34,   11,    0,    0 },
+    {    4,   15,    0,    0 }, {    6,  -18,    0,    0 }, {   17,   26,    0,    0 },
+    {   10,  -28,    0,    0 }, {   56,    4,    0,    0 }, {   33,   -7,    0,    0 },
+    {   31,   26,    0,    0 }, {   -5,   11,    0,    0 }, {   27,  -13,    0,    0 },
+    {   22,   10,    0,    0 }, {  -11,   19,    0,    0 }, {  180,   19,    0,    5 },
+    {  236,    5,    0,   10 }, {  191,  -12,    1,   15 }, {  145,    1,    1,   20 },
+    {  212,   10,    2,   25 }, {  249,    5,    2,   30 }, {  205,   19,    3,   35 },
+    {  216,    3,    4,   40 }, {  178,   21,    5,   45 }, {  194,   37,    6,   50 },
+    {  188,   -1,    8,   55 }, {  219,   -3,    9,   60 }, {  169,   -9,   11,   65 },
+    {  190,    7,   12,   70 }, {  247,   23,   14,   75 }, {  226,   27,   16,   80 },
+    {  146,    7,   18,   85 }, {  198,    2,   20,   90 }, {  231,   10,   23,   95 },
+    {  181,   37,   25,  100 }, {   -5,   21,   28,  100 }, {  -32,   42,   30,  100 },
+    {   17,   53,   32,  100 }, {   86,   44,   35,  100 }, {    4,   23,   38,  100 },
+    {   68,   35,   40,  100 }, {   36,   44,   42,  100 }, {  -92,   45,   45,  100 },
+    {   21,   49,   48,  100 }, {   12,   52,   50,  100 }, {  -16,   60,   52,  100 },
+    {    0,   56,   55,  100 }, {   68,   59,   58,  100 }, {  -17,   64,   60,  100 },
+    {  -30,   63,   62,  100 }, {   61,   46,   65,  100 }, {   11,   51,   68,  100 },
+    {   21,   73,   70,  100 }, {   21,   66,   72,  100 }, {  -45,   59,   75,  100 },
+    {    2,   88,   78,  100 }, {  -48,   95,   80,  100 }, {   -8,   54,   82,  100 },
+    {   62,   88,   85,  100 }, {  -14,   90,   88,  100 }, {   35,   65,   90,  100 },
+    {   57,   77,   92,  100 }, {   42,   84,   95,  100 }, {  -34,   86,   98,  100 },
+    {   -1,  100,  100,  100 }, {  -37,   84,  102,  100 }, {   26,   97,  105,  100 },
+    {   -1,  112,  108,  100 }, {  -26,  139,  110,  100 }, {   -8,  116,  112,  100 },
+    {   10,  129,  115,  100 }, {    2,  103,  118,  100 }, {   23,  127,  120,  100 },
+    {   11,  153,  122,  100 }, {   39,  144,  125,  100 }, { -144,  142,  127,   95 },
+    { -190,  153,  130,   90 }, { -196,  132,  132,   85 }, { -140,  147,  134,   80 },
+    { -218,  129,  136,   75 }, { -213,  154,  138,   70 }, { -196,  138,  139,   65 },
+    { -206,  132,  141,   60 }, { -163,  125,  142,   55 }, { -183,  135,  144,   50 },
+    { -196,  124,  145,   45 }, { -148,  120,  146,   40 }, { -223,  140,  147,   35 },
+    { -182,  135,  148,   30 }, { -236,  140,  148,   25 }, { -216,  138,  149,   20 },
+    { -135,  117,  149,   15 }, { -186,  155,  150,   10 }, { -198,  144,  150,    5 },
+    { -152,  147,  150,    0 }, {  -39,  144,  150,    0 }, {   26,  144,  150,    0 },
+    {   -3,  153,  150,    0 }, {   -1,  152,  150,    0 }, {   35,  140,  150,    0 },
+    {  -34,  171,  150,    0 }, {   27,  138,  150,    0 }, {  -29,  150,  150,    0 },
+    {   21,  158,  150,    0 }, {   26,  143,  150,    0 }, {    2,  126,  150,    0 },
+    {   -8,  142,  150,    0 }, {   48,  129,  150,    0 }, {   73,  164,  150,    0 },
+    {   -1,  141,  150,    0 }, {   22,  156,  150,    0 }, {   37,  123,  150,    0 },
+    {    4,  158,  150,    0 }, {   43,  157,  150,    0 }, {   12,  155,  150,    0 },
+    {   -1,  177,  150,    0 }, {   43,  156,  150,    0 }, {   -3,  149,  150,    0 },
+    {   26,  151,  150,    0 }, {   65,  182,  150,    0 }, {   45,  132,  150,    0 },
+    {   36,  142,  150,    0 }, {   15,  180,  150,    0 }, {  -38,  129,  150,    0 },
+    {   -5,  162,  150,    0 }, {    3,  120,  150,    0 }, {   27,  160,  150,    0 },
+    {   53,  152,  150,    0 }, {   49,  141,  150,    0 }, {   42,  168,  150,    0 },
+    {    7,  144,  150,    0 }, {   53,  139,  150,    0 }, {  -13,  151,  150,    0 },
+    {   33,  164,  150,    0 }, {    0,  158,  150,    0 }, {  -12,  132,  150,    0 },
+    {   91,  139,  150,    0 }, {  -32,  155,  150,    0 }, {   -8,  161,  150,    0 },
+    {  -62,  133,  150,    0 }, {   47,  154,  150,    0 }, {  -13,  173,  150,    0 },
+    {   47,  145,  150,    0 }, {   50,  160,  150,    0 }, {  -24,  138,  150,    0 },
+    {   21,  133,  150,    0 }, {  -34,  142,  150,    0 }, {   37,  152,  150,    0 },
+    {  -17,  112,  150,    0 }, {   38,  146,  150,    0 }, {   39,  148,  150,    0 },
+    {   -2,  153,  150,    0 }, {   -9,  141,  150,    0 }, {  -15,  115,  150,    0 },
+    {   46,  166,  150,    0 }, {   -4,  143,  150,    0 }, {   84,  158,  150,    0 },
+    {    1,  130,  150,    0 }, {   66,  169,  150,    0 }, {  -12,  160,  150,    0 },
+    {  -16,  144,  150,    0 }, {   47,  145,  150,    0 }, {   -8,  127,  150,    0 },
+    {   32,  146,  150,    0 }, {  -24,  181,  150,    0 }, {   -8,  141,  150,    0 },
+    {   26,  145,  150,    0 }, {   15,  156,  150,    0 }, {   -2,  135,  150,    0 },
+    {    4,  165,  150,    0 }, {   14,  174,  150,    0 }, {   17,  135,  150,    0 },
+    {   21,  147,  150,    0 }, {   -1,  147,  150,    0 }, {   43,  163,  150,    0 },
+};
+
+typedef struct altitudeReplayResult_s {
+    float hoverVelocityError;   // RMS while hovering, cm/s
+    float climbVelocityError;   // RMS from the start of the climb until settled in the hover, cm/s
+    float altitudeError;        // RMS, cm
+} altitudeReplayResult_t;
+
+typedef struct altitudeReplayState_s {
+    float altitude;
+    float velocity;
+    float lastBaroAlt;
+    altitudeEstimator_t estimator;
+} altitudeReplayState_t;
+
+// the estimator calculateEstimatedAltitude() used before the Kalman filter, with the default baro_cf_alt and baro_cf_vel
+static void complementaryFilterUpdate(altitudeReplayState_t *state, const altitudeTraceSample_t *sample)
+{
+    const float dt = ALTITUDE_TRACE_DT;
+    float vel_acc = sample->acc * dt;
+
+    state->altitude += (vel_acc * 0.5f) * dt + state->velocity * dt;
+    state->altitude = state->altitude * 0.965f + sample->baroAlt * (1.0f - 0.965f);
+    state->velocity += vel_acc;
+
+    int32_t baroVel = (sample->baroAlt - state->lastBaroAlt) / dt;
+    state->lastBaroAlt = sample->baroAlt;
+    baroVel = constrain(baroVel, -1500, 1500);
+    baroVel = applyDeadband(baroVel, 10);
+
+    state->velocity = state->velocity * 0.985f + baroVel * (1.0f - 0.985f);
+}
+
+static void kalmanFilterUpdate(altitudeReplayState_t *state, const altitudeTraceSample_t *sample)
+{
+    altitudeEstimatorPredict(&state->estimator, sample->acc, ALTITUDE_TRACE_DT);
+    // the baro altitude in the trace is one sample old
+    altitudeEstimatorFuseAltitude(&state->estimator, sample->baroAlt, ALTITUDE_TRACE_DT, ALTITUDE_ESTIMATOR_BARO_NOISE);
+
+    state->altitude = state->estimator.altitude;
+    state->velocity = state->estimator.velocity;
+}
+
+static altitudeReplayResult_t replayClimbTrace(void (*update)(altitudeReplayState_t *state, const altitudeTraceSample_t *sample))
+{
+    altitudeReplayState_t state;
+    altitudeReplayResult_t result = { 0, 0, 0 };
+    float hoverVelocitySquares = 0;
+    int hoverSamples = 0;
+    float climbVelocitySquares = 0;
+    float altitudeSquares = 0;
+
+    memset(&state, 0, sizeof(state));
+    altitudeEstimatorInit(&state.estimator, 0);
+
+    for (unsigned i = 0; i < ARRAYLEN(climbTrace); i++) {
+        update(&state, &climbTrace[i]);
+
+        // ignore the first second while the filters settle
+        if (i >= 40) {
+            altitudeSquares += sq(state.altitude - climbTrace[i].altitude);
+            if (i < ALTITUDE_TRACE_CLIMB_START || i >= ALTITUDE_TRACE_CLIMB_SETTLED) {
+                hoverVelocitySquares += sq(state.velocity - climbTrace[i].velocity);
+                hoverSamples++;
+            } else {
+                climbVelocitySquares += sq(state.velocity - climbTrace[i].velocity);
+            }
+        }
+#ifdef DEBUG_ALTITUDE_HOLD
+        printf("%d: alt %d %.1f vel %d %.1f\n", i, climbTrace[i].altitude, state.altitude, climbTrace[i].velocity, state.velocity);
+#endif
+    }
+
+    result.hoverVelocityError = sqrtf(hoverVelocitySquares / hoverSamples);
+    result.climbVelocityError = sqrtf(climbVelocitySquares / (ALTITUDE_TRACE_CLIMB_SETTLED - ALTITUDE_TRACE_CLIMB_START));
+    result.altitudeError = sqrtf(altitudeSquares / (ARRAYLEN(climbTrace) - 40));
+    return result;
+}
+
+TEST(AltitudeEstimatorTest, ReactsFasterWithoutExtraNoise)
+{
+    // when
+    altitudeReplayResult_t complementary = replayClimbTrace(complementaryFilterUpdate);
+    altitudeReplayResult_t kalman = replayClimbTrace(kalmanFilterUpdate);
+
+#ifdef DEBUG_ALTITUDE_HOLD
+    printf("complementary: climb velocity error %.1fcm/s, hover velocity error %.1fcm/s, altitude error %.1fcm\n",
+        complementary.climbVelocityError, complementary.hoverVelocityError, complementary.altitudeError);
+    printf("kalman: climb velocity error %.1fcm/s, hover velocity error %.1fcm/s, altitude error %.1fcm\n",
+        kalman.climbVelocityError, kalman.hoverVelocityError, kalman.altitudeError);
+#endif
+
+    // then the velocity follows the climb more closely and is less noisy in the hover
+    EXPECT_LT(kalman.climbVelocityError, complementary.climbVelocityError);
+    EXPECT_LT(kalman.hoverVelocityError, complementary.hoverVelocityError);
+    EXPECT_LT(kalman.altitudeError, complementary.altitudeError);
+}
+
+TEST(AltitudeEstimatorTest, EstimatesAccelerometerBias)
+{
+    // given
+    altitudeEstimator_t estimator;
+    altitudeEstimatorInit(&estimator, 0);
+
+    // when
+    for (int repeat = 0; repeat < 5; repeat++) {
+        for (unsigned i = 0; i < ARRAYLEN(climbTrace); i++) {
+            altitudeEstimatorPredict(&estimator, climbTrace[i].acc, ALTITUDE_TRACE_DT);
+            altitudeEstimatorFuseAltitude(&estimator, climbTrace[i].baroAlt - repeat * 200, ALTITUDE_TRACE_DT, ALTITUDE_ESTIMATOR_BARO_NOISE);
+        }
+    }
+
+    // then
+    EXPECT_NEAR(ALTITUDE_TRACE_ACC_BIAS, estimator.accBias, 5);
+}
+
+TEST(AltitudeEstimatorTest, FusesLateMeasurements)
+{
+    // given a craft climbing at 1m/s
+    altitudeEstimator_t estimator;
+    altitudeEstimatorInit(&estimator, 0);
+    estimator.velocity = 100;
+    estimator.P[1][1] = sq(10.0f);
+
+    for (int i = 0; i < 40; i++) {
+        altitudeEstimatorPredict(&estimator, 0, ALTITUDE_TRACE_DT);
+        altitudeEstimatorFuseAltitude(&estimator, (i + 1) * 2.5f, 0.0f, ALTITUDE_ESTIMATOR_BARO_NOISE);
+    }
+    float altitude = estimator.altitude;
+    float velocity = estimator.velocity;
+
+    // when a measurement taken 100ms ago agrees with the track
+    altitudeEstimatorFuseAltitude(&estimator, altitude - velocity * 0.1f, 0.1f, ALTITUDE_ESTIMATOR_SONAR_NOISE);
+
+    // then nothing changes
+    EXPECT_FLOAT_EQ(altitude, estimator.altitude);
+    EXPECT_FLOAT_EQ(velocity, estimator.velocity);
+
+    // when the measurement is too old
+    altitudeEstimatorFuseAltitude(&estimator, 0, ALTITUDE_ESTIMATOR_MAX_AGE * 2, ALTITUDE_ESTIMATOR_SONAR_NOISE);
+
+    // then it is ignored
+    EXPECT_FLOAT_EQ(altitude, estimator.altitude);
+}
+
 // STUBS
 
 extern "C" {
@@ -202,4 +448,5 @@ uint32_t micros(void) { return 0; }
 bool isBaroCalibrationComplete(void) { return true; }
 void performBaroCalibrationCycle(void) {}
 int32_t baroCalculateAltitude(void) { return 0; }
+uint32_t baroGetLatestSampleTime(void) { return 0; }
 }
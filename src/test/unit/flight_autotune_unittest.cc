@@ -0,0 +1,487 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define AUTOTUNE
+
+extern "C" {
+    #include "build/build_config.h"
+
+    #include "common/axis.h"
+    #include "common/maths.h"
+    #include "common/filter.h"
+
+    #include "config/parameter_group.h"
+
+    #include "fc/runtime_config.h"
+
+    #include "drivers/sensor.h"
+    #include "drivers/accgyro.h"
+    #include "sensors/sensors.h"
+    #include "sensors/acceleration.h"
+    #include "sensors/gyro.h"
+
+    #include "rx/rx.h"
+    #include "fc/rc_controls.h"
+    #include "fc/rate_profile.h"
+    #include "fc/rc_adjustments.h"
+    #include "fc/config.h"
+
+    #include "flight/pid.h"
+    #include "flight/pid_kernel.h"
+    #include "flight/imu.h"
+    #include "flight/autotune.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+extern "C" {
+    extern uint8_t PIDweight[3];
+    float dT;
+    int32_t targetLooptime;
+    int beeperConfirmationBeepCount;
+}
+
+#define TEST_LOOPTIME 2048
+
+/*
+ * One axis of the craft: the PID output is delayed by the gyro filter and the ESC, lagged by the motors and then
+ * accelerates the airframe against aerodynamic damping.
+ */
+#define TEST_PLANT_DELAY_LOOPS 3
+#define TEST_MOTOR_TIME_CONSTANT 0.02f      // seconds
+#define TEST_ACCELERATION_GAIN 300.0f       // rate units per second squared per unit of PID output
+#define TEST_DAMPING 2.0f                   // per second
+
+typedef struct testPlant_s {
+    int16_t delayed[TEST_PLANT_DELAY_LOOPS];
+    float motor;
+    float rate;                             // rate PID units, gyroADC / 4
+} testPlant_t;
+
+static void testPlantUpdate(testPlant_t *plant, int16_t output)
+{
+    const int16_t delayedOutput = plant->delayed[0];
+
+    memmove(plant->delayed, plant->delayed + 1, sizeof(plant->delayed) - sizeof(plant->delayed[0]));
+    plant->delayed[TEST_PLANT_DELAY_LOOPS - 1] = output;
+
+    plant->motor += (delayedOutput - plant->motor) * dT / (TEST_MOTOR_TIME_CONSTANT + dT);
+    plant->rate += (TEST_ACCELERATION_GAIN * plant->motor - TEST_DAMPING * plant->rate) * dT;
+}
+
+// the frequency at which the plant lags by 180 degrees and its gain there, found from the model
+static void testPlantUltimatePoint(float *ultimateGain, float *ultimatePeriod)
+{
+    // the output is held for a loop, which adds half a loop to the delay
+    const float delay = (TEST_PLANT_DELAY_LOOPS + 0.5f) * dT;
+    float low = 1.0f;
+    float high = 1000.0f;
+
+    for (int i = 0; i < 50; i++) {
+        const float w = (low + high) / 2;
+        const float phase = atanf(TEST_MOTOR_TIME_CONSTANT * w) + atanf(w / TEST_DAMPING) + w * delay;
+        if (phase < M_PIf) {
+            low = w;
+        } else {
+            high = w;
+        }
+    }
+
+    const float w = low;
+    const float gain = TEST_ACCELERATION_GAIN / (sqrtf(1 + sq(TEST_MOTOR_TIME_CONSTANT * w)) * sqrtf(sq(w) + sq(TEST_DAMPING)));
+    *ultimateGain = 1 / gain;
+    *ultimatePeriod = 2 * M_PIf / w;
+}
+
+static controlRateConfig_t testControlRateConfig;
+static rollAndPitchTrims_t testTrims;
+rxConfig_t rxConfig_System;
+
+static void resetAutotuneTest(void)
+{
+    dT = TEST_LOOPTIME * 0.000001f;
+    targetLooptime = TEST_LOOPTIME;
+
+    autotuneConfig()->autotune_rule = AUTOTUNE_RULE_TYREUS_LUYBEN;
+    autotuneConfig()->autotune_relay_amplitude = 100;
+    autotuneConfig()->autotune_hysteresis = 10;
+    autotuneConfig()->autotune_max_angle = 300;
+    autotuneConfig()->autotune_cycles = 6;
+    autotuneConfig()->autotune_stick_deadband = 10;
+
+    memset(pidProfile(), 0, sizeof(pidProfile_t));
+    pidProfile()->P8[PIDROLL] = 40;
+    pidProfile()->I8[PIDROLL] = 30;
+    pidProfile()->D8[PIDROLL] = 23;
+    pidProfile()->P8[PIDPITCH] = 40;
+    pidProfile()->I8[PIDPITCH] = 30;
+    pidProfile()->D8[PIDPITCH] = 23;
+    pidProfile()->P8[PIDYAW] = 85;
+    pidProfile()->I8[PIDYAW] = 45;
+    pidProfile()->D8[PIDYAW] = 0;
+    pidProfile()->P8[PIDLEVEL] = 20;
+    pidProfile()->yaw_p_limit = YAW_P_LIMIT_MAX;
+    pidProfile()->dterm_lpf = 100;
+    pidProfile()->PTermSetpointWeight = 100;
+
+    memset(&testControlRateConfig, 0, sizeof(testControlRateConfig));
+    memset(&testTrims, 0, sizeof(testTrims));
+    memset(&pidState, 0, sizeof(pidState));
+    rxConfig_System.mincheck = 1100;
+    rxConfig_System.midrc = 1500;
+
+    for (int axis = 0; axis < 3; axis++) {
+        PIDweight[axis] = 100;
+        rcCommand[axis] = 0;
+        gyroADC[axis] = 0;
+    }
+    rcData[THROTTLE] = 1500;
+    attitude.values.roll = 0;
+    attitude.values.pitch = 0;
+    beeperConfirmationBeepCount = 0;
+    flightModeFlags = 0;
+
+    autotuneReset();
+    activatePidConfig();
+}
+
+// flies the three axes with the rate PID, autotune replacing the output of the axis it is tuning
+static void testRunAutotune(testPlant_t plants[3], float seconds)
+{
+    const int32_t angleRate[3] = { 0, 0, 0 };
+
+    for (int i = 0; i < seconds / dT; i++) {
+        int32_t gyroRate[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            gyroADC[axis] = lrintf(plants[axis].rate * 4);
+            gyroRate[axis] = gyroADC[axis] / 4;
+        }
+
+        pidKernel(&pidState, &pidRuntimeConfig, gyroRate, angleRate, axisPID);
+        autotuneUpdate(axisPID);
+
+        for (int axis = 0; axis < 3; axis++) {
+            testPlantUpdate(&plants[axis], axisPID[axis]);
+        }
+    }
+}
+
+// a step of the rate setpoint flown with the current gains, returns the overshoot and the error after a second
+static void testRateStep(int axis, float *overshoot, float *finalError)
+{
+    testPlant_t plant;
+    const int32_t targetRate = 400;
+    float maxRate = 0;
+
+    memset(&plant, 0, sizeof(plant));
+    memset(&pidState, 0, sizeof(pidState));
+
+    for (int i = 0; i < 1.0f / dT; i++) {
+        int32_t gyroRate[3] = { 0, 0, 0 };
+        int32_t angleRate[3] = { 0, 0, 0 };
+        int16_t output[3];
+
+        gyroRate[axis] = lrintf(plant.rate);
+        angleRate[axis] = targetRate;
+        pidKernel(&pidState, &pidRuntimeConfig, gyroRate, angleRate, output);
+        testPlantUpdate(&plant, output[axis]);
+        maxRate = MAX(maxRate, plant.rate);
+    }
+
+    *overshoot = (maxRate - targetRate) / targetRate;
+    *finalError = fabsf(plant.rate - targetRate) / targetRate;
+}
+
+TEST(FlightAutotuneTest, TestRelayMeasuresUltimatePoint)
+{
+    resetAutotuneTest();
+
+    // given
+    float expectedGain, expectedPeriod;
+    testPlantUltimatePoint(&expectedGain, &expectedPeriod);
+
+    autotuneRelay_t relay;
+    testPlant_t plant;
+    memset(&plant, 0, sizeof(plant));
+    autotuneRelayInit(&relay, 100, 0);
+
+    // when
+    while (relay.cycleCount < 10) {
+        testPlantUpdate(&plant, autotuneRelayUpdate(&relay, 0, lrintf(plant.rate), dT));
+        ASSERT_LT(relay.elapsed, 5.0f);
+    }
+
+    // then
+    float ultimateGain, ultimatePeriod;
+    EXPECT_TRUE(autotuneRelayResult(&relay, &ultimateGain, &ultimatePeriod));
+    printf("ultimate gain %.3f (model %.3f), ultimate period %.1fms (model %.1fms)\n",
+        ultimateGain, expectedGain, ultimatePeriod * 1000, expectedPeriod * 1000);
+
+    // the describing function of the relay is an approximation, the period is only limited by the loop time
+    EXPECT_NEAR(expectedGain, ultimateGain, expectedGain * 0.2f);
+    EXPECT_NEAR(expectedPeriod, ultimatePeriod, expectedPeriod * 0.1f);
+}
+
+TEST(FlightAutotuneTest, TestRelayHysteresis)
+{
+    resetAutotuneTest();
+
+    autotuneRelay_t relay;
+    autotuneRelayInit(&relay, 100, 10);
+
+    // starts with the negative output, the error has to be beyond the hysteresis to switch
+    EXPECT_EQ(-100, autotuneRelayUpdate(&relay, 0, 0, dT));
+    EXPECT_EQ(-100, autotuneRelayUpdate(&relay, 0, -10, dT));
+    EXPECT_EQ(100, autotuneRelayUpdate(&relay, 0, -11, dT));
+    EXPECT_EQ(100, autotuneRelayUpdate(&relay, 0, 10, dT));
+    EXPECT_EQ(-100, autotuneRelayUpdate(&relay, 0, 11, dT));
+    EXPECT_EQ(-100, autotuneRelayUpdate(&relay, 20, 11, dT));
+    EXPECT_EQ(100, autotuneRelayUpdate(&relay, 20, 9, dT));
+
+    // no cycles measured yet, there is no result
+    float ultimateGain, ultimatePeriod;
+    EXPECT_FALSE(autotuneRelayResult(&relay, &ultimateGain, &ultimatePeriod));
+}
+
+TEST(FlightAutotuneTest, TestTuningRules)
+{
+    uint8_t P8, I8, D8;
+
+    // Ku = 0.5, Tu = 0.1s
+    autotuneCalculateGains(AUTOTUNE_RULE_ZIEGLER_NICHOLS, true, 0.5f, 0.1f, &P8, &I8, &D8);
+    EXPECT_EQ(lrintf(0.3f / PID_LUX_PTERM_SCALE), P8);
+    EXPECT_EQ(lrintf(0.3f / 0.05f / PID_LUX_ITERM_SCALE), I8);
+    EXPECT_EQ(lrintf(0.3f * 0.0125f / PID_LUX_DTERM_SCALE), D8);
+
+    autotuneCalculateGains(AUTOTUNE_RULE_TYREUS_LUYBEN, true, 0.5f, 0.1f, &P8, &I8, &D8);
+    EXPECT_EQ(lrintf(0.5f / 2.2f / PID_LUX_PTERM_SCALE), P8);
+    EXPECT_EQ(lrintf(0.5f / 2.2f / 0.22f / PID_LUX_ITERM_SCALE), I8);
+    EXPECT_EQ(lrintf(0.5f / 2.2f * 0.1f / 6.3f / PID_LUX_DTERM_SCALE), D8);
+
+    // PI without the D term
+    autotuneCalculateGains(AUTOTUNE_RULE_TYREUS_LUYBEN, false, 0.5f, 0.1f, &P8, &I8, &D8);
+    EXPECT_EQ(lrintf(0.5f / 3.2f / PID_LUX_PTERM_SCALE), P8);
+    EXPECT_EQ(0, D8);
+
+    // limited to the range of the PID profile
+    autotuneCalculateGains(AUTOTUNE_RULE_ZIEGLER_NICHOLS, true, 50.0f, 0.1f, &P8, &I8, &D8);
+    EXPECT_EQ(PID_MAX, P8);
+    EXPECT_EQ(PID_MAX, I8);
+    EXPECT_EQ(PID_MAX, D8);
+}
+
+TEST(FlightAutotuneTest, TestAutotuneTunesAllAxes)
+{
+    resetAutotuneTest();
+
+    // given
+    testPlant_t plants[3];
+    memset(plants, 0, sizeof(plants));
+
+    // when
+    autotuneBegin();
+    testRunAutotune(plants, 10.0f);
+
+    // then every axis has been tuned, in turn
+    EXPECT_TRUE(autotuneHasNewGains());
+    EXPECT_EQ(1 + 2 + 3, beeperConfirmationBeepCount);
+
+    float ultimateGain, ultimatePeriod;
+    testPlantUltimatePoint(&ultimateGain, &ultimatePeriod);
+    uint8_t P8, I8, D8;
+    autotuneCalculateGains(AUTOTUNE_RULE_TYREUS_LUYBEN, true, ultimateGain, ultimatePeriod, &P8, &I8, &D8);
+    printf("roll P %d I %d D %d, pitch P %d I %d D %d, yaw P %d I %d D %d, model P %d I %d D %d\n",
+        pidProfile()->P8[FD_ROLL], pidProfile()->I8[FD_ROLL], pidProfile()->D8[FD_ROLL],
+        pidProfile()->P8[FD_PITCH], pidProfile()->I8[FD_PITCH], pidProfile()->D8[FD_PITCH],
+        pidProfile()->P8[FD_YAW], pidProfile()->I8[FD_YAW], pidProfile()->D8[FD_YAW], P8, I8, D8);
+
+    for (int axis = 0; axis < 2; axis++) {
+        EXPECT_NEAR(P8, pidProfile()->P8[axis], P8 * 0.2f);
+        EXPECT_NEAR(I8, pidProfile()->I8[axis], I8 * 0.25f);
+        EXPECT_NEAR(D8, pidProfile()->D8[axis], D8 * 0.25f);
+    }
+    EXPECT_EQ(0, pidProfile()->D8[FD_YAW]);
+    EXPECT_GT(pidProfile()->P8[FD_YAW], 0);
+
+    // and the runtime config was rebuilt with the new gains
+    EXPECT_EQ(pidProfile()->P8[FD_ROLL], pidRuntimeConfig.P8[FD_ROLL]);
+}
+
+TEST(FlightAutotuneTest, TestTunedGainsAreStable)
+{
+    float overshoot[2], finalError[2];
+
+    for (int rule = AUTOTUNE_RULE_ZIEGLER_NICHOLS; rule <= AUTOTUNE_RULE_TYREUS_LUYBEN; rule++) {
+        resetAutotuneTest();
+        autotuneConfig()->autotune_rule = rule;
+
+        testPlant_t plants[3];
+        memset(plants, 0, sizeof(plants));
+        autotuneBegin();
+        testRunAutotune(plants, 10.0f);
+
+        testRateStep(FD_ROLL, &overshoot[rule], &finalError[rule]);
+        printf("%s: P %d I %d D %d, overshoot %d%%, error after 1s %d%%\n",
+            rule == AUTOTUNE_RULE_ZIEGLER_NICHOLS ? "Ziegler-Nichols" : "Tyreus-Luyben",
+            pidProfile()->P8[FD_ROLL], pidProfile()->I8[FD_ROLL], pidProfile()->D8[FD_ROLL],
+            (int)lrintf(overshoot[rule] * 100), (int)lrintf(finalError[rule] * 100));
+
+        EXPECT_LT(finalError[rule], 0.05f);
+    }
+
+    // Tyreus-Luyben is the better damped of the two
+    EXPECT_LT(overshoot[AUTOTUNE_RULE_TYREUS_LUYBEN], overshoot[AUTOTUNE_RULE_ZIEGLER_NICHOLS]);
+    EXPECT_LT(overshoot[AUTOTUNE_RULE_TYREUS_LUYBEN], 0.3f);
+}
+
+TEST(FlightAutotuneTest, TestAutotuneOnlyRunsInSafeEnvelope)
+{
+    resetAutotuneTest();
+
+    testPlant_t plants[3];
+    memset(plants, 0, sizeof(plants));
+    autotuneBegin();
+
+    // the stick is moved, the PID flies the craft
+    rcCommand[PITCH] = 100;
+    axisPID[FD_ROLL] = 12;
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(12, axisPID[FD_ROLL]);
+
+    // stick noise within the deadband is taken as centred
+    rcCommand[PITCH] = -10;
+    rcCommand[YAW] = 5;
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(-100, axisPID[FD_ROLL]);
+    autotuneBegin();
+    axisPID[FD_ROLL] = 12;
+    rcCommand[PITCH] = 0;
+    rcCommand[YAW] = 0;
+
+    // on the ground
+    rcData[THROTTLE] = 1000;
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(12, axisPID[FD_ROLL]);
+    rcData[THROTTLE] = 1500;
+
+    // tilted too far
+    attitude.values.pitch = 310;
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(12, axisPID[FD_ROLL]);
+    attitude.values.pitch = 0;
+
+    // the relay takes over
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(-100, axisPID[FD_ROLL]);
+
+    // interrupting the relay often enough keeps it from finishing an axis
+    for (int i = 0; i < 20; i++) {
+        testRunAutotune(plants, 0.2f);
+        rcCommand[YAW] = 50;
+        autotuneUpdate(axisPID);
+        rcCommand[YAW] = 0;
+    }
+    EXPECT_FALSE(autotuneHasNewGains());
+    EXPECT_EQ(40, pidProfile()->P8[FD_ROLL]);
+}
+
+TEST(FlightAutotuneTest, TestFailsafeEndsAutotuneAndRestoresTheGains)
+{
+    resetAutotuneTest();
+
+    testPlant_t plants[3];
+    memset(plants, 0, sizeof(plants));
+
+    // given roll has been tuned and pitch is being tuned
+    autotuneBegin();
+    while (beeperConfirmationBeepCount == 0) {
+        testRunAutotune(plants, dT);
+    }
+    EXPECT_TRUE(autotuneHasNewGains());
+    EXPECT_NE(40, pidProfile()->P8[FD_ROLL]);
+
+    // when
+    flightModeFlags |= FAILSAFE_MODE;
+    axisPID[FD_PITCH] = 12;
+    autotuneUpdate(axisPID);
+
+    // then the PID flies the craft with the gains from before autotune
+    EXPECT_EQ(12, axisPID[FD_PITCH]);
+    EXPECT_FALSE(autotuneHasNewGains());
+    EXPECT_EQ(40, pidProfile()->P8[FD_ROLL]);
+    EXPECT_EQ(30, pidProfile()->I8[FD_ROLL]);
+    EXPECT_EQ(23, pidProfile()->D8[FD_ROLL]);
+    EXPECT_EQ(40, pidRuntimeConfig.P8[FD_ROLL]);
+
+    // and the relay doesn't come back once failsafe is over
+    flightModeFlags &= ~FAILSAFE_MODE;
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(12, axisPID[FD_PITCH]);
+}
+
+TEST(FlightAutotuneTest, TestAutotuneGivesUpOnAxisThatDoesNotOscillate)
+{
+    resetAutotuneTest();
+
+    // when the craft does not respond to the relay
+    autotuneBegin();
+    for (int i = 0; i < 31.0f / dT; i++) {
+        axisPID[FD_ROLL] = axisPID[FD_PITCH] = axisPID[FD_YAW] = 0;
+        autotuneUpdate(axisPID);
+    }
+
+    // then each axis times out and the gains are left alone
+    EXPECT_FALSE(autotuneHasNewGains());
+    EXPECT_EQ(0, beeperConfirmationBeepCount);
+    EXPECT_EQ(40, pidProfile()->P8[FD_ROLL]);
+    EXPECT_EQ(30, pidProfile()->I8[FD_ROLL]);
+    EXPECT_EQ(23, pidProfile()->D8[FD_ROLL]);
+    EXPECT_EQ(85, pidProfile()->P8[FD_YAW]);
+
+    // and the PID flies all the axes again
+    axisPID[FD_YAW] = 7;
+    autotuneUpdate(axisPID);
+    EXPECT_EQ(7, axisPID[FD_YAW]);
+}
+
+// STUBS
+
+extern "C" {
+void activatePidConfig(void)
+{
+    pidInitConfig(pidProfile(), &testControlRateConfig, 500, &testTrims, rxConfig());
+}
+void beeperConfirmationBeeps(uint8_t beepCount) { beeperConfirmationBeepCount += beepCount; }
+bool rcModeIsActive(boxId_e) { return false; }
+int16_t GPS_angle[ANGLE_INDEX_COUNT] = { 0, 0 };
+int32_t getRcStickDeflection(int32_t axis, uint16_t midrc) { return MIN(ABS(rcData[axis] - midrc), 500); }
+attitudeEulerAngles_t attitude = { { 0, 0, 0 } };
+uint16_t flightModeFlags = 0;
+uint8_t stateFlags = 0;
+uint8_t motorCount = 4;
+gyro_t gyro;
+int32_t gyroADC[XYZ_AXIS_COUNT];
+int16_t rcCommand[4];
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+bool motorLimitReached;
+}
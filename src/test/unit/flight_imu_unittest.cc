@@ -18,8 +18,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <math.h>
+#include <string.h>
 
 #include <limits.h>
+#include <time.h>
 
 #define BARO
 
@@ -58,6 +60,7 @@ extern "C" {
     #include "flight/mixer.h"
     #include "flight/pid.h"
     #include "flight/imu.h"
+    #include "flight/imu_ekf.h"
 
     PG_REGISTER_PROFILE(pidProfile_t, pidProfile, PG_PID_PROFILE, 0);
     PG_REGISTER_PROFILE(rcControlsConfig_t, rcControlsConfig, PG_RC_CONTROLS_CONFIG, 0);
@@ -74,6 +77,25 @@ extern float q0, q1, q2, q3;
 extern "C" {
 void imuComputeRotationMatrix(void);
 void imuUpdateEulerAngles(void);
+void imuUpdateAccVibration(float dT);
+uint8_t imuCalculateAccHealth(uint32_t currentTime);
+void imuAccumulateDeltaAngle(float gx, float gy, float gz, float dt);
+void imuCalculateEstimatedAttitude(void);
+
+void imuMahonyAHRSupdate(float dt, float gx, float gy, float gz,
+                                bool useAcc, float accWeight, float ax, float ay, float az,
+                                bool useMag, float mx, float my, float mz,
+                                bool useYaw, float yawError);
+void imuEkfAHRSupdate(float dt, float gx, float gy, float gz,
+                                bool useAcc, float accWeight, float ax, float ay, float az,
+                                bool useMag, float mx, float my, float mz,
+                                bool useYaw, float yawError);
+
+extern float accVibration[XYZ_AXIS_COUNT];
+extern imuEkf_t imuEkf;
+extern float deltaAngle[XYZ_AXIS_COUNT];
+extern uint32_t deltaAngleTime;
+extern uint32_t currentTimeUs;
 
 int16_t cycleTime = 2000;
 
@@ -147,6 +169,490 @@ TEST(FlightImuTest, TestEulerAngleCalculation)
     EXPECT_FLOAT_EQ(attitude.values.yaw, 2700);
 }
 
+#define TEST_ACC_1G 512
+
+static void imuSettleAccVibration(void)
+{
+    acc.acc_1G = TEST_ACC_1G;
+    accADC[X] = 0;
+    accADC[Y] = 0;
+    accADC[Z] = TEST_ACC_1G;
+
+    // the filters keep the interval of their first update, 3 seconds at 1kHz lets them settle
+    for (int i = 0; i < 3000; i++) {
+        imuUpdateAccVibration(0.001f);
+    }
+}
+
+TEST(FlightImuTest, TestAccVibrationOfStationaryCraft)
+{
+    // given
+    imuSettleAccVibration();
+
+    // when
+    for (int i = 0; i < 1000; i++) {
+        imuUpdateAccVibration(0.001f);
+    }
+
+    // then
+    EXPECT_NEAR(0, accVibration[X], 0.01f);
+    EXPECT_NEAR(0, accVibration[Y], 0.01f);
+    EXPECT_NEAR(0, accVibration[Z], 0.01f);
+    EXPECT_EQ(0, imuGetAccVibration(Z));
+}
+
+TEST(FlightImuTest, TestAccVibrationRMS)
+{
+    // given
+    imuSettleAccVibration();
+
+    // when a 1g 100Hz vibration is applied to the X axis for 2 seconds at 1kHz
+    for (int i = 0; i < 2000; i++) {
+        accADC[X] = lrintf(TEST_ACC_1G * sinf(2 * M_PIf * 100 * i * 0.001f));
+        imuUpdateAccVibration(0.001f);
+    }
+
+    // then the RMS of the sine wave is reported
+    EXPECT_NEAR(0.707f, accVibration[X], 0.05f);
+    EXPECT_NEAR(71, imuGetAccVibration(X), 5);
+    EXPECT_NEAR(0, accVibration[Y], 0.01f);
+    EXPECT_NEAR(0, accVibration[Z], 0.01f);
+}
+
+TEST(FlightImuTest, TestAccHealth)
+{
+    // given
+    uint32_t currentTime = 1000000;
+    accVibration[X] = 0;
+    accVibration[Y] = 0;
+    accVibration[Z] = 0.1f;
+
+    // expect
+    EXPECT_EQ(100, imuCalculateAccHealth(currentTime));
+
+    // when
+    accVibration[Z] = 1.65f;
+
+    // then halfway between good and bad vibration levels
+    EXPECT_EQ(50, imuCalculateAccHealth(currentTime));
+
+    // when
+    accVibration[X] = 3.0f;
+
+    // then
+    EXPECT_EQ(0, imuCalculateAccHealth(currentTime));
+}
+
+TEST(FlightImuTest, TestAccHealthAfterClipping)
+{
+    // given
+    uint32_t currentTime = 2000000;
+    accVibration[X] = 0;
+    accVibration[Y] = 0;
+    accVibration[Z] = 0;
+    EXPECT_EQ(100, imuCalculateAccHealth(currentTime));
+
+    // when
+    accClipCount++;
+
+    // then the accelerometer is not trusted for a while
+    EXPECT_EQ(0, imuCalculateAccHealth(currentTime));
+    EXPECT_EQ(0, imuCalculateAccHealth(currentTime + 499999));
+    EXPECT_EQ(100, imuCalculateAccHealth(currentTime + 500000));
+    EXPECT_EQ(100, imuCalculateAccHealth(currentTime + 600000));
+}
+
+/*
+ * Synthetic trajectories with a known attitude, used to validate the attitude estimators.
+ *
+ * The true attitude is a fixed bank and pitch rotated about the earth z axis at a constant rate, the gyro and
+ * accelerometer readings are generated from it using the same conventions as the estimators.
+ */
+#define TEST_IMU_DT 0.002f     // default attitude_update_hz
+
+typedef void (*attitudeEstimatorFn)(float dt, float gx, float gy, float gz,
+                                bool useAcc, float accWeight, float ax, float ay, float az,
+                                bool useMag, float mx, float my, float mz,
+                                bool useYaw, float yawError);
+
+typedef struct testTrajectory_s {
+    float roll;             // rad
+    float pitch;            // rad
+    float turnRate;         // rad/s about the earth z axis
+    float turnStart;        // s, until then the accelerometer only sees gravity
+    bool coordinatedTurn;   // the accelerometer only sees the body z axis, as in a fixed-wing turn
+    float gyroBias[XYZ_AXIS_COUNT];
+    bool useGpsCourse;
+} testTrajectory_t;
+
+static void testQuaternionMultiply(const float a[4], const float b[4], float out[4])
+{
+    out[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    out[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    out[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    out[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+static void testTrajectoryAttitude(const testTrajectory_t *trajectory, float time, float q[4])
+{
+    const float qYaw[4] = { cosf(trajectory->turnRate * time / 2), 0, 0, sinf(trajectory->turnRate * time / 2) };
+    const float qPitch[4] = { cosf(trajectory->pitch / 2), 0, sinf(trajectory->pitch / 2), 0 };
+    const float qRoll[4] = { cosf(trajectory->roll / 2), sinf(trajectory->roll / 2), 0, 0 };
+    float qYawPitch[4];
+
+    testQuaternionMultiply(qYaw, qPitch, qYawPitch);
+    testQuaternionMultiply(qYawPitch, qRoll, q);
+}
+
+static void testUpVector(const float q[4], float up[3])
+{
+    up[0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    up[1] = 2.0f * (q[2] * q[3] + q[0] * q[1]);
+    up[2] = 1.0f - 2.0f * q[1] * q[1] - 2.0f * q[2] * q[2];
+}
+
+static float testYaw(const float q[4])
+{
+    return -atan2f(2.0f * (q[1] * q[2] + q[0] * q[3]), 1.0f - 2.0f * q[2] * q[2] - 2.0f * q[3] * q[3]);
+}
+
+// angle between the estimated and true direction of gravity, degrees
+static float testTiltError(const float q[4])
+{
+    const float estimated[4] = { q0, q1, q2, q3 };
+    float trueUp[3], estimatedUp[3];
+
+    testUpVector(q, trueUp);
+    testUpVector(estimated, estimatedUp);
+
+    float cosError = trueUp[0] * estimatedUp[0] + trueUp[1] * estimatedUp[1] + trueUp[2] * estimatedUp[2];
+    return acosf(constrainf(cosError, -1.0f, 1.0f)) * 180.0f / M_PIf;
+}
+
+static void testStartEstimator(imuRuntimeConfig_t *runtimeConfig, accDeadband_t *deadband, const float q[4])
+{
+    runtimeConfig->dcm_kp = 0.25f;
+    runtimeConfig->dcm_ki = 0.0f;
+    runtimeConfig->small_angle = 25;
+    runtimeConfig->attitude_update_hz = 500;
+    runtimeConfig->attitude_estimator = IMU_ESTIMATOR_MAHONY;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    imuComputeRotationMatrix();
+
+    imuConfigure(runtimeConfig, deadband, 5.0f, 800);
+    imuEkfInit(&imuEkf, q0, q1, q2, q3);
+
+    acc.acc_1G = TEST_ACC_1G;
+    armingFlags = ARMED;
+}
+
+// returns the largest tilt error seen in the last half of the trajectory, degrees
+static float testRunTrajectory(attitudeEstimatorFn estimator, const testTrajectory_t *trajectory, const float initialAttitude[4], float duration)
+{
+    imuRuntimeConfig_t runtimeConfig;
+    accDeadband_t deadband = { 0, 0 };
+    float maxError = 0;
+
+    testStartEstimator(&runtimeConfig, &deadband, initialAttitude);
+
+    for (float time = 0; time < duration; time += TEST_IMU_DT) {
+        float q[4];
+        float up[3];
+
+        testTrajectoryAttitude(trajectory, time, q);
+        testUpVector(q, up);
+
+        // the turn is about the earth z axis, which is the up vector in the body frame
+        float gx = up[0] * trajectory->turnRate + trajectory->gyroBias[X];
+        float gy = up[1] * trajectory->turnRate + trajectory->gyroBias[Y];
+        float gz = up[2] * trajectory->turnRate + trajectory->gyroBias[Z];
+
+        float ax, ay, az;
+        if (trajectory->coordinatedTurn && time >= trajectory->turnStart) {
+            ax = 0;
+            ay = 0;
+            az = TEST_ACC_1G / cosf(trajectory->roll);
+        } else {
+            ax = up[0] * TEST_ACC_1G;
+            ay = up[1] * TEST_ACC_1G;
+            az = up[2] * TEST_ACC_1G;
+        }
+
+        const float estimated[4] = { q0, q1, q2, q3 };
+        float yawError = testYaw(estimated) - testYaw(q);
+
+        estimator(TEST_IMU_DT, gx, gy, gz, true, 1.0f, ax, ay, az, false, 0, 0, 0, trajectory->useGpsCourse, yawError);
+
+        if (time > duration / 2) {
+            maxError = MAX(maxError, testTiltError(q));
+        }
+    }
+
+    armingFlags = 0;
+    return maxError;
+}
+
+static const float levelAttitude[4] = { 1, 0, 0, 0 };
+
+TEST(FlightImuTest, TestEkfConvergesFromLevel)
+{
+    // given
+    const testTrajectory_t trajectory = { DEGREES_TO_RADIANS(30), DEGREES_TO_RADIANS(-20), 0, 0, false, { 0, 0, 0 }, false };
+
+    // when the estimator starts level but the craft is tilted
+    float error = testRunTrajectory(imuEkfAHRSupdate, &trajectory, levelAttitude, 10.0f);
+
+    // then
+    EXPECT_LT(error, 0.5f);
+}
+
+TEST(FlightImuTest, TestEkfEstimatesGyroBias)
+{
+    // given
+    const testTrajectory_t trajectory = { DEGREES_TO_RADIANS(10), DEGREES_TO_RADIANS(-5), 0, 0, false, { 0.02f, -0.01f, 0.0f }, false };
+    float q[4];
+    testTrajectoryAttitude(&trajectory, 0, q);
+
+    // when
+    float ekfError = testRunTrajectory(imuEkfAHRSupdate, &trajectory, q, 60.0f);
+
+    // then
+    EXPECT_NEAR(0.02f, imuEkf.gyroBias[X], 0.002f);
+    EXPECT_NEAR(-0.01f, imuEkf.gyroBias[Y], 0.002f);
+    EXPECT_LT(ekfError, 0.2f);
+
+    // when
+    float mahonyError = testRunTrajectory(imuMahonyAHRSupdate, &trajectory, q, 60.0f);
+
+    // then the Mahony filter without an integral term has a steady state error
+    EXPECT_GT(mahonyError, 2.0f);
+}
+
+TEST(FlightImuTest, TestEkfKeepsItsStateWhileSelected)
+{
+    // given
+    imuRuntimeConfig_t runtimeConfig;
+    accDeadband_t deadband = { 0, 0 };
+    testStartEstimator(&runtimeConfig, &deadband, levelAttitude);
+
+    runtimeConfig.attitude_estimator = IMU_ESTIMATOR_EKF;
+    imuConfigure(&runtimeConfig, &deadband, 5.0f, 800);
+    imuEkf.gyroBias[X] = 0.02f;
+
+    // when the configuration is applied again
+    imuConfigure(&runtimeConfig, &deadband, 5.0f, 800);
+
+    // then the learnt bias is kept
+    EXPECT_FLOAT_EQ(0.02f, imuEkf.gyroBias[X]);
+
+    // when the estimator is changed and changed back
+    runtimeConfig.attitude_estimator = IMU_ESTIMATOR_MAHONY;
+    imuConfigure(&runtimeConfig, &deadband, 5.0f, 800);
+    runtimeConfig.attitude_estimator = IMU_ESTIMATOR_EKF;
+    imuConfigure(&runtimeConfig, &deadband, 5.0f, 800);
+
+    // then the EKF starts again
+    EXPECT_FLOAT_EQ(0.0f, imuEkf.gyroBias[X]);
+
+    runtimeConfig.attitude_estimator = IMU_ESTIMATOR_MAHONY;
+    imuConfigure(&runtimeConfig, &deadband, 5.0f, 800);
+}
+
+TEST(FlightImuTest, TestEkfDuringCoordinatedTurn)
+{
+    // given a 20 degree banked turn, as flown by a fixed-wing, with GPS course available.  The estimators settle
+    // for 10 seconds before the turn acceleration is applied.
+    const testTrajectory_t trajectory = { DEGREES_TO_RADIANS(20), 0, 0.24f, 10.0f, true, { 0, 0, 0 }, true };
+    float q[4];
+    testTrajectoryAttitude(&trajectory, 0, q);
+
+    // when
+    float ekfError = testRunTrajectory(imuEkfAHRSupdate, &trajectory, q, 30.0f);
+    float mahonyError = testRunTrajectory(imuMahonyAHRSupdate, &trajectory, q, 30.0f);
+
+    // then the accelerometer pulls the Mahony filter towards level, the EKF recognises the acceleration
+    EXPECT_LT(ekfError, 5.0f);
+    EXPECT_GT(mahonyError, 10.0f);
+}
+
+/*
+ * Coning: the body z axis sweeps a cone of half angle CONING_ANGLE at CONING_FREQUENCY.  The gyro samples are the exact
+ * rotation between samples, so any error comes from combining them.
+ */
+#define TEST_GYRO_DT            0.000125f   // 8kHz
+#define TEST_ATTITUDE_DT        0.002f      // 500Hz
+#define TEST_CONING_ANGLE       0.05f       // rad
+#define TEST_CONING_FREQUENCY   30.0f       // Hz
+
+static void testConingAttitude(float time, float q[4])
+{
+    const float phase = 2.0f * M_PIf * TEST_CONING_FREQUENCY * time;
+
+    q[0] = cosf(TEST_CONING_ANGLE / 2);
+    q[1] = sinf(TEST_CONING_ANGLE / 2) * cosf(phase);
+    q[2] = sinf(TEST_CONING_ANGLE / 2) * sinf(phase);
+    q[3] = 0;
+}
+
+// body frame rotation from a to b, as a rotation vector
+static void testRotationBetween(const float a[4], const float b[4], float rotation[3])
+{
+    const float aConjugate[4] = { a[0], -a[1], -a[2], -a[3] };
+    float delta[4];
+
+    testQuaternionMultiply(aConjugate, b, delta);
+
+    float sinHalfAngle = sqrtf(sq(delta[1]) + sq(delta[2]) + sq(delta[3]));
+    float scale = sinHalfAngle > 1e-9f ? 2.0f * atan2f(sinHalfAngle, delta[0]) / sinHalfAngle : 2.0f;
+
+    rotation[X] = delta[1] * scale;
+    rotation[Y] = delta[2] * scale;
+    rotation[Z] = delta[3] * scale;
+}
+
+// angle between the estimated and true attitude, degrees
+static float testAttitudeError(const float q[4])
+{
+    float dot = q0 * q[0] + q1 * q[1] + q2 * q[2] + q3 * q[3];
+    return 2.0f * acosf(constrainf(fabsf(dot), 0.0f, 1.0f)) * 180.0f / M_PIf;
+}
+
+// returns the attitude error after duration, degrees
+static float testRunConing(bool useConingCorrection, float duration)
+{
+    imuRuntimeConfig_t runtimeConfig;
+    accDeadband_t deadband = { 0, 0 };
+    float q[4];
+    float previousQ[4];
+    float gyroSum[3] = { 0, 0, 0 };
+    int gyroSamples = 0;
+
+    testConingAttitude(0, q);
+    testStartEstimator(&runtimeConfig, &deadband, q);
+    memset(deltaAngle, 0, sizeof(deltaAngle));
+
+    for (int sample = 1; sample * TEST_GYRO_DT <= duration; sample++) {
+        memcpy(previousQ, q, sizeof(q));
+        testConingAttitude(sample * TEST_GYRO_DT, q);
+
+        float rotation[3];
+        testRotationBetween(previousQ, q, rotation);
+
+        if (useConingCorrection) {
+            imuAccumulateDeltaAngle(rotation[X] / TEST_GYRO_DT, rotation[Y] / TEST_GYRO_DT, rotation[Z] / TEST_GYRO_DT, TEST_GYRO_DT);
+        } else {
+            gyroSum[X] += rotation[X];
+            gyroSum[Y] += rotation[Y];
+            gyroSum[Z] += rotation[Z];
+        }
+
+        if (++gyroSamples * TEST_GYRO_DT >= TEST_ATTITUDE_DT - TEST_GYRO_DT / 2) {
+            const float *angle = useConingCorrection ? deltaAngle : gyroSum;
+
+            // no acc, mag or heading so the filter only applies the rotation
+            imuMahonyAHRSupdate(TEST_ATTITUDE_DT, angle[X] / TEST_ATTITUDE_DT, angle[Y] / TEST_ATTITUDE_DT, angle[Z] / TEST_ATTITUDE_DT,
+                                false, 0, 0, 0, 0, false, 0, 0, 0, false, 0);
+
+            memset(deltaAngle, 0, sizeof(deltaAngle));
+            memset(gyroSum, 0, sizeof(gyroSum));
+            gyroSamples = 0;
+        }
+    }
+
+    armingFlags = 0;
+    return testAttitudeError(q);
+}
+
+TEST(FlightImuTest, TestConingCorrection)
+{
+    // when
+    float errorWithoutCorrection = testRunConing(false, 2.0f);
+    float errorWithCorrection = testRunConing(true, 2.0f);
+
+    // then summing the gyro drifts about the cone axis, the coning correction removes most of it
+    EXPECT_GT(errorWithoutCorrection, 0.5f);
+    EXPECT_LT(errorWithCorrection, 0.05f);
+}
+
+TEST(FlightImuTest, TestAttitudeUpdateRate)
+{
+    // given
+    imuRuntimeConfig_t runtimeConfig;
+    accDeadband_t deadband = { 0, 0 };
+
+    testStartEstimator(&runtimeConfig, &deadband, levelAttitude);
+    armingFlags = 0;
+    runtimeConfig.acc_cut_hz = 0;
+    runtimeConfig.attitude_update_hz = 500;
+    imuConfigure(&runtimeConfig, &deadband, 5.0f, 800);
+    gyro.scale = 1.0f;
+    imuInit();
+
+    memset(accADC, 0, sizeof(accADC));
+    memset(gyroADC, 0, sizeof(gyroADC));
+
+    // the first update has no previous gyro sample
+    currentTimeUs = 10000000;
+    imuCalculateEstimatedAttitude();
+
+    // when rotating at 90 degrees per second with a 125us loop
+    gyroADC[Z] = 90;
+    for (int loop = 1; loop < 16; loop++) {
+        currentTimeUs += 125;
+        imuCalculateEstimatedAttitude();
+
+        // then the gyro is accumulated every loop
+        EXPECT_NEAR(DEGREES_TO_RADIANS(90) * 125e-6f * loop, deltaAngle[Z], 1e-6f);
+        EXPECT_EQ(125u * loop, deltaAngleTime);
+    }
+
+    // and the attitude does not change until 2ms have passed
+    EXPECT_FLOAT_EQ(1.0f, q0);
+    EXPECT_FLOAT_EQ(0.0f, q3);
+
+    currentTimeUs += 125;
+    imuCalculateEstimatedAttitude();
+
+    EXPECT_EQ(0.0f, deltaAngle[Z]);
+    EXPECT_EQ(0u, deltaAngleTime);
+    EXPECT_NEAR(sinf(DEGREES_TO_RADIANS(90) * 0.002f / 2), q3, 1e-5f);
+
+    // when
+    for (int loop = 16; loop < 8000; loop++) {
+        currentTimeUs += 125;
+        imuCalculateEstimatedAttitude();
+    }
+
+    // then after one second
+    EXPECT_NEAR(2700, attitude.values.yaw, 2);
+
+    gyroADC[Z] = 0;
+}
+
+TEST(FlightImuTest, TestEstimatorCpuCost)
+{
+    const testTrajectory_t trajectory = { DEGREES_TO_RADIANS(20), 0, 0.24f, 0, false, { 0, 0, 0 }, true };
+    const float duration = 20.0f;
+
+    clock_t start = clock();
+    testRunTrajectory(imuMahonyAHRSupdate, &trajectory, levelAttitude, duration);
+    clock_t mahonyTicks = clock() - start;
+
+    start = clock();
+    testRunTrajectory(imuEkfAHRSupdate, &trajectory, levelAttitude, duration);
+    clock_t ekfTicks = clock() - start;
+
+    // includes the trajectory generation, which is the same for both
+    printf("%d updates at %dHz, Mahony: %ldus, EKF: %ldus\n", (int)(duration / TEST_IMU_DT), (int)lrintf(1 / TEST_IMU_DT),
+        (long)(mahonyTicks * 1000000 / CLOCKS_PER_SEC), (long)(ekfTicks * 1000000 / CLOCKS_PER_SEC));
+
+    SUCCEED();
+}
+
 // STUBS
 
 extern "C" {
@@ -155,6 +661,7 @@ int16_t rcCommand[4];
 int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
 
 acc_t acc;
+uint32_t accClipCount;
 int16_t heading;
 gyro_t gyro;
 int32_t magADC[XYZ_AXIS_COUNT];
@@ -200,9 +707,11 @@ void updateAccelerationReadings(rollAndPitchTrims_t *rollAndPitchTrims)
     UNUSED(rollAndPitchTrims);
 }
 
-uint32_t micros(void) { return 0; }
+uint32_t currentTimeUs = 0;
+uint32_t micros(void) { return currentTimeUs; }
 uint32_t millis(void) { return 0; }
 bool isBaroCalibrationComplete(void) { return true; }
 void performBaroCalibrationCycle(void) {}
 int32_t baroCalculateAltitude(void) { return 0; }
+uint32_t baroGetLatestSampleTime(void) { return 0; }
 }
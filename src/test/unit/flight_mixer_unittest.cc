@@ -19,6 +19,9 @@
 #include <stdbool.h>
 
 #include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
 
 extern "C" {
     #include "build/debug.h"
@@ -37,6 +40,7 @@ extern "C" {
     #include "drivers/sensor.h"
     #include "drivers/accgyro.h"
     #include "drivers/pwm_mapping.h"
+    #include "drivers/dshot.h"
     #include "drivers/gyro_sync.h"
 
     #include "sensors/sensors.h"
@@ -51,6 +55,8 @@ extern "C" {
     #include "io/motor_and_servo.h"
     #include "io/gimbal.h"
     #include "fc/rc_controls.h"
+    #include "fc/runtime_config.h"
+    #include "fc/config.h"
 
 
     extern uint8_t servoCount;
@@ -60,6 +66,10 @@ extern "C" {
     void mixerInitServos(servoMixer_t *initialCustomServoMixers);
     void mixerUsePWMIOConfiguration(pwmIOConfiguration_t *pwmIOConfiguration);
 
+    extern const mixer_t mixers[];
+    extern uint8_t motorCount;
+    extern uint32_t rcModeActivationMask;
+
     PG_REGISTER_PROFILE(gimbalConfig_t, gimbalConfig, PG_GIMBAL_CONFIG, 0);
     PG_REGISTER(motorAndServoConfig_t, motorAndServoConfig, PG_MOTOR_AND_SERVO_CONFIG, 0);
     PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
@@ -89,8 +99,12 @@ motor_t motors[MAX_SUPPORTED_MOTORS];
 servo_t servos[MAX_SUPPORTED_SERVOS];
 
 uint8_t lastOneShotUpdateMotorCount;
+int motorsWrittenBeforeOneShotUpdate;
+bool testMotorProtocolOneshot = false;
+bool testMotorProtocolDshot = false;
 
 uint32_t testFeatureMask = 0;
+bool testFailsafeActive = false;
 
 int updatedServoCount;
 int updatedMotorCount;
@@ -205,6 +219,9 @@ protected:
     virtual void SetUp() {
         updatedServoCount = 0;
         updatedMotorCount = 0;
+        lastOneShotUpdateMotorCount = 0;
+        testMotorProtocolOneshot = false;
+        testMotorProtocolDshot = false;
 
         memset(mixerConfig(), 0, sizeof(*mixerConfig()));
         memset(rxConfig(), 0, sizeof(*rxConfig()));
@@ -278,6 +295,43 @@ TEST_F(BasicMixerIntegrationTest, TestTricopterServo)
     EXPECT_EQ(TEST_SERVO_MID, servos[0].value);
 }
 
+TEST_F(BasicMixerIntegrationTest, TestOneshotPulsesStartAfterAllMotorsAreWritten)
+{
+    // given
+    withDefaultmotorAndServoConfiguration();
+    configureMixer(MIXER_QUADX);
+    mixerInit(customMotorMixer(0));
+
+    pwmIOConfiguration_t pwmIOConfiguration = {
+            .servoCount = 0,
+            .motorCount = 4,
+            .ioCount = 4,
+            .pwmInputCount = 0,
+            .ppmInputCount = 0,
+            .ioConfigurations = {}
+    };
+    mixerUsePWMIOConfiguration(&pwmIOConfiguration);
+
+    // when
+    mixTable();
+    writeMotors();
+
+    // then
+    EXPECT_EQ(0, lastOneShotUpdateMotorCount);
+
+    // given
+    testMotorProtocolOneshot = true;
+    updatedMotorCount = 0;
+
+    // when
+    mixTable();
+    writeMotors();
+
+    // then
+    EXPECT_EQ(4, lastOneShotUpdateMotorCount);
+    EXPECT_EQ(4, motorsWrittenBeforeOneShotUpdate);
+}
+
 TEST_F(BasicMixerIntegrationTest, TestQuadMotors)
 {
     // given
@@ -422,6 +476,489 @@ TEST_F(CustomMixerIntegrationTest, TestCustomMixer)
 
 }
 
+class ArmedMixerTest : public BasicMixerIntegrationTest {
+protected:
+    virtual void SetUp() {
+        BasicMixerIntegrationTest::SetUp();
+
+        motorAndServoConfig()->minthrottle = 1150;
+        motorAndServoConfig()->maxthrottle = 1850;
+        motorAndServoConfig()->mincommand = TEST_MIN_COMMAND;
+        rxConfig()->midrc = TEST_RC_MID;
+        rxConfig()->mincheck = 1100;
+        mixerConfig()->yaw_motor_direction = 1;
+        mixerConfig()->yaw_jump_prevention_limit = YAW_JUMP_PREVENTION_LIMIT_HIGH;
+        mixerConfig()->pid_at_min_throttle = 1;
+        mixerConfig()->thrust_linear = 0;
+
+        rcData[THROTTLE] = 1500;
+        rcModeActivationMask = 0;
+        testFeatureMask = 0;
+        testFailsafeActive = false;
+        armingFlags = ARMED;
+    }
+
+    virtual void TearDown() {
+        rcModeActivationMask = 0;
+        armingFlags = 0;
+        testFailsafeActive = false;
+    }
+
+    void useMixer(uint8_t mixerMode, uint8_t motorCount) {
+        configureMixer(mixerMode);
+
+        mixerInit(customMotorMixer(0));
+        mixerInitServos(customServoMixer(0));
+
+        pwmIOConfiguration_t pwmIOConfiguration = {
+                .servoCount = 0,
+                .motorCount = motorCount,
+                .ioCount = motorCount,
+                .pwmInputCount = 0,
+                .ppmInputCount = 0,
+                .ioConfigurations = {}
+        };
+
+        mixerUsePWMIOConfiguration(&pwmIOConfiguration);
+    }
+};
+
+TEST_F(ArmedMixerTest, TestQuadXMix)
+{
+    // given
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1500;
+    axisPID[FD_ROLL] = 50;
+    axisPID[FD_PITCH] = 20;
+    axisPID[FD_YAW] = 10;
+
+    // when
+    mixTable();
+
+    // then
+    EXPECT_EQ(1500 - 50 + 20 + 10, motor[0]); // REAR_R
+    EXPECT_EQ(1500 - 50 - 20 - 10, motor[1]); // FRONT_R
+    EXPECT_EQ(1500 + 50 + 20 - 10, motor[2]); // REAR_L
+    EXPECT_EQ(1500 + 50 - 20 + 10, motor[3]); // FRONT_L
+}
+
+TEST_F(ArmedMixerTest, TestYawMotorDirectionIsFoldedIntoTheMix)
+{
+    // given
+    mixerConfig()->yaw_motor_direction = -1;
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1500;
+    axisPID[FD_YAW] = 10;
+
+    // when
+    mixTable();
+
+    // then
+    EXPECT_EQ(1490, motor[0]);
+    EXPECT_EQ(1510, motor[1]);
+    EXPECT_EQ(1510, motor[2]);
+    EXPECT_EQ(1490, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, TestMotorsAreShiftedDownToMaxThrottle)
+{
+    // given
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1800;
+    axisPID[FD_ROLL] = 100;
+
+    // when
+    mixTable();
+
+    // then the difference between the motors is kept
+    EXPECT_EQ(1650, motor[0]);
+    EXPECT_EQ(1650, motor[1]);
+    EXPECT_EQ(1850, motor[2]);
+    EXPECT_EQ(1850, motor[3]);
+    EXPECT_FALSE(motorLimitReached);
+}
+
+TEST_F(ArmedMixerTest, TestMotorStopAtLowThrottle)
+{
+    // given
+    testFeatureMask = FEATURE_MOTOR_STOP;
+    useMixer(MIXER_QUADX, 4);
+    rcData[THROTTLE] = 1050;
+    rcCommand[THROTTLE] = 1150;
+    axisPID[FD_ROLL] = 100;
+
+    // when
+    mixTable();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(TEST_MIN_COMMAND, motor[i]);
+    }
+}
+
+TEST_F(ArmedMixerTest, TestAirmodeScalesTheMixIntoTheThrottleRange)
+{
+    // given
+    rcModeActivationMask = (1 << BOXAIRMODE);
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1150;
+    axisPID[FD_ROLL] = 700;
+
+    // when
+    mixTable();
+
+    // then the mix of 1400 is halved to fit the 700 throttle range, centred in it
+    EXPECT_TRUE(motorLimitReached);
+    EXPECT_EQ(1150, motor[0]);
+    EXPECT_EQ(1150, motor[1]);
+    EXPECT_EQ(1850, motor[2]);
+    EXPECT_EQ(1850, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, TestAirmodeRaisesThrottleForTheMix)
+{
+    // given
+    rcModeActivationMask = (1 << BOXAIRMODE);
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1150;
+    axisPID[FD_ROLL] = 100;
+
+    // when
+    mixTable();
+
+    // then
+    EXPECT_FALSE(motorLimitReached);
+    EXPECT_EQ(1150, motor[0]);
+    EXPECT_EQ(1150, motor[1]);
+    EXPECT_EQ(1350, motor[2]);
+    EXPECT_EQ(1350, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, Test3DReversedRange)
+{
+    // given
+    testFeatureMask = FEATURE_3D;
+    motor3DConfig()->deadband3d_low = 1406;
+    motor3DConfig()->deadband3d_high = 1514;
+    rcControlsConfig()->deadband3d_throttle = 50;
+    useMixer(MIXER_QUADX, 4);
+    rcData[THROTTLE] = 1300;
+    rcCommand[THROTTLE] = 1300;
+    axisPID[FD_ROLL] = 400;
+
+    // when
+    mixTable();
+
+    // then the motors stay below the deadband, the 3D mixer gain is halved
+    EXPECT_EQ(1100, motor[0]);
+    EXPECT_EQ(1100, motor[1]);
+    EXPECT_EQ(1406, motor[2]);
+    EXPECT_EQ(1406, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, Test3DDeadbandHoldsTheMotors)
+{
+    // given
+    testFeatureMask = FEATURE_3D;
+    mixerConfig()->pid_at_min_throttle = 0;
+    motor3DConfig()->deadband3d_low = 1406;
+    motor3DConfig()->deadband3d_high = 1514;
+    rcControlsConfig()->deadband3d_throttle = 50;
+    useMixer(MIXER_QUADX, 4);
+    rcData[THROTTLE] = 1520;
+    rcCommand[THROTTLE] = 1520;
+    axisPID[FD_ROLL] = 100;
+
+    // when
+    mixTable();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(1514, motor[i]);
+    }
+}
+
+TEST_F(ArmedMixerTest, Test3DFailsafeKeepsTheReversedRange)
+{
+    // given
+    testFeatureMask = FEATURE_3D;
+    testFailsafeActive = true;
+    motor3DConfig()->deadband3d_low = 1406;
+    motor3DConfig()->deadband3d_high = 1514;
+    rcControlsConfig()->deadband3d_throttle = 50;
+    useMixer(MIXER_QUADX, 4);
+    rcData[THROTTLE] = 1300;
+    rcCommand[THROTTLE] = 1300;
+    axisPID[FD_ROLL] = 400;
+
+    // when
+    mixTable();
+
+    // then the motors stay below the deadband as without failsafe
+    EXPECT_EQ(1100, motor[0]);
+    EXPECT_EQ(1100, motor[1]);
+    EXPECT_EQ(1406, motor[2]);
+    EXPECT_EQ(1406, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, TestFailsafeConstrainsToMinCommand)
+{
+    // given
+    testFailsafeActive = true;
+    useMixer(MIXER_QUADX, 4);
+    rcData[THROTTLE] = 1000;
+    rcCommand[THROTTLE] = 1150;
+    axisPID[FD_ROLL] = 100;
+
+    // when
+    mixTable();
+
+    // then the motors may drop below minthrottle down to mincommand
+    EXPECT_EQ(1050, motor[0]);
+    EXPECT_EQ(1050, motor[1]);
+    EXPECT_EQ(1250, motor[2]);
+    EXPECT_EQ(1250, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, TestLimitsAreUpdatedByMixerInitConfig)
+{
+    // given
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1900;
+
+    // when
+    motorAndServoConfig()->maxthrottle = 1950;
+    mixTable();
+
+    // then the cached limit is used
+    EXPECT_EQ(1850, motor[0]);
+
+    // when
+    mixerInitConfig();
+    mixTable();
+
+    // then
+    EXPECT_EQ(1900, motor[0]);
+}
+
+TEST_F(ArmedMixerTest, TestDisarmedMotors)
+{
+    // given
+    useMixer(MIXER_QUADX, 4);
+    armingFlags = 0;
+    rcCommand[THROTTLE] = 1500;
+
+    // when
+    mixTable();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(TEST_MIN_COMMAND, motor[i]);
+    }
+}
+
+TEST_F(ArmedMixerTest, TestDshotDisarmedMotorsAreStoppedIn3D)
+{
+    // given
+    testMotorProtocolDshot = true;
+    testFeatureMask = FEATURE_3D;
+    motor3DConfig()->neutral3d = 1460;
+    useMixer(MIXER_QUADX, 4);
+    armingFlags = 0;
+    rcCommand[THROTTLE] = 1500;
+
+    // when
+    mixTable();
+    writeMotors();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(DSHOT_CMD_MOTOR_STOP, motors[i].value);
+    }
+
+    // when
+    for (int i = 0; i < 4; i++) {
+        motors[i].value = DSHOT_MAX_THROTTLE;
+    }
+    stopMotors();
+
+    // then
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(DSHOT_CMD_MOTOR_STOP, motors[i].value);
+    }
+}
+
+/*
+ * Times mixTable() for every motor layout, including a custom mix using all MAX_SUPPORTED_MOTORS.
+ */
+// motor output for a thrust with thrust_linear = 100, the thrust is the square of the motor output
+static float quadraticThrustOutput(float thrust)
+{
+    return 1150 + 700 * sqrtf((thrust - 1150) / 700);
+}
+
+TEST_F(ArmedMixerTest, TestThrustLinearisationKeepsTheThrottle)
+{
+    // given
+    mixerConfig()->thrust_linear = 50;
+    useMixer(MIXER_QUADX, 4);
+
+    for (int throttle = 1150; throttle <= 1850; throttle += 50) {
+        rcCommand[THROTTLE] = throttle;
+        axisPID[FD_ROLL] = 0;
+        axisPID[FD_PITCH] = 0;
+        axisPID[FD_YAW] = 0;
+
+        // when
+        mixTable();
+
+        // then
+        for (int i = 0; i < 4; i++) {
+            EXPECT_NEAR(throttle, motor[i], 2);
+        }
+    }
+}
+
+TEST_F(ArmedMixerTest, TestThrustLinearisationOfTheMix)
+{
+    // given
+    mixerConfig()->thrust_linear = 100;
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1500;
+    axisPID[FD_ROLL] = 50;
+
+    // when
+    mixTable();
+
+    // then the thrust of the throttle is a quarter, the roll is added to the thrust
+    const float throttleThrust = 1150 + 700 * 0.25f;
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust - 50), motor[0], 3);
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust - 50), motor[1], 3);
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust + 50), motor[2], 3);
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust + 50), motor[3], 3);
+    EXPECT_GT(1500 - motor[0], motor[2] - 1500);
+}
+
+TEST_F(ArmedMixerTest, TestThrustLinearisationInAirmode)
+{
+    // given
+    mixerConfig()->thrust_linear = 100;
+    rcModeActivationMask = (1 << BOXAIRMODE);
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1150;
+    axisPID[FD_ROLL] = 100;
+
+    // when
+    mixTable();
+
+    // then the throttle is raised in thrust for the mix
+    EXPECT_FALSE(motorLimitReached);
+    EXPECT_EQ(1150, motor[0]);
+    EXPECT_EQ(1150, motor[1]);
+    EXPECT_NEAR(quadraticThrustOutput(1350), motor[2], 3);
+    EXPECT_NEAR(quadraticThrustOutput(1350), motor[3], 3);
+
+    // given
+    axisPID[FD_ROLL] = 700;
+
+    // when
+    mixTable();
+
+    // then the end points are kept
+    EXPECT_TRUE(motorLimitReached);
+    EXPECT_EQ(1150, motor[0]);
+    EXPECT_EQ(1150, motor[1]);
+    EXPECT_EQ(1850, motor[2]);
+    EXPECT_EQ(1850, motor[3]);
+}
+
+TEST_F(ArmedMixerTest, TestThrustLinearisationInFailsafe)
+{
+    // given
+    mixerConfig()->thrust_linear = 100;
+    testFailsafeActive = true;
+    useMixer(MIXER_QUADX, 4);
+    rcCommand[THROTTLE] = 1500;
+    axisPID[FD_ROLL] = 50;
+
+    // when
+    mixTable();
+
+    // then the motor outputs are converted back from thrust as without failsafe
+    const float throttleThrust = 1150 + 700 * 0.25f;
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust - 50), motor[0], 3);
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust - 50), motor[1], 3);
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust + 50), motor[2], 3);
+    EXPECT_NEAR(quadraticThrustOutput(throttleThrust + 50), motor[3], 3);
+}
+
+TEST_F(ArmedMixerTest, TestThrustLinearisationIsNotUsedIn3D)
+{
+    // given
+    mixerConfig()->thrust_linear = 100;
+    testFeatureMask = FEATURE_3D;
+    useMixer(MIXER_QUADX, 4);
+    rcData[THROTTLE] = 1700;
+    rcCommand[THROTTLE] = 1700;
+    axisPID[FD_ROLL] = 50;
+
+    // when
+    mixTable();
+
+    // then the 3D mixer gain is halved
+    EXPECT_EQ(1675, motor[0]);
+    EXPECT_EQ(1725, motor[2]);
+}
+
+TEST_F(ArmedMixerTest, TestMixerBenchmark)
+{
+    const int iterations = 20000;
+
+    motorMixer_t allMotors[MAX_SUPPORTED_MOTORS];
+    for (int i = 0; i < MAX_SUPPORTED_MOTORS; i++) {
+        const float angle = 2 * M_PIf * i / MAX_SUPPORTED_MOTORS;
+        allMotors[i].throttle = 1.0f;
+        allMotors[i].roll = -sinf(angle);
+        allMotors[i].pitch = cosf(angle);
+        allMotors[i].yaw = (i % 2) ? 1.0f : -1.0f;
+    }
+
+    for (int mixerMode = MIXER_TRI; mixerMode <= MIXER_CUSTOM; mixerMode++) {
+        uint8_t layoutMotorCount;
+
+        if (mixerMode == MIXER_CUSTOM) {
+            memcpy(customMotorMixer_arr(), allMotors, sizeof(allMotors));
+            layoutMotorCount = MAX_SUPPORTED_MOTORS;
+        } else if (mixers[mixerMode].motor && !mixers[mixerMode].useServo) {
+            layoutMotorCount = mixers[mixerMode].motorCount;
+        } else {
+            continue;
+        }
+
+        for (int airmode = 0; airmode < 2; airmode++) {
+            for (int thrustLinear = 0; thrustLinear <= 50; thrustLinear += 50) {
+                rcModeActivationMask = airmode ? (1 << BOXAIRMODE) : 0;
+                mixerConfig()->thrust_linear = thrustLinear;
+                useMixer(mixerMode, layoutMotorCount);
+                ASSERT_EQ(layoutMotorCount, motorCount);
+
+                const clock_t start = clock();
+                for (int i = 0; i < iterations; i++) {
+                    rcCommand[THROTTLE] = 1200 + (i & 511);
+                    axisPID[FD_ROLL] = (i & 255) - 128;
+                    axisPID[FD_PITCH] = ((i >> 2) & 255) - 128;
+                    axisPID[FD_YAW] = ((i >> 4) & 127) - 64;
+                    mixTable();
+                }
+                const float seconds = (float)(clock() - start) / CLOCKS_PER_SEC;
+
+                printf("mixer %2d, %2d motors%s%s: %6.1f ns per mixTable()\n", mixerMode, layoutMotorCount,
+                    airmode ? ", airmode" : "", thrustLinear ? ", thrust linear" : "", seconds * 1e9f / iterations);
+            }
+        }
+    }
+}
+
 // STUBS
 
 extern "C" {
@@ -467,6 +1004,19 @@ void pwmShutdownPulsesForAllMotors(uint8_t motorCount)
 
 void pwmCompleteOneshotMotorUpdate(uint8_t motorCount) {
     lastOneShotUpdateMotorCount = motorCount;
+    motorsWrittenBeforeOneShotUpdate = updatedMotorCount;
+}
+
+bool isMotorProtocolOneshot(void) {
+    return testMotorProtocolOneshot;
+}
+
+void pwmCompleteDshotMotorUpdate(uint8_t motorCount) {
+    UNUSED(motorCount);
+}
+
+bool isMotorProtocolDshot(void) {
+    return testMotorProtocolDshot;
 }
 
 void pwmWriteServo(uint8_t index, uint16_t value) {
@@ -483,7 +1033,7 @@ void pwmWriteServo(uint8_t index, uint16_t value) {
 bool rcModeIsActive(boxId_e modeId) { return rcModeActivationMask & (1 << modeId); }
 
 bool failsafeIsActive(void) {
-    return false;
+    return testFailsafeActive;
 }
 
 }
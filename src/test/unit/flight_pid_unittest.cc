@@ -16,7 +16,10 @@
  */
 
 #include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 extern "C" {
     #include "build/build_config.h"
@@ -24,6 +27,8 @@ extern "C" {
 
     #include "common/axis.h"
     #include "common/maths.h"
+    #include "common/filter.h"
+    #include "common/utils.h"
 
     #include "config/parameter_group.h"
 
@@ -40,6 +45,7 @@ extern "C" {
     #include "fc/rate_profile.h"
 
     #include "flight/pid.h"
+    #include "flight/pid_kernel.h"
     #include "config/config_unittest.h"
     #include "flight/imu.h"
 
@@ -50,26 +56,21 @@ extern "C" {
 #include "gtest/gtest.h"
 
 extern "C" {
-    void pidSetController(pidControllerType_e type);
-    typedef void (*pidControllerFuncPtr)(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
-            uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig);            // pid controller function prototype
-    int16_t pidLuxFloatCore(int axis, const pidProfile_t *pidProfile, float gyroRate, float AngleRate);
-    int16_t pidMultiWiiRewriteCore(int axis, const pidProfile_t *pidProfile, int32_t gyroRate, int32_t AngleRate);
-    void pidResetITerm(void);
-    extern pidControllerFuncPtr pid_controller;
     extern uint8_t PIDweight[3];
     extern bool motorLimitReached;
+    extern uint8_t motorCount;
+    extern int16_t GPS_angle[ANGLE_INDEX_COUNT];
     extern uint32_t rcModeActivationMask;
     float dT; // dT for pidLuxFloat
     int32_t targetLooptime; // targetLooptime for pidMultiWiiRewrite
-    float unittest_pidLuxFloatCore_lastRateForDelta[3];
-    float unittest_pidLuxFloatCore_PTerm[3];
-    float unittest_pidLuxFloatCore_ITerm[3];
-    float unittest_pidLuxFloatCore_DTerm[3];
-    int32_t unittest_pidMultiWiiRewriteCore_lastRateForDelta[3];
-    int32_t unittest_pidMultiWiiRewriteCore_PTerm[3];
-    int32_t unittest_pidMultiWiiRewriteCore_ITerm[3];
-    int32_t unittest_pidMultiWiiRewriteCore_DTerm[3];
+    float unittest_pidKernelf_PTerm[3];
+    float unittest_pidKernelf_ITerm[3];
+    float unittest_pidKernelf_DTerm[3];
+    float unittest_pidKernelf_FTerm[3];
+    int32_t unittest_pidKernel_PTerm[3];
+    int32_t unittest_pidKernel_ITerm[3];
+    int32_t unittest_pidKernel_DTerm[3];
+    int32_t unittest_pidKernel_FTerm[3];
 }
 
 static const float luxPTermScale = 1.0f / 128;
@@ -118,6 +119,34 @@ void resetPidProfile(pidProfile_t *pidProfile)
     pidProfile->yaw_p_limit = YAW_P_LIMIT_MAX;
     pidProfile->dterm_lpf = 0;
     pidProfile->yaw_lpf = 0;
+    pidProfile->deltaMethod = PID_DELTA_FROM_MEASUREMENT;
+    pidProfile->feedForward = 0;
+    pidProfile->feedForwardLpf = 0;
+    pidProfile->PTermSetpointWeight = 100;
+    pidProfile->DTermSetpointWeight = 0;
+}
+
+/*
+ * the tests change the profile and rates between runs so the runtime config is rebuilt every time
+ */
+void runPidController(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRate, uint16_t max_angle_inclination,
+        const rollAndPitchTrims_t *rollAndPitchTrims, const rxConfig_t *rxConfig)
+{
+    pidInitConfig(pidProfile, controlRate, max_angle_inclination, rollAndPitchTrims, rxConfig);
+    pidController();
+}
+
+const pidRuntimeConfig_t *initPidRuntimeConfig(const pidProfile_t *pidProfile)
+{
+    controlRateConfig_t controlRate;
+    rollAndPitchTrims_t rollAndPitchTrims;
+    rxConfig_t rxConfig;
+
+    memset(&controlRate, 0, sizeof(controlRate));
+    memset(&rollAndPitchTrims, 0, sizeof(rollAndPitchTrims));
+    memset(&rxConfig, 0, sizeof(rxConfig));
+    pidInitConfig(pidProfile, &controlRate, 500, &rollAndPitchTrims, &rxConfig);
+    return &pidRuntimeConfig;
 }
 
 void resetRcCommands(void)
@@ -150,10 +179,8 @@ void pidControllerInitLuxFloatCore(void)
     PIDweight[FD_ROLL] = 100;
     PIDweight[FD_PITCH] = 100;
     PIDweight[FD_YAW] = 100;
-    // reset the pidLuxFloat static values
-    for (int axis = FD_ROLL; axis <= FD_YAW; ++axis) {
-        unittest_pidLuxFloatCore_lastRateForDelta[axis] = 0.0f;
-    }
+    // reset the deltas and filters
+    memset(&pidState, 0, sizeof(pidState));
 }
 
 void pidControllerInitLuxFloat(controlRateConfig_t *controlRate, uint16_t max_angle_inclination, rollAndPitchTrims_t *rollAndPitchTrims, rxConfig_t *rxConfig)
@@ -241,15 +268,15 @@ TEST(PIDUnittest, TestPidLuxFloat)
     // set up a rateError of zero on all axes
     resetRcCommands();
     resetGyroADC();
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_PTerm[FD_PITCH]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_ITerm[FD_PITCH]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_DTerm[FD_PITCH]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_PTerm[FD_YAW]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_ITerm[FD_YAW]);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_DTerm[FD_YAW]);
+    EXPECT_EQ(0, unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_EQ(0, unittest_pidKernelf_ITerm[FD_ROLL]);
+    EXPECT_EQ(0, unittest_pidKernelf_DTerm[FD_ROLL]);
+    EXPECT_EQ(0, unittest_pidKernelf_PTerm[FD_PITCH]);
+    EXPECT_EQ(0, unittest_pidKernelf_ITerm[FD_PITCH]);
+    EXPECT_EQ(0, unittest_pidKernelf_DTerm[FD_PITCH]);
+    EXPECT_EQ(0, unittest_pidKernelf_PTerm[FD_YAW]);
+    EXPECT_EQ(0, unittest_pidKernelf_ITerm[FD_YAW]);
+    EXPECT_EQ(0, unittest_pidKernelf_DTerm[FD_YAW]);
 
     // set up a rateError of 100 on the roll axis
     const float rateErrorRoll = 100;
@@ -270,61 +297,61 @@ TEST(PIDUnittest, TestPidLuxFloat)
     float ITermRoll = calcLuxITermDelta(pidProfile, FD_ROLL, rateErrorRoll);
     float ITermPitch = calcLuxITermDelta(pidProfile, FD_PITCH, rateErrorPitch);
     float ITermYaw = calcLuxITermDelta(pidProfile, FD_YAW, rateErrorYaw);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidKernelf_ITerm[FD_ROLL]);
     float expectedDTerm = calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidLuxFloatCore_PTerm[FD_PITCH]);
-    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidLuxFloatCore_ITerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidKernelf_PTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidKernelf_ITerm[FD_PITCH]);
     expectedDTerm = calcLuxDTerm(pidProfile, FD_PITCH, rateErrorPitch) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_PITCH]);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_YAW, rateErrorYaw), unittest_pidLuxFloatCore_PTerm[FD_YAW]);
-    EXPECT_FLOAT_EQ(ITermYaw, unittest_pidLuxFloatCore_ITerm[FD_YAW]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_YAW, rateErrorYaw), unittest_pidKernelf_PTerm[FD_YAW]);
+    EXPECT_FLOAT_EQ(ITermYaw, unittest_pidKernelf_ITerm[FD_YAW]);
     expectedDTerm = calcLuxDTerm(pidProfile, FD_YAW, rateErrorYaw) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_YAW]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_YAW]);
 
     // run the PID controller a second time.
     // Error rates unchanged, so expect P unchanged, I integrated and D averaged over DTermAverageCount
     ITermRoll += calcLuxITermDelta(pidProfile, FD_ROLL, rateErrorRoll);
     ITermPitch += calcLuxITermDelta(pidProfile, FD_PITCH, rateErrorPitch);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidKernelf_ITerm[FD_ROLL]);
     expectedDTerm = DTermAverageCount < 2 ? 0 : calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidLuxFloatCore_PTerm[FD_PITCH]);
-    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidLuxFloatCore_ITerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidKernelf_PTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidKernelf_ITerm[FD_PITCH]);
     expectedDTerm = DTermAverageCount < 2 ? 0 : calcLuxDTerm(pidProfile, FD_PITCH, rateErrorPitch) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_PITCH]);
 
     // run the PID controller a third time. Error rates unchanged, so expect P and D unchanged, I integrated
     // Error rates unchanged, so expect P unchanged, I integrated and D averaged over DTermAverageCount
     ITermRoll += calcLuxITermDelta(pidProfile, FD_ROLL, rateErrorRoll);
     ITermPitch += calcLuxITermDelta(pidProfile, FD_PITCH, rateErrorPitch);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidKernelf_ITerm[FD_ROLL]);
     expectedDTerm = DTermAverageCount < 3 ? 0 : calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidLuxFloatCore_PTerm[FD_PITCH]);
-    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidLuxFloatCore_ITerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidKernelf_PTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidKernelf_ITerm[FD_PITCH]);
     expectedDTerm = DTermAverageCount < 3 ? 0 : calcLuxDTerm(pidProfile, FD_PITCH, rateErrorPitch) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_PITCH]);
 
     // run the PID controller a fourth time.
     // Error rates unchanged, so expect P unchanged, I integrated and D averaged over DTermAverageCount
     ITermRoll += calcLuxITermDelta(pidProfile, FD_ROLL, rateErrorRoll);
     ITermPitch += calcLuxITermDelta(pidProfile, FD_PITCH, rateErrorPitch);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRoll), unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidKernelf_ITerm[FD_ROLL]);
     expectedDTerm = DTermAverageCount < 4 ? 0 : calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidLuxFloatCore_PTerm[FD_PITCH]);
-    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidLuxFloatCore_ITerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_PITCH, rateErrorPitch), unittest_pidKernelf_PTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(ITermPitch, unittest_pidKernelf_ITerm[FD_PITCH]);
     expectedDTerm = DTermAverageCount < 4 ? 0 : calcLuxDTerm(pidProfile, FD_PITCH, rateErrorPitch) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidLuxFloatCore_DTerm[FD_PITCH]);
+    EXPECT_FLOAT_EQ(expectedDTerm, unittest_pidKernelf_DTerm[FD_PITCH]);
 }
 
 TEST(PIDUnittest, TestPidLuxFloatIntegrationForLinearFunction)
@@ -350,8 +377,8 @@ TEST(PIDUnittest, TestPidLuxFloatIntegrationForLinearFunction)
     float t = 0.0f;
     // set rateError to k * t
     gyroADC[ROLL] = -k * t  / (luxGyroScale * gyro.scale);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    float pidITerm = unittest_pidLuxFloatCore_ITerm[FD_ROLL]; // integral as estimated by PID
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    float pidITerm = unittest_pidKernelf_ITerm[FD_ROLL]; // integral as estimated by PID
     float actITerm = 0.5 * k * t * t * pidProfile->I8[ROLL] * luxITermScale; // actual value of integral
     EXPECT_FLOAT_EQ(actITerm, pidITerm); // both are zero at this point
     pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
@@ -364,8 +391,8 @@ TEST(PIDUnittest, TestPidLuxFloatIntegrationForLinearFunction)
         t += dT;
         // set rateError to k * t
         gyroADC[ROLL] = -k * t / (luxGyroScale * gyro.scale);
-        pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-        pidITerm = unittest_pidLuxFloatCore_ITerm[FD_ROLL];
+        runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+        pidITerm = unittest_pidKernelf_ITerm[FD_ROLL];
         actITerm = 0.5 * k * t * t * pidProfile->I8[ROLL] * luxITermScale;
         const float pidITermDelta = pidITerm - pidITermPrev;
         const float actITermDelta = actITerm - actITermPrev;
@@ -398,8 +425,8 @@ TEST(PIDUnittest, TestPidLuxFloatIntegrationForQuadraticFunction)
     float t = 0.0f;
     // set rateError to k * t * t
     gyroADC[ROLL] = -k * t * t / (luxGyroScale * gyro.scale);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    float pidITerm = unittest_pidLuxFloatCore_ITerm[FD_ROLL]; // integral as estimated by PID
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    float pidITerm = unittest_pidKernelf_ITerm[FD_ROLL]; // integral as estimated by PID
     float actITerm = (1.0f/3.0f) * k * t * t * t * pidProfile->I8[ROLL] * luxITermScale; // actual value of integral
     EXPECT_FLOAT_EQ(actITerm, pidITerm); // both are zero at this point
 
@@ -412,8 +439,8 @@ TEST(PIDUnittest, TestPidLuxFloatIntegrationForQuadraticFunction)
         t += dT;
         // set rateError to k * t * t
         gyroADC[ROLL] = -k * t * t / (luxGyroScale * gyro.scale);
-        pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-        pidITerm = unittest_pidLuxFloatCore_ITerm[FD_ROLL];
+        runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+        pidITerm = unittest_pidKernelf_ITerm[FD_ROLL];
         actITerm = (1.0f/3.0f) * k * t * t * t * pidProfile->I8[ROLL] * luxITermScale;
         const float pidITermDelta = pidITerm - pidITermPrev;
         const float actITermDelta = actITerm - actITermPrev;
@@ -438,8 +465,8 @@ TEST(PIDUnittest, TestPidLuxFloatITermConstrain)
     rcCommand[ROLL] = calcLuxRcCommandRoll(0, &controlRate);
     float rateErrorRoll = calcLuxAngleRateRoll(&controlRate);
     EXPECT_EQ(0, rateErrorRoll);// cross check
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(0, unittest_pidKernelf_ITerm[FD_ROLL]);
 
     // set rateError to 100, ITerm should not be constrained
     pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
@@ -447,8 +474,8 @@ TEST(PIDUnittest, TestPidLuxFloatITermConstrain)
     rateErrorRoll = calcLuxAngleRateRoll(&controlRate);
     EXPECT_EQ(100, rateErrorRoll);// cross check
     const float ITerm = calcLuxITermDelta(pidProfile, FD_ROLL, rateErrorRoll);
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(ITerm, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(ITerm, unittest_pidKernelf_ITerm[FD_ROLL]);
 
     // set up a very large rateError to force ITerm to be constrained
     pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
@@ -456,8 +483,8 @@ TEST(PIDUnittest, TestPidLuxFloatITermConstrain)
     rcCommand[ROLL] = calcLuxRcCommandRoll(10000, &controlRate);
     rateErrorRoll = calcLuxAngleRateRoll(&controlRate);
     EXPECT_EQ(10000, rateErrorRoll);// cross check
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-//    EXPECT_FLOAT_EQ(PID_LUX_FLOAT_MAX_I, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+//    EXPECT_FLOAT_EQ(PID_LUX_FLOAT_MAX_I, unittest_pidKernelf_ITerm[FD_ROLL]);
 }
 
 TEST(PIDUnittest, TestPidLuxFloatDTermConstrain)
@@ -474,24 +501,24 @@ TEST(PIDUnittest, TestPidLuxFloatDTermConstrain)
     float rateErrorRoll = 0;
     gyroADC[ROLL] = -rateErrorRoll / (luxGyroScale * gyro.scale);
     resetRcCommands();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(0, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(0, unittest_pidKernelf_DTerm[FD_ROLL]);
 
     // set rateError to 100, DTerm should not be constrained
     pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
     rateErrorRoll = 100;
     gyroADC[ROLL] = -rateErrorRoll / (luxGyroScale * gyro.scale);
     resetRcCommands();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidKernelf_DTerm[FD_ROLL]);
 
     // set up a very large rateError to force DTerm to be constrained
     pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
     rateErrorRoll = 10000;
     gyroADC[ROLL] = -rateErrorRoll / (luxGyroScale * gyro.scale);
     resetRcCommands();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    //!!EXPECT_FLOAT_EQ(PID_LUX_FLOAT_MAX_D, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    //!!EXPECT_FLOAT_EQ(PID_LUX_FLOAT_MAX_D, unittest_pidKernelf_DTerm[FD_ROLL]);
 
     // now try a smaller value of dT
     // set rateError to 50, DTerm should not be constrained
@@ -500,8 +527,8 @@ TEST(PIDUnittest, TestPidLuxFloatDTermConstrain)
     rateErrorRoll = 50;
     gyroADC[ROLL] = -rateErrorRoll / (luxGyroScale * gyro.scale);
     resetRcCommands();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidKernelf_DTerm[FD_ROLL]);
 
     // now try a test for dT = 0.001, which is typical for real world case
     // set rateError to 30, DTerm should not be constrained
@@ -510,8 +537,8 @@ TEST(PIDUnittest, TestPidLuxFloatDTermConstrain)
     rateErrorRoll = 30;
     gyroADC[ROLL] = -rateErrorRoll / (luxGyroScale * gyro.scale);
     resetRcCommands();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidKernelf_DTerm[FD_ROLL]);
 
     // set rateError to 32
     pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
@@ -519,9 +546,9 @@ TEST(PIDUnittest, TestPidLuxFloatDTermConstrain)
     rateErrorRoll = 32;
     gyroADC[ROLL] = -rateErrorRoll / (luxGyroScale * gyro.scale);
     resetRcCommands();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
     // following test will fail, since DTerm will be constrained for when dT = 0.001
-    //!!!!//EXPECT_FLOAT_EQ(calcLuxDTerm(&pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    //!!!!//EXPECT_FLOAT_EQ(calcLuxDTerm(&pidProfile, FD_ROLL, rateErrorRoll) / DTermAverageCount, unittest_pidKernelf_DTerm[FD_ROLL]);
 }
 
 void pidControllerInitMultiWiiRewriteCore(void)
@@ -537,10 +564,8 @@ void pidControllerInitMultiWiiRewriteCore(void)
     PIDweight[FD_ROLL] = 100;
     PIDweight[FD_PITCH] = 100;
     PIDweight[FD_YAW] = 100;
-    // reset the pidMultiWiiRewrite static values
-    for (int axis = FD_ROLL; axis <= FD_YAW; ++axis) {
-        unittest_pidMultiWiiRewriteCore_lastRateForDelta[axis] = 0;
-    }
+    // reset the deltas and filters
+    memset(&pidState, 0, sizeof(pidState));
 }
 
 void pidControllerInitMultiWiiRewrite(controlRateConfig_t *controlRate, uint16_t max_angle_inclination, rollAndPitchTrims_t *rollAndPitchTrims, rxConfig_t *rxConfig)
@@ -630,16 +655,16 @@ TEST(PIDUnittest, TestPidMultiWiiRewrite)
     // set up a rateError of zero on all axes
     resetRcCommands();
     resetGyroADC();
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_PTerm[FD_PITCH]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_ITerm[FD_PITCH]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_DTerm[FD_PITCH]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_PTerm[FD_YAW]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_ITerm[FD_YAW]);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_DTerm[FD_YAW]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(0, unittest_pidKernel_PTerm[FD_ROLL]);
+    EXPECT_EQ(0, unittest_pidKernel_ITerm[FD_ROLL]);
+    EXPECT_EQ(0, unittest_pidKernel_DTerm[FD_ROLL]);
+    EXPECT_EQ(0, unittest_pidKernel_PTerm[FD_PITCH]);
+    EXPECT_EQ(0, unittest_pidKernel_ITerm[FD_PITCH]);
+    EXPECT_EQ(0, unittest_pidKernel_DTerm[FD_PITCH]);
+    EXPECT_EQ(0, unittest_pidKernel_PTerm[FD_YAW]);
+    EXPECT_EQ(0, unittest_pidKernel_ITerm[FD_YAW]);
+    EXPECT_EQ(0, unittest_pidKernel_DTerm[FD_YAW]);
 
     // set up a rateError of 100 on the roll axis
     const int32_t rateErrorRoll = 100;
@@ -655,16 +680,16 @@ TEST(PIDUnittest, TestPidMultiWiiRewrite)
     gyroADC[YAW] = -rateErrorYaw * mwrGyroScaleNum / mwrGyroScaleDenom;
     resetRcCommands();
 
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, rateErrorRoll), unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL]);
-    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, rateErrorRoll), unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
-    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDROLL, rateErrorRoll), unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL]);
-    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDPITCH, rateErrorPitch), unittest_pidMultiWiiRewriteCore_PTerm[FD_PITCH]);
-    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDPITCH, rateErrorPitch), unittest_pidMultiWiiRewriteCore_ITerm[FD_PITCH]);
-    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDPITCH, rateErrorPitch), unittest_pidMultiWiiRewriteCore_DTerm[FD_PITCH]);
-    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDYAW, rateErrorYaw), unittest_pidMultiWiiRewriteCore_PTerm[FD_YAW]);
-    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDYAW, rateErrorYaw), unittest_pidMultiWiiRewriteCore_ITerm[FD_YAW]);
-    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDYAW, rateErrorYaw) , unittest_pidMultiWiiRewriteCore_DTerm[FD_YAW]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, rateErrorRoll), unittest_pidKernel_PTerm[FD_ROLL]);
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, rateErrorRoll), unittest_pidKernel_ITerm[FD_ROLL]);
+    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDROLL, rateErrorRoll), unittest_pidKernel_DTerm[FD_ROLL]);
+    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDPITCH, rateErrorPitch), unittest_pidKernel_PTerm[FD_PITCH]);
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDPITCH, rateErrorPitch), unittest_pidKernel_ITerm[FD_PITCH]);
+    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDPITCH, rateErrorPitch), unittest_pidKernel_DTerm[FD_PITCH]);
+    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDYAW, rateErrorYaw), unittest_pidKernel_PTerm[FD_YAW]);
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDYAW, rateErrorYaw), unittest_pidKernel_ITerm[FD_YAW]);
+    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDYAW, rateErrorYaw) , unittest_pidKernel_DTerm[FD_YAW]);
 }
 
 TEST(PIDUnittest, TestPidMultiWiiRewriteITermConstrain)
@@ -681,16 +706,16 @@ TEST(PIDUnittest, TestPidMultiWiiRewriteITermConstrain)
     rcCommand[ROLL] = calcMwrRcCommandRoll(0, &controlRate);
     int16_t rateErrorRoll = calcMwrAngleRateRoll(&controlRate);
     EXPECT_EQ(0, rateErrorRoll);// cross check
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(0, unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(0, unittest_pidKernel_ITerm[FD_ROLL]);
 
     // set rateError to 100, ITerm should not be constrained
     pidControllerInitMultiWiiRewrite(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
     rcCommand[ROLL] = calcMwrRcCommandRoll(100, &controlRate);
     rateErrorRoll = calcMwrAngleRateRoll(&controlRate);
     EXPECT_EQ(100, rateErrorRoll);// cross check
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, rateErrorRoll), unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, rateErrorRoll), unittest_pidKernel_ITerm[FD_ROLL]);
 
     // set up a very large rateError and a large targetLooptime to force ITerm to be constrained
     pidControllerInitMultiWiiRewrite(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
@@ -698,41 +723,46 @@ TEST(PIDUnittest, TestPidMultiWiiRewriteITermConstrain)
     rcCommand[ROLL] = calcMwrRcCommandRoll(32750, &controlRate); // can't use INT16_MAX, since get rounding error
     rateErrorRoll = calcMwrAngleRateRoll(&controlRate);
     EXPECT_EQ(32750, rateErrorRoll);// cross check
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(GYRO_I_MAX, unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(GYRO_I_MAX, unittest_pidKernel_ITerm[FD_ROLL]);
 }
 
-TEST(PIDUnittest, TestPidMultiWiiRewritePidLuxFloatCoreEquivalence)
+TEST(PIDUnittest, TestPidKernelEquivalence)
 {
     pidProfile_t *pidProfile = &testPidProfile;
     const int angleRate = 200;
+    int16_t output[FD_INDEX_COUNT];
 
     pidControllerInitLuxFloatCore();
     EXPECT_EQ(TARGET_LOOPTIME, targetLooptime);
     EXPECT_FLOAT_EQ(TARGET_LOOPTIME * 0.000001f, dT);
 
-    pidLuxFloatCore(FD_ROLL, pidProfile, -angleRate, 0);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, angleRate), unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(calcLuxITermDelta(pidProfile, FD_ROLL, angleRate), unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, angleRate) / DTermAverageCount, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    const float luxGyroRate[FD_INDEX_COUNT] = { -angleRate, 0, 0 };
+    const float luxAngleRate[FD_INDEX_COUNT] = { 0, 0, 0 };
+    pidKernelf(&pidState, initPidRuntimeConfig(pidProfile), luxGyroRate, luxAngleRate, output);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, angleRate), unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(calcLuxITermDelta(pidProfile, FD_ROLL, angleRate), unittest_pidKernelf_ITerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, angleRate) / DTermAverageCount, unittest_pidKernelf_DTerm[FD_ROLL]);
 
     pidControllerInitMultiWiiRewriteCore();
     EXPECT_EQ(TARGET_LOOPTIME, targetLooptime);
     EXPECT_FLOAT_EQ(TARGET_LOOPTIME * 0.000001f, dT);
 
-    pidMultiWiiRewriteCore(FD_ROLL, pidProfile, -angleRate, 0);
-    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, angleRate), unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL]);
-    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, angleRate), unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
-    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDROLL, angleRate), unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL]);
+    const int32_t mwrGyroRate[FD_INDEX_COUNT] = { -angleRate, 0, 0 };
+    const int32_t mwrAngleRate[FD_INDEX_COUNT] = { 0, 0, 0 };
+    pidKernel(&pidState, initPidRuntimeConfig(pidProfile), mwrGyroRate, mwrAngleRate, output);
+    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, angleRate), unittest_pidKernel_PTerm[FD_ROLL]);
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, angleRate), unittest_pidKernel_ITerm[FD_ROLL]);
+    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDROLL, angleRate), unittest_pidKernel_DTerm[FD_ROLL]);
 
-    const float allowedPError = (float)unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL] / 100; // 1% error allowed
-    EXPECT_NEAR(unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL], unittest_pidLuxFloatCore_PTerm[FD_ROLL], allowedPError);
+    const float allowedPError = (float)unittest_pidKernel_PTerm[FD_ROLL] / 100; // 1% error allowed
+    EXPECT_NEAR(unittest_pidKernel_PTerm[FD_ROLL], unittest_pidKernelf_PTerm[FD_ROLL], allowedPError);
 
     const float allowedIError = 1.0f;
-    EXPECT_NEAR(unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL], unittest_pidLuxFloatCore_ITerm[FD_ROLL], allowedIError);
+    EXPECT_NEAR(unittest_pidKernel_ITerm[FD_ROLL], unittest_pidKernelf_ITerm[FD_ROLL], allowedIError);
 
-    const float allowedDError = (float)unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL] / 100; // 1% error allowed
-    EXPECT_NEAR(unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL], unittest_pidLuxFloatCore_DTerm[FD_ROLL], allowedDError);
+    const float allowedDError = (float)unittest_pidKernel_DTerm[FD_ROLL] / 100; // 1% error allowed
+    EXPECT_NEAR(unittest_pidKernel_DTerm[FD_ROLL], unittest_pidKernelf_DTerm[FD_ROLL], allowedDError);
 }
 
 TEST(PIDUnittest, TestPidMultiWiiRewritePidLuxFloatEquivalence)
@@ -758,11 +788,11 @@ TEST(PIDUnittest, TestPidMultiWiiRewritePidLuxFloatEquivalence)
     float ITermRoll = calcLuxITermDelta(pidProfile, FD_ROLL, rateErrorRollf);
 
     // run the PID controller. Check expected PID values
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRollf), unittest_pidLuxFloatCore_PTerm[FD_ROLL]);
-    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidLuxFloatCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, rateErrorRollf), unittest_pidKernelf_PTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(ITermRoll, unittest_pidKernelf_ITerm[FD_ROLL]);
     float expectedDTermf = calcLuxDTerm(pidProfile, FD_ROLL, rateErrorRollf) / DTermAverageCount;
-    EXPECT_FLOAT_EQ(expectedDTermf, unittest_pidLuxFloatCore_DTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(expectedDTermf, unittest_pidKernelf_DTerm[FD_ROLL]);
 
 
 
@@ -775,27 +805,506 @@ TEST(PIDUnittest, TestPidMultiWiiRewritePidLuxFloatEquivalence)
     resetRcCommands();
 
     // run the PID controller. Check expected PID values
-    pid_controller(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
-    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, rateErrorRoll), unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL]);
-    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, rateErrorRoll), unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL]);
+    runPidController(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, rateErrorRoll), unittest_pidKernel_PTerm[FD_ROLL]);
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, rateErrorRoll), unittest_pidKernel_ITerm[FD_ROLL]);
     int32_t expectedDTerm = calcMwrDTerm(pidProfile, PIDROLL, rateErrorRoll);
-    EXPECT_EQ(expectedDTerm, unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL]);
+    EXPECT_EQ(expectedDTerm, unittest_pidKernel_DTerm[FD_ROLL]);
 
-    const float allowedPError = (float)unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL] / 100; // 1% error allowed
-    EXPECT_NEAR(unittest_pidMultiWiiRewriteCore_PTerm[FD_ROLL], unittest_pidLuxFloatCore_PTerm[FD_ROLL], allowedPError);
+    const float allowedPError = (float)unittest_pidKernel_PTerm[FD_ROLL] / 100; // 1% error allowed
+    EXPECT_NEAR(unittest_pidKernel_PTerm[FD_ROLL], unittest_pidKernelf_PTerm[FD_ROLL], allowedPError);
 
     const float allowedIError = 1;
-    EXPECT_NEAR(unittest_pidMultiWiiRewriteCore_ITerm[FD_ROLL], unittest_pidLuxFloatCore_ITerm[FD_ROLL], allowedIError);
+    EXPECT_NEAR(unittest_pidKernel_ITerm[FD_ROLL], unittest_pidKernelf_ITerm[FD_ROLL], allowedIError);
+
+    const float allowedDError = (float)unittest_pidKernel_DTerm[FD_ROLL] / 100; // 1% error allowed
+    EXPECT_NEAR(unittest_pidKernel_DTerm[FD_ROLL], unittest_pidKernelf_DTerm[FD_ROLL], allowedDError);
+}
+/*
+ * Reference copy of pidLuxFloat as it was before pidRuntimeConfig, called through a function pointer and deriving the
+ * gains, rates and horizon strength from the profile every loop.  It keeps the same structure and unit test hooks as
+ * the real controller so the two can be timed against each other, only the blackbox and gtune code is left out.
+ */
+typedef void (*legacyPidControllerFuncPtr)(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
+        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig);
+
+static int16_t legacyAxisPID[3];
+static float legacyLastITermf[3], legacyITermLimitf[3];
+static float legacyLastRateForDelta[3];
+static float legacyPTerm[3], legacyITerm[3], legacyDTerm[3];
+static pt1Filter_t legacyDeltaFilter[3];
+static pt1Filter_t legacyYawFilter;
+
+// pidKernelf is in another file so it is not inlined either
+static __attribute__((noinline)) int16_t legacyPidLuxFloatCore(int axis, const pidProfile_t *pidProfile, float gyroRate, float angleRate)
+{
+    static float lastRateForDelta[3];
+
+    lastRateForDelta[axis] = legacyLastRateForDelta[axis];
+
+    const float rateError = angleRate - gyroRate;
+
+    float PTerm = luxPTermScale * rateError * pidProfile->P8[axis] * PIDweight[axis] / 100;
+    if (axis == YAW) {
+        if (pidProfile->yaw_lpf) {
+            PTerm = pt1FilterApply4(&legacyYawFilter, PTerm, pidProfile->yaw_lpf, dT);
+        }
+        if (pidProfile->yaw_p_limit && motorCount >= 4) {
+            PTerm = constrainf(PTerm, -pidProfile->yaw_p_limit, pidProfile->yaw_p_limit);
+        }
+    }
+
+    float ITerm = legacyLastITermf[axis] + luxITermScale * rateError * dT * pidProfile->I8[axis];
+    ITerm = constrainf(ITerm, -PID_MAX_I, PID_MAX_I);
+    if (rcModeIsActive(BOXAIRMODE)) {
+        if (STATE(ANTI_WINDUP) || motorLimitReached) {
+            ITerm = constrainf(ITerm, -legacyITermLimitf[axis], legacyITermLimitf[axis]);
+        } else {
+            legacyITermLimitf[axis] = ABS(ITerm);
+        }
+    }
+    legacyLastITermf[axis] = ITerm;
+
+    float DTerm;
+    if (pidProfile->D8[axis] == 0) {
+        DTerm = 0;
+    } else {
+        float delta;
+        if (pidProfile->deltaMethod == PID_DELTA_FROM_MEASUREMENT) {
+            delta = -(gyroRate - lastRateForDelta[axis]);
+            lastRateForDelta[axis] = gyroRate;
+        } else {
+            delta = rateError - lastRateForDelta[axis];
+            lastRateForDelta[axis] = rateError;
+        }
+        delta *= (1.0f / dT);
+        if (pidProfile->dterm_lpf) {
+            delta = pt1FilterApply4(&legacyDeltaFilter[axis], delta, pidProfile->dterm_lpf, dT);
+        }
+        DTerm = luxDTermScale * delta * pidProfile->D8[axis] * PIDweight[axis] / 100;
+        DTerm = constrainf(DTerm, -PID_MAX_D, PID_MAX_D);
+    }
+
+    legacyLastRateForDelta[axis] = lastRateForDelta[axis];
+    legacyPTerm[axis] = PTerm;
+    legacyITerm[axis] = ITerm;
+    legacyDTerm[axis] = DTerm;
+    return lrintf(PTerm + ITerm + DTerm);
+}
 
-    const float allowedDError = (float)unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL] / 100; // 1% error allowed
-    EXPECT_NEAR(unittest_pidMultiWiiRewriteCore_DTerm[FD_ROLL], unittest_pidLuxFloatCore_DTerm[FD_ROLL], allowedDError);
+static void legacyPidLuxFloat(const pidProfile_t *pidProfile, const controlRateConfig_t *controlRateConfig,
+        uint16_t max_angle_inclination, const rollAndPitchTrims_t *angleTrim, const rxConfig_t *rxConfig)
+{
+    float horizonLevelStrength = 0.0f;
+    if (FLIGHT_MODE(HORIZON_MODE)) {
+        const int32_t stickPosAil = ABS(getRcStickDeflection(ROLL, rxConfig->midrc));
+        const int32_t stickPosEle = ABS(getRcStickDeflection(PITCH, rxConfig->midrc));
+        const int32_t mostDeflectedPos =  MAX(stickPosAil, stickPosEle);
+
+        horizonLevelStrength = (float)(500 - mostDeflectedPos) / 500;
+        if (pidProfile->D8[PIDLEVEL] == 0) {
+            horizonLevelStrength = 0;
+        } else {
+            horizonLevelStrength = constrainf(((horizonLevelStrength - 1) * (100 / pidProfile->D8[PIDLEVEL])) + 1, 0, 1);
+        }
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        const uint8_t rate = controlRateConfig->rates[axis];
+
+        float angleRate;
+        if (axis == FD_YAW) {
+            angleRate = (float)((rate + 27) * rcCommand[YAW]) / 32.0f;
+        } else {
+            angleRate = (float)((rate + 27) * rcCommand[axis]) / 16.0f;
+            if (FLIGHT_MODE(ANGLE_MODE) || FLIGHT_MODE(HORIZON_MODE)) {
+                const float errorAngle = constrain(2 * rcCommand[axis] + GPS_angle[axis], -((int)max_angle_inclination), max_angle_inclination)
+                        - attitude.raw[axis] + angleTrim->raw[axis];
+                if (FLIGHT_MODE(ANGLE_MODE)) {
+                    angleRate = errorAngle * pidProfile->P8[PIDLEVEL] / 16.0f;
+                } else {
+                    angleRate += errorAngle * pidProfile->I8[PIDLEVEL] * horizonLevelStrength / 16.0f;
+                }
+            }
+        }
+
+        const float gyroRate = luxGyroScale * gyroADC[axis] * gyro.scale;
+        legacyAxisPID[axis] = legacyPidLuxFloatCore(axis, pidProfile, gyroRate, angleRate);
+    }
+}
+
+#define COST_LOOP_COUNT 100000
+static int16_t legacyCostOutput[COST_LOOP_COUNT][3];
+static int16_t costOutput[COST_LOOP_COUNT][3];
+
+static clock_t runLegacyPidController(const int16_t *stick, const pidProfile_t *pidProfile, const controlRateConfig_t *controlRate,
+        uint16_t max_angle_inclination, const rollAndPitchTrims_t *rollAndPitchTrims, const rxConfig_t *rxConfig)
+{
+    // the function pointer is volatile so the compiler cannot bind the call statically
+    legacyPidControllerFuncPtr volatile legacyPidController = legacyPidLuxFloat;
+
+    clock_t start = clock();
+    for (int i = 0; i < COST_LOOP_COUNT; i++) {
+        rcCommand[ROLL] = rcCommand[PITCH] = rcCommand[YAW] = stick[i];
+        rcData[ROLL] = rcData[PITCH] = rxConfig->midrc + stick[i];
+        gyroADC[ROLL] = gyroADC[PITCH] = gyroADC[YAW] = stick[i] * 8 + (i & 7);
+        legacyPidController(pidProfile, controlRate, max_angle_inclination, rollAndPitchTrims, rxConfig);
+        memcpy(legacyCostOutput[i], legacyAxisPID, sizeof(legacyAxisPID));
+    }
+    return clock() - start;
 }
+
+static clock_t runPidControllerLoops(const int16_t *stick, const rxConfig_t *rxConfig)
+{
+    clock_t start = clock();
+    for (int i = 0; i < COST_LOOP_COUNT; i++) {
+        rcCommand[ROLL] = rcCommand[PITCH] = rcCommand[YAW] = stick[i];
+        rcData[ROLL] = rcData[PITCH] = rxConfig->midrc + stick[i];
+        gyroADC[ROLL] = gyroADC[PITCH] = gyroADC[YAW] = stick[i] * 8 + (i & 7);
+        pidController();
+        memcpy(costOutput[i], axisPID, sizeof(axisPID));
+    }
+    return clock() - start;
+}
+
+TEST(PIDUnittest, TestPidRuntimeConfigCpuCost)
+{
+    pidProfile_t *pidProfile = &testPidProfile;
+    controlRateConfig_t controlRate;
+    const uint16_t max_angle_inclination = 500; // 50 degrees
+    rollAndPitchTrims_t rollAndPitchTrims;
+    rxConfig_t rxConfig;
+
+    pidControllerInitLuxFloat(&controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+    pidProfile->D8[PIDLEVEL] = 50;
+    rxConfig.midrc = 1500;
+    flightModeFlags = HORIZON_MODE;
+    memset(legacyLastITermf, 0, sizeof(legacyLastITermf));
+    memset(legacyITermLimitf, 0, sizeof(legacyITermLimitf));
+    memset(legacyLastRateForDelta, 0, sizeof(legacyLastRateForDelta));
+
+    // stick and gyro movement that keeps all three terms away from their limits
+    static int16_t stick[COST_LOOP_COUNT];
+    for (int i = 0; i < COST_LOOP_COUNT; i++) {
+        stick[i] = lrintf(200 * sinf(i * 0.001f));
+    }
+    pidInitConfig(pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+
+    // the runs are interleaved and the fastest of each kept, to reduce the effect of anything else the host is doing
+    clock_t legacyTicks = 0;
+    clock_t ticks = 0;
+    for (int run = 0; run < 5; run++) {
+        clock_t runTicks = runLegacyPidController(stick, pidProfile, &controlRate, max_angle_inclination, &rollAndPitchTrims, &rxConfig);
+        legacyTicks = run == 0 ? runTicks : MIN(legacyTicks, runTicks);
+        runTicks = runPidControllerLoops(stick, &rxConfig);
+        ticks = run == 0 ? runTicks : MIN(ticks, runTicks);
+    }
+
+    flightModeFlags = 0;
+
+    // the gains are scaled in a different order so the float rounding can differ
+    for (int i = 0; i < COST_LOOP_COUNT; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            ASSERT_NEAR(legacyCostOutput[i][axis], costOutput[i][axis], 1);
+        }
+    }
+
+    printf("%d loops, pid_controller: %ldns per loop, pidController: %ldns per loop\n", COST_LOOP_COUNT,
+        (long)(legacyTicks * (1000000000 / COST_LOOP_COUNT) / CLOCKS_PER_SEC), (long)(ticks * (1000000000 / COST_LOOP_COUNT) / CLOCKS_PER_SEC));
+}
+
+/*
+ * Reference copy of pidMultiWiiRewriteCore as it was before pidKernel, one axis per call with the yaw special cases
+ * in line.  Used with legacyPidLuxFloatCore to check the kernels give the same output for all three axes.
+ */
+static int32_t legacyLastITerm[3], legacyITermLimit[3];
+static int32_t legacyLastRateForDeltai[3];
+static pt1Filter_t legacyDeltaFilteri[3];
+static pt1Filter_t legacyYawFilteri;
+
+static int16_t legacyPidMultiWiiRewriteCore(int axis, const pidProfile_t *pidProfile, int32_t gyroRate, int32_t angleRate)
+{
+    const int32_t rateError = angleRate - gyroRate;
+
+    int32_t PTerm = (rateError * pidProfile->P8[axis] * PIDweight[axis] / 100) >> 7;
+    if (axis == YAW) {
+        if (pidProfile->yaw_lpf) {
+            PTerm = pt1FilterApply4(&legacyYawFilteri, PTerm, pidProfile->yaw_lpf, dT);
+        }
+        if (pidProfile->yaw_p_limit && motorCount >= 4) {
+            PTerm = constrain(PTerm, -pidProfile->yaw_p_limit, pidProfile->yaw_p_limit);
+        }
+    }
+
+    int32_t ITerm = legacyLastITerm[axis] + ((rateError * (uint16_t)targetLooptime) >> 11) * pidProfile->I8[axis];
+    ITerm = constrain(ITerm, (int32_t)-(PID_MAX_I << 13), (int32_t)(PID_MAX_I << 13));
+    if (rcModeIsActive(BOXAIRMODE)) {
+        if (STATE(ANTI_WINDUP) || motorLimitReached) {
+            ITerm = constrain(ITerm, -legacyITermLimit[axis], legacyITermLimit[axis]);
+        } else {
+            legacyITermLimit[axis] = ABS(ITerm);
+        }
+    }
+    legacyLastITerm[axis] = ITerm;
+    ITerm = ITerm >> 13;
+
+    int32_t DTerm;
+    if (pidProfile->D8[axis] == 0) {
+        DTerm = 0;
+    } else {
+        int32_t delta;
+        if (pidProfile->deltaMethod == PID_DELTA_FROM_MEASUREMENT) {
+            delta = -(gyroRate - legacyLastRateForDeltai[axis]);
+            legacyLastRateForDeltai[axis] = gyroRate;
+        } else {
+            delta = rateError - legacyLastRateForDeltai[axis];
+            legacyLastRateForDeltai[axis] = rateError;
+        }
+        delta = (delta * ((uint16_t)0xFFFF / ((uint16_t)targetLooptime >> 4))) >> 5;
+        if (pidProfile->dterm_lpf) {
+            delta = lrintf(pt1FilterApply4(&legacyDeltaFilteri[axis], (float)delta, pidProfile->dterm_lpf, dT));
+        }
+        DTerm = (delta * pidProfile->D8[axis] * PIDweight[axis] / 100) >> 8;
+        DTerm = constrain(DTerm, -PID_MAX_D, PID_MAX_D);
+    }
+
+    return PTerm + ITerm + DTerm;
+}
+
+static void resetLegacyPidState(void)
+{
+    memset(legacyLastITermf, 0, sizeof(legacyLastITermf));
+    memset(legacyITermLimitf, 0, sizeof(legacyITermLimitf));
+    memset(legacyLastRateForDelta, 0, sizeof(legacyLastRateForDelta));
+    memset(legacyDeltaFilter, 0, sizeof(legacyDeltaFilter));
+    memset(&legacyYawFilter, 0, sizeof(legacyYawFilter));
+    memset(legacyLastITerm, 0, sizeof(legacyLastITerm));
+    memset(legacyITermLimit, 0, sizeof(legacyITermLimit));
+    memset(legacyLastRateForDeltai, 0, sizeof(legacyLastRateForDeltai));
+    memset(legacyDeltaFilteri, 0, sizeof(legacyDeltaFilteri));
+    memset(&legacyYawFilteri, 0, sizeof(legacyYawFilteri));
+}
+
+#define GOLDEN_LOOP_COUNT 2000
+
+TEST(PIDUnittest, TestPidKernelGoldenOutput)
+{
+    pidProfile_t *pidProfile = &testPidProfile;
+    const uint8_t deltaMethods[] = { PID_DELTA_FROM_MEASUREMENT, PID_DELTA_FROM_ERROR };
+
+    for (unsigned method = 0; method < ARRAYLEN(deltaMethods); method++) {
+        pidControllerInitMultiWiiRewriteCore();
+        resetLegacyPidState();
+        pidProfile->deltaMethod = deltaMethods[method];
+        pidProfile->dterm_lpf = 100;
+        pidProfile->yaw_lpf = 80;
+        pidProfile->yaw_p_limit = 300;
+        pidProfile->D8[PIDYAW] = 0;
+        const pidRuntimeConfig_t *pidConfig = initPidRuntimeConfig(pidProfile);
+        // each kernel has its own state so the filters are not shared
+        pidState_t state, statef;
+        memset(&state, 0, sizeof(state));
+        memset(&statef, 0, sizeof(statef));
+        // airmode with the motors saturated for part of the run, to exercise the anti windup
+        rcModeActivationMask = 1 << BOXAIRMODE;
+
+        srand(method + 1);
+        for (int i = 0; i < GOLDEN_LOOP_COUNT; i++) {
+            int32_t gyroRate[FD_INDEX_COUNT];
+            int32_t angleRate[FD_INDEX_COUNT];
+            float gyroRatef[FD_INDEX_COUNT];
+            float angleRatef[FD_INDEX_COUNT];
+            int16_t output[FD_INDEX_COUNT];
+            int16_t outputf[FD_INDEX_COUNT];
+
+            motorLimitReached = (i / 100) & 1;
+            for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+                gyroRate[axis] = rand() % 2001 - 1000;
+                angleRate[axis] = rand() % 2001 - 1000;
+                gyroRatef[axis] = gyroRate[axis];
+                angleRatef[axis] = angleRate[axis];
+            }
+
+            pidKernel(&state, pidConfig, gyroRate, angleRate, output);
+            pidKernelf(&statef, pidConfig, gyroRatef, angleRatef, outputf);
+            for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+                const int16_t expected = legacyPidMultiWiiRewriteCore(axis, pidProfile, gyroRate[axis], angleRate[axis]);
+                ASSERT_EQ(expected, output[axis]) << "loop " << i << " axis " << axis;
+                // the lux gains are scaled in a different order so the float rounding can differ
+                const int16_t expectedf = legacyPidLuxFloatCore(axis, pidProfile, gyroRatef[axis], angleRatef[axis]);
+                ASSERT_NEAR(expectedf, outputf[axis], 1) << "loop " << i << " axis " << axis;
+            }
+        }
+    }
+    rcModeActivationMask = 0;
+    motorLimitReached = false;
+}
+
+TEST(PIDUnittest, TestPidSetpointWeighting)
+{
+    pidProfile_t *pidProfile = &testPidProfile;
+    int16_t output[FD_INDEX_COUNT];
+    const int32_t gyroRate[FD_INDEX_COUNT] = { 100, 100, 100 };
+    const int32_t angleRate[FD_INDEX_COUNT] = { 300, 300, 300 };
+    const float gyroRatef[FD_INDEX_COUNT] = { 100, 100, 100 };
+    const float angleRatef[FD_INDEX_COUNT] = { 300, 300, 300 };
+
+    // the P term sees half the setpoint
+    pidControllerInitMultiWiiRewriteCore();
+    pidProfile->PTermSetpointWeight = 50;
+    pidKernel(&pidState, initPidRuntimeConfig(pidProfile), gyroRate, angleRate, output);
+    EXPECT_EQ(calcMwrPTerm(pidProfile, PIDROLL, 150 - 100), unittest_pidKernel_PTerm[FD_ROLL]);
+    // the I term always sees the whole error
+    EXPECT_EQ(calcMwrITermDelta(pidProfile, PIDROLL, 300 - 100), unittest_pidKernel_ITerm[FD_ROLL]);
+    pidKernelf(&pidState, initPidRuntimeConfig(pidProfile), gyroRatef, angleRatef, output);
+    EXPECT_FLOAT_EQ(calcLuxPTerm(pidProfile, FD_ROLL, 150 - 100), unittest_pidKernelf_PTerm[FD_ROLL]);
+
+    // a D term setpoint weight of 100% is the same as taking the delta from the error
+    int16_t weightedOutput[FD_INDEX_COUNT];
+    pidControllerInitMultiWiiRewriteCore();
+    pidProfile->DTermSetpointWeight = 100;
+    pidKernel(&pidState, initPidRuntimeConfig(pidProfile), gyroRate, angleRate, weightedOutput);
+    EXPECT_EQ(calcMwrDTerm(pidProfile, PIDROLL, 300 - 100), unittest_pidKernel_DTerm[FD_ROLL]);
+
+    pidControllerInitMultiWiiRewriteCore();
+    pidProfile->deltaMethod = PID_DELTA_FROM_ERROR;
+    pidKernel(&pidState, initPidRuntimeConfig(pidProfile), gyroRate, angleRate, output);
+    EXPECT_EQ(0, memcmp(weightedOutput, output, sizeof(output)));
+}
+
+TEST(PIDUnittest, TestPidFeedForward)
+{
+    pidProfile_t *pidProfile = &testPidProfile;
+    int16_t output[FD_INDEX_COUNT];
+    const int32_t gyroRate[FD_INDEX_COUNT] = { 0, 0, 0 };
+    const float gyroRatef[FD_INDEX_COUNT] = { 0, 0, 0 };
+    const int32_t angleRate[FD_INDEX_COUNT] = { 100, -100, 50 };
+    const float angleRatef[FD_INDEX_COUNT] = { 100, -100, 50 };
+
+    // no feed forward by default
+    pidControllerInitMultiWiiRewriteCore();
+    pidKernel(&pidState, initPidRuntimeConfig(pidProfile), gyroRate, angleRate, output);
+    EXPECT_EQ(0, unittest_pidKernel_FTerm[FD_ROLL]);
+
+    // feed forward is the rate of change of the setpoint, scaled the same as the D term
+    pidControllerInitMultiWiiRewriteCore();
+    pidProfile->feedForward = 20;
+    pidProfile->D8[PIDROLL] = 20;
+    pidProfile->D8[PIDPITCH] = 20;
+    pidProfile->D8[PIDYAW] = 20;
+    pidProfile->deltaMethod = PID_DELTA_FROM_ERROR;
+    const pidRuntimeConfig_t *pidConfig = initPidRuntimeConfig(pidProfile);
+    pidKernel(&pidState, pidConfig, gyroRate, angleRate, output);
+    for (int axis = 0; axis < FD_INDEX_COUNT; axis++) {
+        EXPECT_EQ(unittest_pidKernel_DTerm[axis], unittest_pidKernel_FTerm[axis]);
+    }
+    // and is zero once the setpoint stops changing
+    pidKernel(&pidState, pidConfig, gyroRate, angleRate, output);
+    EXPECT_EQ(0, unittest_pidKernel_FTerm[FD_ROLL]);
+
+    pidControllerInitLuxFloatCore();
+    pidProfile->feedForward = 20;
+    pidProfile->D8[PIDROLL] = 20;
+    pidProfile->deltaMethod = PID_DELTA_FROM_ERROR;
+    pidKernelf(&pidState, initPidRuntimeConfig(pidProfile), gyroRatef, angleRatef, output);
+    EXPECT_FLOAT_EQ(calcLuxDTerm(pidProfile, FD_ROLL, 100), unittest_pidKernelf_FTerm[FD_ROLL]);
+    EXPECT_FLOAT_EQ(unittest_pidKernelf_DTerm[FD_ROLL], unittest_pidKernelf_FTerm[FD_ROLL]);
+
+    // filtered
+    pidControllerInitLuxFloatCore();
+    pidProfile->feedForward = 20;
+    pidProfile->feedForwardLpf = 40;
+    pidProfile->D8[PIDROLL] = 20;
+    pidKernelf(&pidState, initPidRuntimeConfig(pidProfile), gyroRatef, angleRatef, output);
+    EXPECT_GT(unittest_pidKernelf_FTerm[FD_ROLL], 0);
+    EXPECT_LT(unittest_pidKernelf_FTerm[FD_ROLL], calcLuxDTerm(pidProfile, FD_ROLL, 100) / 2);
+}
+
+/*
+ * A single axis of a simple airframe: the PID output drives the motors through a first order lag and the angular
+ * acceleration is proportional to the motor output, less some aerodynamic damping.  Rates are in the units of the
+ * kernels.  The stick moves to the target over three RX frames.  Returns the time taken for the measured rate to
+ * reach half the target, in loops.
+ */
+#define SIM_RX_FRAME_LOOPS 10       // 50Hz RX with the 2048us test looptime
+#define SIM_LOOPS 500
+
+static int simulateRateStep(const pidProfile_t *pidProfile, bool useFloat, int32_t targetRate, float *overshoot)
+{
+    const float motorTimeConstant = 0.02f;          // s
+    const float angularAccelerationGain = 80.0f;    // rate units per second per unit of PID output
+    const float damping = 2.0f;                     // per second
+    const pidRuntimeConfig_t *pidConfig = initPidRuntimeConfig(pidProfile);
+    pidState_t state;
+    memset(&state, 0, sizeof(state));
+
+    float motor = 0;
+    float rate = 0;
+    float maxRate = 0;
+    int halfRiseLoops = -1;
+    for (int i = 0; i < SIM_LOOPS; i++) {
+        const int frame = MIN(i / SIM_RX_FRAME_LOOPS + 1, 3);
+        const int32_t setpoint = targetRate * frame / 3;
+        int16_t output[FD_INDEX_COUNT];
+
+        if (useFloat) {
+            const float gyroRatef[FD_INDEX_COUNT] = { rate, 0, 0 };
+            const float angleRatef[FD_INDEX_COUNT] = { (float)setpoint, 0, 0 };
+            pidKernelf(&state, pidConfig, gyroRatef, angleRatef, output);
+        } else {
+            const int32_t gyroRate[FD_INDEX_COUNT] = { (int32_t)lrintf(rate), 0, 0 };
+            const int32_t angleRate[FD_INDEX_COUNT] = { setpoint, 0, 0 };
+            pidKernel(&state, pidConfig, gyroRate, angleRate, output);
+        }
+
+        motor += (output[FD_ROLL] - motor) * dT / (motorTimeConstant + dT);
+        rate += (angularAccelerationGain * motor - damping * rate) * dT;
+        maxRate = MAX(maxRate, rate);
+        if (halfRiseLoops < 0 && rate >= targetRate / 2) {
+            halfRiseLoops = i;
+        }
+    }
+    *overshoot = (maxRate - targetRate) / targetRate;
+    return halfRiseLoops;
+}
+
+TEST(PIDUnittest, TestPidFeedForwardReducesLatency)
+{
+    pidProfile_t *pidProfile = &testPidProfile;
+    const int32_t targetRate = 800;
+
+    for (int kernel = 0; kernel < 2; kernel++) {
+        const bool useFloat = kernel == 1;
+        float overshoot;
+        float feedForwardOvershoot;
+
+        pidControllerInitMultiWiiRewriteCore();
+        pidProfile->D8[PIDROLL] = 23;
+        pidProfile->dterm_lpf = 100;
+        const int loops = simulateRateStep(pidProfile, useFloat, targetRate, &overshoot);
+
+        pidProfile->feedForward = 100;
+        pidProfile->feedForwardLpf = 40;
+        const int feedForwardLoops = simulateRateStep(pidProfile, useFloat, targetRate, &feedForwardOvershoot);
+
+        printf("%s kernel, time to half rate: %dms without feed forward, %dms with, overshoot %d%% and %d%%\n",
+            useFloat ? "float" : "integer", loops * TARGET_LOOPTIME / 1000, feedForwardLoops * TARGET_LOOPTIME / 1000,
+            (int)lrintf(overshoot * 100), (int)lrintf(feedForwardOvershoot * 100));
+
+        EXPECT_GT(loops, 0);
+        EXPECT_GT(feedForwardLoops, 0);
+        EXPECT_LT(feedForwardLoops, loops * 3 / 4);
+        EXPECT_LT(feedForwardOvershoot, 0.25f);
+    }
+}
+
 // STUBS
 
 extern "C" {
-bool rcModeIsActive(boxId_e modeId)  { return rcModeActivationMask & (1 << modeId); }
+// not inlined into the reference controller, the real controllers are in other files and cannot inline them either
+__attribute__((noinline)) bool rcModeIsActive(boxId_e modeId)  { return rcModeActivationMask & (1 << modeId); }
 int16_t GPS_angle[ANGLE_INDEX_COUNT] = { 0, 0 };
-int32_t getRcStickDeflection(int32_t axis, uint16_t midrc) {return MIN(ABS(rcData[axis] - midrc), 500);}
+__attribute__((noinline)) int32_t getRcStickDeflection(int32_t axis, uint16_t midrc) {return MIN(ABS(rcData[axis] - midrc), 500);}
 attitudeEulerAngles_t attitude = { { 0, 0, 0 } };
 void resetRollAndPitchTrims(rollAndPitchTrims_t *rollAndPitchTrims) {rollAndPitchTrims->values.roll = 0;rollAndPitchTrims->values.pitch = 0;};
 uint16_t flightModeFlags = 0; // acro mode
@@ -0,0 +1,693 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+extern "C" {
+    #include <platform.h>
+    #include "build/build_config.h"
+    #include "build/debug.h"
+
+    #include "common/axis.h"
+    #include "common/maths.h"
+    #include "common/filter.h"
+    #include "common/utils.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+    #include "config/profile.h"
+
+    #include "drivers/sensor.h"
+    #include "drivers/accgyro.h"
+    #include "drivers/pwm_mapping.h"
+
+    #include "sensors/sensors.h"
+    #include "sensors/gyro.h"
+    #include "sensors/acceleration.h"
+
+    #include "fc/runtime_config.h"
+
+    #include "rx/rx.h"
+    #include "io/motor_and_servo.h"
+    #include "io/gimbal.h"
+    #include "fc/rc_controls.h"
+    #include "fc/rate_profile.h"
+    #include "fc/rc_curves.h"
+
+    #include "flight/pid.h"
+    #include "flight/pid_kernel.h"
+    #include "flight/imu.h"
+    #include "flight/mixer.h"
+    #include "flight/servos.h"
+
+    void mixerInit(motorMixer_t *initialCustomMixers);
+    void mixerInitServos(servoMixer_t *initialCustomServoMixers);
+    void mixerUsePWMIOConfiguration(pwmIOConfiguration_t *pwmIOConfiguration);
+
+    extern motorMixer_t currentMixer[MAX_SUPPORTED_MOTORS];
+    extern uint8_t motorCount;
+    extern uint8_t PIDweight[3];
+    extern uint8_t dynP8[3], dynI8[3], dynD8[3];
+
+    extern float q0, q1, q2, q3;
+    extern float deltaAngle[XYZ_AXIS_COUNT];
+    extern uint32_t deltaAngleTime;
+
+    PG_REGISTER_PROFILE(gimbalConfig_t, gimbalConfig, PG_GIMBAL_CONFIG, 0);
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+    PG_REGISTER(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 0);
+    PG_REGISTER_PROFILE(rcControlsConfig_t, rcControlsConfig, PG_RC_CONTROLS_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+/*
+ * Closed loop simulation of a quad.
+ *
+ * The real gyro filter, IMU, rc curves, PID controllers and mixer fly a rigid body model of a 250 class quad in X
+ * configuration on a virtual clock.  Each loop the sensors are sampled from the model, then the flight controller
+ * runs in the order of taskMainPidLoop() and the motor outputs drive the model for one looptime.
+ *
+ * The model is deliberately simple: first order motor lag, thrust proportional to the square of the motor speed,
+ * the torques come from the lever arms in currentMixer and the gyro and accelerometer see white noise.  It is meant
+ * for comparing settings against each other, not for predicting how a particular craft flies.  A simulated
+ * second of flight takes a few milliseconds, so thousands of filter and PID settings can be swept in a test run.
+ */
+
+#define SIM_GRAVITY 9.81f
+#define SIM_MASS 0.5f                       // kg
+#define SIM_MAX_THRUST (SIM_MASS * SIM_GRAVITY) // N per motor, thrust to weight of 4
+#define SIM_ARM_LENGTH 0.057f               // m, lever arm about the roll and pitch axes of a 160mm X frame
+#define SIM_YAW_TORQUE 0.015f               // Nm of reaction torque per N of thrust
+#define SIM_ROTATIONAL_DRAG 0.0005f         // Nm per rad/s
+#define SIM_MOTOR_COMMAND_MIN 1000
+#define SIM_MOTOR_COMMAND_MAX 2000
+
+#define SIM_GYRO_SCALE (1.0f / 16.4f)       // deg/s per LSB, as the MPU6050 at 2000 deg/s
+#define SIM_ACC_1G 512
+
+#define SIM_RADIANS_TO_DEGREES(angle) ((angle) * 57.2957796f)
+
+#define SIM_HOVER_THROTTLE 1550             // rcData, gives a motor output of 1500 with the default curves
+#define SIM_SETTLE_TIME 0.5f                // s
+#define SIM_HOVER_TIME 0.5f                 // s, motor variance is measured while hovering
+#define SIM_STEP_TIME 0.5f                  // s
+#define SIM_SETTLED_TIME 0.1f               // s, the end of the step averaged for the settled rate
+
+static const float simInertia[XYZ_AXIS_COUNT] = { 0.0015f, 0.0015f, 0.0028f };   // kg m^2
+
+typedef struct simConfig_s {
+    float gyroNoise;                        // deg/s RMS
+    float accNoise;                         // g RMS
+    float motorTimeConstant;                // s
+} simConfig_t;
+
+typedef struct simCraft_s {
+    float motorSpeed[MAX_SUPPORTED_MOTORS]; // fraction of full speed
+    float rate[XYZ_AXIS_COUNT];             // rad/s in the body frame
+    float q[4];                             // attitude, same convention as the IMU
+} simCraft_t;
+
+typedef struct simResult_s {
+    float commandedRate;                    // deg/s
+    float settledRate;                      // deg/s
+    float riseTime;                         // s, from 10% to 90% of the settled rate
+    float overshoot;                        // percent of the settled rate
+    float motorVariance;                    // us^2, averaged over the motors while hovering
+} simResult_t;
+
+static simConfig_t simConfig;
+static simCraft_t craft;
+static biquad_t simGyroFilterState[XYZ_AXIS_COUNT];
+static uint32_t simRandomState;
+static rollAndPitchTrims_t simTrims;
+static imuRuntimeConfig_t simImuRuntimeConfig;
+static accDeadband_t simAccDeadband;
+
+extern "C" {
+    uint32_t currentTimeUs;
+    uint32_t targetLooptime;
+    int16_t cycleTime;
+    float dT;
+    extern int32_t accADC[XYZ_AXIS_COUNT];
+}
+
+// xorshift, reproducible between runs and platforms
+static float simRandomUniform(void)
+{
+    simRandomState ^= simRandomState << 13;
+    simRandomState ^= simRandomState >> 17;
+    simRandomState ^= simRandomState << 5;
+    return (simRandomState + 0.5f) / 4294967296.0f;
+}
+
+static float simRandomGaussian(void)
+{
+    // Box-Muller
+    return sqrtf(-2.0f * logf(simRandomUniform())) * cosf(2.0f * M_PIf * simRandomUniform());
+}
+
+static void simQuaternionMultiply(const float a[4], const float b[4], float out[4])
+{
+    out[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    out[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    out[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    out[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+}
+
+// the direction of gravity in the body frame, which is what the accelerometer sees while hovering
+static void simUpVector(const float q[4], float up[3])
+{
+    up[0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    up[1] = 2.0f * (q[2] * q[3] + q[0] * q[1]);
+    up[2] = 1.0f - 2.0f * q[1] * q[1] - 2.0f * q[2] * q[2];
+}
+
+static void simUpdateCraft(float dt)
+{
+    float thrust[MAX_SUPPORTED_MOTORS];
+    float torque[XYZ_AXIS_COUNT] = { 0, 0, 0 };
+
+    for (int i = 0; i < motorCount; i++) {
+        const float command = constrainf((float)(motor[i] - SIM_MOTOR_COMMAND_MIN) / (SIM_MOTOR_COMMAND_MAX - SIM_MOTOR_COMMAND_MIN), 0.0f, 1.0f);
+        craft.motorSpeed[i] += (command - craft.motorSpeed[i]) * dt / (simConfig.motorTimeConstant + dt);
+        thrust[i] = SIM_MAX_THRUST * sq(craft.motorSpeed[i]);
+
+        torque[FD_ROLL] += thrust[i] * currentMixer[i].roll * SIM_ARM_LENGTH;
+        torque[FD_PITCH] += thrust[i] * currentMixer[i].pitch * SIM_ARM_LENGTH;
+        // the mixer adds yaw as -yaw_motor_direction * axisPID[FD_YAW] * yaw
+        torque[FD_YAW] -= thrust[i] * currentMixer[i].yaw * mixerConfig()->yaw_motor_direction * SIM_YAW_TORQUE;
+    }
+
+    // Euler's equations, the gyroscopic term couples the axes
+    const float momentum[XYZ_AXIS_COUNT] = { simInertia[X] * craft.rate[X], simInertia[Y] * craft.rate[Y], simInertia[Z] * craft.rate[Z] };
+    const float gyroscopic[XYZ_AXIS_COUNT] = {
+        craft.rate[Y] * momentum[Z] - craft.rate[Z] * momentum[Y],
+        craft.rate[Z] * momentum[X] - craft.rate[X] * momentum[Z],
+        craft.rate[X] * momentum[Y] - craft.rate[Y] * momentum[X]
+    };
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        craft.rate[axis] += (torque[axis] - gyroscopic[axis] - SIM_ROTATIONAL_DRAG * craft.rate[axis]) / simInertia[axis] * dt;
+    }
+
+    const float rotation[4] = { 0, craft.rate[X] * dt / 2, craft.rate[Y] * dt / 2, craft.rate[Z] * dt / 2 };
+    float change[4];
+    simQuaternionMultiply(craft.q, rotation, change);
+    float norm = 0;
+    for (int i = 0; i < 4; i++) {
+        craft.q[i] += change[i];
+        norm += sq(craft.q[i]);
+    }
+    norm = sqrtf(norm);
+    for (int i = 0; i < 4; i++) {
+        craft.q[i] /= norm;
+    }
+}
+
+// as updateRcCommands() in cleanflight_fc.c, without the deadbands and headfree
+static void simUpdateRcCommands(void)
+{
+    int32_t prop2;
+
+    if (rcData[THROTTLE] < currentControlRateProfile->tpa_breakpoint) {
+        prop2 = 100;
+    } else if (rcData[THROTTLE] < 2000) {
+        prop2 = 100 - (uint16_t)currentControlRateProfile->dynThrPID * (rcData[THROTTLE] - currentControlRateProfile->tpa_breakpoint) / (2000 - currentControlRateProfile->tpa_breakpoint);
+    } else {
+        prop2 = 100 - currentControlRateProfile->dynThrPID;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        int32_t prop1;
+        int32_t tmp = MIN(ABS(rcData[axis] - rxConfig()->midrc), 500);
+        if (axis == ROLL || axis == PITCH) {
+            rcCommand[axis] = rcLookupPitchRoll(tmp);
+            prop1 = 100 - (uint16_t)currentControlRateProfile->rates[axis] * tmp / 500;
+            prop1 = (uint16_t)prop1 * prop2 / 100;
+            PIDweight[axis] = prop2;
+        } else {
+            rcCommand[axis] = rcLookupYaw(tmp) * -rcControlsConfig()->yaw_control_direction;
+            prop1 = 100 - (uint16_t)currentControlRateProfile->rates[axis] * ABS(tmp) / 500;
+            PIDweight[axis] = 100;
+        }
+        dynP8[axis] = (uint16_t)pidRuntimeConfig.P8[axis] * prop1 / 100;
+        dynI8[axis] = (uint16_t)pidRuntimeConfig.I8[axis] * prop1 / 100;
+        dynD8[axis] = (uint16_t)pidRuntimeConfig.D8[axis] * prop1 / 100;
+
+        if (rcData[axis] < rxConfig()->midrc) {
+            rcCommand[axis] = -rcCommand[axis];
+        }
+    }
+
+    int32_t tmp = constrain(rcData[THROTTLE], rxConfig()->mincheck, PWM_RANGE_MAX);
+    tmp = (uint32_t)(tmp - rxConfig()->mincheck) * PWM_RANGE_MIN / (PWM_RANGE_MAX - rxConfig()->mincheck);
+    rcCommand[THROTTLE] = rcLookupThrottle(tmp);
+}
+
+// one iteration of the PID loop followed by a looptime of flight
+static void simRunLoop(void)
+{
+    currentTimeUs += targetLooptime;
+
+    imuUpdateAccelerometer(&simTrims);
+    imuUpdateGyroAndAttitude();
+    simUpdateRcCommands();
+    pidController();
+    mixTable();
+
+    simUpdateCraft(dT);
+}
+
+static void simCentreSticks(void)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        rcData[axis] = rxConfig()->midrc;
+    }
+    rcData[THROTTLE] = SIM_HOVER_THROTTLE;
+}
+
+/*
+ * Loads the default configuration, the tests and sweeps change it before calling simStart().
+ */
+static void simResetConfig(void)
+{
+    pgResetAll(MAX_PROFILE_COUNT);
+    pgActivateProfile(0);
+    setControlRateProfile(0);
+
+    rxConfig()->midrc = 1500;
+    rxConfig()->mincheck = 1100;
+    rcControlsConfig()->yaw_control_direction = 1;
+    gyroConfig()->soft_gyro_lpf_hz = 100;
+
+    simConfig.gyroNoise = 4.0f;
+    simConfig.accNoise = 0.05f;
+    simConfig.motorTimeConstant = 0.03f;
+}
+
+// hovering level with the sticks centred and all filters and PID state cleared
+static void simStart(const float initialAttitude[4])
+{
+    targetLooptime = imuConfig()->looptime;
+    cycleTime = targetLooptime;
+    dT = targetLooptime * 0.000001f;
+    simRandomState = 0x2545F491;
+
+    memset(&simTrims, 0, sizeof(simTrims));
+    memset(&simAccDeadband, 0, sizeof(simAccDeadband));
+    gyro.scale = SIM_GYRO_SCALE;
+    acc.acc_1G = SIM_ACC_1G;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        BiQuadNewLpf(gyroConfig()->soft_gyro_lpf_hz, &simGyroFilterState[axis], targetLooptime);
+    }
+
+    memset(&craft, 0, sizeof(craft));
+    memcpy(craft.q, initialAttitude, sizeof(craft.q));
+    for (int i = 0; i < MAX_SUPPORTED_MOTORS; i++) {
+        craft.motorSpeed[i] = 0.5f;
+    }
+
+    mixerConfig()->mixerMode = MIXER_QUADX;
+    mixerUseConfigs(servoProfile()->servoConf);
+    mixerInit(customMotorMixer(0));
+    mixerInitServos(customServoMixer(0));
+    pwmIOConfiguration_t pwmIOConfiguration = {
+        .servoCount = 0,
+        .motorCount = 4,
+        .ioCount = 4,
+        .pwmInputCount = 0,
+        .ppmInputCount = 0,
+        .ioConfigurations = {}
+    };
+    mixerUsePWMIOConfiguration(&pwmIOConfiguration);
+
+    activateControlRateConfig();
+    pidSetController((pidControllerType_e)pidProfile()->pidController);
+    pidInitConfig(pidProfile(), currentControlRateProfile, imuConfig()->max_angle_inclination, &simTrims, rxConfig());
+    memset(&pidState, 0, sizeof(pidState));
+
+    // the IMU starts from the true attitude, as after calibration on the ground
+    q0 = initialAttitude[0];
+    q1 = initialAttitude[1];
+    q2 = initialAttitude[2];
+    q3 = initialAttitude[3];
+    memset(deltaAngle, 0, sizeof(deltaAngle));
+    deltaAngleTime = 0;
+    simImuRuntimeConfig.dcm_kp = imuConfig()->dcm_kp / 10000.0f;
+    simImuRuntimeConfig.dcm_ki = imuConfig()->dcm_ki / 10000.0f;
+    simImuRuntimeConfig.acc_cut_hz = 15;
+    simImuRuntimeConfig.small_angle = imuConfig()->small_angle;
+    simImuRuntimeConfig.attitude_estimator = imuConfig()->attitude_estimator;
+    simImuRuntimeConfig.attitude_update_hz = imuConfig()->attitude_update_hz;
+    imuConfigure(&simImuRuntimeConfig, &simAccDeadband, 5.0f, throttleCorrectionConfig()->throttle_correction_angle);
+    imuInit();
+
+    simCentreSticks();
+    armingFlags = ARMED;
+    flightModeFlags = 0;
+}
+
+static const float simLevel[4] = { 1, 0, 0, 0 };
+
+/*
+ * Hovers, then steps the stick of one axis in rate mode.  The motor variance while hovering is caused by the sensor
+ * noise passing through the filters and the PID, the step response is measured on the true rate of the model.
+ */
+static void simStepResponse(int axis, int16_t stickDeflection, simResult_t *result)
+{
+    static float rate[(int)(SIM_STEP_TIME * 1000000 / 125) + 1];
+
+    simStart(simLevel);
+
+    for (int i = 0; i < SIM_SETTLE_TIME / dT; i++) {
+        simRunLoop();
+    }
+
+    const int hoverLoops = SIM_HOVER_TIME / dT;
+    float motorSum[MAX_SUPPORTED_MOTORS] = { 0 };
+    float motorSquareSum[MAX_SUPPORTED_MOTORS] = { 0 };
+    for (int i = 0; i < hoverLoops; i++) {
+        simRunLoop();
+        for (int m = 0; m < motorCount; m++) {
+            motorSum[m] += motor[m];
+            motorSquareSum[m] += sq((float)motor[m]);
+        }
+    }
+    result->motorVariance = 0;
+    for (int m = 0; m < motorCount; m++) {
+        const float mean = motorSum[m] / hoverLoops;
+        result->motorVariance += (motorSquareSum[m] / hoverLoops - sq(mean)) / motorCount;
+    }
+
+    rcData[axis] = rxConfig()->midrc + stickDeflection;
+    const int stepLoops = MIN(SIM_STEP_TIME / dT, ARRAYLEN(rate));
+    for (int i = 0; i < stepLoops; i++) {
+        simRunLoop();
+        rate[i] = SIM_RADIANS_TO_DEGREES(craft.rate[axis]);
+    }
+
+    // the angle rate of pidMultiWiiRewrite and pidLuxFloat is in gyroADC / 4
+    if (IS_PID_CONTROLLER_FP_BASED(pidProfile()->pidController)) {
+        result->commandedRate = pidRuntimeConfig.rateScale[axis] * rcCommand[axis] * SIM_GYRO_SCALE * 4;
+    } else {
+        result->commandedRate = ((pidRuntimeConfig.rateFactor[axis] * rcCommand[axis]) >> (axis == FD_YAW ? 5 : 4)) * SIM_GYRO_SCALE * 4;
+    }
+
+    const int settledLoops = SIM_SETTLED_TIME / dT;
+    float settledSum = 0;
+    for (int i = stepLoops - settledLoops; i < stepLoops; i++) {
+        settledSum += rate[i];
+    }
+    result->settledRate = settledSum / settledLoops;
+
+    int riseStart = -1;
+    int riseEnd = -1;
+    float peak = 0;
+    for (int i = 0; i < stepLoops; i++) {
+        const float fraction = rate[i] / result->settledRate;
+        if (riseStart < 0 && fraction >= 0.1f) {
+            riseStart = i;
+        }
+        if (riseEnd < 0 && fraction >= 0.9f) {
+            riseEnd = i;
+        }
+        peak = MAX(peak, fraction);
+    }
+    result->riseTime = (riseStart < 0 || riseEnd < 0) ? SIM_STEP_TIME : (riseEnd - riseStart) * dT;
+    result->overshoot = (peak - 1.0f) * 100;
+}
+
+static void simPrintResult(const char *name, const simResult_t *result)
+{
+    printf("%-28s commanded %6.1f deg/s settled %6.1f deg/s rise %5.1f ms overshoot %5.1f%% motor variance %7.1f us^2\n",
+            name, result->commandedRate, result->settledRate, result->riseTime * 1000, result->overshoot, result->motorVariance);
+}
+
+TEST(FlightSimulationTest, TestDefaultsFlyRollStep)
+{
+    // given
+    simResult_t result;
+    simResetConfig();
+
+    // when
+    simStepResponse(FD_ROLL, 300, &result);
+    simPrintResult("MWREWRITE roll", &result);
+
+    // then
+    EXPECT_NEAR(result.commandedRate, result.settledRate, result.commandedRate * 0.1f);
+    EXPECT_LT(result.riseTime, 0.1f);
+    EXPECT_LT(result.overshoot, 30.0f);
+    EXPECT_GT(result.motorVariance, 0.0f);
+}
+
+TEST(FlightSimulationTest, TestControllersFlyAllAxes)
+{
+    const pidControllerType_e controllers[] = { PID_CONTROLLER_MWREWRITE, PID_CONTROLLER_LUX_FLOAT };
+    const char *names[] = { "MWREWRITE", "LUXFLOAT" };
+    const char *axisNames[] = { "roll", "pitch", "yaw" };
+
+    for (unsigned c = 0; c < ARRAYLEN(controllers); c++) {
+        for (int axis = 0; axis < 3; axis++) {
+            // given
+            simResult_t result;
+            char name[32];
+            simResetConfig();
+            pidProfile()->pidController = controllers[c];
+
+            // when
+            simStepResponse(axis, 300, &result);
+            snprintf(name, sizeof(name), "%s %s", names[c], axisNames[axis]);
+            simPrintResult(name, &result);
+
+            // then
+            EXPECT_NEAR(result.commandedRate, result.settledRate, fabsf(result.commandedRate) * 0.15f) << name;
+            EXPECT_LT(result.riseTime, 0.2f) << name;
+        }
+    }
+}
+
+TEST(FlightSimulationTest, TestMotorVarianceComesFromGyroNoise)
+{
+    // given
+    simResult_t quiet, noisy;
+
+    // when
+    simResetConfig();
+    simConfig.gyroNoise = 0;
+    simConfig.accNoise = 0;
+    simStepResponse(FD_ROLL, 300, &quiet);
+
+    simResetConfig();
+    simConfig.gyroNoise = 8.0f;
+    simStepResponse(FD_ROLL, 300, &noisy);
+
+    // then
+    EXPECT_LT(quiet.motorVariance, 1.0f);
+    EXPECT_GT(noisy.motorVariance, 10 * quiet.motorVariance);
+}
+
+TEST(FlightSimulationTest, TestFilteringReducesMotorVariance)
+{
+    // given
+    simResult_t standard, gyroFiltered, dtermFiltered;
+
+    // when
+    simResetConfig();
+    simStepResponse(FD_ROLL, 300, &standard);
+
+    simResetConfig();
+    gyroConfig()->soft_gyro_lpf_hz = 40;
+    simStepResponse(FD_ROLL, 300, &gyroFiltered);
+
+    simResetConfig();
+    pidProfile()->dterm_lpf = 20;
+    simStepResponse(FD_ROLL, 300, &dtermFiltered);
+
+    simPrintResult("soft_gyro_lpf_hz 100", &standard);
+    simPrintResult("soft_gyro_lpf_hz 40", &gyroFiltered);
+    simPrintResult("dterm_lpf 20", &dtermFiltered);
+
+    // then
+    EXPECT_LT(gyroFiltered.motorVariance, standard.motorVariance);
+    EXPECT_LT(dtermFiltered.motorVariance, standard.motorVariance);
+}
+
+TEST(FlightSimulationTest, TestAngleModeLevelsTheCraft)
+{
+    // given
+    const float tilted[4] = { cosf(DEGREES_TO_RADIANS(20) / 2), sinf(DEGREES_TO_RADIANS(20) / 2), 0, 0 };
+    simResetConfig();
+    simStart(tilted);
+    enableFlightMode(ANGLE_MODE);
+
+    // when
+    for (int i = 0; i < 1.0f / dT; i++) {
+        simRunLoop();
+    }
+
+    // then
+    float up[3];
+    simUpVector(craft.q, up);
+    EXPECT_LT(SIM_RADIANS_TO_DEGREES(acosf(constrainf(up[2], -1.0f, 1.0f))), 2.0f);
+}
+
+/*
+ * Sweeps the filters and the rate P and D of roll, scoring each setting on the step response and the motor noise.
+ */
+TEST(FlightSimulationTest, TestSweepFiltersAndGains)
+{
+    const uint16_t gyroLpf[] = { 40, 60, 80, 100, 150, 200 };
+    const uint16_t dtermLpf[] = { 20, 30, 50, 70, 100, 0 };
+    const uint8_t P8[] = { 20, 30, 40, 50, 60, 70, 80 };
+    const uint8_t D8[] = { 10, 23, 35, 50 };
+    simResult_t result, best;
+    float bestCost = INFINITY;
+    int simulations = 0;
+
+    const clock_t start = clock();
+
+    for (unsigned g = 0; g < ARRAYLEN(gyroLpf); g++) {
+        for (unsigned d = 0; d < ARRAYLEN(dtermLpf); d++) {
+            for (unsigned p = 0; p < ARRAYLEN(P8); p++) {
+                for (unsigned k = 0; k < ARRAYLEN(D8); k++) {
+                    simResetConfig();
+                    gyroConfig()->soft_gyro_lpf_hz = gyroLpf[g];
+                    pidProfile()->dterm_lpf = dtermLpf[d];
+                    pidProfile()->P8[PIDROLL] = P8[p];
+                    pidProfile()->D8[PIDROLL] = D8[k];
+
+                    simStepResponse(FD_ROLL, 300, &result);
+                    simulations++;
+
+                    ASSERT_FALSE(isnan(result.settledRate));
+
+                    // a millisecond of rise time is worth 1% of overshoot and 10us^2 of motor variance
+                    const float cost = result.riseTime * 1000 + MAX(result.overshoot, 0.0f) + result.motorVariance / 10;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        best = result;
+                    }
+                }
+            }
+        }
+    }
+
+    const float seconds = (float)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%d simulations of %.1fs of flight in %.2fs, %.0f simulations per second\n",
+            simulations, SIM_SETTLE_TIME + SIM_HOVER_TIME + SIM_STEP_TIME, seconds, simulations / MAX(seconds, 0.001f));
+    simPrintResult("best", &best);
+
+    simResult_t defaults;
+    simResetConfig();
+    simStepResponse(FD_ROLL, 300, &defaults);
+    simPrintResult("defaults", &defaults);
+
+    EXPECT_LE(bestCost, defaults.riseTime * 1000 + MAX(defaults.overshoot, 0.0f) + defaults.motorVariance / 10);
+}
+
+// STUBS
+
+extern "C" {
+rxRuntimeConfig_t rxRuntimeConfig;
+
+int16_t axisPID[XYZ_AXIS_COUNT];
+int16_t rcCommand[4];
+int16_t rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+
+uint32_t rcModeActivationMask;
+int16_t debug[DEBUG16_VALUE_COUNT];
+
+uint8_t stateFlags;
+uint16_t flightModeFlags;
+uint8_t armingFlags;
+
+acc_t acc;
+uint32_t accClipCount;
+gyro_t gyro;
+int32_t gyroADC[XYZ_AXIS_COUNT];
+int32_t accADC[XYZ_AXIS_COUNT];
+int32_t magADC[XYZ_AXIS_COUNT];
+int16_t heading;
+
+int16_t GPS_angle[ANGLE_INDEX_COUNT];
+int16_t GPS_speed;
+int16_t GPS_ground_course;
+int16_t GPS_numSat;
+float magneticDeclination;
+
+uint16_t enableFlightMode(flightModeFlags_e mask)
+{
+    return flightModeFlags |= (mask);
+}
+
+uint16_t disableFlightMode(flightModeFlags_e mask)
+{
+    return flightModeFlags &= ~(mask);
+}
+
+bool rcModeIsActive(boxId_e modeId) { return rcModeActivationMask & (1 << modeId); }
+int32_t getRcStickDeflection(int32_t axis, uint16_t midrc) { return MIN(ABS(rcData[axis] - midrc), 500); }
+bool failsafeIsActive(void) { return false; }
+bool feature(uint32_t) { return false; }
+
+bool sensors(uint32_t mask)
+{
+    return mask & SENSOR_ACC;
+}
+
+// samples the model as the gyro driver and gyroUpdate() would
+void gyroUpdate(void)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        const float rate = SIM_RADIANS_TO_DEGREES(craft.rate[axis]) + simConfig.gyroNoise * simRandomGaussian();
+        gyroADC[axis] = constrain(lrintf(rate / SIM_GYRO_SCALE), INT16_MIN, INT16_MAX);
+        if (gyroConfig()->soft_gyro_lpf_hz) {
+            gyroADC[axis] = lrintf(applyBiQuadFilter((float)gyroADC[axis], &simGyroFilterState[axis]));
+        }
+    }
+}
+
+void updateAccelerationReadings(rollAndPitchTrims_t *)
+{
+    float up[3];
+    simUpVector(craft.q, up);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        accADC[axis] = lrintf((up[axis] + simConfig.accNoise * simRandomGaussian()) * SIM_ACC_1G);
+    }
+}
+
+uint32_t micros(void) { return currentTimeUs; }
+uint32_t millis(void) { return currentTimeUs / 1000; }
+void delay(uint32_t) {}
+
+void pwmWriteMotor(uint8_t, uint16_t) {}
+void pwmShutdownPulsesForAllMotors(uint8_t) {}
+void pwmCompleteOneshotMotorUpdate(uint8_t) {}
+bool isMotorProtocolOneshot(void) { return false; }
+void pwmCompleteDshotMotorUpdate(uint8_t) {}
+bool isMotorProtocolDshot(void) { return false; }
+void pwmWriteServo(uint8_t, uint16_t) {}
+
+bool isBaroCalibrationComplete(void) { return true; }
+void performBaroCalibrationCycle(void) {}
+int32_t baroCalculateAltitude(void) { return 0; }
+}
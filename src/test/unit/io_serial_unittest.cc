@@ -79,6 +79,142 @@ TEST(IoSerialTest, TestFindPortConfig)
     EXPECT_EQ(NULL, portConfig);
 }
 
+TEST(IoSerialTest, TestRingBufferWrapsByMasking)
+{
+    EXPECT_EQ(1u, serialBufferNext(0, 256));
+    EXPECT_EQ(0u, serialBufferNext(255, 256));
+    EXPECT_EQ(256u, serialBufferNext(255, 1024));
+    EXPECT_EQ(0u, serialBufferNext(1023, 1024));
+
+    EXPECT_TRUE(SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(256));
+    EXPECT_TRUE(SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(2048));
+    EXPECT_FALSE(SERIAL_BUFFER_SIZE_IS_POWER_OF_TWO(1000));
+}
+
+TEST(IoSerialTest, TestRingBufferCountsAbove255)
+{
+    // empty
+    EXPECT_EQ(0, serialBufferUsed(100, 100, 1024));
+    EXPECT_EQ(1023, serialBufferFree(100, 100, 1024));
+
+    // head ahead of the tail
+    EXPECT_EQ(600, serialBufferUsed(700, 100, 1024));
+    EXPECT_EQ(423, serialBufferFree(700, 100, 1024));
+
+    // head wrapped behind the tail
+    EXPECT_EQ(174, serialBufferUsed(50, 900, 1024));
+    EXPECT_EQ(849, serialBufferFree(50, 900, 1024));
+
+    // full, one byte stays free
+    EXPECT_EQ(4095, serialBufferUsed(4094, 4095, 4096));
+    EXPECT_EQ(0, serialBufferFree(4094, 4095, 4096));
+}
+
+TEST(IoSerialTest, TestRingBufferFillAndDrainAcrossTheWrap)
+{
+    static volatile uint8_t buffer[512];
+    const uint32_t size = sizeof(buffer);
+    uint32_t head = 400;
+    uint32_t tail = 400;
+
+    // when
+    int written = 0;
+    while (serialBufferFree(head, tail, size)) {
+        buffer[head] = written++;
+        head = serialBufferNext(head, size);
+    }
+
+    // then
+    EXPECT_EQ(511, written);
+    EXPECT_EQ(511, serialBufferUsed(head, tail, size));
+
+    // and
+    for (int i = 0; i < written; i++) {
+        ASSERT_EQ((uint8_t)i, buffer[tail]);
+        tail = serialBufferNext(tail, size);
+    }
+    EXPECT_EQ(0, serialBufferUsed(head, tail, size));
+}
+
+static uint16_t fakeRxWaiting;
+static uint16_t fakeTxFree;
+
+static uint16_t fakeTotalRxWaiting(serialPort_t *) { return fakeRxWaiting; }
+static uint16_t fakeTotalTxFree(serialPort_t *) { return fakeTxFree; }
+
+static uint8_t fakeTxData[32];
+static int fakeTxLength;
+static int fakeTxCallbackCalls[2];
+static int fakeTxCopiedWhenCalled[2];
+
+static void fakeWriteBuf(serialPort_t *, void *data, int count)
+{
+    memcpy(fakeTxData + fakeTxLength, data, count);
+    fakeTxLength += count;
+}
+
+static void fakeTxComplete(void *context)
+{
+    const int index = *(int *)context;
+    fakeTxCallbackCalls[index]++;
+    fakeTxCopiedWhenCalled[index] = fakeTxLength;
+}
+
+TEST(IoSerialTest, TestSegmentsAreCopiedWithoutTransmitDma)
+{
+    // given
+    struct serialPortVTable vTable;
+    memset(&vTable, 0, sizeof(vTable));
+    vTable.writeBuf = fakeWriteBuf;
+
+    serialPort_t port;
+    memset(&port, 0, sizeof(port));
+    port.vTable = &vTable;
+
+    static const uint8_t header[] = { '$', 'M', '>' };
+    static const uint8_t payload[] = { 1, 2, 3, 4 };
+    int contexts[2] = { 0, 1 };
+    const serialTxSegment_t segments[] = {
+        { header, sizeof(header), fakeTxComplete, &contexts[0] },
+        { payload, sizeof(payload), fakeTxComplete, &contexts[1] },
+    };
+
+    // when
+    serialWriteSegments(&port, segments, 2);
+
+    // then
+    const uint8_t expected[] = { '$', 'M', '>', 1, 2, 3, 4 };
+    EXPECT_EQ((int)sizeof(expected), fakeTxLength);
+    EXPECT_EQ(0, memcmp(expected, fakeTxData, sizeof(expected)));
+
+    // and each callback comes once its segment has been copied
+    EXPECT_EQ(1, fakeTxCallbackCalls[0]);
+    EXPECT_EQ(1, fakeTxCallbackCalls[1]);
+    EXPECT_EQ(3, fakeTxCopiedWhenCalled[0]);
+    EXPECT_EQ(7, fakeTxCopiedWhenCalled[1]);
+}
+
+TEST(IoSerialTest, TestByteCountsAreNotTruncated)
+{
+    // given
+    struct serialPortVTable vTable;
+    memset(&vTable, 0, sizeof(vTable));
+    vTable.serialTotalRxWaiting = fakeTotalRxWaiting;
+    vTable.serialTotalTxFree = fakeTotalTxFree;
+
+    serialPort_t port;
+    memset(&port, 0, sizeof(port));
+    port.vTable = &vTable;
+
+    // when
+    fakeRxWaiting = 600;
+    fakeTxFree = 2047;
+
+    // then
+    EXPECT_EQ(600, serialRxBytesWaiting(&port));
+    EXPECT_EQ(2047, serialTxBytesFree(&port));
+}
+
 
 // STUBS
 
@@ -91,14 +227,10 @@ extern "C" {
 void delay(uint32_t) {}
 void cliEnter(serialPort_t *) {}
 void cliProcess(void) {}
-bool isSerialTransmitBufferEmpty(serialPort_t *) {
-    return true;
-}
 void mspSerialProcess(void) {}
 void systemResetToBootloader(void) {}
 
 serialPort_t *usbVcpOpen(void) { return NULL; }
 serialPort_t *uartOpen(USART_TypeDef *, serialReceiveCallbackPtr, uint32_t, portMode_t, portOptions_t) { return NULL; }
 serialPort_t *openSoftSerial(softSerialPortIndex_e, serialReceiveCallbackPtr, uint32_t, portOptions_t) { return NULL; }
-void serialSetMode(serialPort_t *, portMode_t) {}
 }
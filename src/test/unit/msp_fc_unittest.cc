@@ -460,6 +460,8 @@ TEST_F(MspTest, TestMspCommands)
         MSP_STATUS_EX,           // 150    //out message         cycletime, errors_count, CPU load, sensor present etc
         MSP_UID,                 // 160    //out message         Unique device ID
         MSP_GPSSVINFO,           // 164    //out message         get Signal Strength (only U-Blox)
+        MSP_ACC_VIBRATION,       // 167    //out message         accelerometer vibration, clip count and health
+        MSP_RC_LATENCY,          // 168    //out message         RC frame to motor output latency statistics and histogram
         MSP_ACC_TRIM,            // 240    //out message         get acc angle trim values
         MSP_SERVO_MIX_RULES,     // 241    //out message         Returns servo mixer configuration
     };
@@ -480,6 +482,7 @@ extern "C" {
 mspPostProcessFuncPtr mspPostProcessFn = NULL;
 // from acceleration.c
 acc_t acc;                       // acc access functions
+uint32_t accClipCount = 0;
 void accSetCalibrationCycles(uint16_t calibrationCyclesRequired) {UNUSED(calibrationCyclesRequired);}
 // from altitudehold.c
 int32_t AltHold;
@@ -526,6 +529,8 @@ int32_t gyroADC[XYZ_AXIS_COUNT];
 // form imu.c
 attitudeEulerAngles_t attitude = { { 0, 0, 0 } };     // absolute angle inclination in multiple of 0.1 degree    180 deg = 1800
 int16_t accSmooth[XYZ_AXIS_COUNT];
+uint16_t imuGetAccVibration(int) { return 0; }
+uint8_t imuGetAccHealth(void) { return 100; }
 // from ledstrip.c
 void reevaluateLedConfig(void) {}
 bool setModeColor(ledModeIndex_e , int , int ) { return true; }
@@ -535,6 +540,7 @@ int16_t motor_disarmed[MAX_SUPPORTED_MOTORS];
 int16_t servo[MAX_SUPPORTED_SERVOS];
 void stopMotors(void) {}
 void loadCustomServoMixer(void) {}
+void mixerInitConfig(void) {}
 // from msp.c
 void rxMspFrameReceive(uint16_t *, int ) {}
 // from mw.c
@@ -547,8 +553,8 @@ uint16_t GPS_distanceToHome;        // distance to home point in meters
 int16_t GPS_directionToHome;        // direction to home or hol point in degrees
 navigationMode_e nav_mode = NAV_MODE_NONE;    // Navigation mode
 void GPS_set_next_wp(int32_t *, int32_t *) {}
-// from pid.c
-void pidSetController(pidControllerType_e) {}
+// from config.c
+void activatePidConfig(void) {}
 // from rc_controls.c
 uint32_t rcModeActivationMask; // one bit per mode defined in boxId_e
 bool rcModeIsActive(boxId_e modeId) { return rcModeActivationMask & (1 << modeId); }
@@ -103,6 +103,28 @@ void serialWriteBuf(serialPort_t *instance, uint8_t *data, int count)
         serialWrite(instance, *data++);
 }
 
+// the DMA of a real port calls the callbacks later, the test can hold them back too
+static bool serialTxCompleteDeferred;
+static serialTxSegment_t serialTxDeferredSegment;
+static const uint8_t *serialTxSegmentData[4];
+
+void serialWriteSegments(serialPort_t *instance, const serialTxSegment_t *segments, int count)
+{
+    EXPECT_LE(count, (int)ARRAYLEN(serialTxSegmentData));
+    for (int i = 0; i < count; i++) {
+        serialTxSegmentData[i] = segments[i].data;
+        serialWriteBuf(instance, (uint8_t *)segments[i].data, segments[i].length);
+        if (!segments[i].callback) {
+            continue;
+        }
+        if (serialTxCompleteDeferred) {
+            serialTxDeferredSegment = segments[i];
+        } else {
+            segments[i].callback(segments[i].context);
+        }
+    }
+}
+
 void serialBeginWrite(serialPort_t *instance)
 {
     EXPECT_EQ(instance, &serialTestInstance);
@@ -113,7 +135,7 @@ void serialEndWrite(serialPort_t *instance)
     EXPECT_EQ(instance, &serialTestInstance);
 }
 
-uint8_t serialRxBytesWaiting(serialPort_t *instance)
+uint16_t serialRxBytesWaiting(serialPort_t *instance)
 {
     EXPECT_EQ(instance, &serialTestInstance);
     EXPECT_GE(serialReadEnd, serialReadPos);
@@ -195,7 +217,10 @@ protected:
     virtual void SetUp() {
         mspPort = &mspPorts[0];
         mspPort->port = &serialTestInstance;
+        mspPort->outPending = false;
         serialTestResetBuffers();
+        serialTxCompleteDeferred = false;
+        memset(&serialTxDeferredSegment, 0, sizeof(serialTxDeferredSegment));
     }
 };
 
@@ -254,6 +279,38 @@ TEST_F(SerialMspUnitTest, Test_TestMspSerialInFraming)
     EXPECT_EQ(checksum, serialWriteBuffer.payload[0]);
 }
 
+TEST_F(SerialMspUnitTest, Test_MspSerialWaitsForTheReplyToBeSent)
+{
+    // given
+    const uint8_t pkt[] = {'$', 'M', '<', 0, MSP_TEST_REPLY, MSP_TEST_REPLY};
+    memcpy(serialReadBuffer.buf, pkt, sizeof(pkt));
+    memcpy(serialReadBuffer.buf + sizeof(pkt), pkt, sizeof(pkt));
+    serialReadEnd = 2 * sizeof(pkt);
+    serialTxCompleteDeferred = true;
+
+    // when
+    mspSerialProcess();
+
+    // then the reply is sent from the port's own buffer
+    const int replyLength = sizeof(mspHeader_t) + sizeof(msp_reply_data) + 1;
+    EXPECT_EQ(replyLength, serialWritePos);
+    EXPECT_TRUE(mspPort->outPending);
+    EXPECT_EQ(mspPort->outBuf, serialTxSegmentData[1]);
+    ASSERT_TRUE(serialTxDeferredSegment.callback != NULL);
+
+    // and the next command waits
+    mspSerialProcess();
+    EXPECT_EQ(replyLength, serialWritePos);
+    EXPECT_EQ((int)sizeof(pkt), serialReadPos);
+
+    // until the reply has gone
+    serialTxDeferredSegment.callback(serialTxDeferredSegment.context);
+    EXPECT_FALSE(mspPort->outPending);
+    mspSerialProcess();
+    EXPECT_EQ(2 * replyLength, serialWritePos);
+    EXPECT_EQ(0, memcmp(serialWriteBuffer.buf, serialWriteBuffer.buf + replyLength, replyLength));
+}
+
 // STUBS
 extern "C" {
 void evaluateOtherData(serialPort_t *, uint8_t) {}
@@ -70,15 +70,99 @@ typedef struct {
 } DMA_TypeDef;
 
 typedef struct {
-    void* test;
+    uint32_t CCR;
+    uint32_t CNDTR;
+    uint32_t CPAR;
+    uint32_t CMAR;
 } DMA_Channel_TypeDef;
 
+typedef struct {
+    uint32_t DMA_PeripheralBaseAddr;
+    uint32_t DMA_MemoryBaseAddr;
+    uint32_t DMA_DIR;
+    uint32_t DMA_BufferSize;
+    uint32_t DMA_PeripheralInc;
+    uint32_t DMA_MemoryInc;
+    uint32_t DMA_PeripheralDataSize;
+    uint32_t DMA_MemoryDataSize;
+    uint32_t DMA_Mode;
+    uint32_t DMA_Priority;
+    uint32_t DMA_M2M;
+} DMA_InitTypeDef;
+
+#define DMA_DIR_PeripheralDST           ((uint32_t)0x00000010)
+#define DMA_DIR_PeripheralSRC           ((uint32_t)0x00000000)
+#define DMA_PeripheralInc_Disable       ((uint32_t)0x00000000)
+#define DMA_MemoryInc_Enable            ((uint32_t)0x00000080)
+#define DMA_PeripheralDataSize_Byte     ((uint32_t)0x00000000)
+#define DMA_MemoryDataSize_Byte         ((uint32_t)0x00000000)
+#define DMA_PeripheralDataSize_HalfWord ((uint32_t)0x00000100)
+#define DMA_MemoryDataSize_HalfWord     ((uint32_t)0x00000400)
+#define DMA_Mode_Circular               ((uint32_t)0x00000020)
+#define DMA_Mode_Normal                 ((uint32_t)0x00000000)
+#define DMA_Priority_Medium             ((uint32_t)0x00001000)
+#define DMA_M2M_Disable                 ((uint32_t)0x00000000)
+#define DMA_IT_TC                       ((uint32_t)0x00000002)
+
+typedef struct {
+    uint16_t TIM_Channel;
+    uint16_t TIM_ICPolarity;
+    uint16_t TIM_ICSelection;
+    uint16_t TIM_ICPrescaler;
+    uint16_t TIM_ICFilter;
+} TIM_ICInitTypeDef;
+
+#define TIM_ICPolarity_Rising           ((uint16_t)0x0000)
+#define TIM_ICPolarity_Falling          ((uint16_t)0x0002)
+#define TIM_ICSelection_DirectTI        ((uint16_t)0x0001)
+#define TIM_ICPSC_DIV1                  ((uint16_t)0x0000)
+
 //typedef struct DMA_Channel_Struct DMA_Channel_TypeDef;
 typedef struct USART_Struct USART_TypeDef;
 
+typedef struct {
+    uint32_t USART_BaudRate;
+    uint32_t USART_WordLength;
+    uint32_t USART_StopBits;
+    uint32_t USART_Parity;
+    uint32_t USART_Mode;
+    uint32_t USART_HardwareFlowControl;
+} USART_InitTypeDef;
+
+#define USART_WordLength_8b             ((uint32_t)0x00000000)
+#define USART_StopBits_1                ((uint32_t)0x00000000)
+#define USART_StopBits_2                ((uint32_t)0x00002000)
+#define USART_Parity_No                 ((uint32_t)0x00000000)
+#define USART_Parity_Even               ((uint32_t)0x00000400)
+#define USART_Mode_Rx                   ((uint32_t)0x00000004)
+#define USART_Mode_Tx                   ((uint32_t)0x00000008)
+#define USART_HardwareFlowControl_None  ((uint32_t)0x00000000)
+#define USART_DMAReq_Tx                 ((uint32_t)0x00000080)
+#define USART_DMAReq_Rx                 ((uint32_t)0x00000040)
+#define USART_IT_IDLE                   ((uint32_t)0x00040004)
+#define USART_IT_RXNE                   ((uint32_t)0x00050105)
+#define USART_IT_TXE                    ((uint32_t)0x00070107)
+
 uint8_t DMA_GetFlagStatus(uint32_t);
 void DMA_Cmd(DMA_Channel_TypeDef*, FunctionalState );
 void DMA_ClearFlag(uint32_t);
+void DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx);
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct);
+void DMA_StructInit(DMA_InitTypeDef *DMA_InitStruct);
+void DMA_ITConfig(DMA_Channel_TypeDef *DMAy_Channelx, uint32_t DMA_IT, FunctionalState NewState);
+void DMA_SetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx, uint16_t DataNumber);
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx);
+
+void TIM_ICStructInit(TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct);
+void TIM_DMACmd(TIM_TypeDef *TIMx, uint16_t TIM_DMASource, FunctionalState NewState);
+
+void USART_Init(USART_TypeDef *USARTx, USART_InitTypeDef *USART_InitStruct);
+void USART_Cmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void USART_HalfDuplexCmd(USART_TypeDef *USARTx, FunctionalState NewState);
+void USART_ITConfig(USART_TypeDef *USARTx, uint32_t USART_IT, FunctionalState NewState);
+void USART_DMACmd(USART_TypeDef *USARTx, uint32_t USART_DMAReq, FunctionalState NewState);
+void USART_ClearITPendingBit(USART_TypeDef *USARTx, uint32_t USART_IT);
 
 #define WS2811_DMA_TC_FLAG 1
 #define WS2811_DMA_HANDLER_IDENTIFER 0
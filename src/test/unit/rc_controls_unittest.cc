@@ -766,6 +766,7 @@ TEST_F(RcControlsAdjustmentsTest, processPIDIncreasePidController2) // uses floa
 
 extern "C" {
 void saveConfigAndNotify(void) {}
+void activatePidConfig(void) {}
 void generateThrottleCurve(controlRateConfig_t *, motorAndServoConfig_t *) {}
 void changeProfile(uint8_t) {}
 void accSetCalibrationCycles(uint16_t) {}
@@ -0,0 +1,120 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern "C" {
+    #include "fc/rc_latency.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+TEST(RcLatencyTest, TestNothingRecordedBeforeTheFirstFrame)
+{
+    // given
+    rcLatencyReset();
+
+    // when
+    rcLatencyRecord(0, 1000);
+
+    // then
+    EXPECT_EQ(0u, rcLatencyGetStats()->count);
+}
+
+TEST(RcLatencyTest, TestEachFrameIsMeasuredOnce)
+{
+    // given
+    rcLatencyReset();
+
+    // when the motors are written three times from the same frame
+    rcLatencyRecord(10000, 11500);
+    rcLatencyRecord(10000, 12000);
+    rcLatencyRecord(10000, 12500);
+
+    // then only the first motor write counts
+    const rcLatencyStats_t *stats = rcLatencyGetStats();
+    EXPECT_EQ(1u, stats->count);
+    EXPECT_EQ(1500, stats->latest);
+    EXPECT_EQ(1500, stats->min);
+    EXPECT_EQ(1500, stats->average);
+    EXPECT_EQ(1500, stats->max);
+    EXPECT_EQ(1u, stats->histogram[1500 / RC_LATENCY_HISTOGRAM_BUCKET_WIDTH_US]);
+}
+
+TEST(RcLatencyTest, TestMinAverageMax)
+{
+    // given
+    rcLatencyReset();
+
+    // when
+    uint32_t frameTime = 100000;
+    for (int i = 0; i < 200; i++) {
+        frameTime += 9000;
+        rcLatencyRecord(frameTime, frameTime + 1000 + (i % 3) * 500);
+    }
+
+    // then
+    const rcLatencyStats_t *stats = rcLatencyGetStats();
+    EXPECT_EQ(200u, stats->count);
+    EXPECT_EQ(1000, stats->min);
+    EXPECT_EQ(2000, stats->max);
+    EXPECT_NEAR(1500, stats->average, 100);
+}
+
+TEST(RcLatencyTest, TestHistogram)
+{
+    // given
+    rcLatencyReset();
+
+    // when
+    rcLatencyRecord(1000, 1000 + 100);
+    rcLatencyRecord(2000, 2000 + 499);
+    rcLatencyRecord(3000, 3000 + 500);
+    rcLatencyRecord(4000, 4000 + 3200);
+    rcLatencyRecord(5000, 5000 + 50000);
+    rcLatencyRecord(6000, 6000 + 100000);
+
+    // then
+    const rcLatencyStats_t *stats = rcLatencyGetStats();
+    EXPECT_EQ(2u, stats->histogram[0]);
+    EXPECT_EQ(1u, stats->histogram[1]);
+    EXPECT_EQ(1u, stats->histogram[6]);
+    // everything above the histogram range lands in the last bucket
+    EXPECT_EQ(2u, stats->histogram[RC_LATENCY_HISTOGRAM_BUCKET_COUNT - 1]);
+    EXPECT_EQ(UINT16_MAX, stats->max);
+
+    uint32_t total = 0;
+    for (int i = 0; i < RC_LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+        total += stats->histogram[i];
+    }
+    EXPECT_EQ(stats->count, total);
+}
+
+TEST(RcLatencyTest, TestTimerWrap)
+{
+    // given
+    rcLatencyReset();
+
+    // when micros() wraps between the frame and the motor update
+    rcLatencyRecord(UINT32_MAX - 299, 500);
+
+    // then
+    EXPECT_EQ(800, rcLatencyGetStats()->latest);
+}
@@ -0,0 +1,250 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "common/maths.h"
+
+    #include "rx/rx.h"
+    #include "fc/rc_smoothing.h"
+
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+}
+
+static uint16_t measuredFrameInterval;
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define LOOP_TIME 1000
+#define FRAME_INTERVAL 9000
+#define START_TIME 100000
+#define STEP_TIME 1000000      // the frame at START_TIME + 100 * FRAME_INTERVAL
+
+/*
+ * Simulates the main loop running every LOOP_TIME +- loopJitter us with frames arriving every
+ * FRAME_INTERVAL +- frameJitter us.  Each frame carries input(frame time), the loop smooths the command of the last
+ * frame it has seen, like taskMainPidLoop() does.
+ */
+class RcSmoothingTest : public ::testing::Test {
+protected:
+    uint32_t now;
+    uint32_t nextFrameAt;
+    uint32_t frameTime;
+    int16_t frameValue;
+    int16_t command[RC_SMOOTHING_CHANNEL_COUNT];
+
+    virtual void SetUp() {
+        srand(1);
+        memset(rxConfig(), 0, sizeof(*rxConfig()));
+        rxConfig()->rcSmoothing = RC_SMOOTHING_LINEAR;
+
+        now = START_TIME;
+        nextFrameAt = now;
+        frameTime = 0;
+        frameValue = 0;
+        // the nominal rate of the protocol until the receiver code has measured the real one
+        measuredFrameInterval = 11000;
+        rcSmoothingInit();
+        measuredFrameInterval = FRAME_INTERVAL;
+    }
+
+    static int jitter(int range) {
+        return range ? (rand() % (2 * range + 1)) - range : 0;
+    }
+
+    // runs one loop iteration and returns the smoothed command
+    int16_t loop(int16_t (*input)(uint32_t), int loopJitter, int frameJitter) {
+        now += LOOP_TIME + jitter(loopJitter);
+        if ((int32_t)(now - nextFrameAt) >= 0) {
+            frameTime = nextFrameAt;
+            frameValue = input(frameTime);
+            nextFrameAt += FRAME_INTERVAL + jitter(frameJitter);
+        }
+        for (int i = 0; i < RC_SMOOTHING_CHANNEL_COUNT; i++) {
+            command[i] = frameValue;
+        }
+        rcSmoothingApply(command, frameTime, now);
+        return command[0];
+    }
+};
+
+static int16_t stepInput(uint32_t time)
+{
+    return time >= STEP_TIME ? 500 : 0;
+}
+
+static int16_t rampInput(uint32_t time)
+{
+    // 100 per frame interval
+    return (int32_t)(time - START_TIME) / (FRAME_INTERVAL / 100);
+}
+
+TEST_F(RcSmoothingTest, TestOffPassesTheCommandThrough)
+{
+    rxConfig()->rcSmoothing = RC_SMOOTHING_OFF;
+
+    for (int i = 0; i < 1200; i++) {
+        int16_t output = loop(stepInput, 200, 2000);
+        EXPECT_EQ(frameValue, output);
+    }
+}
+
+TEST_F(RcSmoothingTest, TestCutoffFollowsTheMeasuredFrameInterval)
+{
+    // auto cutoff is half the frame rate
+    EXPECT_EQ(1000000 / 11000 / 2, rcSmoothingGetCutoff());
+
+    for (int i = 0; i < 20; i++) {
+        loop(rampInput, 300, 3000);
+    }
+    EXPECT_EQ(1000000 / FRAME_INTERVAL / 2, rcSmoothingGetCutoff());
+
+    rxConfig()->rcSmoothingCutoff = 20;
+    for (int i = 0; i < 20; i++) {
+        loop(rampInput, 0, 0);
+    }
+    EXPECT_EQ(20, rcSmoothingGetCutoff());
+}
+
+TEST_F(RcSmoothingTest, TestLinearInterpolationReachesEachFrameWithinOneInterval)
+{
+    // given a measured frame interval
+    int16_t output = 0;
+    while (frameValue == 0) {
+        output = loop(stepInput, 0, 0);
+    }
+    const uint32_t stepFrameTime = frameTime;
+
+    // when the step arrives, then it is spread over one frame interval
+    int16_t previous = output;
+    EXPECT_LT(output, 500 * 2 * LOOP_TIME / FRAME_INTERVAL);
+    while (now + LOOP_TIME - stepFrameTime < FRAME_INTERVAL) {
+        output = loop(stepInput, 0, 0);
+        EXPECT_GT(output, previous);
+        EXPECT_LT(output, 500);
+        previous = output;
+    }
+    output = loop(stepInput, 0, 0);
+    EXPECT_NEAR(500, output, 5);
+
+    for (int i = 0; i < FRAME_INTERVAL / LOOP_TIME; i++) {
+        output = loop(stepInput, 0, 0);
+    }
+    EXPECT_EQ(500, output);
+}
+
+TEST_F(RcSmoothingTest, TestLinearInterpolationOfAJitteredRamp)
+{
+    int maxStepSmoothed = 0;
+    int maxStepRaw = 0;
+    int16_t previousOutput = 0;
+    int16_t previousFrameValue = 0;
+
+    for (int i = 0; i < 2000; i++) {
+        int16_t output = loop(rampInput, 300, 2000);
+        if (i > 100) {
+            maxStepSmoothed = MAX(maxStepSmoothed, ABS(output - previousOutput));
+            maxStepRaw = MAX(maxStepRaw, ABS(frameValue - previousFrameValue));
+            // the output follows the ramp at most one frame interval behind
+            EXPECT_GE(output, rampInput(now - FRAME_INTERVAL - 2000 - 1000) - 2);
+            EXPECT_LE(output, frameValue);
+        }
+        previousOutput = output;
+        previousFrameValue = frameValue;
+    }
+
+    // a 100 step per frame becomes steps of about 100 * loop time / frame interval
+    EXPECT_GE(maxStepRaw, 100);
+    EXPECT_LE(maxStepSmoothed, 40);
+}
+
+TEST_F(RcSmoothingTest, TestPt1StepResponseDoesNotDependOnTheLoopJitter)
+{
+    rxConfig()->rcSmoothing = RC_SMOOTHING_PT1;
+    rxConfig()->rcSmoothingCutoff = 20;
+
+    int16_t output = 0;
+    while (now < STEP_TIME + 8000) {
+        output = loop(stepInput, 0, 0);
+    }
+    const int16_t atTimeConstant = output;
+
+    // after one time constant, 1 / (2 * pi * 20Hz) = 8ms, about 63% of the step
+    EXPECT_NEAR(500 * 0.63f, atTimeConstant, 500 * 0.1f);
+
+    SetUp();
+    rxConfig()->rcSmoothing = RC_SMOOTHING_PT1;
+    rxConfig()->rcSmoothingCutoff = 20;
+    while (now < STEP_TIME + 8000) {
+        output = loop(stepInput, 400, 0);
+    }
+    EXPECT_NEAR(atTimeConstant, output, 500 * 0.08f);
+}
+
+TEST_F(RcSmoothingTest, TestPt2StepResponseDoesNotOvershoot)
+{
+    rxConfig()->rcSmoothing = RC_SMOOTHING_PT2;
+
+    int16_t previous = 0;
+    int16_t output = 0;
+    for (int i = 0; i < 1300; i++) {
+        output = loop(stepInput, 300, 2000);
+        EXPECT_GE(output, previous);
+        EXPECT_LE(output, 500);
+        previous = output;
+    }
+    EXPECT_EQ(500, output);
+}
+
+TEST_F(RcSmoothingTest, TestSwitchingTheSmoothingOnDoesNotStep)
+{
+    rxConfig()->rcSmoothing = RC_SMOOTHING_OFF;
+    for (int i = 0; i < 250; i++) {
+        loop(rampInput, 0, 0);
+    }
+
+    for (int type = RC_SMOOTHING_LINEAR; type <= RC_SMOOTHING_PT2; type++) {
+        rxConfig()->rcSmoothing = type;
+        int16_t previous = loop(rampInput, 0, 0);
+        for (int i = 0; i < 50; i++) {
+            int16_t output = loop(rampInput, 0, 0);
+            EXPECT_LE(ABS(output - previous), 100) << "type " << type;
+            previous = output;
+        }
+    }
+}
+
+// STUBS
+
+extern "C" {
+
+uint16_t rxGetFrameInterval(void)
+{
+    return measuredFrameInterval;
+}
+
+}
@@ -0,0 +1,367 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "common/crc.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/serial.h"
+    #include "io/serial.h"
+
+    #include "rx/rx.h"
+    #include "rx/crsf.h"
+
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define CRSF_CHANNEL_COUNT 16
+#define CRSF_RC_FRAME_SIZE 26
+#define CRSF_LINK_STATISTICS_FRAME_SIZE 14
+
+static uint32_t microsValue;
+static serialReceiveCallbackPtr byteCallback;
+static serialReceiveFrameCallbackPtr frameCallback;
+static rcReadRawDataPtr readRawRC;
+rxRuntimeConfig_t rxRuntimeConfig;
+
+static uint8_t writtenData[128];
+static int writtenLength;
+static uint8_t txBytesFree;
+
+// packs one bit at a time, independent of the decoder, and appends the crc
+static void packRcFrame(uint8_t *frame, const uint16_t *channels)
+{
+    memset(frame, 0, CRSF_RC_FRAME_SIZE);
+    frame[0] = CRSF_ADDRESS_FLIGHT_CONTROLLER;
+    frame[1] = 24;
+    frame[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
+    for (int bit = 0; bit < CRSF_CHANNEL_COUNT * 11; bit++) {
+        if (channels[bit / 11] & (1 << (bit % 11))) {
+            frame[3 + bit / 8] |= 1 << (bit % 8);
+        }
+    }
+    uint8_t crc = 0;
+    for (int i = 2; i < CRSF_RC_FRAME_SIZE - 1; i++) {
+        crc = crc8_dvb_s2(crc, frame[i]);
+    }
+    frame[CRSF_RC_FRAME_SIZE - 1] = crc;
+}
+
+// uplink RSSI -60/-70 dBm, LQ 87 %, SNR 9 dB, antenna 0, 150 Hz, power 3, downlink -55 dBm, 100 %, SNR -3 dB
+static const uint8_t linkStatisticsFrame[CRSF_LINK_STATISTICS_FRAME_SIZE] = {
+    0xC8, 0x0C, 0x14, 60, 70, 87, 9, 0, 2, 3, 55, 100, 0xFD, 0x00
+};
+
+class CrsfTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        microsValue = 0;
+        byteCallback = NULL;
+        frameCallback = NULL;
+        writtenLength = 0;
+        txBytesFree = 255;
+        rssi = 0;
+        memset(rxConfig(), 0, sizeof(*rxConfig()));
+        rxConfig()->midrc = 1500;
+        memset(&rxRuntimeConfig, 0, sizeof(rxRuntimeConfig));
+
+        memcpy(linkStatistics, linkStatisticsFrame, sizeof(linkStatistics));
+        uint8_t crc = 0;
+        for (int i = 2; i < CRSF_LINK_STATISTICS_FRAME_SIZE - 1; i++) {
+            crc = crc8_dvb_s2(crc, linkStatistics[i]);
+        }
+        linkStatistics[CRSF_LINK_STATISTICS_FRAME_SIZE - 1] = crc;
+
+        ASSERT_TRUE(crsfInit(&rxRuntimeConfig, &readRawRC));
+        ASSERT_TRUE(byteCallback != NULL);
+        ASSERT_TRUE(frameCallback != NULL);
+    }
+
+    uint8_t linkStatistics[CRSF_LINK_STATISTICS_FRAME_SIZE];
+};
+
+TEST_F(CrsfTest, TestCrc8DvbS2)
+{
+    const char *check = "123456789";
+    uint8_t crc = 0;
+    for (int i = 0; i < 9; i++) {
+        crc = crc8_dvb_s2(crc, check[i]);
+    }
+    EXPECT_EQ(0xBC, crc);
+}
+
+TEST_F(CrsfTest, TestInitialChannelsAreCentred)
+{
+    EXPECT_EQ(CRSF_CHANNEL_COUNT, rxRuntimeConfig.channelCount);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+    for (int i = 0; i < CRSF_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(1500, readRawRC(&rxRuntimeConfig, i));
+    }
+    EXPECT_TRUE(crsfRxIsActive());
+}
+
+TEST_F(CrsfTest, TestRcChannelsFrame)
+{
+    const uint16_t channels[CRSF_CHANNEL_COUNT] = {
+        172, 992, 1811, 0, 2047, 1000, 500, 1500, 172, 992, 1811, 300, 600, 900, 1200, 1700
+    };
+    const uint16_t expected[CRSF_CHANNEL_COUNT] = {
+        988, 1500, 2012, 881, 2159, 1505, 1193, 1818, 988, 1500, 2012, 1068, 1255, 1443, 1630, 1943
+    };
+    uint8_t frame[CRSF_RC_FRAME_SIZE];
+    packRcFrame(frame, channels);
+
+    // when
+    frameCallback(frame, CRSF_RC_FRAME_SIZE, 1234);
+
+    // then
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, crsfFrameStatus());
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+    EXPECT_EQ(1234u, rxFrameTime);
+    for (int i = 0; i < CRSF_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(expected[i], readRawRC(&rxRuntimeConfig, i)) << "channel " << i;
+    }
+    EXPECT_EQ(1u, crsfGetFrameStats()->frameCount);
+}
+
+TEST_F(CrsfTest, TestCrcErrorIsRejected)
+{
+    uint16_t channels[CRSF_CHANNEL_COUNT] = { 0 };
+    uint8_t frame[CRSF_RC_FRAME_SIZE];
+    packRcFrame(frame, channels);
+    frame[10] ^= 0x01;
+
+    frameCallback(frame, CRSF_RC_FRAME_SIZE, 1234);
+
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+    EXPECT_EQ(1500, readRawRC(&rxRuntimeConfig, 0));
+    EXPECT_EQ(1u, crsfGetFrameStats()->crcErrorCount);
+    EXPECT_EQ(0u, crsfGetFrameStats()->frameCount);
+}
+
+TEST_F(CrsfTest, TestCorruptFramesAreRejected)
+{
+    uint16_t channels[CRSF_CHANNEL_COUNT] = { 0 };
+    uint8_t frame[CRSF_RC_FRAME_SIZE];
+    packRcFrame(frame, channels);
+
+    // cut short
+    frameCallback(frame, CRSF_RC_FRAME_SIZE - 1, 0);
+    // wrong address
+    frame[0] = 0xEA;
+    frameCallback(frame, CRSF_RC_FRAME_SIZE, 0);
+
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+    EXPECT_EQ(2u, crsfGetFrameStats()->corruptFrameCount);
+}
+
+TEST_F(CrsfTest, TestLinkStatisticsFeedRssi)
+{
+    frameCallback(linkStatistics, CRSF_LINK_STATISTICS_FRAME_SIZE, 0);
+
+    // no channels, but the link statistics are processed
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+    EXPECT_EQ(87 * 1023 / 100, rssi);
+
+    const crsfLinkStatistics_t *link = crsfGetLinkStatistics();
+    EXPECT_EQ(60, link->uplinkRssi1);
+    EXPECT_EQ(70, link->uplinkRssi2);
+    EXPECT_EQ(87, link->uplinkLinkQuality);
+    EXPECT_EQ(9, link->uplinkSnr);
+    EXPECT_EQ(2, link->rfMode);
+    EXPECT_EQ(55, link->downlinkRssi);
+    EXPECT_EQ(100, link->downlinkLinkQuality);
+    EXPECT_EQ(-3, link->downlinkSnr);
+    EXPECT_EQ(1u, crsfGetFrameStats()->linkStatisticsCount);
+}
+
+TEST_F(CrsfTest, TestFramesWithoutPauseInOneBurst)
+{
+    uint16_t channels[CRSF_CHANNEL_COUNT] = { 992 };
+    uint8_t burst[CRSF_RC_FRAME_SIZE + CRSF_LINK_STATISTICS_FRAME_SIZE];
+    packRcFrame(burst, channels);
+    memcpy(&burst[CRSF_RC_FRAME_SIZE], linkStatistics, CRSF_LINK_STATISTICS_FRAME_SIZE);
+
+    frameCallback(burst, sizeof(burst), 5000);
+
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, crsfFrameStatus());
+    EXPECT_EQ(1500, readRawRC(&rxRuntimeConfig, 0));
+    EXPECT_EQ(87 * 1023 / 100, rssi);
+    EXPECT_EQ(0u, crsfGetFrameStats()->corruptFrameCount);
+}
+
+TEST_F(CrsfTest, TestBackToBackFramesAreUnpackedWhole)
+{
+    uint16_t first[CRSF_CHANNEL_COUNT];
+    uint16_t second[CRSF_CHANNEL_COUNT];
+    for (int i = 0; i < CRSF_CHANNEL_COUNT; i++) {
+        first[i] = 172;
+        second[i] = 1811;
+    }
+    uint8_t frame[CRSF_RC_FRAME_SIZE];
+
+    // when a second frame arrives before the first is unpacked
+    packRcFrame(frame, first);
+    frameCallback(frame, CRSF_RC_FRAME_SIZE, 1000);
+    packRcFrame(frame, second);
+    frameCallback(frame, CRSF_RC_FRAME_SIZE, 5000);
+
+    // then the newest is unpacked, once
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, crsfFrameStatus());
+    for (int i = 0; i < CRSF_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(2012, readRawRC(&rxRuntimeConfig, i)) << "channel " << i;
+    }
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+
+    // and the following frame is unpacked in turn
+    packRcFrame(frame, first);
+    frameCallback(frame, CRSF_RC_FRAME_SIZE, 9000);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, crsfFrameStatus());
+    for (int i = 0; i < CRSF_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(988, readRawRC(&rxRuntimeConfig, i)) << "channel " << i;
+    }
+    EXPECT_EQ(3u, crsfGetFrameStats()->frameCount);
+}
+
+TEST_F(CrsfTest, TestByteByByteReception)
+{
+    uint16_t channels[CRSF_CHANNEL_COUNT] = { 172 };
+    uint8_t frame[CRSF_RC_FRAME_SIZE];
+    packRcFrame(frame, channels);
+
+    // a partial frame followed by a gap is corrupt, the noise before the address byte is ignored
+    microsValue = 1000;
+    for (int i = 0; i < 10; i++) {
+        byteCallback(frame[i]);
+    }
+    microsValue = 10000;
+    byteCallback(0x55);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, crsfFrameStatus());
+    EXPECT_EQ(1u, crsfGetFrameStats()->corruptFrameCount);
+
+    for (int i = 0; i < CRSF_RC_FRAME_SIZE; i++) {
+        byteCallback(frame[i]);
+        microsValue += 24;
+    }
+    for (int i = 0; i < CRSF_LINK_STATISTICS_FRAME_SIZE; i++) {
+        byteCallback(linkStatistics[i]);
+        microsValue += 24;
+    }
+
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, crsfFrameStatus());
+    EXPECT_EQ(988, readRawRC(&rxRuntimeConfig, 0));
+    EXPECT_EQ(10000u + 25 * 24, rxFrameTime);
+    EXPECT_EQ(87 * 1023 / 100, rssi);
+    EXPECT_EQ(1u, crsfGetFrameStats()->frameCount);
+}
+
+TEST_F(CrsfTest, TestTelemetryFrame)
+{
+    const uint8_t payload[] = { 0x00, 0x7E, 0x00, 0x0C, 0x00, 0x01, 0xF4, 0x4B };
+
+    crsfRxSendFrame(CRSF_FRAMETYPE_BATTERY_SENSOR, payload, sizeof(payload));
+
+    ASSERT_EQ(12, writtenLength);
+    EXPECT_EQ(CRSF_ADDRESS_FLIGHT_CONTROLLER, writtenData[0]);
+    EXPECT_EQ(10, writtenData[1]);
+    EXPECT_EQ(CRSF_FRAMETYPE_BATTERY_SENSOR, writtenData[2]);
+    EXPECT_EQ(0, memcmp(payload, &writtenData[3], sizeof(payload)));
+    uint8_t crc = 0;
+    for (int i = 2; i < 11; i++) {
+        crc = crc8_dvb_s2(crc, writtenData[i]);
+    }
+    EXPECT_EQ(crc, writtenData[11]);
+
+    // the frame is the same as one received, so the decoder accepts it
+    frameCallback(writtenData, writtenLength, 0);
+    EXPECT_EQ(0u, crsfGetFrameStats()->crcErrorCount);
+    EXPECT_EQ(0u, crsfGetFrameStats()->corruptFrameCount);
+
+    // frames that don't fit in the transmit buffer are dropped
+    writtenLength = 0;
+    txBytesFree = 11;
+    crsfRxSendFrame(CRSF_FRAMETYPE_BATTERY_SENSOR, payload, sizeof(payload));
+    EXPECT_EQ(0, writtenLength);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t rxFrameTime;
+uint16_t rssi;
+
+uint32_t micros(void)
+{
+    return microsValue;
+}
+
+static serialPortConfig_t portConfig;
+static serialPort_t port;
+
+serialPortConfig_t *findSerialPortConfig(uint16_t function)
+{
+    UNUSED(function);
+    return &portConfig;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, portOptions_t options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(options);
+
+    EXPECT_EQ(420000u, baudRate);
+    EXPECT_EQ(MODE_RXTX, mode);
+
+    byteCallback = callback;
+    return &port;
+}
+
+bool serialSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr callback)
+{
+    UNUSED(instance);
+    frameCallback = callback;
+    return true;
+}
+
+uint16_t serialTxBytesFree(serialPort_t *instance)
+{
+    UNUSED(instance);
+    return txBytesFree;
+}
+
+void serialWriteBuf(serialPort_t *instance, uint8_t *data, int count)
+{
+    UNUSED(instance);
+    memcpy(&writtenData[writtenLength], data, count);
+    writtenLength += count;
+}
+
+}
@@ -0,0 +1,367 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "common/crc.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/serial.h"
+    #include "io/serial.h"
+
+    #include "rx/rx.h"
+    #include "rx/rx_frame.h"
+    #include "rx/ibus.h"
+    #include "rx/spektrum.h"
+    #include "rx/srxl.h"
+    #include "rx/sumd.h"
+    #include "rx/xbus.h"
+
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static uint32_t microsValue;
+static serialReceiveCallbackPtr byteCallback;
+static serialReceiveFrameCallbackPtr frameCallback;
+static rcReadRawDataPtr readRawRC;
+rxRuntimeConfig_t rxRuntimeConfig;
+
+// SUMD, 8 channels 1500 1100 1900 1500 1000 2000 1500 1500 us
+static const uint8_t sumdFrame[] = {
+    0xA8, 0x01, 0x08, 0x2E, 0xE0, 0x22, 0x60, 0x3B, 0x60, 0x2E, 0xE0, 0x1F, 0x40, 0x3E, 0x80, 0x2E, 0xE0, 0x2E, 0xE0,
+    0xCA, 0x7D
+};
+
+// IBUS, 14 channels 1500 1100 1900 1500 1000 2000 1500 1500 1234 1766 1500 1500 1500 1500 us
+static const uint8_t ibusFrame[] = {
+    0x20, 0x40, 0xDC, 0x05, 0x4C, 0x04, 0x6C, 0x07, 0xDC, 0x05, 0xE8, 0x03, 0xD0, 0x07, 0xDC, 0x05, 0xDC, 0x05,
+    0xD2, 0x04, 0xE6, 0x06, 0xDC, 0x05, 0xDC, 0x05, 0xDC, 0x05, 0xDC, 0x05, 0x50, 0xF4
+};
+
+// XBUS mode B in an Align RJ01 frame, channels 0x800 0x000 0xFFF 0x800 0x400 0xC00 0x800 0x800 0x800 0x800 0x800 0x124
+static const uint8_t xBusFrame[] = {
+    0xA1, 0x1E, 0x00, 0xA1, 0x08, 0x00, 0x00, 0x00, 0x0F, 0xFF, 0x08, 0x00, 0x04, 0x00, 0x0C, 0x00, 0x08, 0x00,
+    0x08, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08, 0x00, 0x01, 0x24, 0x6F, 0xE2, 0x00, 0x00, 0x10
+};
+
+static const uint16_t modeBChannelsUs[] = {
+    1500, 800, 2199, 1500, 1150, 1850, 1500, 1500, 1500, 1500, 1500, 899, 1500, 800, 2199, 1500
+};
+
+// SRXL with 12 channels, the same as the XBUS mode B frame
+static const uint8_t srxlFrameA1[] = {
+    0xA1, 0x08, 0x00, 0x00, 0x00, 0x0F, 0xFF, 0x08, 0x00, 0x04, 0x00, 0x0C, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08,
+    0x00, 0x08, 0x00, 0x08, 0x00, 0x01, 0x24, 0x6F, 0xE2
+};
+
+// SRXL with 16 channels, channels 13 to 16 are 0x800 0x000 0xFFF 0x800
+static const uint8_t srxlFrameA2[] = {
+    0xA2, 0x08, 0x00, 0x00, 0x00, 0x0F, 0xFF, 0x08, 0x00, 0x04, 0x00, 0x0C, 0x00, 0x08, 0x00, 0x08, 0x00, 0x08,
+    0x00, 0x08, 0x00, 0x08, 0x00, 0x01, 0x24, 0x08, 0x00, 0x00, 0x00, 0x0F, 0xFF, 0x08, 0x00, 0x26, 0xC1
+};
+
+// Spektrum 2048, channels 0 to 6 are 1024 200 1848 1024 0 2047 1024
+static const uint8_t spektrumFrame[] = {
+    0x00, 0xB2, 0x04, 0x00, 0x08, 0xC8, 0x17, 0x38, 0x1C, 0x00, 0x20, 0x00, 0x2F, 0xFF, 0x34, 0x00
+};
+
+class RxFrameTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        microsValue = 100000;
+        byteCallback = NULL;
+        frameCallback = NULL;
+        rxFrameTime = 0;
+        memset(rxConfig(), 0, sizeof(*rxConfig()));
+        rxConfig()->midrc = 1500;
+        memset(&rxRuntimeConfig, 0, sizeof(rxRuntimeConfig));
+    }
+
+    // the bytes as they arrive at the port, byteTime apart
+    void receiveBytes(const uint8_t *data, int length, uint32_t byteTime) {
+        for (int i = 0; i < length; i++) {
+            byteCallback(data[i]);
+            microsValue += byteTime;
+        }
+    }
+
+    void expectChannels(const uint16_t *expected, int count) {
+        for (int i = 0; i < count; i++) {
+            EXPECT_EQ(expected[i], readRawRC(&rxRuntimeConfig, i)) << "channel " << i;
+        }
+    }
+};
+
+TEST_F(RxFrameTest, TestCrc8Dallas)
+{
+    const char *check = "123456789";
+    uint8_t crc = 0;
+    for (int i = 0; i < 9; i++) {
+        crc = crc8_dallas(crc, check[i]);
+    }
+    EXPECT_EQ(0xA1, crc);
+}
+
+TEST_F(RxFrameTest, TestSumd)
+{
+    const uint16_t expected[] = { 1500, 1100, 1900, 1500, 1000, 2000, 1500, 1500 };
+
+    ASSERT_TRUE(sumdInit(&rxRuntimeConfig, &readRawRC));
+    EXPECT_EQ(16, rxRuntimeConfig.channelCount);
+
+    // noise, then the frame at 115200 baud
+    const uint8_t noise[] = { 0x00, 0x12, 0xFF };
+    receiveBytes(noise, sizeof(noise), 87);
+    microsValue += 10000;
+    receiveBytes(sumdFrame, sizeof(sumdFrame), 87);
+
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, sumdFrameStatus());
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, sumdFrameStatus());
+    expectChannels(expected, 8);
+    EXPECT_EQ(microsValue - 87, rxFrameTime);
+
+    // failsafe frame, the CRC covers the status byte
+    uint8_t frame[sizeof(sumdFrame)];
+    memcpy(frame, sumdFrame, sizeof(frame));
+    frame[1] = 0x81;
+    uint16_t crc = 0;
+    for (unsigned i = 0; i < sizeof(frame) - 2; i++) {
+        crc = crc16_CCITT(crc, frame[i]);
+    }
+    frame[sizeof(frame) - 2] = crc >> 8;
+    frame[sizeof(frame) - 1] = crc & 0xFF;
+    frameCallback(frame, sizeof(frame), 5000);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE | SERIAL_RX_FRAME_FAILSAFE, sumdFrameStatus());
+
+    // bad CRC
+    frame[5] ^= 0x01;
+    frameCallback(frame, sizeof(frame), 6000);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, sumdFrameStatus());
+    EXPECT_EQ(1u, rxFrameGetStats()->checksumErrorCount);
+    EXPECT_EQ(3u, rxFrameGetStats()->frameCount);
+}
+
+TEST_F(RxFrameTest, TestIbus)
+{
+    const uint16_t expected[] = { 1500, 1100, 1900, 1500, 1000, 2000, 1500, 1500, 1234, 1766 };
+
+    ASSERT_TRUE(ibusInit(&rxRuntimeConfig, &readRawRC));
+    EXPECT_EQ(10, rxRuntimeConfig.channelCount);
+
+    receiveBytes(ibusFrame, sizeof(ibusFrame), 87);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, ibusFrameStatus());
+    expectChannels(expected, 10);
+
+    // a frame received whole is the same
+    frameCallback(ibusFrame, sizeof(ibusFrame), 7000);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, ibusFrameStatus());
+    EXPECT_EQ(7000u, rxFrameTime);
+
+    // bad checksum
+    uint8_t frame[sizeof(ibusFrame)];
+    memcpy(frame, ibusFrame, sizeof(frame));
+    frame[sizeof(frame) - 1] ^= 0x01;
+    frameCallback(frame, sizeof(frame), 14000);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, ibusFrameStatus());
+    EXPECT_EQ(1u, rxFrameGetStats()->checksumErrorCount);
+}
+
+TEST_F(RxFrameTest, TestXbusRj01)
+{
+    ASSERT_TRUE(xBusInit(&rxRuntimeConfig, &readRawRC));
+    EXPECT_EQ(12, rxRuntimeConfig.channelCount);
+
+    receiveBytes(xBusFrame, sizeof(xBusFrame), 40);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, xBusFrameStatus());
+    expectChannels(modeBChannelsUs, 12);
+    EXPECT_EQ(0, readRawRC(&rxRuntimeConfig, 12));
+
+    // the outer CRC is checked with the frame
+    uint8_t frame[sizeof(xBusFrame)];
+    memcpy(frame, xBusFrame, sizeof(frame));
+    frame[sizeof(frame) - 1] ^= 0x01;
+    frameCallback(frame, sizeof(frame), 10000);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, xBusFrameStatus());
+    EXPECT_EQ(1u, rxFrameGetStats()->checksumErrorCount);
+
+    // a frame whose length byte doesn't match the frame
+    frameCallback(xBusFrame, sizeof(xBusFrame) - 1, 20000);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, xBusFrameStatus());
+    EXPECT_EQ(1u, rxFrameGetStats()->corruptFrameCount);
+}
+
+TEST_F(RxFrameTest, TestSrxl)
+{
+    ASSERT_TRUE(srxlInit(&rxRuntimeConfig, &readRawRC));
+    EXPECT_EQ(16, rxRuntimeConfig.channelCount);
+
+    // the size of each frame follows from its start byte
+    receiveBytes(srxlFrameA1, sizeof(srxlFrameA1), 87);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, srxlFrameStatus());
+    expectChannels(modeBChannelsUs, 12);
+
+    microsValue += 10000;
+    receiveBytes(srxlFrameA2, sizeof(srxlFrameA2), 87);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, srxlFrameStatus());
+    expectChannels(modeBChannelsUs, 16);
+
+    frameCallback(srxlFrameA1, sizeof(srxlFrameA1), 50000);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, srxlFrameStatus());
+    frameCallback(srxlFrameA2, sizeof(srxlFrameA1), 60000);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, srxlFrameStatus());
+
+    const rxFrameStats_t *stats = rxFrameGetStats();
+    EXPECT_EQ(3u, stats->frameCount);
+    EXPECT_EQ(1u, stats->corruptFrameCount);
+    EXPECT_EQ(0u, stats->checksumErrorCount);
+}
+
+TEST_F(RxFrameTest, TestSpektrum2048)
+{
+    const uint16_t expected[] = { 1500, 1088, 1912, 1500, 988, 2011, 1500 };
+
+    rxConfig()->serialrx_provider = SERIALRX_SPEKTRUM2048;
+    ASSERT_TRUE(spektrumInit(&rxRuntimeConfig, &readRawRC));
+    EXPECT_EQ(12, rxRuntimeConfig.channelCount);
+
+    // the frames have no sync byte, a pause aligns the receiver to them
+    receiveBytes(spektrumFrame, 5, 87);
+    microsValue += 11000;
+    receiveBytes(spektrumFrame, sizeof(spektrumFrame), 87);
+
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, spektrumFrameStatus());
+    expectChannels(expected, 7);
+    EXPECT_EQ(1u, rxFrameGetStats()->corruptFrameCount);
+    EXPECT_EQ(1u, rxFrameGetStats()->frameCount);
+}
+
+TEST_F(RxFrameTest, TestFramesOfAnotherProtocolAreIgnored)
+{
+    ASSERT_TRUE(ibusInit(&rxRuntimeConfig, &readRawRC));
+
+    frameCallback(ibusFrame, sizeof(ibusFrame), 7000);
+
+    // serialrx_provider changed without a reboot
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, sumdFrameStatus());
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, ibusFrameStatus());
+}
+
+TEST_F(RxFrameTest, TestEachFrameIsReturnedOnce)
+{
+    static const rxFrameDescriptor_t descriptor = {
+        .syncByte = 0x0F,
+        .syncByteMask = 0xFF,
+        .frameSize = 4,
+        .frameSizeMax = 4,
+        .lengthOffset = 0,
+        .lengthMask = 0,
+        .lengthMultiplier = 0,
+        .checksum = RX_FRAME_CHECKSUM_NONE,
+        .interFrameGapUs = 3000,
+    };
+    const uint8_t frame[] = { 0x0F, 1, 2, 3 };
+    uint8_t length;
+
+    ASSERT_TRUE(rxFrameOpenPort(&descriptor, 100000, MODE_RX, SERIAL_NOT_INVERTED) != NULL);
+    EXPECT_EQ(NULL, rxFrameGet(&descriptor, &length));
+
+    frameCallback(frame, sizeof(frame), 7000);
+    const uint8_t *first = rxFrameGet(&descriptor, &length);
+    ASSERT_TRUE(first != NULL);
+    EXPECT_EQ(sizeof(frame), length);
+    EXPECT_EQ(NULL, rxFrameGet(&descriptor, &length));
+
+    // the next frame is received into the other buffer while the first one is decoded
+    frameCallback(frame, sizeof(frame), 14000);
+    const uint8_t *second = rxFrameGet(&descriptor, &length);
+    ASSERT_TRUE(second != NULL);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(14000u, rxFrameTime);
+    EXPECT_EQ(NULL, rxFrameGet(&descriptor, &length));
+}
+
+TEST_F(RxFrameTest, TestFrameIntervalStatistics)
+{
+    ASSERT_TRUE(ibusInit(&rxRuntimeConfig, &readRawRC));
+
+    uint32_t frameEndAt = 100000;
+    for (int i = 0; i < 20; i++) {
+        frameCallback(ibusFrame, sizeof(ibusFrame), frameEndAt);
+        frameEndAt += (i & 1) ? 7000 : 8000;
+    }
+
+    const rxFrameStats_t *stats = rxFrameGetStats();
+    EXPECT_EQ(20u, stats->frameCount);
+    EXPECT_EQ(7000, stats->frameIntervalMin);
+    EXPECT_EQ(8000, stats->frameIntervalMax);
+    EXPECT_NEAR(7500, stats->frameIntervalAverage, 500);
+
+    rxFrameResetStats();
+    EXPECT_EQ(0u, stats->frameCount);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t rxFrameTime;
+
+uint32_t micros(void)
+{
+    return microsValue;
+}
+
+static serialPortConfig_t portConfig;
+static serialPort_t port;
+
+serialPortConfig_t *findSerialPortConfig(uint16_t function)
+{
+    UNUSED(function);
+    return &portConfig;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, portOptions_t options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(baudRate);
+    UNUSED(mode);
+    UNUSED(options);
+
+    byteCallback = callback;
+    return &port;
+}
+
+bool serialSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr callback)
+{
+    UNUSED(instance);
+    frameCallback = callback;
+    return true;
+}
+
+}
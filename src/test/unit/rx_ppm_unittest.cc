@@ -0,0 +1,356 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "build/build_config.h"
+
+    #include "common/utils.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/dma.h"
+    #include "drivers/gpio.h"
+    #include "drivers/timer.h"
+    #include "drivers/pwm_rx.h"
+
+    #define PPM_DMA_BUFFER_SIZE 64
+
+    extern captureCompare_t ppmDmaBuffer[PPM_DMA_BUFFER_SIZE];
+
+    PG_REGISTER(pwmRxConfig_t, pwmRxConfig, PG_DRIVER_PWM_RX_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_CHANNEL_COUNT 8
+#define TEST_SYNC_PULSE 6000            // us, what is left of the 20ms frame
+#define TEST_FRAMES_TO_LOCK_ON 30       // the decoder waits for 25 frames with the same channel count
+
+static DMA_TypeDef testDma;
+static DMA_Channel_TypeDef testDmaChannel;
+static dmaChannel_t testDmaDescriptor = { &testDma, &testDmaChannel, NULL, 0, TEST_IRQ, 0 };
+static timerDmaMapping_t testDmaMapping = { NULL, 1, &testDmaChannel, 0 };
+static timerHardware_t testTimerHardware;
+
+static captureCompare_t captureTime;
+
+// what the circular DMA does for each rising edge captured by the timer
+static void captureEdge(uint16_t pulse)
+{
+    captureTime += pulse;
+
+    ppmDmaBuffer[PPM_DMA_BUFFER_SIZE - testDmaChannel.CNDTR] = captureTime;
+    if (--testDmaChannel.CNDTR == PPM_DMA_BUFFER_SIZE / 2) {
+        testDma.ISR |= DMA_IT_HTIF;
+    }
+    if (testDmaChannel.CNDTR == 0) {
+        testDmaChannel.CNDTR = PPM_DMA_BUFFER_SIZE;
+        testDma.ISR |= DMA_IT_TCIF;
+    }
+}
+
+static void captureFrame(const uint16_t *channels)
+{
+    for (int i = 0; i < TEST_CHANNEL_COUNT; i++) {
+        captureEdge(channels[i]);
+    }
+    captureEdge(TEST_SYNC_PULSE);
+}
+
+// the RX task polling for a new frame
+static bool pollFrame(void)
+{
+    bool received = isPPMDataBeingReceived();
+    resetPPMDataReceivedState();
+
+    // the flags written to the clear register
+    testDma.ISR &= ~testDma.IFCR;
+    testDma.IFCR = 0;
+
+    return received;
+}
+
+static uint8_t dmaWriteIndex(void)
+{
+    return PPM_DMA_BUFFER_SIZE - testDmaChannel.CNDTR;
+}
+
+static void expectChannels(const uint16_t *channels)
+{
+    for (int i = 0; i < TEST_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(channels[i], ppmRead(i)) << "channel " << i;
+    }
+}
+
+static const uint16_t centeredChannels[TEST_CHANNEL_COUNT] = { 1500, 1500, 1000, 1500, 1000, 1000, 2000, 1500 };
+static const uint16_t movedChannels[TEST_CHANNEL_COUNT] = { 1200, 1800, 1350, 1650, 2000, 1000, 1000, 1100 };
+
+class PpmDmaTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        memset(&testDma, 0, sizeof(testDma));
+        memset(&testDmaChannel, 0, sizeof(testDmaChannel));
+        memset(ppmDmaBuffer, 0, sizeof(ppmDmaBuffer));
+        captureTime = 0;
+
+        ppmInConfig(&testTimerHardware);
+        ppmInDmaConfig();
+    }
+
+    void lockOnToFrames(const uint16_t *channels) {
+        for (int i = 0; i < TEST_FRAMES_TO_LOCK_ON; i++) {
+            captureFrame(channels);
+            pollFrame();
+        }
+    }
+};
+
+TEST_F(PpmDmaTest, TestFramesAreDecodedFromTheEdgeBuffer)
+{
+    // given
+    lockOnToFrames(centeredChannels);
+
+    // when
+    captureFrame(movedChannels);
+
+    // then
+    EXPECT_TRUE(pollFrame());
+    expectChannels(movedChannels);
+
+    // and no new frame without new edges
+    EXPECT_FALSE(pollFrame());
+    expectChannels(movedChannels);
+}
+
+TEST_F(PpmDmaTest, TestHalfAFrameWaitsForTheRestOfTheFrame)
+{
+    // given
+    lockOnToFrames(centeredChannels);
+
+    // when
+    for (int i = 0; i < TEST_CHANNEL_COUNT / 2; i++) {
+        captureEdge(movedChannels[i]);
+    }
+
+    // then
+    EXPECT_FALSE(pollFrame());
+    expectChannels(centeredChannels);
+
+    // when
+    for (int i = TEST_CHANNEL_COUNT / 2; i < TEST_CHANNEL_COUNT; i++) {
+        captureEdge(movedChannels[i]);
+    }
+    captureEdge(TEST_SYNC_PULSE);
+
+    // then
+    EXPECT_TRUE(pollFrame());
+    expectChannels(movedChannels);
+}
+
+TEST_F(PpmDmaTest, TestEdgesAreDecodedAcrossTheEndOfTheBuffer)
+{
+    // given
+    lockOnToFrames(centeredChannels);
+    while (dmaWriteIndex() < PPM_DMA_BUFFER_SIZE - TEST_CHANNEL_COUNT) {
+        captureEdge(TEST_SYNC_PULSE);
+        pollFrame();
+    }
+
+    // when
+    captureFrame(movedChannels);
+
+    // then the DMA wrapped to the start of the buffer without passing the half
+    EXPECT_LT(dmaWriteIndex(), PPM_DMA_BUFFER_SIZE / 2);
+    EXPECT_TRUE(testDma.ISR & DMA_IT_TCIF);
+    EXPECT_FALSE(testDma.ISR & DMA_IT_HTIF);
+
+    EXPECT_TRUE(pollFrame());
+    expectChannels(movedChannels);
+}
+
+TEST_F(PpmDmaTest, TestOverrunDropsTheEdgesAndResynchronises)
+{
+    // given
+    lockOnToFrames(centeredChannels);
+
+    // when the RX task misses enough edges for the DMA to pass both flags
+    for (int i = 0; i < 8; i++) {
+        captureFrame(movedChannels);
+    }
+    EXPECT_TRUE(testDma.ISR & DMA_IT_HTIF);
+    EXPECT_TRUE(testDma.ISR & DMA_IT_TCIF);
+
+    // then none of the frames in the overwritten buffer are used
+    EXPECT_FALSE(pollFrame());
+    expectChannels(centeredChannels);
+
+    // when the next frame has been seen the decoder waits for its sync
+    captureFrame(movedChannels);
+
+    // then
+    EXPECT_FALSE(pollFrame());
+    expectChannels(centeredChannels);
+
+    // when
+    captureFrame(movedChannels);
+
+    // then
+    EXPECT_TRUE(pollFrame());
+    expectChannels(movedChannels);
+}
+
+TEST_F(PpmDmaTest, TestInvalidPulseDropsTheFrame)
+{
+    // given
+    lockOnToFrames(centeredChannels);
+
+    // when
+    uint16_t glitchedChannels[TEST_CHANNEL_COUNT];
+    memcpy(glitchedChannels, movedChannels, sizeof(glitchedChannels));
+    glitchedChannels[3] = 400;
+    captureFrame(glitchedChannels);
+
+    // then
+    EXPECT_FALSE(pollFrame());
+    expectChannels(centeredChannels);
+
+    // when
+    captureFrame(movedChannels);
+
+    // then
+    EXPECT_TRUE(pollFrame());
+    expectChannels(movedChannels);
+}
+
+// STUBS
+
+extern "C" {
+
+void gpioInit(GPIO_TypeDef *gpio, const gpio_config_t *config)
+{
+    UNUSED(gpio);
+    UNUSED(config);
+}
+
+void TIM_ICStructInit(TIM_ICInitTypeDef *TIM_ICInitStruct)
+{
+    memset(TIM_ICInitStruct, 0, sizeof(*TIM_ICInitStruct));
+}
+
+void TIM_ICInit(TIM_TypeDef *TIMx, TIM_ICInitTypeDef *TIM_ICInitStruct)
+{
+    UNUSED(TIMx);
+    UNUSED(TIM_ICInitStruct);
+}
+
+void TIM_DMACmd(TIM_TypeDef *TIMx, uint16_t TIM_DMASource, FunctionalState NewState)
+{
+    UNUSED(TIMx);
+    UNUSED(TIM_DMASource);
+    UNUSED(NewState);
+}
+
+void timerConfigure(const timerHardware_t *timHw, uint16_t period, uint8_t mhz)
+{
+    UNUSED(timHw);
+    UNUSED(period);
+    UNUSED(mhz);
+}
+
+void timerChCCHandlerInit(timerCCHandlerRec_t *self, timerCCHandlerCallback *fn)
+{
+    self->fn = fn;
+}
+
+void timerChOvrHandlerInit(timerOvrHandlerRec_t *self, timerOvrHandlerCallback *fn)
+{
+    self->fn = fn;
+}
+
+void timerChConfigCallbacks(const timerHardware_t *channel, timerCCHandlerRec_t *edgeCallback, timerOvrHandlerRec_t *overflowCallback)
+{
+    UNUSED(channel);
+    UNUSED(edgeCallback);
+    UNUSED(overflowCallback);
+}
+
+void timerChITConfig(const timerHardware_t *timHw, FunctionalState newState)
+{
+    UNUSED(timHw);
+    UNUSED(newState);
+}
+
+static timCCR_t testCCR;
+
+volatile timCCR_t *timerChCCR(const timerHardware_t *timHw)
+{
+    UNUSED(timHw);
+    return &testCCR;
+}
+
+const timerDmaMapping_t *timerDmaAllocate(const timerHardware_t *timHw)
+{
+    UNUSED(timHw);
+    return &testDmaMapping;
+}
+
+uint16_t timerDmaSource(uint8_t channel)
+{
+    UNUSED(channel);
+    return 0;
+}
+
+dmaChannel_t *dmaFindChannelDescriptor(DMA_Channel_TypeDef *channel)
+{
+    return channel == &testDmaChannel ? &testDmaDescriptor : NULL;
+}
+
+void DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx)
+{
+    UNUSED(DMAy_Channelx);
+}
+
+void DMA_StructInit(DMA_InitTypeDef *DMA_InitStruct)
+{
+    memset(DMA_InitStruct, 0, sizeof(*DMA_InitStruct));
+}
+
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct)
+{
+    DMAy_Channelx->CNDTR = DMA_InitStruct->DMA_BufferSize;
+}
+
+void DMA_Cmd(DMA_Channel_TypeDef *DMAy_Channelx, FunctionalState NewState)
+{
+    UNUSED(DMAy_Channelx);
+    UNUSED(NewState);
+}
+
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx)
+{
+    return DMAy_Channelx->CNDTR;
+}
+
+}
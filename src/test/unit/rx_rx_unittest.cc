@@ -28,6 +28,7 @@ extern "C" {
     #include "config/parameter_group_ids.h"
 
     #include "rx/rx.h"
+    #include "fc/config.h"
     #include "fc/rc_controls.h"
     #include "common/maths.h"
     #include "common/utils.h"
@@ -39,6 +40,7 @@ extern "C" {
     bool rxHaveValidFlightChannels(void);
     bool isPulseValid(uint16_t pulseDuration);
     void rxUpdateFlightChannelStatus(uint8_t channel, uint16_t pulseDuration);
+    void rxUpdateFrameInterval(uint32_t frameTime);
 }
 
 #include "unittest_macros.h"
@@ -49,6 +51,8 @@ extern "C" {
 typedef struct testData_s {
     bool isPPMDataBeingReceived;
     bool isPWMDataBeingReceived;
+    uint32_t enabledFeatures;
+    uint16_t rawChannels[NON_AUX_CHANNEL_COUNT];
 } testData_t;
 
 static testData_t testData;
@@ -158,6 +162,120 @@ TEST(RxTest, TestInvalidFlightChannels)
     }
 }
 
+TEST(RxTest, TestFrameIntervalIsMeasuredFromJitteredFrames)
+{
+    // given
+    modeActivationCondition_t modeActivationConditions[MAX_MODE_ACTIVATION_CONDITION_COUNT];
+    memset(&modeActivationConditions, 0, sizeof(modeActivationConditions));
+    rxInit(modeActivationConditions);
+
+    // then (the nominal rate until frames arrive)
+    EXPECT_EQ(20000, rxGetFrameInterval());
+
+    // when (a receiver much faster than the nominal rate, 9 ms +- 1 ms)
+    uint32_t frameTime = 100000;
+    for (int i = 0; i < 200; i++) {
+        frameTime += 9000 + ((i * 7) % 3 - 1) * 1000;
+        rxUpdateFrameInterval(frameTime);
+    }
+
+    // then
+    EXPECT_NEAR(9000, rxGetFrameInterval(), 300);
+}
+
+TEST(RxTest, TestMissedFramesAndOutagesDontChangeTheFrameInterval)
+{
+    // given
+    modeActivationCondition_t modeActivationConditions[MAX_MODE_ACTIVATION_CONDITION_COUNT];
+    memset(&modeActivationConditions, 0, sizeof(modeActivationConditions));
+    rxInit(modeActivationConditions);
+
+    uint32_t frameTime = 100000;
+    for (int i = 0; i < 100; i++) {
+        frameTime += 20000;
+        rxUpdateFrameInterval(frameTime);
+    }
+    EXPECT_EQ(20000, rxGetFrameInterval());
+
+    // when (a missed frame, a frame split by a glitch, a lost link)
+    frameTime += 40000;
+    rxUpdateFrameInterval(frameTime);
+    frameTime += 3000;
+    rxUpdateFrameInterval(frameTime);
+    frameTime += 17000;
+    rxUpdateFrameInterval(frameTime);
+    frameTime += 500000;
+    rxUpdateFrameInterval(frameTime);
+
+    // then (only the 17 ms interval is averaged in)
+    EXPECT_NEAR(20000, rxGetFrameInterval(), 200);
+}
+
+TEST(RxTest, TestPpmChannelsAreTheAverageOfTheLastSamples)
+{
+    // given
+    memset(&testData, 0, sizeof(testData));
+    testData.enabledFeatures = FEATURE_RX_PPM;
+    testData.isPPMDataBeingReceived = true;
+    rcModeActivationMask = DE_ACTIVATE_ALL_BOXES;
+
+    memset(rxConfig(), 0, sizeof(*rxConfig()));
+    rxConfig()->midrc = 1500;
+    rxConfig()->rx_min_usec = 885;
+    rxConfig()->rx_max_usec = 2115;
+    for (int i = 0; i < MAX_MAPPABLE_RX_INPUTS; i++) {
+        rxConfig()->rcmap[i] = i;
+    }
+    for (int i = 0; i < NON_AUX_CHANNEL_COUNT; i++) {
+        channelRanges(i)->min = PWM_RANGE_MIN;
+        channelRanges(i)->max = PWM_RANGE_MAX;
+        testData.rawChannels[i] = 1500;
+    }
+
+    modeActivationCondition_t modeActivationConditions[MAX_MODE_ACTIVATION_CONDITION_COUNT];
+    memset(&modeActivationConditions, 0, sizeof(modeActivationConditions));
+    rxInit(modeActivationConditions);
+
+    const struct {
+        uint16_t sample;
+        int16_t expected;
+    } samples[] = {
+        { 1100, 1100 },     // the samples are used as they are until there are enough to average
+        { 1400, 1400 },
+        { 1700, 1700 },
+        { 2000, 1700 },
+        { 1000, 1566 },
+        { 1000, 1333 },
+        { 1300, 1100 },
+    };
+
+    uint32_t currentTime = 0;
+    for (unsigned i = 0; i < ARRAYLEN(samples); i++) {
+        // when
+        testData.rawChannels[ROLL] = samples[i].sample;
+        currentTime += 20000;
+        updateRx(currentTime);
+        calculateRxChannelsAndUpdateFailsafe(currentTime);
+
+        // then
+        EXPECT_EQ(samples[i].expected, rcData[ROLL]) << "sample " << i;
+        EXPECT_EQ(1500, rcData[PITCH]);
+    }
+
+    // when (hundreds of frames later the sample slots and the running sum are still in step)
+    uint16_t history[3] = { 1000, 1000, 1300 };
+    for (int i = 0; i < 1000; i++) {
+        const uint16_t sample = 1000 + (i * 373) % 1001;
+        history[i % 3] = sample;
+        testData.rawChannels[ROLL] = sample;
+        currentTime += 20000;
+        updateRx(currentTime);
+        calculateRxChannelsAndUpdateFailsafe(currentTime);
+
+        // then
+        EXPECT_EQ((history[0] + history[1] + history[2]) / 3, rcData[ROLL]) << "sample " << i;
+    }
+}
 
 // STUBS
 
@@ -174,8 +292,7 @@ extern "C" {
     uint32_t millis(void) { return 0; }
 
     bool feature(uint32_t mask) {
-        UNUSED(mask);
-        return false;
+        return (testData.enabledFeatures & mask) != 0;
     }
 
     bool isPPMDataBeingReceived(void) {
@@ -192,5 +309,12 @@ extern "C" {
 
     void rxMspInit(rxRuntimeConfig_t *, rcReadRawDataPtr *) {}
 
-    void rxPwmInit(rxRuntimeConfig_t *, rcReadRawDataPtr *) {}
+    static uint16_t testReadRawRC(rxRuntimeConfig_t *, uint8_t chan) {
+        return chan < NON_AUX_CHANNEL_COUNT ? testData.rawChannels[chan] : 1500;
+    }
+
+    void rxPwmInit(rxRuntimeConfig_t *rxRuntimeConfig, rcReadRawDataPtr *callback) {
+        rxRuntimeConfig->channelCount = NON_AUX_CHANNEL_COUNT;
+        *callback = testReadRawRC;
+    }
 }
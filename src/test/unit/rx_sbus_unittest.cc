@@ -0,0 +1,299 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/serial.h"
+    #include "io/serial.h"
+
+    #include "rx/rx.h"
+    #include "rx/rx_frame.h"
+    #include "rx/sbus.h"
+
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define SBUS_FRAME_SIZE 25
+#define SBUS_CHANNEL_COUNT 18
+
+static uint32_t microsValue;
+static serialReceiveCallbackPtr byteCallback;
+static serialReceiveFrameCallbackPtr frameCallback;
+static rcReadRawDataPtr readRawRC;
+rxRuntimeConfig_t rxRuntimeConfig;
+
+// channels 173, 993, 1812, 0, 2047, 1024, 1, 1000, 2000, 300, 600, 900, 1200, 1500, 1800, 1234, channel 17 and 18 on
+static const uint8_t knownFrame[SBUS_FRAME_SIZE] = {
+    0x0F, 0xAD, 0x08, 0x1F, 0xC5, 0x01, 0xF0, 0x7F, 0x00, 0x06, 0x00, 0x7D, 0xD0,
+    0x67, 0x09, 0x96, 0x08, 0x07, 0x4B, 0xEE, 0x22, 0x5C, 0x9A, 0x03, 0x00
+};
+
+static const uint16_t knownFrameUs[SBUS_CHANNEL_COUNT] = {
+    988, 1500, 2012, 880, 2159, 1520, 880, 1505, 2130, 1067, 1255, 1442, 1630, 1817, 2005, 1651, 2012, 2012
+};
+
+// packs one bit at a time, independent of the decoder
+static void packFrame(uint8_t *frame, const uint16_t *channels, uint8_t flags)
+{
+    memset(frame, 0, SBUS_FRAME_SIZE);
+    frame[0] = 0x0F;
+    for (int bit = 0; bit < 16 * 11; bit++) {
+        if (channels[bit / 11] & (1 << (bit % 11))) {
+            frame[1 + bit / 8] |= 1 << (bit % 8);
+        }
+    }
+    frame[23] = flags;
+}
+
+class SbusTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        microsValue = 0;
+        byteCallback = NULL;
+        frameCallback = NULL;
+        memset(rxConfig(), 0, sizeof(*rxConfig()));
+        rxConfig()->midrc = 1500;
+        memset(&rxRuntimeConfig, 0, sizeof(rxRuntimeConfig));
+
+        ASSERT_TRUE(sbusInit(&rxRuntimeConfig, &readRawRC));
+        ASSERT_TRUE(byteCallback != NULL);
+        ASSERT_TRUE(frameCallback != NULL);
+    }
+
+    void expectChannels(const uint16_t *expected) {
+        for (int i = 0; i < SBUS_CHANNEL_COUNT; i++) {
+            EXPECT_EQ(expected[i], readRawRC(&rxRuntimeConfig, i)) << "channel " << i;
+        }
+    }
+};
+
+TEST_F(SbusTest, TestInitialChannelsAreCentred)
+{
+    EXPECT_EQ(SBUS_CHANNEL_COUNT, rxRuntimeConfig.channelCount);
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, sbusFrameStatus());
+    for (int i = 0; i < SBUS_CHANNEL_COUNT; i++) {
+        EXPECT_EQ(1500, readRawRC(&rxRuntimeConfig, i));
+    }
+}
+
+TEST_F(SbusTest, TestKnownFrame)
+{
+    // when
+    frameCallback(knownFrame, SBUS_FRAME_SIZE, 1234);
+
+    // then
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, sbusFrameStatus());
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, sbusFrameStatus());
+    EXPECT_EQ(1234u, rxFrameTime);
+    expectChannels(knownFrameUs);
+}
+
+TEST_F(SbusTest, TestMatchesFloatScalingForAllValues)
+{
+    uint16_t channels[16];
+    uint8_t frame[SBUS_FRAME_SIZE];
+
+    for (int value = 0; value < 2048; value++) {
+        for (int i = 0; i < 16; i++) {
+            channels[i] = (value + i * 131) & 0x7FF;
+        }
+        packFrame(frame, channels, 0);
+        frameCallback(frame, SBUS_FRAME_SIZE, value);
+        ASSERT_EQ(SERIAL_RX_FRAME_COMPLETE, sbusFrameStatus());
+
+        for (int i = 0; i < 16; i++) {
+            ASSERT_EQ((uint16_t)((0.625f * channels[i]) + 880), readRawRC(&rxRuntimeConfig, i));
+        }
+    }
+}
+
+TEST_F(SbusTest, TestDigitalChannelsAndFailsafe)
+{
+    uint16_t channels[16] = { 0 };
+    uint8_t frame[SBUS_FRAME_SIZE];
+
+    // channel 17 on, channel 18 off
+    packFrame(frame, channels, 1 << 0);
+    frameCallback(frame, SBUS_FRAME_SIZE, 0);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, sbusFrameStatus());
+    EXPECT_EQ(2012, readRawRC(&rxRuntimeConfig, 16));
+    EXPECT_EQ(988, readRawRC(&rxRuntimeConfig, 17));
+
+    // failsafe still delivers the channels
+    channels[0] = 993;
+    packFrame(frame, channels, 1 << 3);
+    frameCallback(frame, SBUS_FRAME_SIZE, 0);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE | SERIAL_RX_FRAME_FAILSAFE, sbusFrameStatus());
+    EXPECT_EQ(1500, readRawRC(&rxRuntimeConfig, 0));
+}
+
+TEST_F(SbusTest, TestLostAndCorruptFrameCounters)
+{
+    uint16_t channels[16] = { 0 };
+    uint8_t frame[SBUS_FRAME_SIZE];
+
+    packFrame(frame, channels, 1 << 2);
+    frameCallback(frame, SBUS_FRAME_SIZE, 0);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, sbusFrameStatus());
+    frameCallback(knownFrame, SBUS_FRAME_SIZE, 9000);
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, sbusFrameStatus());
+
+    // wrong length and wrong start byte
+    frameCallback(knownFrame, SBUS_FRAME_SIZE - 1, 18000);
+    frame[0] = 0x00;
+    frameCallback(frame, SBUS_FRAME_SIZE, 27000);
+
+    const rxFrameStats_t *stats = rxFrameGetStats();
+    EXPECT_EQ(2u, stats->frameCount);
+    EXPECT_EQ(1u, stats->lostFrameCount);
+    EXPECT_EQ(2u, stats->corruptFrameCount);
+    EXPECT_EQ(9000u, stats->lastFrameAt);
+    EXPECT_EQ(9000u, rxFrameTime);
+
+    rxFrameResetStats();
+    EXPECT_EQ(0u, stats->frameCount);
+    EXPECT_EQ(0u, stats->corruptFrameCount);
+}
+
+TEST_F(SbusTest, TestFrameIntervalStatistics)
+{
+    const uint32_t intervals[] = { 9000, 9000, 8000, 10000, 9000, 9000 };
+    uint32_t frameEndAt = 100000;
+
+    frameCallback(knownFrame, SBUS_FRAME_SIZE, frameEndAt);
+    for (unsigned i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+        frameEndAt += intervals[i];
+        frameCallback(knownFrame, SBUS_FRAME_SIZE, frameEndAt);
+    }
+
+    const rxFrameStats_t *stats = rxFrameGetStats();
+    EXPECT_EQ(7u, stats->frameCount);
+    EXPECT_EQ(8000, stats->frameIntervalMin);
+    EXPECT_EQ(10000, stats->frameIntervalMax);
+    EXPECT_NEAR(9000, stats->frameIntervalAverage, 100);
+
+    // an outage doesn't count as a frame interval
+    frameEndAt += 500000;
+    frameCallback(knownFrame, SBUS_FRAME_SIZE, frameEndAt);
+    EXPECT_EQ(10000, stats->frameIntervalMax);
+    EXPECT_EQ(8u, stats->frameCount);
+}
+
+TEST_F(SbusTest, TestByteByByteReception)
+{
+    // a partial frame followed by a gap is corrupt
+    microsValue = 1000;
+    for (int i = 0; i < 10; i++) {
+        byteCallback(knownFrame[i]);
+    }
+    EXPECT_EQ(SERIAL_RX_FRAME_PENDING, sbusFrameStatus());
+
+    microsValue = 20000;
+    for (int i = 0; i < SBUS_FRAME_SIZE; i++) {
+        byteCallback(knownFrame[i]);
+        microsValue += 120;
+    }
+
+    EXPECT_EQ(SERIAL_RX_FRAME_COMPLETE, sbusFrameStatus());
+    expectChannels(knownFrameUs);
+    EXPECT_EQ(20000u + 24 * 120, rxFrameTime);
+
+    const rxFrameStats_t *stats = rxFrameGetStats();
+    EXPECT_EQ(1u, stats->frameCount);
+    EXPECT_EQ(1u, stats->corruptFrameCount);
+}
+
+TEST_F(SbusTest, TestDecodeBenchmark)
+{
+    const int iterations = 100000;
+    uint16_t channels[16];
+    uint8_t frame[SBUS_FRAME_SIZE];
+
+    for (int i = 0; i < 16; i++) {
+        channels[i] = 173 + i * 100;
+    }
+    packFrame(frame, channels, 0);
+
+    uint32_t sum = 0;
+    const clock_t start = clock();
+    for (int i = 0; i < iterations; i++) {
+        frame[1] = i;
+        frameCallback(frame, SBUS_FRAME_SIZE, i * 9000);
+        sbusFrameStatus();
+        for (int channel = 0; channel < SBUS_CHANNEL_COUNT; channel++) {
+            sum += readRawRC(&rxRuntimeConfig, channel);
+        }
+    }
+    const float seconds = (float)(clock() - start) / CLOCKS_PER_SEC;
+
+    EXPECT_GT(sum, 0u);
+    printf("sbus: %6.1f ns per frame received, decoded and read\n", seconds * 1e9f / iterations);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t rxFrameTime;
+
+uint32_t micros(void)
+{
+    return microsValue;
+}
+
+static serialPortConfig_t portConfig;
+static serialPort_t port;
+
+serialPortConfig_t *findSerialPortConfig(uint16_t function)
+{
+    UNUSED(function);
+    return &portConfig;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr callback, uint32_t baudRate, portMode_t mode, portOptions_t options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(baudRate);
+    UNUSED(mode);
+    UNUSED(options);
+
+    byteCallback = callback;
+    return &port;
+}
+
+bool serialSetReceiveFrameCallback(serialPort_t *instance, serialReceiveFrameCallbackPtr callback)
+{
+    UNUSED(instance);
+    frameCallback = callback;
+    return true;
+}
+
+}
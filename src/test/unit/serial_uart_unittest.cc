@@ -0,0 +1,557 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "build/build_config.h"
+
+    #include "common/utils.h"
+
+    #include "drivers/dma.h"
+    #include "drivers/serial.h"
+    #include "drivers/serial_uart.h"
+    #include "drivers/serial_uart_impl.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_BAUDRATE 115200
+#define TEST_CHAR_TIME 86       // us, 10 bits at 115200 baud
+#define TEST_BUFFER_SIZE 128
+
+static uint32_t microsValue;
+static bool idleInterruptEnabled;
+static bool useRxDMA;
+static bool useTxDMA;
+
+static DMA_Channel_TypeDef rxDMAChannel;
+static DMA_Channel_TypeDef txDMAChannel;
+static uint8_t rxBuffer[TEST_BUFFER_SIZE];
+static uint8_t txBuffer[TEST_BUFFER_SIZE];
+static uartPort_t testPort;
+
+static uint8_t frame[SERIAL_RX_FRAME_SIZE_MAX];
+static uint8_t frameLength;
+static uint32_t frameEndAt;
+static int frameCount;
+
+static void testFrameCallback(const uint8_t *data, uint8_t length, uint32_t endAt)
+{
+    memcpy(frame, data, length);
+    frameLength = length;
+    frameEndAt = endAt;
+    frameCount++;
+}
+
+static void testByteCallback(uint16_t data)
+{
+    UNUSED(data);
+}
+
+// what the RXNE interrupt does for each byte
+static void receiveByInterrupt(const uint8_t *data, int length)
+{
+    for (int i = 0; i < length; i++) {
+        testPort.port.rxBuffer[testPort.port.rxBufferHead] = data[i];
+        testPort.port.rxBufferHead = serialBufferNext(testPort.port.rxBufferHead, testPort.port.rxBufferSize);
+    }
+}
+
+// what the circular receive DMA does for each byte
+static void receiveByDMA(const uint8_t *data, int length)
+{
+    for (int i = 0; i < length; i++) {
+        rxBuffer[TEST_BUFFER_SIZE - rxDMAChannel.CNDTR] = data[i];
+        if (--rxDMAChannel.CNDTR == 0) {
+            rxDMAChannel.CNDTR = TEST_BUFFER_SIZE;
+        }
+    }
+}
+
+static serialPort_t *openFramePort(void)
+{
+    serialPort_t *port = uartOpen(USART1, NULL, TEST_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
+    uartSetReceiveFrameCallback(port, testFrameCallback);
+    return port;
+}
+
+class SerialUartRxFrameTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        memset(&testPort, 0, sizeof(testPort));
+        memset(&rxDMAChannel, 0, sizeof(rxDMAChannel));
+        memset(rxBuffer, 0, sizeof(rxBuffer));
+        microsValue = 0;
+        idleInterruptEnabled = false;
+        useRxDMA = false;
+        useTxDMA = false;
+        frameLength = 0;
+        frameEndAt = 0;
+        frameCount = 0;
+    }
+};
+
+TEST_F(SerialUartRxFrameTest, TestSettingTheFrameCallbackEnablesTheIdleInterrupt)
+{
+    // given
+    serialPort_t *port = uartOpen(USART1, testByteCallback, TEST_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
+    EXPECT_FALSE(idleInterruptEnabled);
+
+    // when
+    EXPECT_TRUE(uartSetReceiveFrameCallback(port, testFrameCallback));
+
+    // then
+    EXPECT_TRUE(idleInterruptEnabled);
+    EXPECT_EQ(testFrameCallback, port->frameCallback);
+    EXPECT_EQ(NULL, port->callback);
+    EXPECT_EQ(TEST_CHAR_TIME, testPort.rxCharTime);
+}
+
+TEST_F(SerialUartRxFrameTest, TestTransmitOnlyPortHasNoFrames)
+{
+    // given
+    serialPort_t *port = uartOpen(USART1, NULL, TEST_BAUDRATE, MODE_TX, SERIAL_NOT_INVERTED);
+
+    // expect
+    EXPECT_FALSE(uartSetReceiveFrameCallback(port, testFrameCallback));
+    EXPECT_FALSE(idleInterruptEnabled);
+}
+
+TEST_F(SerialUartRxFrameTest, TestIdleLineDeliversTheFrameReceivedByInterrupt)
+{
+    // given
+    openFramePort();
+    const uint8_t data[] = { 0x20, 0x40, 0xDC, 0x05, 0xDC, 0x05 };
+    receiveByInterrupt(data, sizeof(data));
+    microsValue = 10000;
+
+    // when
+    uartRxIdleHandler(&testPort);
+
+    // then
+    EXPECT_EQ(1, frameCount);
+    EXPECT_EQ(sizeof(data), frameLength);
+    EXPECT_EQ(0, memcmp(data, frame, sizeof(data)));
+    EXPECT_EQ(10000 - TEST_CHAR_TIME, frameEndAt);
+    EXPECT_EQ(0, uartTotalRxBytesWaiting(&testPort.port));
+
+    // and the next idle line without any bytes delivers nothing
+    uartRxIdleHandler(&testPort);
+    EXPECT_EQ(1, frameCount);
+}
+
+TEST_F(SerialUartRxFrameTest, TestFrameWrappingTheReceiveBufferIsDeliveredInOrder)
+{
+    // given
+    openFramePort();
+    testPort.port.rxBufferHead = testPort.port.rxBufferTail = TEST_BUFFER_SIZE - 3;
+    const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    receiveByInterrupt(data, sizeof(data));
+
+    // when
+    uartRxIdleHandler(&testPort);
+
+    // then
+    EXPECT_EQ(1, frameCount);
+    EXPECT_EQ(sizeof(data), frameLength);
+    EXPECT_EQ(0, memcmp(data, frame, sizeof(data)));
+}
+
+TEST_F(SerialUartRxFrameTest, TestIdleLineDeliversTheFramesReceivedByDMA)
+{
+    // given
+    useRxDMA = true;
+    openFramePort();
+    EXPECT_EQ(&rxDMAChannel, testPort.rxDMAChannel);
+    EXPECT_TRUE(rxDMAChannel.CCR & 1);
+
+    // when the second frame wraps round the end of the buffer
+    uint8_t first[TEST_BUFFER_SIZE - 4];
+    for (unsigned i = 0; i < sizeof(first); i++) {
+        first[i] = i;
+    }
+    receiveByDMA(first, SERIAL_RX_FRAME_SIZE_MAX);
+    uartRxIdleHandler(&testPort);
+    receiveByDMA(first, sizeof(first) - SERIAL_RX_FRAME_SIZE_MAX);
+    uartRxIdleHandler(&testPort);
+
+    const uint8_t second[] = { 0xC8, 0x18, 0x16, 0xE0, 0x03, 0x1F, 0x58, 0xC0 };
+    receiveByDMA(second, sizeof(second));
+    microsValue = 5000;
+    uartRxIdleHandler(&testPort);
+
+    // then
+    EXPECT_EQ(3, frameCount);
+    EXPECT_EQ(sizeof(second), frameLength);
+    EXPECT_EQ(0, memcmp(second, frame, sizeof(second)));
+    EXPECT_EQ(5000 - TEST_CHAR_TIME, frameEndAt);
+    EXPECT_EQ(0, uartTotalRxBytesWaiting(&testPort.port));
+}
+
+TEST_F(SerialUartRxFrameTest, TestOverlongFrameIsDropped)
+{
+    // given
+    openFramePort();
+    uint8_t data[SERIAL_RX_FRAME_SIZE_MAX + 1];
+    memset(data, 0x55, sizeof(data));
+    receiveByInterrupt(data, sizeof(data));
+
+    // when
+    uartRxIdleHandler(&testPort);
+
+    // then
+    EXPECT_EQ(0, frameCount);
+    EXPECT_EQ(0, uartTotalRxBytesWaiting(&testPort.port));
+
+    // and the next frame is delivered on its own
+    receiveByInterrupt(data, 4);
+    uartRxIdleHandler(&testPort);
+    EXPECT_EQ(1, frameCount);
+    EXPECT_EQ(4, frameLength);
+}
+
+TEST_F(SerialUartRxFrameTest, TestIdleInterruptWithoutFrameCallbackIsDisabled)
+{
+    // given
+    uartOpen(USART1, testByteCallback, TEST_BAUDRATE, MODE_RX, SERIAL_NOT_INVERTED);
+    idleInterruptEnabled = true;
+    const uint8_t data[] = { 1, 2, 3 };
+    receiveByInterrupt(data, sizeof(data));
+
+    // when
+    uartRxIdleHandler(&testPort);
+
+    // then
+    EXPECT_FALSE(idleInterruptEnabled);
+    EXPECT_EQ(0, frameCount);
+
+    // and the bytes are left for the receive callback's reader
+    EXPECT_EQ(sizeof(data), uartTotalRxBytesWaiting(&testPort.port));
+}
+
+#define TEST_SEGMENT_COUNT_MAX (UART_TX_SEGMENT_QUEUE_SIZE - 1)
+
+static const uint8_t segmentData[TEST_SEGMENT_COUNT_MAX + 1][4] = {
+    { 0x24, 0x4D, 0x3E, 0x00 }, { 0x10, 0x11, 0x12, 0x13 }, { 0x20, 0x21, 0x22, 0x23 }, { 0x30, 0x31, 0x32, 0x33 },
+    { 0x40, 0x41, 0x42, 0x43 }, { 0x50, 0x51, 0x52, 0x53 }, { 0x60, 0x61, 0x62, 0x63 }, { 0x70, 0x71, 0x72, 0x73 },
+};
+
+static int segmentsSent[TEST_SEGMENT_COUNT_MAX + 1];
+static int segmentsSentCount;
+static serialTxSegment_t nextSegment;
+static bool queueNextSegment;
+
+static void testSegmentSent(void *context)
+{
+    segmentsSent[segmentsSentCount++] = *(const int *)context;
+
+    if (queueNextSegment) {
+        queueNextSegment = false;
+        uartWriteSegments(&testPort.port, &nextSegment, 1);
+    }
+}
+
+static const int segmentIds[TEST_SEGMENT_COUNT_MAX + 1] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+static serialTxSegment_t testSegment(int id)
+{
+    const serialTxSegment_t segment = { segmentData[id], sizeof(segmentData[id]), testSegmentSent, (void *)&segmentIds[id] };
+    return segment;
+}
+
+static bool dmaIsSending(const volatile void *data, uint32_t length)
+{
+    return (txDMAChannel.CCR & 1) && txDMAChannel.CMAR == (uint32_t)(uintptr_t)data && txDMAChannel.CNDTR == length;
+}
+
+// what the transmit DMA interrupt does once the transfer is complete
+static void completeTxDMA(void)
+{
+    EXPECT_TRUE(txDMAChannel.CCR & 1);
+    txDMAChannel.CNDTR = 0;
+    DMA_Cmd(&txDMAChannel, DISABLE);
+    uartTxDMAComplete(&testPort);
+}
+
+class SerialUartTxSegmentTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        memset(&testPort, 0, sizeof(testPort));
+        memset(&txDMAChannel, 0, sizeof(txDMAChannel));
+        memset(txBuffer, 0, sizeof(txBuffer));
+        useRxDMA = false;
+        useTxDMA = true;
+        memset(segmentsSent, 0, sizeof(segmentsSent));
+        segmentsSentCount = 0;
+        queueNextSegment = false;
+
+        port = uartOpen(USART1, NULL, TEST_BAUDRATE, MODE_TX, SERIAL_NOT_INVERTED);
+    }
+
+    serialPort_t *port;
+};
+
+TEST_F(SerialUartTxSegmentTest, TestSegmentIsSentFromTheCallersMemory)
+{
+    // given
+    const serialTxSegment_t segment = testSegment(0);
+
+    // when
+    EXPECT_TRUE(uartWriteSegments(port, &segment, 1));
+
+    // then
+    EXPECT_TRUE(dmaIsSending(segmentData[0], sizeof(segmentData[0])));
+    EXPECT_EQ(TEST_BUFFER_SIZE - 1, uartTotalTxBytesFree(port));
+    EXPECT_FALSE(isUartTransmitBufferEmpty(port));
+
+    // when
+    completeTxDMA();
+
+    // then
+    EXPECT_EQ(1, segmentsSentCount);
+    EXPECT_EQ(0, segmentsSent[0]);
+    EXPECT_FALSE(txDMAChannel.CCR & 1);
+    EXPECT_TRUE(isUartTransmitBufferEmpty(port));
+}
+
+TEST_F(SerialUartTxSegmentTest, TestSegmentIsSentAfterTheBytesWrittenBeforeIt)
+{
+    // given the DMA sending the first byte
+    uartWrite(port, 'a');
+    EXPECT_TRUE(dmaIsSending(&txBuffer[0], 1));
+
+    // when
+    uartWrite(port, 'b');
+    uartWrite(port, 'c');
+    const serialTxSegment_t segment = testSegment(1);
+    EXPECT_TRUE(uartWriteSegments(port, &segment, 1));
+    uartWrite(port, 'd');
+    uartWrite(port, 'e');
+
+    // then the transmit buffer is split where the segment was queued
+    completeTxDMA();
+    EXPECT_TRUE(dmaIsSending(&txBuffer[1], 2));
+    EXPECT_EQ(0, segmentsSentCount);
+
+    completeTxDMA();
+    EXPECT_TRUE(dmaIsSending(segmentData[1], sizeof(segmentData[1])));
+    EXPECT_EQ(0, segmentsSentCount);
+
+    completeTxDMA();
+    EXPECT_EQ(1, segmentsSentCount);
+    EXPECT_TRUE(dmaIsSending(&txBuffer[3], 2));
+    EXPECT_EQ(0, memcmp("de", &txBuffer[3], 2));
+
+    completeTxDMA();
+    EXPECT_TRUE(isUartTransmitBufferEmpty(port));
+}
+
+TEST_F(SerialUartTxSegmentTest, TestTransmitBufferWrapsBeforeTheSegment)
+{
+    // given the DMA sending the byte before the end of the transmit buffer
+    port->txBufferHead = port->txBufferTail = TEST_BUFFER_SIZE - 2;
+    uartWrite(port, 'a');
+    EXPECT_TRUE(dmaIsSending(&txBuffer[TEST_BUFFER_SIZE - 2], 1));
+
+    // when
+    uartWrite(port, 'b');
+    uartWrite(port, 'c');
+    uartWrite(port, 'd');
+    const serialTxSegment_t segment = testSegment(2);
+    EXPECT_TRUE(uartWriteSegments(port, &segment, 1));
+
+    // then
+    completeTxDMA();
+    EXPECT_TRUE(dmaIsSending(&txBuffer[TEST_BUFFER_SIZE - 1], 1));
+
+    completeTxDMA();
+    EXPECT_TRUE(dmaIsSending(&txBuffer[0], 2));
+    EXPECT_EQ(0, memcmp("cd", &txBuffer[0], 2));
+
+    completeTxDMA();
+    EXPECT_TRUE(dmaIsSending(segmentData[2], sizeof(segmentData[2])));
+    EXPECT_EQ(0, segmentsSentCount);
+
+    completeTxDMA();
+    EXPECT_EQ(1, segmentsSentCount);
+    EXPECT_TRUE(isUartTransmitBufferEmpty(port));
+}
+
+TEST_F(SerialUartTxSegmentTest, TestCallbacksAreCalledInOrderAsEachSegmentIsSent)
+{
+    // given
+    const serialTxSegment_t segments[] = { testSegment(0), testSegment(1), testSegment(2) };
+
+    // when
+    EXPECT_TRUE(uartWriteSegments(port, segments, ARRAYLEN(segments)));
+
+    // then
+    for (unsigned i = 0; i < ARRAYLEN(segments); i++) {
+        EXPECT_TRUE(dmaIsSending(segmentData[i], sizeof(segmentData[i])));
+        EXPECT_EQ((int)i, segmentsSentCount);
+
+        completeTxDMA();
+
+        EXPECT_EQ((int)i + 1, segmentsSentCount);
+        EXPECT_EQ((int)i, segmentsSent[i]);
+    }
+    EXPECT_TRUE(isUartTransmitBufferEmpty(port));
+}
+
+TEST_F(SerialUartTxSegmentTest, TestCallbackMayQueueTheNextSegment)
+{
+    // given
+    const serialTxSegment_t segment = testSegment(0);
+    nextSegment = testSegment(1);
+    queueNextSegment = true;
+    EXPECT_TRUE(uartWriteSegments(port, &segment, 1));
+
+    // when
+    completeTxDMA();
+
+    // then
+    EXPECT_EQ(1, segmentsSentCount);
+    EXPECT_TRUE(dmaIsSending(segmentData[1], sizeof(segmentData[1])));
+
+    completeTxDMA();
+    EXPECT_EQ(2, segmentsSentCount);
+    EXPECT_EQ(1, segmentsSent[1]);
+    EXPECT_TRUE(isUartTransmitBufferEmpty(port));
+}
+
+TEST_F(SerialUartTxSegmentTest, TestFullQueueIsLeftToTheCaller)
+{
+    // given
+    serialTxSegment_t segments[TEST_SEGMENT_COUNT_MAX + 1];
+    for (int i = 0; i < TEST_SEGMENT_COUNT_MAX + 1; i++) {
+        segments[i] = testSegment(i);
+    }
+
+    // expect
+    EXPECT_FALSE(uartWriteSegments(port, segments, TEST_SEGMENT_COUNT_MAX + 1));
+    EXPECT_TRUE(uartWriteSegments(port, segments, TEST_SEGMENT_COUNT_MAX));
+    EXPECT_FALSE(uartWriteSegments(port, &segments[TEST_SEGMENT_COUNT_MAX], 1));
+
+    // and once the first has been sent there is room for one more
+    completeTxDMA();
+    EXPECT_TRUE(uartWriteSegments(port, &segments[TEST_SEGMENT_COUNT_MAX], 1));
+
+    for (int i = 1; i < TEST_SEGMENT_COUNT_MAX + 1; i++) {
+        EXPECT_TRUE(dmaIsSending(segmentData[i], sizeof(segmentData[i])));
+        completeTxDMA();
+    }
+    EXPECT_EQ(TEST_SEGMENT_COUNT_MAX + 1, segmentsSentCount);
+    for (int i = 0; i < TEST_SEGMENT_COUNT_MAX + 1; i++) {
+        EXPECT_EQ(i, segmentsSent[i]);
+    }
+}
+
+TEST_F(SerialUartTxSegmentTest, TestPortWithoutTransmitDMALeavesTheSegmentsToTheCaller)
+{
+    // given
+    useTxDMA = false;
+    port = uartOpen(USART1, NULL, TEST_BAUDRATE, MODE_TX, SERIAL_NOT_INVERTED);
+    const serialTxSegment_t segment = testSegment(0);
+
+    // expect
+    EXPECT_FALSE(uartWriteSegments(port, &segment, 1));
+    EXPECT_EQ(0, segmentsSentCount);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t micros(void) { return microsValue; }
+
+uartPort_t *serialUART1(uint32_t baudRate, portMode_t mode, portOptions_t options)
+{
+    UNUSED(baudRate);
+    UNUSED(mode);
+    UNUSED(options);
+
+    testPort.port.vTable = uartVTable;
+    testPort.port.rxBuffer = rxBuffer;
+    testPort.port.rxBufferSize = TEST_BUFFER_SIZE;
+    testPort.port.txBuffer = txBuffer;
+    testPort.port.txBufferSize = TEST_BUFFER_SIZE;
+    testPort.rxDMAChannel = useRxDMA ? &rxDMAChannel : NULL;
+    testPort.txDMAChannel = useTxDMA ? &txDMAChannel : NULL;
+    testPort.USARTx = USART1;
+
+    return &testPort;
+}
+
+uartPort_t *serialUART2(uint32_t, portMode_t, portOptions_t) { return NULL; }
+uartPort_t *serialUART3(uint32_t, portMode_t, portOptions_t) { return NULL; }
+uartPort_t *serialUART4(uint32_t, portMode_t, portOptions_t) { return NULL; }
+uartPort_t *serialUART5(uint32_t, portMode_t, portOptions_t) { return NULL; }
+
+void USART_Init(USART_TypeDef *, USART_InitTypeDef *) {}
+void USART_Cmd(USART_TypeDef *, FunctionalState) {}
+void USART_HalfDuplexCmd(USART_TypeDef *, FunctionalState) {}
+void USART_DMACmd(USART_TypeDef *, uint32_t, FunctionalState) {}
+void USART_ClearITPendingBit(USART_TypeDef *, uint32_t) {}
+
+void USART_ITConfig(USART_TypeDef *, uint32_t USART_IT, FunctionalState NewState)
+{
+    if (USART_IT == USART_IT_IDLE) {
+        idleInterruptEnabled = (NewState == ENABLE);
+    }
+}
+
+void DMA_StructInit(DMA_InitTypeDef *) {}
+void DMA_ITConfig(DMA_Channel_TypeDef *, uint32_t, FunctionalState) {}
+
+void DMA_DeInit(DMA_Channel_TypeDef *DMAy_Channelx)
+{
+    memset(DMAy_Channelx, 0, sizeof(*DMAy_Channelx));
+}
+
+void DMA_Init(DMA_Channel_TypeDef *DMAy_Channelx, DMA_InitTypeDef *DMA_InitStruct)
+{
+    DMAy_Channelx->CNDTR = DMA_InitStruct->DMA_BufferSize;
+    DMAy_Channelx->CPAR = DMA_InitStruct->DMA_PeripheralBaseAddr;
+    DMAy_Channelx->CMAR = DMA_InitStruct->DMA_MemoryBaseAddr;
+}
+
+void DMA_Cmd(DMA_Channel_TypeDef *DMAy_Channelx, FunctionalState NewState)
+{
+    if (NewState == ENABLE) {
+        DMAy_Channelx->CCR |= 1;
+    } else {
+        DMAy_Channelx->CCR &= ~1;
+    }
+}
+
+void DMA_SetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx, uint16_t DataNumber)
+{
+    DMAy_Channelx->CNDTR = DataNumber;
+}
+
+uint16_t DMA_GetCurrDataCounter(DMA_Channel_TypeDef *DMAy_Channelx)
+{
+    return DMAy_Channelx->CNDTR;
+}
+
+}
@@ -24,6 +24,8 @@
 #define TELEMETRY
 #define LED_STRIP
 #define USE_SERVOS
+#define USE_DSHOT
+#define USE_IMU_EKF
 #define TRANSPONDER
 #define USE_VCP
 #define USE_UART1
@@ -0,0 +1,244 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include <platform.h>
+
+    #include "common/axis.h"
+    #include "common/maths.h"
+    #include "common/utils.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+    #include "config/feature.h"
+
+    #include "drivers/sensor.h"
+    #include "drivers/accgyro.h"
+    #include "drivers/serial.h"
+    #include "io/serial.h"
+
+    #include "fc/config.h"
+    #include "fc/rc_controls.h"
+
+    #include "sensors/sensors.h"
+    #include "sensors/acceleration.h"
+    #include "sensors/battery.h"
+
+    #include "flight/imu.h"
+
+    #include "rx/rx.h"
+    #include "rx/crsf.h"
+
+    #include "telemetry/crsf.h"
+
+    PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define CRSF_TELEMETRY_CYCLE_MS 50
+
+static uint32_t millisValue;
+static uint32_t enabledFeatures;
+static bool crsfActive;
+static uint8_t batteryPercentage;
+
+static uint8_t sentType;
+static uint8_t sentPayload[CRSF_PAYLOAD_SIZE_MAX];
+static uint8_t sentPayloadLength;
+static int sentFrameCount;
+
+static int16_t payloadValue16(int offset)
+{
+    return (int16_t)((sentPayload[offset] << 8) | sentPayload[offset + 1]);
+}
+
+// the battery and attitude frames take turns, one each cycle
+static bool sendTelemetryFrame(uint8_t type)
+{
+    for (int i = 0; i < 2; i++) {
+        millisValue += CRSF_TELEMETRY_CYCLE_MS;
+        sentFrameCount = 0;
+        handleCrsfTelemetry();
+        if (sentFrameCount == 1 && sentType == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class CrsfTelemetryTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        enabledFeatures = FEATURE_RX_SERIAL;
+        crsfActive = true;
+        memset(rxConfig(), 0, sizeof(*rxConfig()));
+        rxConfig()->serialrx_provider = SERIALRX_CRSF;
+
+        vbat = 0;
+        amperage = 0;
+        mAhDrawn = 0;
+        batteryPercentage = 0;
+        memset(&attitude, 0, sizeof(attitude));
+
+        sentFrameCount = 0;
+        sentPayloadLength = 0;
+
+        initCrsfTelemetry();
+        checkCrsfTelemetryState();
+    }
+};
+
+TEST_F(CrsfTelemetryTest, TestTelemetryOnlyRunsOnTheCrsfReceiverPort)
+{
+    // given
+    rxConfig()->serialrx_provider = SERIALRX_SBUS;
+    checkCrsfTelemetryState();
+
+    // when
+    millisValue += CRSF_TELEMETRY_CYCLE_MS;
+    handleCrsfTelemetry();
+
+    // then
+    EXPECT_EQ(0, sentFrameCount);
+
+    // given
+    rxConfig()->serialrx_provider = SERIALRX_CRSF;
+    crsfActive = false;
+    checkCrsfTelemetryState();
+
+    // when
+    millisValue += CRSF_TELEMETRY_CYCLE_MS;
+    handleCrsfTelemetry();
+
+    // then
+    EXPECT_EQ(0, sentFrameCount);
+}
+
+TEST_F(CrsfTelemetryTest, TestOneFramePerCycle)
+{
+    // given
+    millisValue += CRSF_TELEMETRY_CYCLE_MS;
+    handleCrsfTelemetry();
+    EXPECT_EQ(1, sentFrameCount);
+
+    // when
+    millisValue += CRSF_TELEMETRY_CYCLE_MS - 1;
+    handleCrsfTelemetry();
+
+    // then
+    EXPECT_EQ(1, sentFrameCount);
+
+    millisValue += 1;
+    handleCrsfTelemetry();
+    EXPECT_EQ(2, sentFrameCount);
+}
+
+TEST_F(CrsfTelemetryTest, TestBatterySensorFrame)
+{
+    // given
+    vbat = 168;                 // 16.8 V
+    amperage = 1234;            // 12.34 A
+    mAhDrawn = 0x012345;
+    batteryPercentage = 76;
+
+    // when
+    ASSERT_TRUE(sendTelemetryFrame(CRSF_FRAMETYPE_BATTERY_SENSOR));
+
+    // then
+    ASSERT_EQ(8, sentPayloadLength);
+    EXPECT_EQ(168, payloadValue16(0));
+    EXPECT_EQ(123, payloadValue16(2));
+    EXPECT_EQ(0x01, sentPayload[4]);
+    EXPECT_EQ(0x23, sentPayload[5]);
+    EXPECT_EQ(0x45, sentPayload[6]);
+    EXPECT_EQ(76, sentPayload[7]);
+}
+
+TEST_F(CrsfTelemetryTest, TestAttitudeFrame)
+{
+    // given
+    attitude.values.roll = -450;
+    attitude.values.pitch = 100;
+    attitude.values.yaw = 900;
+
+    // when
+    ASSERT_TRUE(sendTelemetryFrame(CRSF_FRAMETYPE_ATTITUDE));
+
+    // then pitch, roll and yaw in radians * 10000
+    ASSERT_EQ(6, sentPayloadLength);
+    EXPECT_EQ(1745, payloadValue16(0));
+    EXPECT_EQ(-7854, payloadValue16(2));
+    EXPECT_EQ(15708, payloadValue16(4));
+}
+
+TEST_F(CrsfTelemetryTest, TestHeadingsPastSouthAreSentAsNegativeAngles)
+{
+    const struct {
+        int16_t yaw;            // decidegrees, as kept by the IMU
+        int16_t expected;       // radians * 10000
+    } headings[] = {
+        { 0,        0 },
+        { 1800,     31416 },
+        { 1801,     -31398 },
+        { 2700,     -15708 },
+        { 3599,     -17 },
+    };
+
+    for (unsigned i = 0; i < ARRAYLEN(headings); i++) {
+        // given
+        attitude.values.yaw = headings[i].yaw;
+
+        // when
+        ASSERT_TRUE(sendTelemetryFrame(CRSF_FRAMETYPE_ATTITUDE));
+
+        // then
+        EXPECT_EQ(headings[i].expected, payloadValue16(4)) << "yaw " << headings[i].yaw;
+    }
+}
+
+// STUBS
+
+extern "C" {
+
+uint16_t vbat;
+int32_t amperage;
+int32_t mAhDrawn;
+attitudeEulerAngles_t attitude;
+
+uint32_t millis(void) { return millisValue; }
+
+bool feature(uint32_t mask) { return (enabledFeatures & mask) != 0; }
+
+uint8_t calculateBatteryPercentage(void) { return batteryPercentage; }
+
+bool crsfRxIsActive(void) { return crsfActive; }
+
+void crsfRxSendFrame(uint8_t type, const uint8_t *payload, uint8_t payloadLength)
+{
+    sentType = type;
+    memcpy(sentPayload, payload, payloadLength);
+    sentPayloadLength = payloadLength;
+    sentFrameCount++;
+}
+
+}
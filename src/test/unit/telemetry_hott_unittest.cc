@@ -180,12 +180,12 @@ uint32_t millis(void) {
 
 uint32_t micros(void) { return 0; }
 
-uint8_t serialRxBytesWaiting(serialPort_t *instance) {
+uint16_t serialRxBytesWaiting(serialPort_t *instance) {
     UNUSED(instance);
     return 0;
 }
 
-uint8_t serialTxBytesFree(serialPort_t *instance) {
+uint16_t serialTxBytesFree(serialPort_t *instance) {
     UNUSED(instance);
     return 0;
 }